@@ -0,0 +1,602 @@
+/**
+ * @file bench.c
+ * @brief Micro and end-to-end benchmarks of the Fuzzy-C kernels.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Measures the membership functions per shape, classification, inference and
+ * defuzzification on their own, and whole evaluations of the TecFanControl
+ * model and of synthetic rule bases. Every benchmark reports the time per
+ * evaluation, evaluations per second, timestamp counter cycles per evaluation
+ * (x86 only) and heap allocations per evaluation, as a table on stdout and
+ * optionally as CSV and JSON for tracking regressions.
+ *
+ * Usage: bench [--csv FILE] [--json FILE] [--time SECONDS] [FILTER]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "fuzzyc.h"
+#include "tecfan.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_CYCLES 1
+#endif
+
+#define BENCH_SAMPLES 5
+#define BENCH_INPUTS 1024
+#define BENCH_MAX_RESULTS 64
+
+// Allocation counting, the Makefile links with -Wl,--wrap=malloc and friends
+static uint64_t allocations;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *pointer, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    allocations++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    allocations++;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *pointer, size_t size) {
+    allocations++;
+    return __real_realloc(pointer, size);
+}
+
+// Runs iterations evaluations and returns a checksum of the results
+typedef FuzzyReal_t (*BenchFunction_t)(void *context, long iterations);
+
+typedef struct {
+    char group[32];
+    char name[64];
+    int rules;
+    int inputs;
+    long iterations;
+    double ns;
+    double evalsPerSecond;
+    double cycles;
+    double allocations;
+} BenchResult_t;
+
+static BenchResult_t results[BENCH_MAX_RESULTS];
+static int numResults;
+static double sampleTime = 0.05;
+static const char *filter;
+static volatile FuzzyReal_t sink;
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+static uint64_t cycles(void) {
+#ifdef BENCH_HAVE_CYCLES
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static int compareDouble(const void *a, const void *b) {
+    const double x = *(const double *)a;
+    const double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Runs a benchmark and records the median of BENCH_SAMPLES samples.
+ *
+ * The iteration count is calibrated so one sample takes about sampleTime.
+ */
+static void run(const char *group, const char *name, int rules, int inputs,
+                BenchFunction_t function, void *context) {
+    char fullName[128];
+    snprintf(fullName, sizeof(fullName), "%s/%s", group, name);
+    if ((filter != NULL && strstr(fullName, filter) == NULL) ||
+        numResults == BENCH_MAX_RESULTS) {
+        return;
+    }
+
+    // Warm up and calibrate
+    long iterations = 1;
+    for (;;) {
+        const double start = now();
+        sink = function(context, iterations);
+        const double elapsed = now() - start;
+        if (elapsed >= sampleTime / 4 || iterations >= (1L << 40)) {
+            iterations = (long)((double)iterations * sampleTime / elapsed) + 1;
+            break;
+        }
+        iterations *= 2;
+    }
+
+    double ns[BENCH_SAMPLES];
+    double tsc[BENCH_SAMPLES];
+    uint64_t allocated = 0;
+    for (int s = 0; s < BENCH_SAMPLES; s++) {
+        const uint64_t before = allocations;
+        const uint64_t startCycles = cycles();
+        const double start = now();
+        sink = function(context, iterations);
+        const double elapsed = now() - start;
+        tsc[s] = (double)(cycles() - startCycles) / (double)iterations;
+        ns[s] = elapsed * 1e9 / (double)iterations;
+        allocated += allocations - before;
+    }
+    qsort(ns, BENCH_SAMPLES, sizeof(double), compareDouble);
+    qsort(tsc, BENCH_SAMPLES, sizeof(double), compareDouble);
+
+    BenchResult_t *result = &results[numResults++];
+    snprintf(result->group, sizeof(result->group), "%s", group);
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    result->rules = rules;
+    result->inputs = inputs;
+    result->iterations = iterations;
+    result->ns = ns[BENCH_SAMPLES / 2];
+    result->evalsPerSecond = 1e9 / result->ns;
+    result->cycles = tsc[BENCH_SAMPLES / 2];
+    result->allocations =
+        (double)allocated / ((double)iterations * BENCH_SAMPLES);
+
+    printf("%-44s %10.1f ns %14.0f /s %10.1f cycles %8.3f allocs\n", fullName,
+           result->ns, result->evalsPerSecond, result->cycles,
+           result->allocations);
+    fflush(stdout);
+}
+
+// Deterministic pseudo random numbers, so runs are comparable
+static uint32_t randomState = 1;
+
+static uint32_t randomNext(void) {
+    randomState = randomState * 1103515245u + 12345u;
+    return randomState >> 8;
+}
+
+static FuzzyReal_t randomReal(FuzzyReal_t min, FuzzyReal_t max) {
+    return min + (max - min) * (FuzzyReal_t)(randomNext() % 65536) /
+                     FUZZY_REAL_C(65535.0);
+}
+
+/* ------------------------------------------------------------------------ */
+/* Kernels                                                                  */
+/* ------------------------------------------------------------------------ */
+
+typedef struct {
+    MembershipFunction_t function;
+    FuzzyReal_t xs[BENCH_INPUTS];
+    FuzzyReal_t out[BENCH_INPUTS];
+} MembershipBench_t;
+
+static FuzzyReal_t benchMembership(void *context, long iterations) {
+    MembershipBench_t *bench = (MembershipBench_t *)context;
+    FuzzyReal_t sum = 0.0;
+    for (long i = 0; i < iterations; i++) {
+        sum += membershipFunction(bench->xs[i % BENCH_INPUTS], bench->function);
+    }
+    return sum;
+}
+
+// One evaluation is one value of a batch of BENCH_INPUTS values
+static FuzzyReal_t benchMembershipBatch(void *context, long iterations) {
+    MembershipBench_t *bench = (MembershipBench_t *)context;
+    FuzzyReal_t sum = 0.0;
+    for (long i = 0; i < iterations; i += BENCH_INPUTS) {
+        membershipFunctionBatch(bench->xs, BENCH_INPUTS, bench->function,
+                                bench->out, 1);
+        sum += bench->out[i % BENCH_INPUTS];
+    }
+    return sum;
+}
+
+typedef struct {
+    FuzzySet_t *set;
+    FuzzyReal_t xs[BENCH_INPUTS];
+} ClassifierBench_t;
+
+static FuzzyReal_t benchClassifier(void *context, long iterations) {
+    ClassifierBench_t *bench = (ClassifierBench_t *)context;
+    FuzzyReal_t sum = 0.0;
+    for (long i = 0; i < iterations; i++) {
+        FuzzyClassifier(bench->xs[i % BENCH_INPUTS], bench->set);
+        sum += bench->set->membershipValues[0];
+    }
+    return sum;
+}
+
+static void benchKernels(void) {
+    static const MembershipFunction_t shapes[] = {
+        {20.0, 50.0, 80.0, 0.0, TRIANGULAR},
+        {20.0, 40.0, 60.0, 80.0, TRAPEZOIDAL},
+        {20.0, 80.0, 0.0, 0.0, RECTANGULAR},
+    };
+    static const char *shapeNames[] = {"triangular", "trapezoidal",
+                                       "rectangular"};
+
+    MembershipBench_t *membership =
+        (MembershipBench_t *)malloc(sizeof(MembershipBench_t));
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        membership->xs[i] = randomReal(0.0, 100.0);
+    }
+    for (int s = 0; s < 3; s++) {
+        membership->function = shapes[s];
+        run("membershipFunction", shapeNames[s], 0, 1, benchMembership,
+            membership);
+        run("membershipFunctionBatch", shapeNames[s], 0, 1,
+            benchMembershipBatch, membership);
+    }
+    free(membership);
+
+    // Strong partitions of 3 and 15 triangles, with and without the index
+    ClassifierBench_t *classifier =
+        (ClassifierBench_t *)malloc(sizeof(ClassifierBench_t));
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        classifier->xs[i] = randomReal(0.0, 1.0);
+    }
+    static const int lengths[] = {3, 15};
+    for (int l = 0; l < 2; l++) {
+        const int length = lengths[l];
+        MembershipFunction_t *functions = (MembershipFunction_t *)malloc(
+            length * sizeof(MembershipFunction_t));
+        const FuzzyReal_t step = FUZZY_REAL_C(1.0) / (FuzzyReal_t)(length - 1);
+        for (int k = 0; k < length; k++) {
+            const FuzzyReal_t peak = step * (FuzzyReal_t)k;
+            functions[k] = (MembershipFunction_t){peak - step, peak,
+                                                  peak + step, 0.0, TRIANGULAR};
+        }
+
+        FuzzySet_t set;
+        FuzzySetInit(&set, functions, length);
+        classifier->set = &set;
+        char name[32];
+        snprintf(name, sizeof(name), "%d terms", length);
+        run("FuzzyClassifier", name, 0, 1, benchClassifier, classifier);
+        FuzzySetEnablePartition(&set);
+        snprintf(name, sizeof(name), "%d terms partition", length);
+        run("FuzzyClassifier", name, 0, 1, benchClassifier, classifier);
+        FuzzySetFree(&set);
+        free(functions);
+    }
+    free(classifier);
+}
+
+/* ------------------------------------------------------------------------ */
+/* TecFanControl                                                            */
+/* ------------------------------------------------------------------------ */
+
+typedef struct {
+    FuzzySet_t *inputs[TECFAN_NUM_INPUTS];
+    FuzzySet_t *output;
+    FuzzyReal_t xs[BENCH_INPUTS][TECFAN_NUM_INPUTS];
+    FuzzyModel_t model;
+    FuzzyState_t state;
+} TecFanBench_t;
+
+static void tecFanClassify(TecFanBench_t *bench, long i) {
+    for (int j = 0; j < TECFAN_NUM_INPUTS; j++) {
+        FuzzyClassifier(bench->xs[i % BENCH_INPUTS][j], bench->inputs[j]);
+    }
+}
+
+static FuzzyReal_t benchTecFanInference(void *context, long iterations) {
+    TecFanBench_t *bench = (TecFanBench_t *)context;
+    FuzzyReal_t sum = 0.0;
+    tecFanClassify(bench, 0);
+    for (long i = 0; i < iterations; i++) {
+        fuzzyInference(tecFanRules(), tecFanNumRules);
+        sum += bench->output->membershipValues[0];
+    }
+    return sum;
+}
+
+static FuzzyReal_t benchTecFanDefuzzification(void *context, long iterations) {
+    TecFanBench_t *bench = (TecFanBench_t *)context;
+    FuzzyReal_t sum = 0.0;
+    tecFanClassify(bench, 0);
+    fuzzyInference(tecFanRules(), tecFanNumRules);
+    for (long i = 0; i < iterations; i++) {
+        sum += defuzzification(bench->output);
+    }
+    return sum;
+}
+
+static FuzzyReal_t benchTecFanArea(void *context, long iterations) {
+    TecFanBench_t *bench = (TecFanBench_t *)context;
+    FuzzyReal_t sum = 0.0;
+    tecFanClassify(bench, 0);
+    fuzzyInference(tecFanRules(), tecFanNumRules);
+    for (long i = 0; i < iterations; i++) {
+        sum += defuzzificationArea(bench->output,
+                                   bench->output->membershipValues);
+    }
+    return sum;
+}
+
+// Classify, infer and defuzzify through the set based API of the example
+static FuzzyReal_t benchTecFanPipeline(void *context, long iterations) {
+    TecFanBench_t *bench = (TecFanBench_t *)context;
+    FuzzyReal_t sum = 0.0;
+    for (long i = 0; i < iterations; i++) {
+        tecFanClassify(bench, i);
+        fuzzyInference(tecFanRules(), tecFanNumRules);
+        sum += defuzzification(bench->output);
+    }
+    return sum;
+}
+
+static FuzzyReal_t benchTecFanModel(void *context, long iterations) {
+    TecFanBench_t *bench = (TecFanBench_t *)context;
+    FuzzyReal_t sum = 0.0;
+    for (long i = 0; i < iterations; i++) {
+        FuzzyReal_t output;
+        FuzzyEvaluate(&bench->model, &bench->state, bench->xs[i % BENCH_INPUTS],
+                      &output);
+        sum += output;
+    }
+    return sum;
+}
+
+static void benchTecFan(void) {
+    static const FuzzyReal_t ranges[TECFAN_NUM_INPUTS][2] = {
+        {-20.0, 60.0}, {-5.0, 5.0}, {-5.0, 50.0}, {0.0, 100.0}};
+
+    TecFanBench_t *bench = (TecFanBench_t *)malloc(sizeof(TecFanBench_t));
+    tecFanInit();
+    tecFanSets(bench->inputs, &bench->output);
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        for (int j = 0; j < TECFAN_NUM_INPUTS; j++) {
+            bench->xs[i][j] = randomReal(ranges[j][0], ranges[j][1]);
+        }
+    }
+
+    const FuzzySet_t *inputs[TECFAN_NUM_INPUTS];
+    for (int j = 0; j < TECFAN_NUM_INPUTS; j++) {
+        inputs[j] = bench->inputs[j];
+    }
+    const FuzzySet_t *outputs[] = {bench->output};
+    FuzzyModelInit(&bench->model, tecFanRules(), tecFanNumRules, inputs,
+                   TECFAN_NUM_INPUTS, outputs, 1);
+    FuzzyStateInit(&bench->state, &bench->model);
+
+    const int rules = tecFanNumRules;
+    run("TecFanControl", "fuzzyInference", rules, TECFAN_NUM_INPUTS,
+        benchTecFanInference, bench);
+    run("TecFanControl", "defuzzification", rules, TECFAN_NUM_INPUTS,
+        benchTecFanDefuzzification, bench);
+    run("TecFanControl", "defuzzificationArea", rules, TECFAN_NUM_INPUTS,
+        benchTecFanArea, bench);
+    run("TecFanControl", "pipeline", rules, TECFAN_NUM_INPUTS,
+        benchTecFanPipeline, bench);
+    run("TecFanControl", "FuzzyEvaluate", rules, TECFAN_NUM_INPUTS,
+        benchTecFanModel, bench);
+
+    FuzzyStateFree(&bench->state);
+    FuzzyModelFree(&bench->model);
+    tecFanFree();
+    free(bench);
+}
+
+/* ------------------------------------------------------------------------ */
+/* Synthetic rule bases                                                     */
+/* ------------------------------------------------------------------------ */
+
+#define SYNTHETIC_TERMS 5
+#define SYNTHETIC_MAX_INPUTS 16
+
+typedef struct {
+    int numInputs;
+    FuzzySet_t sets[SYNTHETIC_MAX_INPUTS + 1];
+    FuzzyRule_t *rules;
+    int numRules;
+    FuzzyReal_t *xs;
+    FuzzyModel_t model;
+    FuzzyState_t state;
+} SyntheticBench_t;
+
+static FuzzyReal_t benchSynthetic(void *context, long iterations) {
+    SyntheticBench_t *bench = (SyntheticBench_t *)context;
+    FuzzyReal_t sum = 0.0;
+    for (long i = 0; i < iterations; i++) {
+        FuzzyReal_t output;
+        FuzzyEvaluate(&bench->model, &bench->state,
+                      &bench->xs[(i % BENCH_INPUTS) * bench->numInputs],
+                      &output);
+        sum += output;
+    }
+    return sum;
+}
+
+/**
+ * Builds a rule base of numRules random rules over numInputs inputs with
+ * SYNTHETIC_TERMS triangles each. Every rule is a conjunction of up to three
+ * distinct inputs, with the occasional negation.
+ */
+static void syntheticInit(SyntheticBench_t *bench, int numRules,
+                          int numInputs) {
+    MembershipFunction_t functions[SYNTHETIC_TERMS];
+    const FuzzyReal_t step =
+        FUZZY_REAL_C(1.0) / (FuzzyReal_t)(SYNTHETIC_TERMS - 1);
+    for (int k = 0; k < SYNTHETIC_TERMS; k++) {
+        const FuzzyReal_t peak = step * (FuzzyReal_t)k;
+        functions[k] = (MembershipFunction_t){peak - step, peak, peak + step,
+                                              0.0, TRIANGULAR};
+    }
+
+    bench->numInputs = numInputs;
+    bench->numRules = numRules;
+    for (int i = 0; i <= numInputs; i++) {
+        FuzzySetInit(&bench->sets[i], functions, SYNTHETIC_TERMS);
+    }
+
+    bench->rules = (FuzzyRule_t *)calloc(numRules, sizeof(FuzzyRule_t));
+    for (int r = 0; r < numRules; r++) {
+        const int count = 1 + (int)(randomNext() % 3);
+        const int numVariables = count < numInputs ? count : numInputs;
+        FuzzyVariable_t *variables =
+            (FuzzyVariable_t *)calloc(numVariables, sizeof(FuzzyVariable_t));
+        const int first = (int)(randomNext() % numInputs);
+        for (int v = 0; v < numVariables; v++) {
+            variables[v].variable = &bench->sets[(first + v) % numInputs];
+            variables[v].value = (int)(randomNext() % SYNTHETIC_TERMS);
+            variables[v].invert = randomNext() % 8 == 0;
+        }
+
+        FuzzyAntecedent_t *antecedent =
+            (FuzzyAntecedent_t *)calloc(1, sizeof(FuzzyAntecedent_t));
+        antecedent->variables = variables;
+        antecedent->num_variables = numVariables;
+        antecedent->fuzzy_operator = FUZZY_ALL_OF;
+        bench->rules[r].antecedent = antecedent;
+        bench->rules[r].num_antecedents = 1;
+        bench->rules[r].consequent =
+            (FuzzyVariable_t){.variable = &bench->sets[numInputs],
+                              .value = (int)(randomNext() % SYNTHETIC_TERMS)};
+    }
+
+    bench->xs =
+        (FuzzyReal_t *)malloc(BENCH_INPUTS * numInputs * sizeof(FuzzyReal_t));
+    for (int i = 0; i < BENCH_INPUTS * numInputs; i++) {
+        bench->xs[i] = randomReal(0.0, 1.0);
+    }
+
+    const FuzzySet_t *inputs[SYNTHETIC_MAX_INPUTS];
+    for (int i = 0; i < numInputs; i++) {
+        inputs[i] = &bench->sets[i];
+    }
+    const FuzzySet_t *outputs[] = {&bench->sets[numInputs]};
+    FuzzyModelInit(&bench->model, bench->rules, numRules, inputs, numInputs,
+                   outputs, 1);
+    FuzzyStateInit(&bench->state, &bench->model);
+}
+
+static void syntheticFree(SyntheticBench_t *bench) {
+    FuzzyStateFree(&bench->state);
+    FuzzyModelFree(&bench->model);
+    for (int r = 0; r < bench->numRules; r++) {
+        free(bench->rules[r].antecedent->variables);
+        free(bench->rules[r].antecedent);
+    }
+    free(bench->rules);
+    free(bench->xs);
+    for (int i = 0; i <= bench->numInputs; i++) {
+        FuzzySetFree(&bench->sets[i]);
+    }
+}
+
+static void benchSyntheticBases(void) {
+    static const int numRules[] = {10, 100, 1000};
+    static const int numInputs[] = {2, 4, 8, 16};
+
+    for (int r = 0; r < 3; r++) {
+        for (int i = 0; i < 4; i++) {
+            SyntheticBench_t bench;
+            char name[64];
+            snprintf(name, sizeof(name), "%d rules %d inputs", numRules[r],
+                     numInputs[i]);
+            syntheticInit(&bench, numRules[r], numInputs[i]);
+            run("synthetic", name, numRules[r], numInputs[i], benchSynthetic,
+                &bench);
+            syntheticFree(&bench);
+        }
+    }
+}
+
+/* ------------------------------------------------------------------------ */
+/* Reports                                                                  */
+/* ------------------------------------------------------------------------ */
+
+static void writeCsv(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        perror(path);
+        return;
+    }
+    fprintf(file, "group,name,rules,inputs,iterations,ns_per_eval,"
+                  "evals_per_sec,cycles_per_eval,allocs_per_eval\n");
+    for (int i = 0; i < numResults; i++) {
+        const BenchResult_t *r = &results[i];
+        fprintf(file, "%s,%s,%d,%d,%ld,%.3f,%.0f,%.3f,%.6f\n", r->group,
+                r->name, r->rules, r->inputs, r->iterations, r->ns,
+                r->evalsPerSecond, r->cycles, r->allocations);
+    }
+    fclose(file);
+}
+
+static void writeJson(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        perror(path);
+        return;
+    }
+    fprintf(file, "{\n  \"real\": \"%s\",\n  \"cycles\": %s,\n",
+            sizeof(FuzzyReal_t) == sizeof(float) ? "float" : "double",
+#ifdef BENCH_HAVE_CYCLES
+            "\"tsc\""
+#else
+            "null"
+#endif
+    );
+    fprintf(file, "  \"results\": [\n");
+    for (int i = 0; i < numResults; i++) {
+        const BenchResult_t *r = &results[i];
+        fprintf(file,
+                "    {\"group\": \"%s\", \"name\": \"%s\", \"rules\": %d, "
+                "\"inputs\": %d, \"iterations\": %ld, \"ns_per_eval\": %.3f, "
+                "\"evals_per_sec\": %.0f, \"cycles_per_eval\": %.3f, "
+                "\"allocs_per_eval\": %.6f}%s\n",
+                r->group, r->name, r->rules, r->inputs, r->iterations, r->ns,
+                r->evalsPerSecond, r->cycles, r->allocations,
+                i + 1 < numResults ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+}
+
+int main(int argc, char *argv[]) {
+    const char *csv = NULL;
+    const char *json = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            csv = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json = argv[++i];
+        } else if (strcmp(argv[i], "--time") == 0 && i + 1 < argc) {
+            sampleTime = atof(argv[++i]) / BENCH_SAMPLES;
+        } else if (argv[i][0] != '-') {
+            filter = argv[i];
+        } else {
+            printf("Usage: %s [--csv FILE] [--json FILE] [--time SECONDS] "
+                   "[FILTER]\n",
+                   argv[0]);
+            return 1;
+        }
+    }
+
+    benchKernels();
+    benchTecFan();
+    benchSyntheticBases();
+
+    if (csv != NULL) {
+        writeCsv(csv);
+    }
+    if (json != NULL) {
+        writeJson(json);
+    }
+    return 0;
+}
@@ -0,0 +1,33 @@
+/**
+ * @file tecfan.c
+ * @brief The TecFanControl example model, exported for the benchmarks.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+// Reuse the sets and rules of the example as they are, without its main
+#define main tecFanMain
+#include "../example/TecFanControl.c"
+#undef main
+
+#include "tecfan.h"
+
+const int tecFanNumRules = FUZZY_LENGTH(rules);
+
+FuzzyRule_t *tecFanRules(void) { return rules; }
+
+void tecFanSets(FuzzySet_t **inputs, FuzzySet_t **output) {
+    inputs[0] = &TemperatureState;
+    inputs[1] = &TempChangeState;
+    inputs[2] = &TECPowerState;
+    inputs[3] = &FanState;
+    *output = &FanSpeed;
+}
+
+void tecFanInit(void) { createClassifiers(); }
+
+void tecFanFree(void) { destroyClassifiers(); }
@@ -0,0 +1,27 @@
+/**
+ * @file tecfan.h
+ * @brief The TecFanControl example model, exported for the benchmarks.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#ifndef FUZZY_BENCH_TECFAN_H
+#define FUZZY_BENCH_TECFAN_H
+#pragma once
+
+#include "fuzzyc.h"
+
+#define TECFAN_NUM_INPUTS 4
+
+extern const int tecFanNumRules;
+
+FuzzyRule_t *tecFanRules(void);
+void tecFanSets(FuzzySet_t **inputs, FuzzySet_t **output);
+void tecFanInit(void);
+void tecFanFree(void);
+
+#endif
@@ -29,6 +29,7 @@
 #include "fuzzyc.h"
 
 #include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -162,6 +163,27 @@ void destroyClassifiers() {
     FuzzySetFree(&FanSpeed);
 }
 
+static FuzzyModel_t model;
+static pthread_once_t modelOnce = PTHREAD_ONCE_INIT;
+
+static void initModel(void) {
+    createClassifiers();
+    const FuzzySet_t *inputs[] = {&TemperatureState, &TempChangeState,
+                                  &TECPowerState, &FanState};
+    const FuzzySet_t *outputs[] = {&FanSpeed};
+    FuzzyModelInit(&model, rules, FUZZY_LENGTH(rules), inputs,
+                   FUZZY_LENGTH(inputs), outputs, FUZZY_LENGTH(outputs));
+}
+
+// Builds a model of the rules once, so the controller can also be evaluated
+// through the model API, e.g. by FuzzySweep() from the Python binding (see
+// fuzzyc.py and plot.py). Concurrent first calls, e.g. from several threads
+// starting sweeps, build it only once.
+const FuzzyModel_t *TecFanModel(void) {
+    pthread_once(&modelOnce, initModel);
+    return &model;
+}
+
 // Helper function to map a value from one range to another
 double map_range(double value, double in_min, double in_max, double out_min,
                  double out_max) {
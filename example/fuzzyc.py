@@ -0,0 +1,61 @@
+"""Thin ctypes binding of the Fuzzy-C sweep API.
+
+Loads a shared library built from the engine and a model (see the `shared`
+target of the Makefile) and evaluates the model over grids of inputs with
+FuzzySweep(), straight into a NumPy array. The library must be built with the
+default FuzzyReal_t of double.
+"""
+
+import ctypes
+
+import numpy as np
+
+
+class FuzzyGridAxis(ctypes.Structure):
+    """One axis of a sweep grid, see FuzzyGridAxis_t in batch.h."""
+
+    _fields_ = [
+        ("min", ctypes.c_double),
+        ("max", ctypes.c_double),
+        ("points", ctypes.c_int),
+    ]
+
+
+class Library:
+    """A shared library exporting the engine and model builder functions."""
+
+    def __init__(self, path):
+        self.lib = ctypes.CDLL(path)
+        self.lib.FuzzySweep.argtypes = [
+            ctypes.c_void_p,
+            ctypes.POINTER(FuzzyGridAxis),
+            ctypes.POINTER(ctypes.c_double),
+            ctypes.c_int,
+        ]
+        self.lib.FuzzySweep.restype = ctypes.c_bool
+
+    def model(self, name):
+        """Calls the exported function `name` returning a FuzzyModel_t *."""
+        function = getattr(self.lib, name)
+        function.argtypes = []
+        function.restype = ctypes.c_void_p
+        return function()
+
+    def sweep(self, model, axes, num_outputs=1, threads=0):
+        """Evaluates a model over the Cartesian grid of axes.
+
+        axes holds one (min, max, points) tuple per input of the model, a
+        single point holds the input at min. Returns an array of shape
+        (points_0, ..., points_n, num_outputs). threads of 0 uses one thread
+        per processor.
+        """
+        grid = (FuzzyGridAxis * len(axes))(
+            *[FuzzyGridAxis(lo, hi, points) for lo, hi, points in axes])
+        shape = tuple(points for _, _, points in axes) + (num_outputs,)
+        outputs = np.empty(shape, dtype=np.float64)
+        if not self.lib.FuzzySweep(
+                model, grid,
+                outputs.ctypes.data_as(ctypes.POINTER(ctypes.c_double)),
+                threads):
+            raise MemoryError("FuzzySweep() could not allocate its scratch space")
+        return outputs
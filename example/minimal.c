@@ -48,6 +48,10 @@ DEFINE_FUZZY_MEMBERSHIP(InputMembershipFunctions)
     X(OUTPUT_HIGH, 50.0, 70.0, 100.0, 100.0, TRAPEZOIDAL)
 DEFINE_FUZZY_MEMBERSHIP(OutputMembershipFunctions)
 
+// Define static storage for the membership values, so no heap is needed
+FUZZY_SET_STORAGE(InputValues, InputMembershipFunctions);
+FUZZY_SET_STORAGE(OutputValues, OutputMembershipFunctions);
+
 // Define the fuzzy rules
 FuzzyRule_t rules[] = {
     // If the input is low, then the output is high
@@ -72,11 +76,11 @@ int main(int argc, char *argv[]) {
         input_x = atof(argv[1]);
     }
 
-    // Initialize the fuzzy sets
-    FuzzySetInit(&Input, InputMembershipFunctions,
-                 FUZZY_LENGTH(InputMembershipFunctions));
-    FuzzySetInit(&Output, OutputMembershipFunctions,
-                 FUZZY_LENGTH(OutputMembershipFunctions));
+    // Initialize the fuzzy sets on their static storage
+    FuzzySetInitBuffer(&Input, InputMembershipFunctions,
+                       FUZZY_LENGTH(InputMembershipFunctions), InputValues);
+    FuzzySetInitBuffer(&Output, OutputMembershipFunctions,
+                       FUZZY_LENGTH(OutputMembershipFunctions), OutputValues);
 
     // Classify the input into a fuzzy state
     FuzzyClassifier(input_x, &Input);
@@ -1,7 +1,8 @@
-import subprocess
 import numpy as np
 import matplotlib.pyplot as plt
 
+from fuzzyc import Library
+
 RESOLUTION = 50
 # Define the ranges for the input parameters
 TEMPERATURE_RANGE = np.linspace(10, 45, RESOLUTION)
@@ -9,6 +10,10 @@ TEMPERATURE_CHANGE_RANGE = np.linspace(-1, 1, RESOLUTION)
 TEC_POWER_RANGE = np.linspace(0, 45, RESOLUTION)
 FAN_RANGE = np.linspace(0, 100, RESOLUTION)
 
+# Load the engine and the TecFanControl model, build it with `make shared`
+library = Library('./out/libTecFanControl.so')
+model = library.model('TecFanModel')
+
 # Create a figure with a 3D subplot
 fig = plt.figure(figsize=(10, 8))
 ax = fig.add_subplot(111, projection='3d')
@@ -16,32 +21,19 @@ ax = fig.add_subplot(111, projection='3d')
 # Define the fixed parameters for the plot
 fixed_params = (0, 50)
 
-# Calculate the total number of iterations
-total_iterations = len(TEMPERATURE_RANGE) * len(TEC_POWER_RANGE)
-
-# Initialize a counter for the current iteration
-current_iteration = 0
-
-# Loop over the parameters and plot the results
-results = np.zeros((len(TEMPERATURE_RANGE), len(TEC_POWER_RANGE)))
-for i, temperature in enumerate(TEMPERATURE_RANGE):
-    for j, TEC_power in enumerate(TEC_POWER_RANGE):
-        # Print the current progress
-        current_iteration += 1
-        progress = (current_iteration / total_iterations) * 100
-        print(f"Progress: {progress:.2f}% ({current_iteration}/{total_iterations}) - Temperature: {temperature}, TEC Power: {TEC_power}", end='\r')
-
-        # Call the program with the current parameter values and fixed values for the other parameters
-        output = subprocess.check_output(['./out/TecFanControl.out', str(temperature), str(fixed_params[0]), str(TEC_power), str(fixed_params[1])])
-        # Decode the output and split it into lines
-        lines = output.decode().strip().split('\n')
-        # Extract the fan speed value from the last line
-        fan_speed = float(lines[-1].split(': ')[1].strip('%'))
-        # Append the result to the array
-        results[i, j] = fan_speed
-
-# Print a final message
-print("\nProgress: 100.00% - Completed")
+# Evaluate the whole grid in one call, the fixed parameters are axes of a
+# single point
+axes = [
+    (TEMPERATURE_RANGE[0], TEMPERATURE_RANGE[-1], len(TEMPERATURE_RANGE)),
+    (fixed_params[0], fixed_params[0], 1),
+    (TEC_POWER_RANGE[0], TEC_POWER_RANGE[-1], len(TEC_POWER_RANGE)),
+    (fixed_params[1], fixed_params[1], 1),
+]
+results = library.sweep(model, axes)[:, 0, :, 0, 0]
+
+# Map the fan speed like TecFanControl does, the extreme points (0, 100)
+# can't be reached due to the centroid calculation
+results = np.clip((results - 10.0) * 100.0 / 70.0, 0.0, 100.0)
 
 # Plot the results
 X, Y = np.meshgrid(TEC_POWER_RANGE, TEMPERATURE_RANGE)
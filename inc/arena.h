@@ -0,0 +1,31 @@
+/**
+ * @file arena.h
+ * @brief Fuzzy Logic bump allocator header.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#ifndef FUZZY_ARENA_H
+#define FUZZY_ARENA_H
+#pragma once
+
+#include <stddef.h>
+
+// A bump allocator on a caller provided buffer. Allocations are never freed
+// individually, the whole arena is released by FuzzyArenaReset() or by
+// discarding the buffer.
+typedef struct {
+    unsigned char *buffer;
+    size_t size;
+    size_t used;
+} FuzzyArena_t;
+
+void FuzzyArenaInit(FuzzyArena_t *arena, void *buffer, size_t size);
+void *FuzzyArenaAlloc(FuzzyArena_t *arena, size_t size);
+void FuzzyArenaReset(FuzzyArena_t *arena);
+
+#endif
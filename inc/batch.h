@@ -0,0 +1,37 @@
+/**
+ * @file batch.h
+ * @brief Fuzzy Logic multi-threaded batch evaluation header.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#ifndef FUZZY_BATCH_H
+#define FUZZY_BATCH_H
+#pragma once
+
+#include "model.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// One input axis of a grid: points evenly spaced samples from min to max
+typedef struct {
+    FuzzyReal_t min;
+    FuzzyReal_t max;
+    int points;
+} FuzzyGridAxis_t;
+
+void FuzzyEvaluateBatch(const FuzzyModel_t *model, const FuzzyReal_t *inputs,
+                        FuzzyReal_t *outputs, size_t count, int threads);
+bool FuzzySweep(const FuzzyModel_t *model, const FuzzyGridAxis_t *axes,
+                FuzzyReal_t *outputs, int threads);
+size_t FuzzySweepCount(const FuzzyModel_t *model,
+                       const FuzzyGridAxis_t *axes);
+void FuzzyGridPoint(const FuzzyGridAxis_t *axes, int numAxes, size_t index,
+                    FuzzyReal_t *inputs);
+
+#endif
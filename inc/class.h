@@ -13,19 +13,87 @@
 #define FUZZY_CLASS_H
 #pragma once
 
+#include "arena.h"
 #include "membership_function.h"
+#include "memo.h"
+
+#include <stdbool.h>
+
+// Sorted breakpoint index of the membership functions of a set, see
+// FuzzySetEnablePartition(). The sorted support bounds split the universe into
+// regions: region 2k + 1 is the breakpoint k itself and region 2k the open
+// interval in front of it.
+typedef struct {
+    // sorted, distinct support bounds of the membership functions
+    FuzzyReal_t *breakpoints;
+    int numBreakpoints;
+    // region r may be non-zero in the functions
+    // regionFunctions[regionStarts[r]] .. regionFunctions[regionStarts[r + 1]]
+    int *regionStarts;
+    int *regionFunctions;
+    // roughly evenly spaced breakpoints are found by direct indexing, bucket b
+    // of width 1 / inverseStep starts at breakpoint buckets[b]
+    bool uniform;
+    FuzzyReal_t origin;
+    FuzzyReal_t inverseStep;
+    int *buckets;
+    int numBuckets;
+} FuzzyPartition_t;
 
 typedef struct {
-    double *membershipValues;
-    MembershipFunction_t *membershipFunctions;
+    FuzzyReal_t *membershipValues;
+    const MembershipFunction_t *membershipFunctions;
     int length;
+    // true if the set allocated its storage and FuzzySetFree() releases it
+    bool ownsStorage;
+    // optional breakpoint index used by the classifier, NULL if disabled
+    FuzzyPartition_t *partition;
+    // optional cache of FuzzyClassifier() results, NULL if disabled
+    FuzzyMemo_t *memo;
+    // optional struct-of-arrays copy of the membership functions used by the
+    // classifier, NULL if disabled
+    MembershipLayout_t *layout;
 } FuzzySet_t;
 
+// Declares static storage for the membership values of a set with the given
+// membership function list (see DEFINE_FUZZY_MEMBERSHIP), sized at compile
+// time:
+// > FUZZY_SET_STORAGE(InputValues, InputMembershipFunctions);
+// > FuzzySetInitBuffer(&Input, InputMembershipFunctions,
+// >                    FUZZY_LENGTH(InputMembershipFunctions), InputValues);
+#define FUZZY_SET_STORAGE(name, membershipFunctions)                           \
+    static FuzzyReal_t name[sizeof(membershipFunctions) /                      \
+                       sizeof(membershipFunctions[0])]
+
+// The number of bytes FuzzySetInitArena() takes from an arena for a set of
+// the given length, including worst case alignment padding. Builds with
+// FUZZY_DIVISION_FREE add the layout of the set.
+#ifdef FUZZY_DIVISION_FREE
+#define FUZZY_SET_ARENA_SIZE(length)                                           \
+    ((length) * sizeof(FuzzyReal_t) + sizeof(MembershipLayout_t) +            \
+     FUZZY_LAYOUT_SIZE(length) + 3 * _Alignof(max_align_t))
+#else
+#define FUZZY_SET_ARENA_SIZE(length)                                           \
+    ((length) * sizeof(FuzzyReal_t) + _Alignof(max_align_t))
+#endif
+
 void FuzzySetInit(FuzzySet_t *set,
                   const MembershipFunction_t *membershipFunctions, int length);
+void FuzzySetInitBuffer(FuzzySet_t *set,
+                        const MembershipFunction_t *membershipFunctions,
+                        int length, FuzzyReal_t *values);
+bool FuzzySetInitArena(FuzzySet_t *set,
+                       const MembershipFunction_t *membershipFunctions,
+                       int length, FuzzyArena_t *arena);
 void FuzzySetFree(FuzzySet_t *set);
 
+bool FuzzySetEnablePartition(FuzzySet_t *set);
+int FuzzyPartitionRegion(const FuzzyPartition_t *partition, FuzzyReal_t x);
+bool FuzzySetEnableMemo(FuzzySet_t *set, int numEntries);
+bool FuzzySetEnableLayout(FuzzySet_t *set);
+
 void normalizeClass(FuzzySet_t *set);
+void normalizeMembershipValues(FuzzyReal_t *values, int length);
 
 void printClassifier(FuzzySet_t *set, const char **labels);
 
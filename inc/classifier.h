@@ -15,6 +15,14 @@
 
 #include "class.h"
 
-void FuzzyClassifier(double x, FuzzySet_t *set);
+#include <stddef.h>
+
+void FuzzyClassifier(FuzzyReal_t x, FuzzySet_t *set);
+void FuzzyClassifierValues(FuzzyReal_t x, const FuzzySet_t *set,
+                           FuzzyReal_t *values);
+int FuzzyClassifierSparse(FuzzyReal_t x, const FuzzySet_t *set, int *indices,
+                          FuzzyReal_t *values);
+void FuzzyClassifierBatch(const FuzzyReal_t *xs, size_t n,
+                          const FuzzySet_t *set, FuzzyReal_t *out);
 
 #endif
@@ -0,0 +1,70 @@
+/**
+ * @file cost.h
+ * @brief Fuzzy Logic static cost analysis header.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#ifndef FUZZY_COST_H
+#define FUZZY_COST_H
+#pragma once
+
+#include "model.h"
+
+#include <stdint.h>
+
+// The primitive operations counted by FuzzyModelCost()
+typedef enum {
+    // additions, subtractions and negations
+    FUZZY_COST_ADD,
+    FUZZY_COST_MUL,
+    FUZZY_COST_DIV,
+    // comparisons, selects, min and max
+    FUZZY_COST_COMPARE,
+    FUZZY_COST_LOAD,
+    FUZZY_COST_STORE,
+    // loop back edges, calls and dispatches
+    FUZZY_COST_BRANCH,
+    // calls of log(), sqrt() and erfc()
+    FUZZY_COST_MATH,
+    FUZZY_NUM_COSTS
+} FuzzyCostPrimitive_e;
+
+// The stages of an evaluation
+typedef enum {
+    FUZZY_COST_CLASSIFY,
+    FUZZY_COST_INFERENCE,
+    FUZZY_COST_DEFUZZIFY,
+    FUZZY_NUM_COST_STAGES
+} FuzzyCostStage_e;
+
+// Cycles per primitive of a simple in-order core with a pipelined FPU, in the
+// order of FuzzyCostPrimitive_e
+#define FUZZY_COST_DEFAULT_CYCLES {1, 1, 14, 1, 2, 1, 3, 60}
+
+// The work of one FuzzyEvaluate() call of a model
+typedef struct {
+    // membership functions evaluated, by MembershipFunctionType_e
+    uint32_t functions[FUZZY_NUM_MEMBERSHIP_TYPES];
+    // program operations executed, by FuzzyOpCode_e
+    uint32_t ops[FUZZY_NUM_OP_CODES];
+    // membership values reset and normalized by the program
+    uint32_t normalized;
+    // membership values read by the defuzzifiers
+    uint32_t defuzzified;
+    // primitive operations of every stage, by FuzzyCostPrimitive_e
+    uint64_t primitives[FUZZY_NUM_COST_STAGES][FUZZY_NUM_COSTS];
+} FuzzyCost_t;
+
+void FuzzyModelCost(const FuzzyModel_t *model, FuzzyCost_t *cost);
+uint64_t FuzzyCostStageCycles(const FuzzyCost_t *cost, FuzzyCostStage_e stage,
+                              const uint32_t *cycles);
+uint64_t FuzzyCostCycles(const FuzzyCost_t *cost, const uint32_t *cycles);
+int FuzzyCostPrimitive(const char *name);
+void FuzzyCostPrint(const FuzzyCost_t *cost, const uint32_t *cycles);
+
+#endif
@@ -16,6 +16,55 @@
 #include "class.h"
 #include "classifier.h"
 
-double defuzzification(FuzzySet_t *set);
+#include <stdbool.h>
+
+// Defuzzification methods
+typedef enum {
+    // weighted average of the fixed centroids of the membership functions,
+    // see defuzzification()
+    FUZZY_DEFUZZIFY_WEIGHTED_CENTROIDS,
+    // closed form center of sums of the clipped membership functions, see
+    // defuzzificationArea(): overlapping shapes are added, not max-aggregated
+    // as by FUZZY_DEFUZZIFY_CENTROID
+    FUZZY_DEFUZZIFY_AREA,
+    // the following methods need a sampled universe, see FuzzyUniverse_t, and
+    // are only available through defuzzificationUniverse(); a model can not
+    // select them, FuzzyModelDefuzzify() treats them as
+    // FUZZY_DEFUZZIFY_WEIGHTED_CENTROIDS
+    FUZZY_DEFUZZIFY_CENTROID,
+    FUZZY_DEFUZZIFY_BISECTOR,
+    FUZZY_DEFUZZIFY_MEAN_OF_MAX,
+    // weighted average of singletons at the parameters a of the membership
+    // functions, see defuzzificationSingletons()
+    FUZZY_DEFUZZIFY_SINGLETONS,
+} FuzzyDefuzzifyMethod_e;
+
+// A sampled universe of discourse of a set, with the membership degrees of
+// every membership function precomputed at every sample point
+typedef struct {
+    const FuzzySet_t *set;
+    FuzzyReal_t min;
+    FuzzyReal_t max;
+    int resolution;
+    // resolution x set->length membership degrees
+    FuzzyReal_t *table;
+} FuzzyUniverse_t;
+
+FuzzyReal_t calculateCentroid(MembershipFunction_t function,
+                              FuzzyReal_t membership);
+FuzzyReal_t defuzzification(FuzzySet_t *set);
+FuzzyReal_t defuzzificationValues(const FuzzySet_t *set,
+                                  const FuzzyReal_t *values);
+FuzzyReal_t defuzzificationArea(const FuzzySet_t *set,
+                                const FuzzyReal_t *values);
+FuzzyReal_t defuzzificationSingletons(const FuzzySet_t *set,
+                                      const FuzzyReal_t *values);
+
+bool FuzzyUniverseInit(FuzzyUniverse_t *universe, const FuzzySet_t *set,
+                       FuzzyReal_t min, FuzzyReal_t max, int resolution);
+void FuzzyUniverseFree(FuzzyUniverse_t *universe);
+FuzzyReal_t defuzzificationUniverse(const FuzzyUniverse_t *universe,
+                                    const FuzzyReal_t *values,
+                                    FuzzyDefuzzifyMethod_e method);
 
 #endif
@@ -0,0 +1,149 @@
+/**
+ * @file fixed_point.h
+ * @brief Fuzzy Logic fixed point (Q15/Q31) header.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#ifndef FUZZY_FIXED_POINT_H
+#define FUZZY_FIXED_POINT_H
+#pragma once
+
+#include "membership_function.h"
+#include "program.h"
+#include "real.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Fixed point backends for targets without an FPU. Crisp values are mapped
+// from a universe [min, max] onto [-1, 1) and membership degrees are stored in
+// [0, 1]. Evaluation uses only integer additions, multiplications and shifts,
+// the preparation functions taking FuzzyReal_t run once at startup (or on the
+// host).
+typedef int16_t FuzzyQ15_t;
+typedef int32_t FuzzyQ31_t;
+
+#define FUZZY_Q15_ONE INT16_MAX
+#define FUZZY_Q31_ONE INT32_MAX
+
+// A membership function with its breakpoints converted to Q15 and its slopes
+// converted to multipliers, degree = ((x - a) * rise) >> riseShift
+typedef struct {
+    FuzzyQ15_t a;
+    FuzzyQ15_t b;
+    FuzzyQ15_t c;
+    FuzzyQ15_t d;
+    uint16_t rise;
+    uint16_t fall;
+    uint8_t riseShift;
+    uint8_t fallShift;
+    uint8_t type;
+} FuzzyQ15Function_t;
+
+typedef struct {
+    FuzzyQ31_t a;
+    FuzzyQ31_t b;
+    FuzzyQ31_t c;
+    FuzzyQ31_t d;
+    uint32_t rise;
+    uint32_t fall;
+    uint8_t riseShift;
+    uint8_t fallShift;
+    uint8_t type;
+} FuzzyQ31Function_t;
+
+static inline FuzzyQ15_t fuzzyQ15Min(FuzzyQ15_t a, FuzzyQ15_t b) {
+    return a < b ? a : b;
+}
+
+static inline FuzzyQ15_t fuzzyQ15Max(FuzzyQ15_t a, FuzzyQ15_t b) {
+    return a > b ? a : b;
+}
+
+static inline FuzzyQ15_t fuzzyQ15Saturate(int32_t x) {
+    return (FuzzyQ15_t)(x > INT16_MAX   ? INT16_MAX
+                        : x < INT16_MIN ? INT16_MIN
+                                        : x);
+}
+
+static inline FuzzyQ15_t fuzzyQ15Add(FuzzyQ15_t a, FuzzyQ15_t b) {
+    return fuzzyQ15Saturate((int32_t)a + b);
+}
+
+static inline FuzzyQ15_t fuzzyQ15Sub(FuzzyQ15_t a, FuzzyQ15_t b) {
+    return fuzzyQ15Saturate((int32_t)a - b);
+}
+
+static inline FuzzyQ15_t fuzzyQ15Mul(FuzzyQ15_t a, FuzzyQ15_t b) {
+    return fuzzyQ15Saturate(((int32_t)a * b + (1 << 14)) >> 15);
+}
+
+static inline FuzzyQ31_t fuzzyQ31Min(FuzzyQ31_t a, FuzzyQ31_t b) {
+    return a < b ? a : b;
+}
+
+static inline FuzzyQ31_t fuzzyQ31Max(FuzzyQ31_t a, FuzzyQ31_t b) {
+    return a > b ? a : b;
+}
+
+static inline FuzzyQ31_t fuzzyQ31Saturate(int64_t x) {
+    return (FuzzyQ31_t)(x > INT32_MAX   ? INT32_MAX
+                        : x < INT32_MIN ? INT32_MIN
+                                        : x);
+}
+
+static inline FuzzyQ31_t fuzzyQ31Add(FuzzyQ31_t a, FuzzyQ31_t b) {
+    return fuzzyQ31Saturate((int64_t)a + b);
+}
+
+static inline FuzzyQ31_t fuzzyQ31Sub(FuzzyQ31_t a, FuzzyQ31_t b) {
+    return fuzzyQ31Saturate((int64_t)a - b);
+}
+
+static inline FuzzyQ31_t fuzzyQ31Mul(FuzzyQ31_t a, FuzzyQ31_t b) {
+    return fuzzyQ31Saturate(((int64_t)a * b + (1 << 30)) >> 31);
+}
+
+FuzzyQ15_t FuzzyQ15FromReal(FuzzyReal_t x, FuzzyReal_t min, FuzzyReal_t max);
+FuzzyReal_t FuzzyQ15ToReal(FuzzyQ15_t x, FuzzyReal_t min, FuzzyReal_t max);
+FuzzyQ31_t FuzzyQ31FromReal(FuzzyReal_t x, FuzzyReal_t min, FuzzyReal_t max);
+FuzzyReal_t FuzzyQ31ToReal(FuzzyQ31_t x, FuzzyReal_t min, FuzzyReal_t max);
+
+bool FuzzyQ15FunctionInit(FuzzyQ15Function_t *function,
+                          MembershipFunction_t mf, FuzzyReal_t min,
+                          FuzzyReal_t max);
+bool FuzzyQ31FunctionInit(FuzzyQ31Function_t *function,
+                          MembershipFunction_t mf, FuzzyReal_t min,
+                          FuzzyReal_t max);
+void FuzzyQ15Centroids(const MembershipFunction_t *mfs, int length,
+                       FuzzyReal_t min, FuzzyReal_t max,
+                       FuzzyQ15_t *centroids);
+void FuzzyQ31Centroids(const MembershipFunction_t *mfs, int length,
+                       FuzzyReal_t min, FuzzyReal_t max,
+                       FuzzyQ31_t *centroids);
+
+FuzzyQ15_t FuzzyQ15Membership(FuzzyQ15_t x,
+                              const FuzzyQ15Function_t *function);
+FuzzyQ31_t FuzzyQ31Membership(FuzzyQ31_t x,
+                              const FuzzyQ31Function_t *function);
+void FuzzyQ15Classify(FuzzyQ15_t x, const FuzzyQ15Function_t *functions,
+                      int length, FuzzyQ15_t *values);
+void FuzzyQ31Classify(FuzzyQ31_t x, const FuzzyQ31Function_t *functions,
+                      int length, FuzzyQ31_t *values);
+
+bool FuzzyProgramRunQ15(const FuzzyProgram_t *program,
+                        FuzzyQ15_t *const *values);
+bool FuzzyProgramRunQ31(const FuzzyProgram_t *program,
+                        FuzzyQ31_t *const *values);
+
+FuzzyQ15_t FuzzyQ15Defuzzify(const FuzzyQ15_t *values,
+                             const FuzzyQ15_t *centroids, int length);
+FuzzyQ31_t FuzzyQ31Defuzzify(const FuzzyQ31_t *values,
+                             const FuzzyQ31_t *centroids, int length);
+
+#endif
@@ -13,11 +13,27 @@
 #define FUZZY_C_H
 #pragma once
 
+#include "arena.h"
+#include "batch.h"
 #include "class.h"
 #include "classifier.h"
+#include "cost.h"
 #include "defuzzifier.h"
+#include "fixed_point.h"
+#include "handle.h"
+#include "incremental.h"
 #include "inference.h"
 #include "membership_function.h"
+#include "memo.h"
+#include "model_file.h"
+#include "model.h"
+#include "opencl.h"
+#include "optimizer.h"
+#include "program.h"
+#include "real.h"
+#include "stats.h"
+#include "stream.h"
+#include "surface.h"
 
 #define FUZZY_LENGTH(x) (sizeof(x) / sizeof(x[0]))
 
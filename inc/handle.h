@@ -0,0 +1,82 @@
+/**
+ * @file handle.h
+ * @brief Fuzzy Logic hot swappable model handle header.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#ifndef FUZZY_HANDLE_H
+#define FUZZY_HANDLE_H
+#pragma once
+
+#include "model.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Called once a retired model is no longer used by any reader, e.g. to free
+// it with FuzzyModelFree() or FuzzyModelClose()
+typedef void (*FuzzyModelRelease_t)(const FuzzyModel_t *model, void *context);
+
+// A reader slot of a handle. Every evaluating thread uses its own slot, the
+// slot keeps a state for the model the thread evaluated last.
+typedef struct {
+    // the epoch the reader entered in, 0 while it is outside of an evaluation
+    _Alignas(64) _Atomic uint64_t epoch;
+    // the epoch of the model the state is laid out for, 0 before the first
+    // evaluation
+    uint64_t stateEpoch;
+    FuzzyState_t state;
+} FuzzyReader_t;
+
+// A model replaced by a swap, waiting for the readers which may still use it
+typedef struct {
+    const FuzzyModel_t *model;
+    // the epoch of the swap, readers which entered in it or later can not
+    // reference the model
+    uint64_t epoch;
+} FuzzyRetiredModel_t;
+
+// A model which can be replaced while other threads evaluate it. Every
+// published model gets its own even epoch, which is odd while a swap is in
+// progress. Readers load the current model atomically and announce the epoch
+// it belongs to, a swap publishes the new model under the next epoch and
+// retires the old one, which is released once no reader announces an older
+// epoch. Readers never lock or wait for each other, they only retry while a
+// swap is being published. Swaps are serialized among each other.
+typedef struct {
+    _Atomic(const FuzzyModel_t *) model;
+    _Atomic uint64_t epoch;
+    FuzzyReader_t *readers;
+    int numReaders;
+    FuzzyModelRelease_t release;
+    void *context;
+    // serializes swaps and reclamation
+    atomic_flag lock;
+    FuzzyRetiredModel_t *retired;
+    int numRetired;
+    int capacity;
+} FuzzyModelHandle_t;
+
+bool FuzzyModelHandleInit(FuzzyModelHandle_t *handle, const FuzzyModel_t *model,
+                          int numReaders, FuzzyModelRelease_t release,
+                          void *context);
+void FuzzyModelHandleFree(FuzzyModelHandle_t *handle);
+
+const FuzzyModel_t *FuzzyModelHandleEnter(FuzzyModelHandle_t *handle,
+                                          int reader);
+void FuzzyModelHandleExit(FuzzyModelHandle_t *handle, int reader);
+bool FuzzyModelHandleEvaluate(FuzzyModelHandle_t *handle, int reader,
+                              const FuzzyReal_t *inputs, FuzzyReal_t *outputs);
+
+void FuzzyModelHandleSwap(FuzzyModelHandle_t *handle,
+                          const FuzzyModel_t *model);
+int FuzzyModelHandleReclaim(FuzzyModelHandle_t *handle);
+void FuzzyModelHandleSynchronize(FuzzyModelHandle_t *handle);
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * @file incremental.h
+ * @brief Fuzzy Logic incremental evaluation header.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#ifndef FUZZY_INCREMENTAL_H
+#define FUZZY_INCREMENTAL_H
+#pragma once
+
+#include "model.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Incremental evaluation context of a model. The context caches the crisp
+// inputs, membership values, rule strengths and crisp outputs of the last
+// evaluation. FuzzyUpdateInput() marks an input dirty and
+// FuzzyContextEvaluate() only recomputes the rules reading dirty inputs and
+// the output sets fed by rules whose strength changed.
+typedef struct {
+    const FuzzyModel_t *model;
+    FuzzyState_t state;
+    FuzzyReal_t *inputs;
+    FuzzyReal_t *outputs;
+    bool *dirtyInputs;
+    // the next evaluation recomputes everything
+    bool dirtyAll;
+    // false if the model needs a full evaluation every time, see
+    // FuzzyContextInit()
+    bool incremental;
+
+    int numRules;
+    // offset of the first operation of every rule, plus the end of the program
+    uint32_t *ruleStarts;
+    FuzzyReal_t *strengths;
+    // evaluation in which a rule was last recomputed
+    uint32_t *ruleStamps;
+    uint32_t stamp;
+    // rules reading input i: inputRules[inputStarts[i] .. inputStarts[i + 1]]
+    uint32_t *inputStarts;
+    uint32_t *inputRules;
+    // consequents of program output o (see FuzzyProgram_t.outputs), the rule
+    // and the membership value it accumulates into:
+    // outputRules[outputStarts[o] .. outputStarts[o + 1]]
+    uint32_t *outputStarts;
+    uint32_t *outputRules;
+    uint16_t *outputValues;
+    // program output index of every set of the program, -1 for other sets
+    int *outputOfSet;
+    bool *dirtyOutputs;
+} FuzzyContext_t;
+
+void FuzzyContextInit(FuzzyContext_t *context, const FuzzyModel_t *model);
+void FuzzyContextFree(FuzzyContext_t *context);
+
+void FuzzyUpdateInput(FuzzyContext_t *context, int input, FuzzyReal_t x);
+void FuzzyContextEvaluate(FuzzyContext_t *context, FuzzyReal_t *outputs);
+
+#endif
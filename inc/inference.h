@@ -43,27 +43,25 @@ typedef struct {
 } FuzzyRule_t;
 
 // Define macros to create fuzzy variables and antecedents
+// The variable macros expand to plain braced initializers (rather than
+// compound literals) so rule tables can be defined at file scope.
 #define NOT(_variable, _value)                                                 \
-    (FuzzyVariable_t) {                                                        \
-        .variable = &_variable, .value = _value, .invert = true                \
-    }
+    { .variable = &_variable, .value = _value, .invert = true }
 
 #define VAR(_variable, _value)                                                 \
-    (FuzzyVariable_t) {                                                        \
-        .variable = &_variable, .value = _value, .invert = false               \
-    }
+    { .variable = &_variable, .value = _value, .invert = false }
 
 #define THEN(_variable, _value)                                                \
-    (FuzzyVariable_t) { .variable = &_variable, .value = _value }
+    { .variable = &_variable, .value = _value }
 
 #define ANY_OF(...)                                                            \
-    {.fuzzy_operator= FUZZY_ANY_OF,                                                  \
+    {.fuzzy_operator= FUZZY_ANY_OF,                                            \
      .variables = (FuzzyVariable_t[]){__VA_ARGS__},                            \
      .num_variables =                                                          \
          sizeof((FuzzyVariable_t[]){__VA_ARGS__}) / sizeof(FuzzyVariable_t)}
 
 #define ALL_OF(...)                                                            \
-    {.fuzzy_operator= FUZZY_ALL_OF,                                                  \
+    {.fuzzy_operator= FUZZY_ALL_OF,                                            \
      .variables = (FuzzyVariable_t[]){__VA_ARGS__},                            \
      .num_variables =                                                          \
          sizeof((FuzzyVariable_t[]){__VA_ARGS__}) / sizeof(FuzzyVariable_t)}
@@ -77,6 +75,77 @@ typedef struct {
          sizeof((FuzzyAntecedent_t[])_antecedent) / sizeof(FuzzyAntecedent_t), \
      .consequent = _consequent}
 
+// Static rules. These macros mirror the ones above but expand to the
+// FuzzyOp_t operations of a compiled program (see program.h) at compile time,
+// so a rule table can be a const array in read-only memory. Sets are referred
+// to by their index, e.g. the set labels generated by
+// DEFINE_STATIC_FUZZY_MODEL. Each ALL_OF or ANY_OF group takes at most 16
+// variables.
+// > STATIC_PROPOSITION(
+// >     STATIC_WHEN(STATIC_ALL_OF(STATIC_VAR(Input, INPUT_LOW))),
+// >     STATIC_THEN(Output, OUTPUT_HIGH))
+
+// A variable is a tuple of set, value and its operation in ALL_OF and ANY_OF
+#define STATIC_VAR(_set, _value) (_set, _value, FUZZY_OP_MIN, FUZZY_OP_MAX)
+#define STATIC_NOT(_set, _value)                                               \
+    (_set, _value, FUZZY_OP_MIN_NOT, FUZZY_OP_MAX_NOT)
+
+#define STATIC_THEN(_set, _value)                                              \
+    {.code = FUZZY_OP_ACCUMULATE, .set = _set, .value = _value}
+
+#define FUZZY_STATIC_OP_ALL_(_set, _value, _all, _any)                         \
+    {.code = _all, .set = _set, .value = _value},
+#define FUZZY_STATIC_OP_ANY_(_set, _value, _all, _any)                         \
+    {.code = _any, .set = _set, .value = _value},
+#define FUZZY_STATIC_OP_ALL(_variable) FUZZY_STATIC_OP_ALL_ _variable
+#define FUZZY_STATIC_OP_ANY(_variable) FUZZY_STATIC_OP_ANY_ _variable
+
+#define STATIC_ALL_OF(...)                                                     \
+    {.code = FUZZY_OP_ALL_OF},                                                 \
+        FUZZY_FOR_EACH(FUZZY_STATIC_OP_ALL, __VA_ARGS__){                      \
+            .code = FUZZY_OP_REDUCE}
+
+#define STATIC_ANY_OF(...)                                                     \
+    {.code = FUZZY_OP_ANY_OF},                                                 \
+        FUZZY_FOR_EACH(FUZZY_STATIC_OP_ANY, __VA_ARGS__){                      \
+            .code = FUZZY_OP_REDUCE}
+
+#define STATIC_WHEN(...) __VA_ARGS__
+
+#define STATIC_PROPOSITION(_antecedent, _consequent)                           \
+    {.code = FUZZY_OP_RULE}, _antecedent, _consequent
+
+// FUZZY_FOR_EACH(m, a, b, c) expands to m(a) m(b) m(c), for up to 16 arguments
+#define FUZZY_FOR_EACH(m, ...)                                                 \
+    FUZZY_FOR_EACH_(FUZZY_FOR_EACH_COUNT(__VA_ARGS__), m, __VA_ARGS__)
+#define FUZZY_FOR_EACH_(n, m, ...) FUZZY_FOR_EACH__(n, m, __VA_ARGS__)
+#define FUZZY_FOR_EACH__(n, m, ...) FUZZY_FOR_EACH_##n(m, __VA_ARGS__)
+#define FUZZY_FOR_EACH_COUNT(...)                                              \
+    FUZZY_FOR_EACH_NTH(__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, \
+                       4, 3, 2, 1, 0)
+#define FUZZY_FOR_EACH_NTH(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12,  \
+                           _13, _14, _15, _16, n, ...)                         \
+    n
+#define FUZZY_FOR_EACH_1(m, x) m(x)
+#define FUZZY_FOR_EACH_2(m, x, ...) m(x) FUZZY_FOR_EACH_1(m, __VA_ARGS__)
+#define FUZZY_FOR_EACH_3(m, x, ...) m(x) FUZZY_FOR_EACH_2(m, __VA_ARGS__)
+#define FUZZY_FOR_EACH_4(m, x, ...) m(x) FUZZY_FOR_EACH_3(m, __VA_ARGS__)
+#define FUZZY_FOR_EACH_5(m, x, ...) m(x) FUZZY_FOR_EACH_4(m, __VA_ARGS__)
+#define FUZZY_FOR_EACH_6(m, x, ...) m(x) FUZZY_FOR_EACH_5(m, __VA_ARGS__)
+#define FUZZY_FOR_EACH_7(m, x, ...) m(x) FUZZY_FOR_EACH_6(m, __VA_ARGS__)
+#define FUZZY_FOR_EACH_8(m, x, ...) m(x) FUZZY_FOR_EACH_7(m, __VA_ARGS__)
+#define FUZZY_FOR_EACH_9(m, x, ...) m(x) FUZZY_FOR_EACH_8(m, __VA_ARGS__)
+#define FUZZY_FOR_EACH_10(m, x, ...) m(x) FUZZY_FOR_EACH_9(m, __VA_ARGS__)
+#define FUZZY_FOR_EACH_11(m, x, ...) m(x) FUZZY_FOR_EACH_10(m, __VA_ARGS__)
+#define FUZZY_FOR_EACH_12(m, x, ...) m(x) FUZZY_FOR_EACH_11(m, __VA_ARGS__)
+#define FUZZY_FOR_EACH_13(m, x, ...) m(x) FUZZY_FOR_EACH_12(m, __VA_ARGS__)
+#define FUZZY_FOR_EACH_14(m, x, ...) m(x) FUZZY_FOR_EACH_13(m, __VA_ARGS__)
+#define FUZZY_FOR_EACH_15(m, x, ...) m(x) FUZZY_FOR_EACH_14(m, __VA_ARGS__)
+#define FUZZY_FOR_EACH_16(m, x, ...) m(x) FUZZY_FOR_EACH_15(m, __VA_ARGS__)
+
 void fuzzyInference(const FuzzyRule_t *rules, int numRules);
+int fuzzyOutputSets(const FuzzyRule_t *rules, int numRules, FuzzySet_t **sets);
+void fuzzyInferenceOnce(const FuzzyRule_t *rules, int numRules,
+                        FuzzySet_t *const *sets, int numSets);
 
 #endif
@@ -13,16 +13,89 @@
 #define FUZZY_MEMBERSHIP_FUNCTION_H
 #pragma once
 
-typedef enum { TRIANGULAR, TRAPEZOIDAL, RECTANGULAR } MembershipFunctionType_e;
+#include "real.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// The shapes of membership functions and the meaning of their parameters:
+//   TRIANGULAR   a, b, c     start, peak and end point
+//   TRAPEZOIDAL  a, b, c, d  start, plateau start, plateau end and end point
+//   RECTANGULAR  a, b        start and end point, 1 in [a, b)
+//   GAUSSIAN     a, b        center and standard deviation,
+//                            e^(-(x - a)^2 / 2b^2)
+//   SIGMOID      a, b        slope and crossover point, 1 / (1 + e^(-a(x - b))),
+//                            rising for a > 0 and falling for a < 0
+//   BELL         a, b, c     half width, shape and center,
+//                            1 / (1 + |(x - c) / a|^2b)
+//   SINGLETON    a           the point, 1 at x == a and 0 elsewhere
+// The smooth shapes use a fast exponential, see membershipFunction().
+typedef enum {
+    TRIANGULAR,
+    TRAPEZOIDAL,
+    RECTANGULAR,
+    GAUSSIAN,
+    SIGMOID,
+    BELL,
+    SINGLETON
+} MembershipFunctionType_e;
+
+// The number of membership function types
+#define FUZZY_NUM_MEMBERSHIP_TYPES (SINGLETON + 1)
 
 typedef struct {
-    double a;
-    double b;
-    double c;
-    double d;
+    FuzzyReal_t a;
+    FuzzyReal_t b;
+    FuzzyReal_t c;
+    FuzzyReal_t d;
     MembershipFunctionType_e type;
 } MembershipFunction_t;
 
+// Alignment of the parameter arrays of a MembershipLayout_t, one cache line
+#define FUZZY_LAYOUT_ALIGNMENT 64
+
+// Struct-of-arrays copy of the membership functions of a set, see
+// FuzzySetEnableLayout(). The functions are grouped by type, so every group is
+// evaluated by one vector loop across its functions. Slot k holds function
+// order[k] of the set, the functions of type t are stored in the slots
+// groupStarts[t] .. groupStarts[t + 1] and the slots from
+// groupStarts[FUZZY_NUM_MEMBERSHIP_TYPES] on hold functions of unknown type.
+typedef struct {
+    FuzzyReal_t *a;
+    FuzzyReal_t *b;
+    FuzzyReal_t *c;
+    FuzzyReal_t *d;
+    // reciprocals of the widths of the rising and falling edges, 1 / (b - a)
+    // and 1 / (d - c), or 1 / (c - b) for triangles
+    FuzzyReal_t *leftSlope;
+    FuzzyReal_t *rightSlope;
+    // the centroids of the functions in set order, see calculateCentroid()
+    FuzzyReal_t *centroids;
+    int *order;
+    // the inverse of order, function i of the set is stored in slot slots[i]
+    int *slots;
+    int groupStarts[FUZZY_NUM_MEMBERSHIP_TYPES + 2];
+    // true if the functions are already grouped, so order[k] == k
+    bool ordered;
+    // true if membershipLayoutInit() allocated the arrays, false if they live
+    // in caller provided storage, see membershipLayoutInitBuffer()
+    bool ownsStorage;
+} MembershipLayout_t;
+
+// The number of values per parameter array of a layout of the given length,
+// rounded up to whole cache lines
+#define FUZZY_LAYOUT_PADDED(length)                                            \
+    (((size_t)(length) + FUZZY_LAYOUT_ALIGNMENT / sizeof(FuzzyReal_t)) /       \
+     (FUZZY_LAYOUT_ALIGNMENT / sizeof(FuzzyReal_t)) *                          \
+     (FUZZY_LAYOUT_ALIGNMENT / sizeof(FuzzyReal_t)))
+
+// The number of bytes membershipLayoutInitBuffer() takes for the arrays of a
+// layout of the given length, including worst case alignment padding
+#define FUZZY_LAYOUT_SIZE(length)                                              \
+    (FUZZY_LAYOUT_ALIGNMENT - 1 +                                              \
+     7 * FUZZY_LAYOUT_PADDED(length) * sizeof(FuzzyReal_t) +                   \
+     2 * (size_t)(length) * sizeof(int))
+
 #define FUZZY_LABEL(a, ...) a,
 #define FUZZY_VALUE(a, ...) {__VA_ARGS__},
 
@@ -42,6 +115,68 @@ typedef struct {
     enum { name(FUZZY_LABEL) };                                                \
     MembershipFunction_t name[] = {name(FUZZY_VALUE)};
 
-double membershipFunction(double x, MembershipFunction_t mf);
+// Same as DEFINE_FUZZY_MEMBERSHIP, but the list is emitted as a static const
+// array, so it is placed in read-only memory (e.g. flash) and its parameters
+// are known to the compiler. Used for static models, see
+// DEFINE_STATIC_FUZZY_MODEL.
+#define DEFINE_CONST_FUZZY_MEMBERSHIP(name)                                    \
+    enum { name(FUZZY_LABEL) };                                                \
+    static const MembershipFunction_t name[] = {name(FUZZY_VALUE)};
+
+FuzzyReal_t membershipFunction(FuzzyReal_t x, MembershipFunction_t mf);
+
+FuzzyReal_t triangularMembershipFunction(FuzzyReal_t x, FuzzyReal_t a,
+                                         FuzzyReal_t b, FuzzyReal_t c);
+FuzzyReal_t trapezoidalMembershipFunction(FuzzyReal_t x, FuzzyReal_t a,
+                                          FuzzyReal_t b, FuzzyReal_t c,
+                                          FuzzyReal_t d);
+FuzzyReal_t rectangularMembershipFunction(FuzzyReal_t x, FuzzyReal_t a,
+                                          FuzzyReal_t b);
+FuzzyReal_t gaussianMembershipFunction(FuzzyReal_t x, FuzzyReal_t a,
+                                       FuzzyReal_t b);
+FuzzyReal_t sigmoidMembershipFunction(FuzzyReal_t x, FuzzyReal_t a,
+                                      FuzzyReal_t b);
+FuzzyReal_t bellMembershipFunction(FuzzyReal_t x, FuzzyReal_t a, FuzzyReal_t b,
+                                   FuzzyReal_t c);
+FuzzyReal_t singletonMembershipFunction(FuzzyReal_t x, FuzzyReal_t a);
+
+void triangularMembershipFunctionBatch(const FuzzyReal_t *xs, size_t n,
+                                       FuzzyReal_t a, FuzzyReal_t b,
+                                       FuzzyReal_t c, FuzzyReal_t *out,
+                                       size_t stride);
+void trapezoidalMembershipFunctionBatch(const FuzzyReal_t *xs, size_t n,
+                                        FuzzyReal_t a, FuzzyReal_t b,
+                                        FuzzyReal_t c, FuzzyReal_t d,
+                                        FuzzyReal_t *out, size_t stride);
+void rectangularMembershipFunctionBatch(const FuzzyReal_t *xs, size_t n,
+                                        FuzzyReal_t a, FuzzyReal_t b,
+                                        FuzzyReal_t *out, size_t stride);
+void gaussianMembershipFunctionBatch(const FuzzyReal_t *xs, size_t n,
+                                     FuzzyReal_t a, FuzzyReal_t b,
+                                     FuzzyReal_t *out, size_t stride);
+void sigmoidMembershipFunctionBatch(const FuzzyReal_t *xs, size_t n,
+                                    FuzzyReal_t a, FuzzyReal_t b,
+                                    FuzzyReal_t *out, size_t stride);
+void bellMembershipFunctionBatch(const FuzzyReal_t *xs, size_t n,
+                                 FuzzyReal_t a, FuzzyReal_t b, FuzzyReal_t c,
+                                 FuzzyReal_t *out, size_t stride);
+void singletonMembershipFunctionBatch(const FuzzyReal_t *xs, size_t n,
+                                      FuzzyReal_t a, FuzzyReal_t *out,
+                                      size_t stride);
+
+void membershipFunctionBatch(const FuzzyReal_t *xs, size_t n,
+                             MembershipFunction_t mf, FuzzyReal_t *out,
+                             size_t stride);
+
+bool membershipLayoutInit(MembershipLayout_t *layout,
+                          const MembershipFunction_t *functions, int length);
+void membershipLayoutInitBuffer(MembershipLayout_t *layout,
+                                const MembershipFunction_t *functions,
+                                int length, void *storage);
+void membershipLayoutFree(MembershipLayout_t *layout);
+void membershipLayoutValues(FuzzyReal_t x, const MembershipLayout_t *layout,
+                            FuzzyReal_t *values);
+FuzzyReal_t membershipLayoutValue(FuzzyReal_t x,
+                                  const MembershipLayout_t *layout, int i);
 
 #endif
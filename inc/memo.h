@@ -0,0 +1,45 @@
+/**
+ * @file memo.h
+ * @brief Fuzzy Logic memoization cache header.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#ifndef FUZZY_MEMO_H
+#define FUZZY_MEMO_H
+#pragma once
+
+#include "real.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Direct-mapped cache from a tuple of keyLength crisp values to valueLength
+// results. Quantized inputs (such as ADC readings) recur exactly, so keys are
+// compared bit by bit and a hit returns exactly what was computed for the
+// key. Each key maps to one entry, a colliding key replaces it.
+typedef struct {
+    // power of two
+    int numEntries;
+    int keyLength;
+    int valueLength;
+    FuzzyReal_t *keys;
+    FuzzyReal_t *values;
+    bool *valid;
+    uint64_t hits;
+    uint64_t misses;
+} FuzzyMemo_t;
+
+bool FuzzyMemoInit(FuzzyMemo_t *memo, int numEntries, int keyLength,
+                   int valueLength);
+void FuzzyMemoFree(FuzzyMemo_t *memo);
+void FuzzyMemoClear(FuzzyMemo_t *memo);
+
+FuzzyReal_t *FuzzyMemoLookup(FuzzyMemo_t *memo, const FuzzyReal_t *key,
+                             bool *hit);
+
+#endif
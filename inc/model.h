@@ -0,0 +1,171 @@
+/**
+ * @file model.h
+ * @brief Fuzzy Logic reentrant model and evaluation state header.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#ifndef FUZZY_MODEL_H
+#define FUZZY_MODEL_H
+#pragma once
+
+#include "arena.h"
+#include "class.h"
+#include "defuzzifier.h"
+#include "inference.h"
+#include "memo.h"
+#include "program.h"
+
+// The consequents of Takagi-Sugeno inference, see FuzzyModelEnableTsk(). Every
+// membership function of an output set is a consequent
+//   z = c[0] + c[1] * input 0 + ... + c[numInputs] * input numInputs - 1
+// The coefficients of an output are stored by coefficient: coefficient k of
+// its consequents is the contiguous row k, so the output is a sum of dot
+// products of the rule weights with the rows.
+typedef struct {
+    FuzzyReal_t *coefficients;
+    // offset of the first row of every output in coefficients
+    int *offsets;
+    // false if all consequents are constants, the rows of the inputs are
+    // skipped then
+    bool linear;
+} FuzzyTsk_t;
+
+// An immutable controller model: the membership functions of its sets and the
+// compiled rules. The sets of the program are ordered inputs first, then
+// outputs, then any further sets used by the rules. The membership values
+// stored in the sets themselves are never touched, so one model can be shared
+// by any number of threads without locking.
+typedef struct {
+    FuzzyProgram_t program;
+    int numInputs;
+    int numOutputs;
+    // total number of membership values of all sets of the program
+    int numValues;
+    // FUZZY_DEFUZZIFY_WEIGHTED_CENTROIDS, FUZZY_DEFUZZIFY_AREA or
+    // FUZZY_DEFUZZIFY_SINGLETONS
+    FuzzyDefuzzifyMethod_e defuzzifier;
+    // Takagi-Sugeno consequents replacing the defuzzifier, owned by the model,
+    // NULL for Mamdani inference
+    FuzzyTsk_t *tsk;
+} FuzzyModel_t;
+
+// The per-evaluation state of a model: the membership values of every set
+typedef struct {
+    FuzzyReal_t *buffer;
+    // values[i] points to the membership values of program set i in buffer
+    FuzzyReal_t **values;
+    // true if the state allocated its storage and FuzzyStateFree() releases it
+    bool ownsStorage;
+} FuzzyState_t;
+
+// Static models. A static model is defined entirely at compile time and
+// emitted as const data, so it needs no initialization and can live in
+// read-only memory. The input and output sets are given as X-macro lists of
+// (set label, membership function list) pairs, the lists defined with
+// DEFINE_CONST_FUZZY_MEMBERSHIP. The set labels become enum constants which
+// the STATIC_ rules (see inference.h) use to refer to the sets:
+// > #define Inputs(X) X(Input, InputMembershipFunctions)
+// > #define Outputs(X) X(Output, OutputMembershipFunctions)
+// > DEFINE_STATIC_FUZZY_MODEL(
+// >     Model, Inputs, Outputs,
+// >     STATIC_PROPOSITION(STATIC_WHEN(STATIC_ALL_OF(STATIC_VAR(Input, LOW))),
+// >                        STATIC_THEN(Output, HIGH)))
+// This defines `const FuzzyModel_t Model` and the constants Model_NUM_SETS and
+// Model_NUM_VALUES. A static model must not be passed to FuzzyModelFree() and
+// its program can only be run with FuzzyProgramRunValues(), e.g. through
+// FuzzyEvaluate(). Static models use Mamdani inference.
+#define FUZZY_STATIC_SET_LABEL(_set, _functions) _set,
+#define FUZZY_STATIC_SET_COUNT(_set, _functions) +1
+#define FUZZY_STATIC_SET_VALUES(_set, _functions)                              \
+    +(int)(sizeof(_functions) / sizeof(_functions[0]))
+#define FUZZY_STATIC_SET(_set, _functions)                                     \
+    static const FuzzySet_t _set##_staticSet = {                               \
+        .membershipValues = NULL,                                              \
+        .membershipFunctions = _functions,                                     \
+        .length = (int)(sizeof(_functions) / sizeof(_functions[0])),           \
+        .ownsStorage = false};
+#define FUZZY_STATIC_SET_POINTER(_set, _functions) &_set##_staticSet,
+#define FUZZY_STATIC_SET_INDEX(_set, _functions) _set,
+
+#define DEFINE_STATIC_FUZZY_MODEL(_name, _inputs, _outputs, ...)               \
+    enum { _inputs(FUZZY_STATIC_SET_LABEL) _outputs(FUZZY_STATIC_SET_LABEL) }; \
+    enum {                                                                     \
+        _name##_NUM_INPUTS = 0 _inputs(FUZZY_STATIC_SET_COUNT),                \
+        _name##_NUM_OUTPUTS = 0 _outputs(FUZZY_STATIC_SET_COUNT),              \
+        _name##_NUM_SETS = _name##_NUM_INPUTS + _name##_NUM_OUTPUTS,           \
+        _name##_NUM_VALUES = 0 _inputs(FUZZY_STATIC_SET_VALUES)                \
+            _outputs(FUZZY_STATIC_SET_VALUES)                                  \
+    };                                                                         \
+    _inputs(FUZZY_STATIC_SET) _outputs(FUZZY_STATIC_SET)                       \
+    static const FuzzySet_t *const _name##_sets[] = {                          \
+        _inputs(FUZZY_STATIC_SET_POINTER) _outputs(FUZZY_STATIC_SET_POINTER)}; \
+    static const uint16_t _name##_outputSets[] = {                             \
+        _outputs(FUZZY_STATIC_SET_INDEX)};                                     \
+    static const FuzzyOp_t _name##_ops[] = {__VA_ARGS__};                      \
+    const FuzzyModel_t _name = {                                               \
+        .program = {.ops = _name##_ops,                                        \
+                    .numOps = sizeof(_name##_ops) / sizeof(FuzzyOp_t),         \
+                    .sets = _name##_sets,                                      \
+                    .numSets = _name##_NUM_SETS,                               \
+                    .outputs = _name##_outputSets,                             \
+                    .numOutputs = _name##_NUM_OUTPUTS,                         \
+                    .normalization = FUZZY_NORMALIZE_ONCE,                     \
+                    .values = NULL},                                           \
+        .numInputs = _name##_NUM_INPUTS,                                       \
+        .numOutputs = _name##_NUM_OUTPUTS,                                     \
+        .numValues = _name##_NUM_VALUES,                                       \
+        .defuzzifier = FUZZY_DEFUZZIFY_WEIGHTED_CENTROIDS};
+
+// The offset of the membership values in the buffer of a state, behind the
+// table of pointers to them and rounded up to the alignment of FuzzyReal_t
+#define FUZZY_STATE_VALUES_OFFSET(numSets)                                     \
+    (((numSets) * sizeof(FuzzyReal_t *) + _Alignof(FuzzyReal_t) - 1) /        \
+     _Alignof(FuzzyReal_t) * _Alignof(FuzzyReal_t))
+
+// The number of bytes the buffer of a state needs, see FuzzyStateSize()
+#define FUZZY_STATE_SIZE(numSets, numValues)                                   \
+    (FUZZY_STATE_VALUES_OFFSET(numSets) + (numValues) * sizeof(FuzzyReal_t))
+
+// Declares static storage for a state of a static model, sized at compile
+// time and aligned for both arrays, to be passed to FuzzyStateInitBuffer()
+#define FUZZY_STATE_STORAGE(_name, _model)                                     \
+    static _Alignas(FuzzyReal_t *) _Alignas(FuzzyReal_t) unsigned char         \
+        _name[FUZZY_STATE_SIZE(_model##_NUM_SETS, _model##_NUM_VALUES)]
+
+bool FuzzyModelInit(FuzzyModel_t *model, const FuzzyRule_t *rules,
+                    int numRules, const FuzzySet_t *const *inputs,
+                    int numInputs, const FuzzySet_t *const *outputs,
+                    int numOutputs);
+void FuzzyModelFree(FuzzyModel_t *model);
+bool FuzzyModelShareAntecedents(FuzzyModel_t *model);
+bool FuzzyModelEnableTsk(FuzzyModel_t *model, const FuzzyReal_t *coefficients);
+
+bool FuzzyStateInit(FuzzyState_t *state, const FuzzyModel_t *model);
+size_t FuzzyStateSize(const FuzzyModel_t *model);
+void FuzzyStateInitBuffer(FuzzyState_t *state, const FuzzyModel_t *model,
+                          void *buffer);
+bool FuzzyStateInitArena(FuzzyState_t *state, const FuzzyModel_t *model,
+                         FuzzyArena_t *arena);
+void FuzzyStateFree(FuzzyState_t *state);
+
+void FuzzyEvaluate(const FuzzyModel_t *model, FuzzyState_t *state,
+                   const FuzzyReal_t *inputs, FuzzyReal_t *outputs);
+bool FuzzyModelMemoInit(FuzzyMemo_t *memo, const FuzzyModel_t *model,
+                        int numEntries);
+void FuzzyEvaluateMemo(const FuzzyModel_t *model, FuzzyState_t *state,
+                       FuzzyMemo_t *memo, const FuzzyReal_t *inputs,
+                       FuzzyReal_t *outputs);
+FuzzyReal_t FuzzyModelDefuzzify(const FuzzyModel_t *model, int output,
+                                const FuzzyReal_t *values);
+FuzzyReal_t FuzzyModelTskOutput(const FuzzyModel_t *model, int output,
+                                const FuzzyReal_t *inputs,
+                                const FuzzyReal_t *weights);
+void FuzzyModelInfer(const FuzzyModel_t *model, FuzzyReal_t *const *values,
+                     const FuzzyReal_t *inputs, FuzzyReal_t *outputs);
+
+#endif
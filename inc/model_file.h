@@ -0,0 +1,97 @@
+/**
+ * @file model_file.h
+ * @brief Fuzzy Logic binary model file header.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#ifndef FUZZY_MODEL_FILE_H
+#define FUZZY_MODEL_FILE_H
+#pragma once
+
+#include "class.h"
+#include "membership_function.h"
+#include "model.h"
+#include "program.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A compiled model as a position independent image: a header followed by
+// sections of plain arrays which are referred to by their byte offset from the
+// start of the image. The membership functions, operations, output list and
+// rule index are stored exactly as FuzzyModel_t uses them, so an image (e.g.
+// a mapped file or a const array in flash) is used in place without parsing.
+// Images are written in the byte order of the writer.
+#define FUZZY_MODEL_MAGIC "FZYM"
+#define FUZZY_MODEL_VERSION 1
+// Every section starts at a multiple of this, as must the image itself
+#define FUZZY_MODEL_ALIGNMENT 16
+
+typedef struct {
+    // byte offset from the start of the image
+    uint32_t offset;
+    // number of elements
+    uint32_t count;
+} FuzzyModelSection_t;
+
+// The membership functions of a set, a range of the functions section
+typedef struct {
+    uint32_t first;
+    uint32_t length;
+} FuzzyModelSet_t;
+
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    // sizeof(FuzzyReal_t) and sizeof(MembershipFunction_t) of the writer, the
+    // membership functions are used in place so the reader has to agree
+    uint16_t realSize;
+    uint32_t functionSize;
+    // total size of the image in bytes
+    uint32_t size;
+    uint16_t numInputs;
+    uint16_t numOutputs;
+    uint16_t defuzzifier;
+    uint16_t normalization;
+    uint16_t sparse;
+    // FuzzyNorm_e, zero (min and max) in images without it
+    uint16_t norm;
+    FuzzyModelSection_t sets;      // FuzzyModelSet_t, inputs, outputs, others
+    FuzzyModelSection_t functions; // MembershipFunction_t
+    FuzzyModelSection_t ops;       // FuzzyOp_t
+    FuzzyModelSection_t outputs;   // uint16_t
+    // rule index, see FuzzyRuleIndex_t, all empty if the model has none
+    FuzzyModelSection_t ruleStarts;   // uint32_t, number of rules + 1
+    FuzzyModelSection_t gates;        // FuzzyGate_t
+    FuzzyModelSection_t gatedRules;   // uint32_t
+    FuzzyModelSection_t ungatedRules; // uint32_t
+} FuzzyModelHeader_t;
+
+// A model loaded from an image. Only the set structures and the set table are
+// allocated, everything else points into the image. Every load yields its own
+// FuzzyModel_t, so switching a controller to a new model is a pointer swap.
+typedef struct {
+    FuzzyModel_t model;
+    // the sets of the model, e.g. for FuzzySetEnablePartition()
+    FuzzySet_t *sets;
+    const void *image;
+    size_t size;
+    // true if the image was mapped by FuzzyModelOpen()
+    bool mapped;
+} FuzzyModelFile_t;
+
+size_t FuzzyModelImageSize(const FuzzyModel_t *model);
+void FuzzyModelWriteImage(const FuzzyModel_t *model, void *image);
+bool FuzzyModelSave(const FuzzyModel_t *model, const char *path);
+
+bool FuzzyModelLoad(FuzzyModelFile_t *file, const void *image, size_t size);
+bool FuzzyModelOpen(FuzzyModelFile_t *file, const char *path);
+void FuzzyModelClose(FuzzyModelFile_t *file);
+
+#endif
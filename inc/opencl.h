@@ -0,0 +1,82 @@
+/**
+ * @file opencl.h
+ * @brief Fuzzy Logic OpenCL batch evaluation header.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#ifndef FUZZY_OPENCL_H
+#define FUZZY_OPENCL_H
+#pragma once
+
+// Optional offload of large batches to an OpenCL device. Build the library
+// and its users with -DFUZZY_ENABLE_OPENCL and link with -lOpenCL. Without
+// the flag none of the declarations below exist.
+#ifdef FUZZY_ENABLE_OPENCL
+
+#include "model.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 120
+#endif
+#ifdef __APPLE__
+#include <OpenCL/opencl.h>
+#else
+#include <CL/cl.h>
+#endif
+
+// Number of batches in flight, the upload of a batch overlaps the kernel and
+// download of the previous one
+#define FUZZY_CL_SLOTS 2
+
+typedef struct {
+    cl_command_queue queue;
+    cl_mem inputs;
+    cl_mem outputs;
+    // completes with the download of the outputs of the batch in the slot
+    cl_event done;
+    bool busy;
+} FuzzyClSlot_t;
+
+// A model uploaded to an OpenCL device. The kernel is built for the sizes of
+// the model and evaluates one row of inputs per work item: classification,
+// rules and defuzzification in one pass with the membership values in
+// private memory.
+typedef struct {
+    const FuzzyModel_t *model;
+    cl_context context;
+    cl_device_id device;
+    cl_program program;
+    cl_kernel kernel;
+    // the model: the parameters a, b, c, d and the type of every membership
+    // function, the offset of every set, the ops, the output sets and the
+    // centroids of the output functions
+    cl_mem parameters;
+    cl_mem types;
+    cl_mem offsets;
+    cl_mem ops;
+    cl_mem targets;
+    cl_mem centroids;
+    // the maximum number of rows of a batch
+    size_t capacity;
+    FuzzyClSlot_t slots[FUZZY_CL_SLOTS];
+    int next;
+} FuzzyCl_t;
+
+bool FuzzyClInit(FuzzyCl_t *cl, const FuzzyModel_t *model, cl_device_id device,
+                 size_t capacity);
+void FuzzyClFree(FuzzyCl_t *cl);
+bool FuzzyClSubmit(FuzzyCl_t *cl, const FuzzyReal_t *inputs,
+                   FuzzyReal_t *outputs, size_t count);
+bool FuzzyClFinish(FuzzyCl_t *cl);
+
+#endif
+
+#endif
@@ -0,0 +1,67 @@
+/**
+ * @file optimizer.h
+ * @brief Fuzzy Logic rule base optimizer header.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#ifndef FUZZY_OPTIMIZER_H
+#define FUZZY_OPTIMIZER_H
+#pragma once
+
+#include "inference.h"
+
+#include <stdbool.h>
+
+// The passes of FuzzyRulesOptimize(). Removing dead rules keeps the outputs
+// of every operator family, the other passes rely on min and max: a rule
+// weaker than another one with the same consequent adds nothing to their
+// maximum, and rules differing in one ANY_OF group are the maximum of both
+// groups by distributivity. Reordering keeps min/max results exactly and
+// changes the rounding of the other families. Rules chained through a set
+// which one rule writes and another one reads are only removed when dead.
+typedef enum {
+    // rules whose antecedents on one input set can never be non-zero together
+    FUZZY_OPTIMIZE_DEAD = 1 << 0,
+    // duplicate variables and groups, groups implied by other groups and rules
+    // implied by rules with the same consequent
+    FUZZY_OPTIMIZE_SUBSUME = 1 << 1,
+    // rules with the same consequent differing in one group
+    FUZZY_OPTIMIZE_MERGE = 1 << 2,
+    // the ALL_OF variables most often zero first
+    FUZZY_OPTIMIZE_REORDER = 1 << 3,
+    FUZZY_OPTIMIZE_ALL = (1 << 4) - 1,
+} FuzzyOptimizePass_e;
+
+// What FuzzyRulesOptimize() changed
+typedef struct {
+    int deadRules;
+    int subsumedRules;
+    int mergedRules;
+    // variables and groups removed from the remaining rules
+    int removedVariables;
+    int removedGroups;
+    // operations of the program compiled from the rules, see
+    // FuzzyCompileRules(), before and after
+    int opsBefore;
+    int opsAfter;
+} FuzzyOptimizeReport_t;
+
+// An optimized copy of a rule base. The rules refer to the sets of the
+// original rules but own their antecedents.
+typedef struct {
+    FuzzyRule_t *rules;
+    int numRules;
+    FuzzyOptimizeReport_t report;
+} FuzzyRuleBase_t;
+
+bool FuzzyRulesOptimize(FuzzyRuleBase_t *base, const FuzzyRule_t *rules,
+                        int numRules, int passes);
+void FuzzyRuleBaseFree(FuzzyRuleBase_t *base);
+void printOptimizeReport(const FuzzyOptimizeReport_t *report);
+
+#endif
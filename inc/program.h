@@ -0,0 +1,145 @@
+/**
+ * @file program.h
+ * @brief Fuzzy Logic compiled rule program header.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#ifndef FUZZY_PROGRAM_H
+#define FUZZY_PROGRAM_H
+#pragma once
+
+#include "class.h"
+#include "inference.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The operations of a compiled rule program. Every rule is lowered to
+//   RULE, { ALL_OF | ANY_OF, leaf..., REDUCE }..., ACCUMULATE
+// where the leaf operations fold one membership value (or its complement)
+// into the current antecedent group. Programs with shared antecedents (see
+// FuzzyProgramShareAntecedents()) start with a prologue of
+//   { ALL_OF | ANY_OF, leaf..., STORE }...
+// computing every shared group once into a temporary, which the rules read
+// with LOAD instead of repeating the group, and rules may end in several
+// ACCUMULATE operations. The min and max of the operations are the t-norm T
+// and the s-norm S of the program's operator family, see FuzzyNorm_e.
+typedef enum {
+    FUZZY_OP_RULE,       // strength = 1
+    FUZZY_OP_ALL_OF,     // group = 1
+    FUZZY_OP_ANY_OF,     // group = 0
+    FUZZY_OP_MIN,        // group = min(group, membership)
+    FUZZY_OP_MIN_NOT,    // group = min(group, 1 - membership)
+    FUZZY_OP_MAX,        // group = max(group, membership)
+    FUZZY_OP_MAX_NOT,    // group = max(group, 1 - membership)
+    FUZZY_OP_REDUCE,     // strength = min(strength, group)
+    FUZZY_OP_ACCUMULATE, // membership = max(membership, strength)
+    FUZZY_OP_STORE,      // temporary = group
+    FUZZY_OP_LOAD,       // strength = min(strength, temporary)
+} FuzzyOpCode_e;
+
+// The number of operation codes
+#define FUZZY_NUM_OP_CODES (FUZZY_OP_LOAD + 1)
+
+// The t-norm T combining ALL_OF groups and the antecedents of a rule, and the
+// s-norm S combining ANY_OF groups and the rules targeting a consequent
+typedef enum {
+    // T(a, b) = min(a, b), S(a, b) = max(a, b)
+    FUZZY_NORM_MIN_MAX,
+    // T(a, b) = ab, S(a, b) = a + b - ab
+    FUZZY_NORM_PRODUCT,
+    // T(a, b) = max(0, a + b - 1), S(a, b) = min(1, a + b)
+    FUZZY_NORM_LUKASIEWICZ,
+    // T(a, b) = ab / (a + b - ab), S(a, b) = (a + b - 2ab) / (1 - ab), with
+    // T(0, 0) = 0 and S(1, 1) = 1
+    FUZZY_NORM_HAMACHER,
+} FuzzyNorm_e;
+
+// How a program resets and normalizes its output sets
+typedef enum {
+    // every distinct output set is reset and normalized once per run
+    FUZZY_NORMALIZE_ONCE,
+    // consequents are reset and their set is normalized once per rule, this
+    // reproduces fuzzyInference() exactly
+    FUZZY_NORMALIZE_PER_RULE,
+} FuzzyNormalization_e;
+
+// A single operation, set indexes into the program's set table and value is
+// the membership function index in that set
+typedef struct {
+    uint16_t code;
+    uint16_t set;
+    uint16_t value;
+} FuzzyOp_t;
+
+// A membership value which has to be non-zero for its rules to fire
+typedef struct {
+    uint16_t set;
+    uint16_t value;
+    // range of the gated rules in FuzzyRuleIndex_t.gatedRules
+    uint32_t first;
+    uint32_t count;
+} FuzzyGate_t;
+
+// Index of the rules of a program for sparse evaluation. Every rule is either
+// listed under a gate, a membership value which must be non-zero for the rule
+// to fire, or as ungated when no such value exists.
+typedef struct {
+    int numRules;
+    // offset of the first operation of every rule, plus the end of the program
+    const uint32_t *ruleStarts;
+    const FuzzyGate_t *gates;
+    int numGates;
+    const uint32_t *gatedRules;
+    const uint32_t *ungatedRules;
+    int numUngated;
+} FuzzyRuleIndex_t;
+
+typedef struct {
+    const FuzzyOp_t *ops;
+    int numOps;
+    // distinct sets referenced by the rules, in order of first appearance
+    const FuzzySet_t *const *sets;
+    int numSets;
+    // distinct output sets (indexes into sets) targeted by the rules
+    const uint16_t *outputs;
+    int numOutputs;
+    FuzzyNormalization_e normalization;
+    // the operator family, FUZZY_NORM_MIN_MAX unless set after compiling
+    FuzzyNorm_e norm;
+    // only evaluate rules which can fire using the index, see
+    // FuzzyProgramRunValues()
+    bool sparse;
+    FuzzyRuleIndex_t index;
+    // scratch table of membership value arrays used by FuzzyProgramRun()
+    FuzzyReal_t **values;
+    // the set holding the temporaries of shared antecedent groups, owned by
+    // the program and last in the set table, NULL if none are shared
+    FuzzySet_t *temporaries;
+} FuzzyProgram_t;
+
+bool FuzzyCompileRules(const FuzzyRule_t *rules, int numRules,
+                       FuzzyProgram_t *program);
+bool FuzzyCompileRulesWithSets(const FuzzyRule_t *rules, int numRules,
+                               FuzzyProgram_t *program,
+                               const FuzzySet_t *const *sets, int numSets);
+void FuzzyProgramFree(FuzzyProgram_t *program);
+bool FuzzyProgramShareAntecedents(FuzzyProgram_t *program);
+
+void FuzzyProgramRun(const FuzzyProgram_t *program);
+void FuzzyProgramRunValues(const FuzzyProgram_t *program,
+                           FuzzyReal_t *const *values);
+void FuzzyProgramRunWeights(const FuzzyProgram_t *program,
+                            FuzzyReal_t *const *values);
+FuzzyReal_t FuzzyRuleStrength(const FuzzyOp_t *op, const FuzzyOp_t *end,
+                              FuzzyReal_t *const *values);
+FuzzyReal_t FuzzyProgramRuleStrength(const FuzzyProgram_t *program,
+                                     const FuzzyOp_t *op, const FuzzyOp_t *end,
+                                     FuzzyReal_t *const *values);
+
+#endif
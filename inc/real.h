@@ -0,0 +1,54 @@
+/**
+ * @file real.h
+ * @brief Fuzzy Logic scalar type header.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#ifndef FUZZY_REAL_H
+#define FUZZY_REAL_H
+#pragma once
+
+// The floating point type used for inputs, membership values and outputs,
+// either double (the default) or float. Build the library and its users with
+// -DFUZZY_REAL=float for targets with a single precision FPU. The whole
+// program has to agree on the type, as it is part of every structure and
+// signature. See fixed_point.h for targets without an FPU.
+#ifndef FUZZY_REAL
+#define FUZZY_REAL double
+#endif
+
+typedef FUZZY_REAL FuzzyReal_t;
+
+// Marks a floating point constant as FuzzyReal_t, so expressions with float
+// values are not promoted to double
+#define FUZZY_REAL_C(x) ((FuzzyReal_t)(x))
+
+// Build the library with -DFUZZY_DIVISION_FREE for targets where a division
+// costs many times a multiplication. FuzzySetInit(), FuzzySetInitArena() and
+// FuzzyModelLoad() then prepare every set with a layout (see
+// FuzzySetEnableLayout()), so classification multiplies by reciprocal slopes,
+// and normalization multiplies by the reciprocal of the sum. Sets initialized
+// with FuzzySetInitBuffer() allocate nothing and keep dividing unless
+// FuzzySetEnableLayout() is called on them, the const sets of static models
+// (see DEFINE_STATIC_FUZZY_MODEL) always divide. Results may differ from the
+// default build by one ulp.
+
+// Build the library with -DFUZZY_WCET for a bounded latency: classification,
+// inference and defuzzification then have no input dependent early exits, so
+// the work per evaluation only depends on the sizes of the model. The
+// piecewise linear shapes compute both edges and select, compiled programs
+// run every operation instead of skipping rules, and partition indexes, memo
+// caches and incremental contexts, which skip work depending on the inputs,
+// are not available. The library is compiled once for all models, so its
+// loops still read their bounds (set->length, program->numOps, ...) from the
+// model at run time; they are fixed once the model is defined or loaded, but
+// a static analyzer can not derive them from the library code. Take the
+// bounds from FuzzyModelCost() (or tools/model_cost.c) for the model instead,
+// which counts the membership functions and ops of one evaluation exactly.
+
+#endif
@@ -0,0 +1,125 @@
+/**
+ * @file stats.h
+ * @brief Fuzzy Logic instrumentation header.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#ifndef FUZZY_STATS_H
+#define FUZZY_STATS_H
+#pragma once
+
+// Optional instrumentation of the hot paths. Build the library and its users
+// with -DFUZZY_ENABLE_STATS to record the cycles spent in classification,
+// inference and defuzzification, how strongly every rule fires and how often
+// every membership function of a set is active. Without the flag the hooks
+// expand to nothing and none of the declarations below exist.
+#ifdef FUZZY_ENABLE_STATS
+
+#include "class.h"
+#include "program.h"
+#include "real.h"
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+// Rules, sets and membership functions past these limits are not recorded
+#ifndef FUZZY_STATS_MAX_RULES
+#define FUZZY_STATS_MAX_RULES 256
+#endif
+#ifndef FUZZY_STATS_MAX_SETS
+#define FUZZY_STATS_MAX_SETS 32
+#endif
+#ifndef FUZZY_STATS_MAX_TERMS
+#define FUZZY_STATS_MAX_TERMS 16
+#endif
+// Number of equally wide bins of the firing strength histograms over (0, 1]
+#define FUZZY_STATS_BINS 10
+
+typedef enum {
+    FUZZY_STAGE_CLASSIFY,
+    FUZZY_STAGE_INFERENCE,
+    FUZZY_STAGE_DEFUZZIFY,
+    FUZZY_STAGE_COUNT
+} FuzzyStage_e;
+
+typedef struct {
+    uint64_t calls;
+    // timestamp counter cycles on x86, nanoseconds elsewhere
+    uint64_t ticks;
+    uint64_t maxTicks;
+} FuzzyStageStats_t;
+
+typedef struct {
+    uint64_t evaluations;
+    // evaluations with a non-zero strength
+    uint64_t fires;
+    uint64_t histogram[FUZZY_STATS_BINS];
+} FuzzyRuleStats_t;
+
+typedef struct {
+    const FuzzySet_t *set;
+    uint64_t classifications;
+    // classifications with a non-zero degree of every membership function
+    uint64_t activations[FUZZY_STATS_MAX_TERMS];
+} FuzzySetStats_t;
+
+// Rules are numbered by their position in the rule array passed to
+// fuzzyInference() or compiled into a program, sets are recorded in the order
+// they are first classified.
+typedef struct {
+    FuzzyStageStats_t stages[FUZZY_STAGE_COUNT];
+    FuzzyRuleStats_t rules[FUZZY_STATS_MAX_RULES];
+    int numRules;
+    FuzzySetStats_t sets[FUZZY_STATS_MAX_SETS];
+    int numSets;
+} FuzzyStats_t;
+
+FuzzyStats_t *FuzzyStatsGet(void);
+void FuzzyStatsReset(void);
+void FuzzyStatsMerge(FuzzyStats_t *stats, const FuzzyStats_t *other);
+void printStats(const FuzzyStats_t *stats, const char *const *ruleLabels);
+
+void fuzzyStatsStage(FuzzyStage_e stage, uint64_t ticks);
+void fuzzyStatsRule(int rule, FuzzyReal_t strength);
+void fuzzyStatsSet(const FuzzySet_t *set, const FuzzyReal_t *values);
+void fuzzyStatsProgram(const FuzzyProgram_t *program,
+                       FuzzyReal_t *const *values);
+
+static inline uint64_t fuzzyStatsTicks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000u + (uint64_t)t.tv_nsec;
+#endif
+}
+
+#define FUZZY_STATS_BEGIN() const uint64_t fuzzyStatsStart = fuzzyStatsTicks()
+#define FUZZY_STATS_END(stage)                                                 \
+    fuzzyStatsStage(stage, fuzzyStatsTicks() - fuzzyStatsStart)
+#define FUZZY_STATS_RULE(rule, strength) fuzzyStatsRule(rule, strength)
+#define FUZZY_STATS_SET(set, values) fuzzyStatsSet(set, values)
+#define FUZZY_STATS_PROGRAM(program, values) fuzzyStatsProgram(program, values)
+
+#else
+
+#define FUZZY_STATS_BEGIN()
+#define FUZZY_STATS_END(stage) ((void)0)
+#define FUZZY_STATS_RULE(rule, strength) ((void)0)
+#define FUZZY_STATS_SET(set, values) ((void)0)
+#define FUZZY_STATS_PROGRAM(program, values) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,103 @@
+/**
+ * @file stream.h
+ * @brief Fuzzy Logic streaming evaluation header.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#ifndef FUZZY_STREAM_H
+#define FUZZY_STREAM_H
+#pragma once
+
+#include "model.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Number of frames a stream evaluates per micro-batch by default
+#define FUZZY_STREAM_BATCH 32
+
+// A single-producer, single-consumer lock-free ring buffer of frames of
+// width values each. The producer only writes head and the consumer only
+// writes tail, both count frames and wrap around naturally.
+typedef struct {
+    FuzzyReal_t *frames;
+    int width;
+    // power of two
+    size_t capacity;
+    _Alignas(64) _Atomic size_t head;
+    _Alignas(64) _Atomic size_t tail;
+} FuzzyRing_t;
+
+// Where a model input of a stream comes from
+typedef enum {
+    // a channel of the frame
+    FUZZY_STREAM_CHANNEL,
+    // the change of a channel since the previous frame times scale, e.g. the
+    // frame rate for a change per second
+    FUZZY_STREAM_DELTA,
+} FuzzyStreamSource_e;
+
+typedef struct {
+    FuzzyStreamSource_e source;
+    int channel;
+    FuzzyReal_t scale;
+} FuzzyStreamInput_t;
+
+// Maps a crisp output linearly from [inMin, inMax] to [outMin, outMax] and
+// clamps it to the latter
+typedef struct {
+    FuzzyReal_t inMin;
+    FuzzyReal_t inMax;
+    FuzzyReal_t outMin;
+    FuzzyReal_t outMax;
+} FuzzyRange_t;
+
+// A streaming stage evaluating a model on every frame of an input ring into
+// an output ring of model->numOutputs values per frame
+typedef struct {
+    const FuzzyModel_t *model;
+    // one per model input
+    FuzzyStreamInput_t *inputs;
+    // one per model output, NULL to output the crisp values
+    FuzzyRange_t *ranges;
+    int batchSize;
+    // the channels of the previous frame read by FUZZY_STREAM_DELTA inputs
+    FuzzyReal_t *previous;
+    bool primed;
+    // micro-batch scratch: one input column, the crisp inputs frame by frame,
+    // batchSize states and their membership value tables
+    FuzzyReal_t *column;
+    FuzzyReal_t *crisp;
+    FuzzyReal_t *buffer;
+    FuzzyReal_t **values;
+    // the number of frames processed since the last reset
+    uint64_t frames;
+} FuzzyStream_t;
+
+bool FuzzyRingInit(FuzzyRing_t *ring, int width, size_t capacity);
+void FuzzyRingFree(FuzzyRing_t *ring);
+size_t FuzzyRingPush(FuzzyRing_t *ring, const FuzzyReal_t *frames,
+                     size_t count);
+size_t FuzzyRingPop(FuzzyRing_t *ring, FuzzyReal_t *frames, size_t count);
+size_t FuzzyRingCount(FuzzyRing_t *ring);
+size_t FuzzyRingPeek(FuzzyRing_t *ring, const FuzzyReal_t **frames);
+void FuzzyRingConsume(FuzzyRing_t *ring, size_t count);
+size_t FuzzyRingReserve(FuzzyRing_t *ring, FuzzyReal_t **frames);
+void FuzzyRingCommit(FuzzyRing_t *ring, size_t count);
+
+bool FuzzyStreamInit(FuzzyStream_t *stream, const FuzzyModel_t *model,
+                     const FuzzyStreamInput_t *inputs,
+                     const FuzzyRange_t *ranges, int batchSize);
+void FuzzyStreamFree(FuzzyStream_t *stream);
+void FuzzyStreamReset(FuzzyStream_t *stream);
+size_t FuzzyStreamProcess(FuzzyStream_t *stream, FuzzyRing_t *input,
+                          FuzzyRing_t *output);
+
+#endif
@@ -0,0 +1,60 @@
+/**
+ * @file surface.h
+ * @brief Fuzzy Logic precomputed control surface header.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#ifndef FUZZY_SURFACE_H
+#define FUZZY_SURFACE_H
+#pragma once
+
+#include "batch.h"
+#include "model.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define FUZZY_SURFACE_MAX_INPUTS 8
+
+// A model evaluated offline on a regular grid, interpolated at run time
+typedef struct {
+    int numInputs;
+    int numOutputs;
+    FuzzyGridAxis_t axes[FUZZY_SURFACE_MAX_INPUTS];
+    // grid points per unit of each input
+    FuzzyReal_t scales[FUZZY_SURFACE_MAX_INPUTS];
+    // distance in values between neighbouring grid points of each axis
+    size_t strides[FUZZY_SURFACE_MAX_INPUTS];
+    // grid points x numOutputs values, the first axis varies slowest
+    FuzzyReal_t *values;
+} FuzzySurface_t;
+
+// Interpolation error of a surface against its model
+typedef struct {
+    size_t samples;
+    // largest absolute error over all outputs and where it occurred
+    FuzzyReal_t maxError;
+    int maxErrorOutput;
+    FuzzyReal_t maxErrorInputs[FUZZY_SURFACE_MAX_INPUTS];
+    // mean and root mean square absolute error over all outputs
+    FuzzyReal_t meanError;
+    FuzzyReal_t rmsError;
+} FuzzySurfaceError_t;
+
+bool FuzzyBakeSurface(FuzzySurface_t *surface, const FuzzyModel_t *model,
+                      const FuzzyGridAxis_t *axes, int threads);
+void FuzzySurfaceFree(FuzzySurface_t *surface);
+
+void FuzzySurfaceEval(const FuzzySurface_t *surface, const FuzzyReal_t *inputs,
+                      FuzzyReal_t *outputs);
+
+bool FuzzySurfaceError(const FuzzySurface_t *surface,
+                       const FuzzyModel_t *model, int samplesPerAxis,
+                       FuzzySurfaceError_t *report);
+
+#endif
@@ -0,0 +1,58 @@
+/**
+ * @file arena.c
+ * @brief Fuzzy Logic bump allocator implementation.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "arena.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Initializes a FuzzyArena_t on a caller provided buffer.
+ *
+ * @param arena The FuzzyArena_t struct to initialize.
+ * @param buffer The memory to allocate from.
+ * @param size The size of the buffer in bytes.
+ */
+void FuzzyArenaInit(FuzzyArena_t *arena, void *buffer, size_t size) {
+    arena->buffer = (unsigned char *)buffer;
+    arena->size = size;
+    arena->used = 0;
+}
+
+/**
+ * Allocates memory from a FuzzyArena_t.
+ *
+ * The returned memory is suitably aligned for any type.
+ *
+ * @param arena The FuzzyArena_t to allocate from.
+ * @param size The number of bytes to allocate.
+ * @return The allocated memory or NULL if the arena is exhausted.
+ */
+void *FuzzyArenaAlloc(FuzzyArena_t *arena, size_t size) {
+    const uintptr_t alignment = _Alignof(max_align_t);
+    uintptr_t base = (uintptr_t)arena->buffer;
+    uintptr_t start = (base + arena->used + alignment - 1) & ~(alignment - 1);
+    size_t offset = start - base;
+
+    if (offset > arena->size || size > arena->size - offset) {
+        return NULL;
+    }
+
+    arena->used = offset + size;
+    return arena->buffer + offset;
+}
+
+/**
+ * Releases all allocations of a FuzzyArena_t at once.
+ *
+ * @param arena The FuzzyArena_t to reset.
+ */
+void FuzzyArenaReset(FuzzyArena_t *arena) { arena->used = 0; }
@@ -0,0 +1,384 @@
+/**
+ * @file batch.c
+ * @brief Fuzzy Logic multi-threaded batch evaluation implementation.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "batch.h"
+
+#include "model.h"
+#include "stats.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Define FUZZY_NO_THREADS on targets without POSIX threads, batches are then
+// evaluated on the calling thread.
+#ifndef FUZZY_NO_THREADS
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#endif
+
+// A batch is split into chunks of consecutive evaluations. Each worker owns a
+// range of chunks which it consumes from the front; idle workers steal the
+// upper half of the range of another worker.
+typedef struct {
+    const FuzzyModel_t *model;
+    // the rows of inputs, or NULL for a sweep over the grid of axes
+    const FuzzyReal_t *inputs;
+    const FuzzyGridAxis_t *axes;
+    FuzzyReal_t *outputs;
+    size_t count;
+    size_t chunkSize;
+} FuzzyBatchJob_t;
+
+/**
+ * Allocates the scratch space for the inputs of a sweep, model->numInputs
+ * values per thread. Batches of given inputs need none.
+ *
+ * @return false if allocating failed.
+ */
+static bool newPoints(const FuzzyBatchJob_t *job, int threads,
+                      FuzzyReal_t **points) {
+    *points = NULL;
+    if (job->axes == NULL) {
+        return true;
+    }
+    *points = (FuzzyReal_t *)malloc((size_t)threads * job->model->numInputs *
+                                    sizeof(FuzzyReal_t));
+    return *points != NULL;
+}
+
+/**
+ * Evaluates the evaluations [begin, end) of a batch job.
+ *
+ * @param point Scratch space for the inputs of a sweep, model->numInputs
+ * values, see newPoints().
+ */
+static void evaluateRange(const FuzzyBatchJob_t *job, FuzzyState_t *state,
+                          FuzzyReal_t *point, size_t begin, size_t end) {
+    const int numInputs = job->model->numInputs;
+    const int numOutputs = job->model->numOutputs;
+
+    for (size_t i = begin; i < end; i++) {
+        const FuzzyReal_t *inputs = point;
+        if (job->axes != NULL) {
+            FuzzyGridPoint(job->axes, numInputs, i, point);
+        } else {
+            inputs = job->inputs + i * numInputs;
+        }
+        FuzzyEvaluate(job->model, state, inputs, job->outputs + i * numOutputs);
+    }
+}
+
+#ifndef FUZZY_NO_THREADS
+
+typedef struct {
+    // owned chunk range, the low 32 bits hold the first and the high 32 bits
+    // one past the last chunk
+    _Alignas(64) _Atomic uint64_t range;
+    const FuzzyBatchJob_t *job;
+    // the scratch space of the worker, see newPoints()
+    FuzzyReal_t *point;
+    void *workers;
+    int index;
+    int numWorkers;
+    int started;
+    pthread_t thread;
+#ifdef FUZZY_ENABLE_STATS
+    // the statistics of a worker thread, kept past its exit for the caller
+    FuzzyStats_t *stats;
+#endif
+} FuzzyBatchWorker_t;
+
+static inline uint64_t packRange(uint32_t begin, uint32_t end) {
+    return ((uint64_t)end << 32) | begin;
+}
+
+/**
+ * Takes the first chunk of the range of a worker.
+ */
+static int popChunk(FuzzyBatchWorker_t *worker, uint32_t *chunk) {
+    uint64_t range = atomic_load(&worker->range);
+    for (;;) {
+        uint32_t begin = (uint32_t)range;
+        uint32_t end = (uint32_t)(range >> 32);
+        if (begin >= end) {
+            return 0;
+        }
+        if (atomic_compare_exchange_weak(&worker->range, &range,
+                                         packRange(begin + 1, end))) {
+            *chunk = begin;
+            return 1;
+        }
+    }
+}
+
+/**
+ * Moves the upper half of the range of a victim to a thief.
+ */
+static int stealChunks(FuzzyBatchWorker_t *thief, FuzzyBatchWorker_t *victim) {
+    uint64_t range = atomic_load(&victim->range);
+    for (;;) {
+        uint32_t begin = (uint32_t)range;
+        uint32_t end = (uint32_t)(range >> 32);
+        if (begin >= end) {
+            return 0;
+        }
+        uint32_t half = (end - begin + 1) / 2;
+        if (atomic_compare_exchange_weak(&victim->range, &range,
+                                         packRange(begin, end - half))) {
+            atomic_store(&thief->range, packRange(end - half, end));
+            return 1;
+        }
+    }
+}
+
+/**
+ * Worker loop: consume the own range, then steal until no work is left.
+ */
+static void *runWorker(void *argument) {
+    FuzzyBatchWorker_t *worker = (FuzzyBatchWorker_t *)argument;
+    FuzzyBatchWorker_t *workers = (FuzzyBatchWorker_t *)worker->workers;
+    const FuzzyBatchJob_t *job = worker->job;
+
+    FuzzyState_t state;
+    FuzzyStateInit(&state, job->model);
+
+    for (;;) {
+        uint32_t chunk;
+        while (popChunk(worker, &chunk)) {
+            size_t begin = (size_t)chunk * job->chunkSize;
+            size_t end = begin + job->chunkSize;
+            if (end > job->count) {
+                end = job->count;
+            }
+            evaluateRange(job, &state, worker->point, begin, end);
+        }
+
+        // No work is ever added, so one fruitless pass over all other
+        // workers means the batch is done
+        int stolen = 0;
+        for (int i = 1; i < worker->numWorkers && !stolen; i++) {
+            int victim = (worker->index + i) % worker->numWorkers;
+            stolen = stealChunks(worker, &workers[victim]);
+        }
+        if (!stolen) {
+            break;
+        }
+    }
+
+    FuzzyStateFree(&state);
+
+#ifdef FUZZY_ENABLE_STATS
+    // The statistics of the thread die with it, the caller merges the copy
+    if (worker->index != 0) {
+        worker->stats = (FuzzyStats_t *)malloc(sizeof(FuzzyStats_t));
+        if (worker->stats != NULL) {
+            *worker->stats = *FuzzyStatsGet();
+        }
+    }
+#endif
+    return NULL;
+}
+
+#endif
+
+/**
+ * Runs a batch job on multiple threads, see FuzzyEvaluateBatch().
+ *
+ * @return false if allocating the scratch space of a sweep failed, no outputs
+ * are written then.
+ */
+static bool runJob(FuzzyBatchJob_t *job, int threads) {
+    FuzzyReal_t *points;
+
+#ifndef FUZZY_NO_THREADS
+    if (threads <= 0) {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = processors > 0 ? (int)processors : 1;
+    }
+
+    // Aim for a few dozen chunks per thread so stealing can balance the load
+    job->chunkSize = job->count / ((size_t)threads * 32);
+    if (job->chunkSize < 16) {
+        job->chunkSize = 16;
+    }
+    size_t numChunks = (job->count + job->chunkSize - 1) / job->chunkSize;
+    // chunk indexes are 32 bits wide
+    while (numChunks > UINT32_MAX) {
+        job->chunkSize *= 2;
+        numChunks = (job->count + job->chunkSize - 1) / job->chunkSize;
+    }
+    if ((size_t)threads > numChunks) {
+        threads = numChunks > 0 ? (int)numChunks : 1;
+    }
+
+    // Without memory for the workers the batch runs on the calling thread
+    FuzzyBatchWorker_t *workers =
+        threads > 1 ? (FuzzyBatchWorker_t *)aligned_alloc(
+                          _Alignof(FuzzyBatchWorker_t),
+                          threads * sizeof(FuzzyBatchWorker_t))
+                    : NULL;
+    if (workers != NULL) {
+        if (!newPoints(job, threads, &points)) {
+            free(workers);
+            return false;
+        }
+
+        for (int i = 0; i < threads; i++) {
+            uint32_t begin = (uint32_t)(numChunks * i / threads);
+            uint32_t end = (uint32_t)(numChunks * (i + 1) / threads);
+            atomic_init(&workers[i].range, packRange(begin, end));
+            workers[i].job = job;
+            workers[i].point =
+                points != NULL ? points + i * job->model->numInputs : NULL;
+            workers[i].workers = workers;
+            workers[i].index = i;
+            workers[i].numWorkers = threads;
+#ifdef FUZZY_ENABLE_STATS
+            workers[i].stats = NULL;
+#endif
+        }
+
+        // The calling thread is worker 0; if a thread can not be created its
+        // chunks are stolen by the remaining workers
+        for (int i = 1; i < threads; i++) {
+            workers[i].started = pthread_create(&workers[i].thread, NULL,
+                                                runWorker, &workers[i]) == 0;
+        }
+        runWorker(&workers[0]);
+        for (int i = 1; i < threads; i++) {
+            if (workers[i].started) {
+                pthread_join(workers[i].thread, NULL);
+            }
+#ifdef FUZZY_ENABLE_STATS
+            if (workers[i].stats != NULL) {
+                FuzzyStatsMerge(FuzzyStatsGet(), workers[i].stats);
+                free(workers[i].stats);
+            }
+#endif
+        }
+
+        free(points);
+        free(workers);
+        return true;
+    }
+#else
+    (void)threads;
+#endif
+
+    if (!newPoints(job, 1, &points)) {
+        return false;
+    }
+    FuzzyState_t state;
+    FuzzyStateInit(&state, job->model);
+    evaluateRange(job, &state, points, 0, job->count);
+    FuzzyStateFree(&state);
+    free(points);
+    return true;
+}
+
+/**
+ * Evaluates a model for a batch of crisp inputs on multiple threads.
+ *
+ * The inputs are stored row by row, count rows of model->numInputs values,
+ * and the outputs are written the same way with model->numOutputs values per
+ * row. The batch is split into chunks which are distributed over the threads
+ * and balanced by work stealing; every thread uses its own FuzzyState_t.
+ * Builds with FUZZY_ENABLE_STATS add the statistics of the worker threads to
+ * those of the calling thread.
+ *
+ * @param model The FuzzyModel_t to evaluate.
+ * @param inputs The crisp inputs, count x model->numInputs values.
+ * @param outputs The crisp outputs, count x model->numOutputs values.
+ * @param count The number of evaluations.
+ * @param threads The number of threads to use including the calling thread,
+ * zero or less uses one thread per online processor.
+ */
+void FuzzyEvaluateBatch(const FuzzyModel_t *model, const FuzzyReal_t *inputs,
+                        FuzzyReal_t *outputs, size_t count, int threads) {
+    FuzzyBatchJob_t job = {.model = model,
+                           .inputs = inputs,
+                           .axes = NULL,
+                           .outputs = outputs,
+                           .count = count};
+    // Batches of given inputs need no scratch space, so they always run
+    (void)runJob(&job, threads);
+}
+
+/**
+ * Evaluates a model over a Cartesian grid of crisp inputs on multiple threads.
+ *
+ * Axis i spans input i of the model with axes[i].points evenly spaced points
+ * from axes[i].min to axes[i].max, a single point holds the input at min. The
+ * grid points are generated on the fly by FuzzyGridPoint() and evaluated like
+ * FuzzyEvaluateBatch() does, nothing is printed. The outputs are stored in
+ * row-major order with the last axis varying fastest and model->numOutputs
+ * values per point, so they form a C array of dimensions
+ * axes[0].points x ... x numOutputs.
+ *
+ * @param model The FuzzyModel_t to evaluate.
+ * @param axes The grid, model->numInputs axes.
+ * @param outputs The crisp outputs, FuzzySweepCount() x model->numOutputs
+ * values.
+ * @param threads The number of threads to use including the calling thread,
+ * zero or less uses one thread per online processor.
+ * @return false if allocating the scratch space for the grid points failed,
+ * no outputs are written then.
+ */
+bool FuzzySweep(const FuzzyModel_t *model, const FuzzyGridAxis_t *axes,
+                FuzzyReal_t *outputs, int threads) {
+    FuzzyBatchJob_t job = {.model = model,
+                           .inputs = NULL,
+                           .axes = axes,
+                           .outputs = outputs,
+                           .count = FuzzySweepCount(model, axes)};
+    return runJob(&job, threads);
+}
+
+/**
+ * Calculates the number of points of a sweep grid.
+ *
+ * @param model The FuzzyModel_t to sweep.
+ * @param axes The grid, model->numInputs axes.
+ * @return The product of the point counts of all axes.
+ */
+size_t FuzzySweepCount(const FuzzyModel_t *model,
+                       const FuzzyGridAxis_t *axes) {
+    size_t count = 1;
+    for (int i = 0; i < model->numInputs; i++) {
+        count *= axes[i].points > 0 ? (size_t)axes[i].points : 0;
+    }
+    return count;
+}
+
+/**
+ * Calculates the inputs of a point of a grid.
+ *
+ * The points are numbered in row-major order, the last axis varying fastest
+ * like the outputs of FuzzySweep().
+ *
+ * @param axes The axes of the grid, each with at least one point.
+ * @param numAxes The number of axes.
+ * @param index The index of the point, below the product of the point counts.
+ * @param inputs Receives one value per axis.
+ */
+void FuzzyGridPoint(const FuzzyGridAxis_t *axes, int numAxes, size_t index,
+                    FuzzyReal_t *inputs) {
+    for (int k = numAxes - 1; k >= 0; k--) {
+        const size_t points = (size_t)axes[k].points;
+        const size_t i = index % points;
+        index /= points;
+        inputs[k] = points > 1 ? axes[k].min + (axes[k].max - axes[k].min) *
+                                                   (FuzzyReal_t)i / (points - 1)
+                               : axes[k].min;
+    }
+}
@@ -11,17 +11,31 @@
 
 #include "class.h"
 
+#include "arena.h"
+#include "defuzzifier.h"
 #include "membership_function.h"
 
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+/**
+ * Stores the centroids of the membership functions of a set in its layout.
+ */
+static void prepareCentroids(const FuzzySet_t *set,
+                             MembershipLayout_t *layout) {
+    for (int i = 0; i < set->length; i++) {
+        layout->centroids[i] =
+            calculateCentroid(set->membershipFunctions[i], FUZZY_REAL_C(1.0));
+    }
+}
+
 /**
  * Initializes a FuzzySet_t struct.
  *
  * This function allocates memory for the membership values in the FuzzySet_t
- * struct.
+ * struct. Builds with FUZZY_DIVISION_FREE also enable the layout of the set,
+ * see FuzzySetEnableLayout().
  *
  * @param set The FuzzySet_t struct to initialize.
  * @param membershipFunctions The membership functions for this FuzzySet_t.
@@ -31,27 +45,447 @@ void FuzzySetInit(FuzzySet_t *set,
                   const MembershipFunction_t *membershipFunctions, int length) {
 
     set->length = length;
+    set->ownsStorage = true;
+    set->partition = NULL;
+    set->memo = NULL;
+    set->layout = NULL;
 
-    set->membershipValues = (double *)malloc(length * sizeof(double));
-    set->membershipFunctions =
+    set->membershipValues = (FuzzyReal_t *)malloc(length * sizeof(FuzzyReal_t));
+    MembershipFunction_t *functions =
         (MembershipFunction_t *)malloc(length * sizeof(MembershipFunction_t));
 
     for (int i = 0; i < length; i++) {
-        set->membershipFunctions[i] = membershipFunctions[i];
+        functions[i] = membershipFunctions[i];
+    }
+    set->membershipFunctions = functions;
+
+#ifdef FUZZY_DIVISION_FREE
+    // Without memory for the layout the set is classified by division
+    FuzzySetEnableLayout(set);
+#endif
+}
+
+/**
+ * Initializes a FuzzySet_t struct without allocating memory.
+ *
+ * The membership functions are borrowed rather than copied, so they must
+ * outlive the set (as the static arrays of DEFINE_FUZZY_MEMBERSHIP do). The
+ * membership values are stored in the caller provided buffer, see
+ * FUZZY_SET_STORAGE(). No layout is enabled, also in FUZZY_DIVISION_FREE
+ * builds, see FuzzySetEnableLayout().
+ *
+ * @param set The FuzzySet_t struct to initialize.
+ * @param membershipFunctions The membership functions for this FuzzySet_t.
+ * @param length The number of membership values and Functions in the set.
+ * @param values The storage for the membership values, must hold length
+ * values.
+ */
+void FuzzySetInitBuffer(FuzzySet_t *set,
+                        const MembershipFunction_t *membershipFunctions,
+                        int length, FuzzyReal_t *values) {
+    set->length = length;
+    set->ownsStorage = false;
+    set->partition = NULL;
+    set->memo = NULL;
+    set->layout = NULL;
+    set->membershipValues = values;
+    set->membershipFunctions = membershipFunctions;
+
+    for (int i = 0; i < length; i++) {
+        values[i] = 0.0;
+    }
+}
+
+/**
+ * Initializes a FuzzySet_t struct with storage from an arena.
+ *
+ * This function works like FuzzySetInitBuffer() but takes the storage for the
+ * membership values from an arena. Builds with FUZZY_DIVISION_FREE also take
+ * the layout of the set from the arena, see FuzzySetEnableLayout().
+ *
+ * @param set The FuzzySet_t struct to initialize.
+ * @param membershipFunctions The membership functions for this FuzzySet_t.
+ * @param length The number of membership values and Functions in the set.
+ * @param arena The FuzzyArena_t to allocate from.
+ * @return false if the arena is exhausted, the set is left untouched then.
+ */
+bool FuzzySetInitArena(FuzzySet_t *set,
+                       const MembershipFunction_t *membershipFunctions,
+                       int length, FuzzyArena_t *arena) {
+    FuzzyReal_t *values =
+        (FuzzyReal_t *)FuzzyArenaAlloc(arena, length * sizeof(FuzzyReal_t));
+    if (values == NULL) {
+        return false;
+    }
+
+    FuzzySetInitBuffer(set, membershipFunctions, length, values);
+
+#ifdef FUZZY_DIVISION_FREE
+    // Without room for the layout the set is classified by division
+    MembershipLayout_t *layout = (MembershipLayout_t *)FuzzyArenaAlloc(
+        arena, sizeof(MembershipLayout_t));
+    void *storage = FuzzyArenaAlloc(arena, FUZZY_LAYOUT_SIZE(length));
+    if (layout != NULL && storage != NULL) {
+        membershipLayoutInitBuffer(layout, membershipFunctions, length,
+                                   storage);
+        prepareCentroids(set, layout);
+        set->layout = layout;
     }
+#endif
+    return true;
+}
+
+static void freeLayout(MembershipLayout_t *layout) {
+    if (layout == NULL || !layout->ownsStorage) {
+        return;
+    }
+    membershipLayoutFree(layout);
+    free(layout);
+}
+
+static void freePartition(FuzzyPartition_t *partition) {
+    if (partition == NULL) {
+        return;
+    }
+    free(partition->breakpoints);
+    free(partition->regionStarts);
+    free(partition->regionFunctions);
+    free(partition->buckets);
+    free(partition);
 }
 
 /**
  * Frees the memory allocated for a FuzzySet_t struct.
  *
  * This function should be called when the FuzzySet_t struct is no longer
- * needed.
+ * needed. The partition index, memo cache and layout are always released,
+ * borrowed storage is left untouched.
  *
  * @param set The FuzzySet_t struct to free.
  */
 void FuzzySetFree(FuzzySet_t *set) {
+    freePartition(set->partition);
+    set->partition = NULL;
+    if (set->memo != NULL) {
+        FuzzyMemoFree(set->memo);
+        free(set->memo);
+        set->memo = NULL;
+    }
+    freeLayout(set->layout);
+    set->layout = NULL;
+    if (!set->ownsStorage) {
+        return;
+    }
     free(set->membershipValues);
-    free(set->membershipFunctions);
+    free((void *)set->membershipFunctions);
+}
+
+// Only the partition index needs the supports, FUZZY_WCET builds have none
+#ifndef FUZZY_WCET
+/**
+ * Finds the closed interval outside of which a membership function is zero.
+ *
+ * @param mf The membership function.
+ * @param lo Receives the lower bound of the support.
+ * @param hi Receives the upper bound of the support.
+ * @return false if the function is zero everywhere.
+ */
+static bool membershipSupport(MembershipFunction_t mf, FuzzyReal_t *lo,
+                              FuzzyReal_t *hi) {
+    switch (mf.type) {
+    case TRIANGULAR:
+        *lo = mf.a;
+        *hi = mf.c;
+        return true;
+    case TRAPEZOIDAL:
+        *lo = mf.a;
+        *hi = mf.d;
+        return true;
+    case RECTANGULAR:
+        *lo = mf.a;
+        *hi = mf.b;
+        return true;
+    case GAUSSIAN:
+    case SIGMOID:
+    case BELL:
+        // The smooth shapes are only zero far out in their tails
+        *lo = -INFINITY;
+        *hi = INFINITY;
+        return true;
+    case SINGLETON:
+        *lo = mf.a;
+        *hi = mf.a;
+        return true;
+    default:
+        return false;
+    }
+}
+
+static int compareDouble(const void *a, const void *b) {
+    const FuzzyReal_t x = *(const FuzzyReal_t *)a;
+    const FuzzyReal_t y = *(const FuzzyReal_t *)b;
+    return (x > y) - (x < y);
+}
+#endif
+
+/**
+ * Finds the region of the universe of a partition containing x.
+ *
+ * Regions alternate between the open intervals between breakpoints and the
+ * breakpoints themselves (see FuzzyPartition_t), so a partition with n
+ * breakpoints has 2n + 1 regions. Uniform partitions start at the first
+ * breakpoint of the bucket of x and step over the few remaining ones, others
+ * use a binary search.
+ *
+ * @param partition The FuzzyPartition_t to search.
+ * @param x The input value, must not be NaN.
+ * @return The region index.
+ */
+int FuzzyPartitionRegion(const FuzzyPartition_t *partition, FuzzyReal_t x) {
+    const FuzzyReal_t *points = partition->breakpoints;
+    const int n = partition->numBreakpoints;
+
+    // Find the number of breakpoints less than or equal to x
+    int count;
+    if (partition->uniform) {
+        const FuzzyReal_t bucket =
+            (x - partition->origin) * partition->inverseStep;
+        const int b = bucket < FUZZY_REAL_C(0.0) ? 0
+                      : bucket >= partition->numBuckets
+                          ? partition->numBuckets - 1
+                          : (int)bucket;
+        count = partition->buckets[b];
+        while (count < n && points[count] <= x) {
+            count++;
+        }
+        while (count > 0 && points[count - 1] > x) {
+            count--;
+        }
+    } else {
+        int low = 0;
+        int high = n;
+        while (low < high) {
+            int mid = low + (high - low) / 2;
+            if (points[mid] <= x) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        count = low;
+    }
+
+    if (count > 0 && points[count - 1] == x) {
+        return 2 * count - 1;
+    }
+    return 2 * count;
+}
+
+/**
+ * Builds a sorted breakpoint index for the classification of a set.
+ *
+ * In a strong fuzzy partition only one or two membership functions are
+ * non-zero at any input, yet FuzzyClassifierValues() evaluates all of them.
+ * With the index it looks up the region of the input, evaluates only the
+ * functions whose closed support reaches into it and zero fills the rest,
+ * which gives exactly the same values. Enabling is worthwhile for sets with
+ * many functions; the index is released by FuzzySetFree(). The membership
+ * functions must not change while the index is enabled; enabling it again
+ * rebuilds the index. FUZZY_WCET builds always evaluate every function and
+ * have no index.
+ *
+ * @param set The FuzzySet_t struct to index.
+ * @return false if allocating the index failed or in FUZZY_WCET builds, the
+ * set is left unchanged then.
+ */
+bool FuzzySetEnablePartition(FuzzySet_t *set) {
+#ifdef FUZZY_WCET
+    (void)set;
+    return false;
+#else
+    FuzzyPartition_t *partition =
+        (FuzzyPartition_t *)calloc(1, sizeof(FuzzyPartition_t));
+    FuzzyReal_t *points =
+        (FuzzyReal_t *)malloc((2 * set->length + 1) * sizeof(FuzzyReal_t));
+    if (partition == NULL || points == NULL) {
+        free(partition);
+        free(points);
+        return false;
+    }
+
+    // Collect the sorted, distinct support bounds
+    int n = 0;
+    for (int i = 0; i < set->length; i++) {
+        FuzzyReal_t lo, hi;
+        if (membershipSupport(set->membershipFunctions[i], &lo, &hi)) {
+            points[n++] = lo;
+            points[n++] = hi;
+        }
+    }
+    qsort(points, n, sizeof(FuzzyReal_t), compareDouble);
+    int unique = 0;
+    for (int i = 0; i < n; i++) {
+        if (unique == 0 || points[i] != points[unique - 1]) {
+            points[unique++] = points[i];
+        }
+    }
+    n = unique;
+
+    partition->breakpoints = points;
+    partition->numBreakpoints = n;
+
+    // List the functions of every region in two passes, counting first
+    const int numRegions = 2 * n + 1;
+    int *starts = (int *)calloc(numRegions + 1, sizeof(int));
+    partition->regionStarts = starts;
+    if (starts == NULL) {
+        freePartition(partition);
+        return false;
+    }
+    int *functions = NULL;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < set->length; i++) {
+            FuzzyReal_t lo, hi;
+            if (!membershipSupport(set->membershipFunctions[i], &lo, &hi)) {
+                continue;
+            }
+            int first = FuzzyPartitionRegion(partition, lo);
+            int last = FuzzyPartitionRegion(partition, hi);
+            for (int r = first; r <= last; r++) {
+                if (pass == 0) {
+                    starts[r + 1]++;
+                } else {
+                    functions[starts[r]++] = i;
+                }
+            }
+        }
+
+        if (pass == 0) {
+            for (int r = 0; r < numRegions; r++) {
+                starts[r + 1] += starts[r];
+            }
+            functions = (int *)malloc(
+                (starts[numRegions] > 0 ? starts[numRegions] : 1) *
+                sizeof(int));
+            partition->regionFunctions = functions;
+            if (functions == NULL) {
+                freePartition(partition);
+                return false;
+            }
+        }
+    }
+    // The second pass advanced every start to the start of the next region
+    for (int r = numRegions; r > 0; r--) {
+        starts[r] = starts[r - 1];
+    }
+    starts[0] = 0;
+
+    // Use direct indexing if no bucket holds more than a few breakpoints. The
+    // lookup corrects the bucket start, so rounding only costs extra steps.
+    const FuzzyReal_t step =
+        n >= 2 ? (points[n - 1] - points[0]) / (n - 1) : FUZZY_REAL_C(0.0);
+    int *buckets = (step > FUZZY_REAL_C(0.0) && isfinite(step))
+                       ? (int *)malloc((n - 1) * sizeof(int))
+                       : NULL;
+    if (buckets != NULL) {
+        int count = 0;
+        int widest = 0;
+        for (int b = 0; b < n - 1; b++) {
+            const int start = count;
+            while (count < n && (points[count] - points[0]) / step < b) {
+                count++;
+            }
+            buckets[b] = count;
+            if (b > 0 && count - start > widest) {
+                widest = count - start;
+            }
+        }
+        if (n - count > widest) {
+            widest = n - count;
+        }
+
+        partition->uniform = widest <= 4;
+        partition->origin = points[0];
+        partition->inverseStep = FUZZY_REAL_C(1.0) / step;
+        partition->buckets = buckets;
+        partition->numBuckets = n - 1;
+    }
+
+    freePartition(set->partition);
+    set->partition = partition;
+    return true;
+#endif
+}
+
+/**
+ * Enables a memo cache for the classification of a set.
+ *
+ * FuzzyClassifier() then looks up the input in a direct-mapped cache keyed by
+ * its exact value and copies the cached membership values on a hit instead of
+ * evaluating the membership functions. This pays off for quantized inputs
+ * which recur constantly, such as ADC readings. The hit and miss counters are
+ * kept in set->memo. The cache is released by FuzzySetFree() and has to be
+ * cleared with FuzzyMemoClear() if the membership functions change. As the
+ * cache is written on every miss, a set with a cache must not be classified
+ * from several threads; FuzzyClassifierValues() does not use the cache.
+ *
+ * @param set The FuzzySet_t struct to cache.
+ * @param numEntries The number of cached inputs, rounded up to a power of two.
+ * @return false if allocating the cache failed or in FUZZY_WCET builds (see
+ * FuzzyMemoInit()), the set is left uncached then.
+ */
+bool FuzzySetEnableMemo(FuzzySet_t *set, int numEntries) {
+    FuzzyMemo_t *memo = (FuzzyMemo_t *)malloc(sizeof(FuzzyMemo_t));
+    if (memo == NULL) {
+        return false;
+    }
+    if (!FuzzyMemoInit(memo, numEntries, 1, set->length)) {
+        free(memo);
+        return false;
+    }
+
+    if (set->memo != NULL) {
+        FuzzyMemoFree(set->memo);
+        free(set->memo);
+    }
+    set->memo = memo;
+    return true;
+}
+
+/**
+ * Enables a vectorized, division-free classification of a set.
+ *
+ * The membership functions are copied into a struct-of-arrays layout grouped
+ * by type, with the reciprocals of the edge widths precomputed, see
+ * MembershipLayout_t. FuzzyClassifierValues() then evaluates every group with
+ * one SIMD loop across its functions and multiplies instead of dividing. The
+ * degrees on the edges of the functions may differ from the exact quotients
+ * by one ulp, supports, peaks and plateaus are exact. Sets with a partition
+ * index keep using the index and evaluate its candidates with the prepared
+ * slopes. The centroids of the functions are prepared as
+ * well, which spares defuzzificationValues() a division per function. The
+ * layout is released by FuzzySetFree(), the membership functions must not
+ * change while it is enabled.
+ *
+ * @param set The FuzzySet_t struct to lay out.
+ * @return false if allocating the layout failed, the set is left unchanged
+ * then.
+ */
+bool FuzzySetEnableLayout(FuzzySet_t *set) {
+    MembershipLayout_t *layout =
+        (MembershipLayout_t *)malloc(sizeof(MembershipLayout_t));
+    if (layout == NULL) {
+        return false;
+    }
+    if (!membershipLayoutInit(layout, set->membershipFunctions, set->length)) {
+        free(layout);
+        return false;
+    }
+    prepareCentroids(set, layout);
+
+    freeLayout(set->layout);
+    set->layout = layout;
+    return true;
 }
 
 /**
@@ -63,25 +497,65 @@ void FuzzySetFree(FuzzySet_t *set) {
  * @param set The FuzzySet_t struct to normalize.
  */
 void normalizeClass(FuzzySet_t *set) {
+    normalizeMembershipValues(set->membershipValues, set->length);
+}
+
+/**
+ * Normalizes an array of membership values.
+ *
+ * This function calculates the sum of all membership values and divides each
+ * membership value by the sum. If the sum is zero all values are set to zero.
+ * Builds with FUZZY_DIVISION_FREE multiply by the reciprocal of the sum,
+ * FUZZY_WCET builds divide in both cases and select the zeros.
+ *
+ * @param values The membership values to normalize.
+ * @param length The number of membership values.
+ */
+void normalizeMembershipValues(FuzzyReal_t *values, int length) {
     // Calculate the sum of all membership values
-    double sum = 0.0;
-    for (int i = 0; i < set->length; i++) {
-        sum += set->membershipValues[i];
+    FuzzyReal_t sum = 0.0;
+    for (int i = 0; i < length; i++) {
+        sum += values[i];
     }
 
+#ifdef FUZZY_WCET
+    // Divide unconditionally and select 0 for a zero sum, so both cases take
+    // the same time
+    const FuzzyReal_t divisor =
+        sum == FUZZY_REAL_C(0.0) ? FUZZY_REAL_C(1.0) : sum;
+#ifdef FUZZY_DIVISION_FREE
+    const FuzzyReal_t scale = FUZZY_REAL_C(1.0) / divisor;
+#endif
+    for (int i = 0; i < length; i++) {
+#ifdef FUZZY_DIVISION_FREE
+        const FuzzyReal_t value = values[i] * scale;
+#else
+        const FuzzyReal_t value = values[i] / divisor;
+#endif
+        values[i] = sum == FUZZY_REAL_C(0.0) ? FUZZY_REAL_C(0.0) : value;
+    }
+#else
     // Check for division by zero
-    if (sum == 0.0) {
+    if (sum == FUZZY_REAL_C(0.0)) {
         // Handle the case where the sum is zero
         // For example, set all membership values to 0.0
-        for (int i = 0; i < set->length; i++) {
-            set->membershipValues[i] = 0.0;
+        for (int i = 0; i < length; i++) {
+            values[i] = 0.0;
         }
     } else {
         // Normalize the membership values
-        for (int i = 0; i < set->length; i++) {
-            set->membershipValues[i] /= sum;
+#ifdef FUZZY_DIVISION_FREE
+        const FuzzyReal_t scale = FUZZY_REAL_C(1.0) / sum;
+        for (int i = 0; i < length; i++) {
+            values[i] *= scale;
+        }
+#else
+        for (int i = 0; i < length; i++) {
+            values[i] /= sum;
         }
+#endif
     }
+#endif
 }
 
 /**
@@ -109,7 +583,7 @@ void printClassifier(FuzzySet_t *set, const char **labels) {
                 printf(" ");
             }
         }
-        printf("] %6.2f %%\n", set->membershipValues[i] * 100.0);
+        printf("] %6.2f %%\n", (double)set->membershipValues[i] * 100.0);
     }
     printf("\n");
 }
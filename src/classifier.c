@@ -12,9 +12,11 @@
 #include "classifier.h"
 
 #include "membership_function.h"
+#include "stats.h"
 
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 
 /**
  * Performs fuzzy classification on an input value.
@@ -22,13 +24,147 @@
  * This function takes an input value x and a FuzzySet_t struct as
  * arguments. It calculates the membership degree of the input value for each
  * membership function in the FuzzySet_t struct and stores the resulting values.
+ * Sets with a memo cache (see FuzzySetEnableMemo()) copy the cached values of
+ * recurring inputs instead.
  *
  * @param x The input value to classify.
  * @param input The FuzzySet_t
  */
-void FuzzyClassifier(double x, FuzzySet_t *set) {
+void FuzzyClassifier(FuzzyReal_t x, FuzzySet_t *set) {
+    if (set->memo == NULL) {
+        FuzzyClassifierValues(x, set, set->membershipValues);
+        return;
+    }
+
+    bool hit;
+    FuzzyReal_t *cached = FuzzyMemoLookup(set->memo, &x, &hit);
+    if (!hit) {
+        FuzzyClassifierValues(x, set, cached);
+        memcpy(set->membershipValues, cached,
+               set->length * sizeof(FuzzyReal_t));
+        return;
+    }
+
+    // Hits are recorded as classifications, too
+    FUZZY_STATS_BEGIN();
+    memcpy(set->membershipValues, cached, set->length * sizeof(FuzzyReal_t));
+    FUZZY_STATS_END(FUZZY_STAGE_CLASSIFY);
+    FUZZY_STATS_SET(set, cached);
+}
+
+/**
+ * Performs fuzzy classification on an input value into a caller buffer.
+ *
+ * This function works like FuzzyClassifier() but stores the membership
+ * degrees in the values array instead of the set, so the set itself is only
+ * read and can be shared between threads. Sets with a partition index (see
+ * FuzzySetEnablePartition()) only evaluate the functions which can be non-zero
+ * at x, sets with a layout (see FuzzySetEnableLayout()) evaluate all functions
+ * with vector loops, or the candidates of the partition index with the
+ * prepared slopes.
+ *
+ * @param x The input value to classify.
+ * @param set The FuzzySet_t providing the membership functions.
+ * @param values The output buffer, must hold set->length values.
+ */
+void FuzzyClassifierValues(FuzzyReal_t x, const FuzzySet_t *set,
+                           FuzzyReal_t *values) {
+    FUZZY_STATS_BEGIN();
+    const FuzzyPartition_t *partition = set->partition;
+    // NaN inputs take the dense path, which propagates them
+    if (partition != NULL && !isnan(x)) {
+        for (int i = 0; i < set->length; i++) {
+            values[i] = 0.0;
+        }
+        const int region = FuzzyPartitionRegion(partition, x);
+        for (int k = partition->regionStarts[region];
+             k < partition->regionStarts[region + 1]; k++) {
+            const int i = partition->regionFunctions[k];
+            values[i] =
+                set->layout != NULL
+                    ? membershipLayoutValue(x, set->layout, i)
+                    : membershipFunction(x, set->membershipFunctions[i]);
+        }
+    } else if (set->layout != NULL) {
+        membershipLayoutValues(x, set->layout, values);
+    } else {
+        for (int i = 0; i < set->length; i++) {
+            values[i] = membershipFunction(x, set->membershipFunctions[i]);
+        }
+    }
+    FUZZY_STATS_END(FUZZY_STAGE_CLASSIFY);
+    FUZZY_STATS_SET(set, values);
+}
+
+/**
+ * Performs fuzzy classification on an input value, reporting only the
+ * membership functions which can be non-zero.
+ *
+ * The indices and degrees of the candidate functions are stored in indices and
+ * values, all other functions have a degree of zero. Without a partition index
+ * every function is evaluated and the non-zero ones are reported. The degrees
+ * equal those of FuzzyClassifierValues().
+ *
+ * @param x The input value to classify.
+ * @param set The FuzzySet_t providing the membership functions.
+ * @param indices The output buffer for the function indices, must hold
+ * set->length values.
+ * @param values The output buffer for the degrees, must hold set->length
+ * values.
+ * @return The number of reported functions.
+ */
+int FuzzyClassifierSparse(FuzzyReal_t x, const FuzzySet_t *set, int *indices,
+                          FuzzyReal_t *values) {
+    const FuzzyPartition_t *partition = set->partition;
+    int count = 0;
+
+    if (partition != NULL && !isnan(x)) {
+        const int region = FuzzyPartitionRegion(partition, x);
+        for (int k = partition->regionStarts[region];
+             k < partition->regionStarts[region + 1]; k++) {
+            const int i = partition->regionFunctions[k];
+            indices[count] = i;
+            values[count] =
+                set->layout != NULL
+                    ? membershipLayoutValue(x, set->layout, i)
+                    : membershipFunction(x, set->membershipFunctions[i]);
+            count++;
+        }
+        return count;
+    }
+
     for (int i = 0; i < set->length; i++) {
-        set->membershipValues[i] =
-            membershipFunction(x, set->membershipFunctions[i]);
+        FuzzyReal_t value =
+            set->layout != NULL
+                ? membershipLayoutValue(x, set->layout, i)
+                : membershipFunction(x, set->membershipFunctions[i]);
+        if (value != FUZZY_REAL_C(0.0)) {
+            indices[count] = i;
+            values[count] = value;
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * Performs fuzzy classification on many input values at once.
+ *
+ * This function classifies n input values against the membership functions of
+ * a FuzzySet_t struct and writes an n x length membership matrix. Row i holds
+ * the membership degrees of xs[i], so out[i * set->length + j] is the degree
+ * of xs[i] in membership function j. The membership values stored in the set
+ * itself are not touched.
+ *
+ * @param xs The input values to classify.
+ * @param n The number of input values.
+ * @param set The FuzzySet_t providing the membership functions.
+ * @param out The output matrix, must hold n * set->length values.
+ */
+void FuzzyClassifierBatch(const FuzzyReal_t *xs, size_t n,
+                          const FuzzySet_t *set, FuzzyReal_t *out) {
+    for (int j = 0; j < set->length; j++) {
+        membershipFunctionBatch(xs, n, set->membershipFunctions[j], out + j,
+                                (size_t)set->length);
     }
 }
@@ -0,0 +1,381 @@
+/**
+ * @file cost.c
+ * @brief Fuzzy Logic static cost analysis implementation.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "cost.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// The primitive operations of the scalar code paths of the library, counted
+// operation by operation in the order of FuzzyCostPrimitive_e:
+//   add, mul, div, compare, load, store, branch, math
+// Every membership function costs its shape, its dispatch and its store
+static const uint16_t classifyMix[FUZZY_NUM_MEMBERSHIP_TYPES]
+                                 [FUZZY_NUM_COSTS] = {
+    [TRIANGULAR] = {4, 0, 2, 7, 4, 1, 2, 0},
+    [TRAPEZOIDAL] = {4, 0, 2, 7, 5, 1, 2, 0},
+    [RECTANGULAR] = {0, 0, 0, 3, 3, 1, 2, 0},
+    [GAUSSIAN] = {15, 14, 1, 7, 3, 1, 2, 0},
+    [SIGMOID] = {15, 12, 1, 6, 3, 1, 2, 0},
+    [BELL] = {26, 23, 3, 18, 4, 1, 2, 0},
+    [SINGLETON] = {0, 0, 0, 2, 2, 1, 2, 0},
+};
+
+// Layouts evaluate triangles and trapezoids with the prepared reciprocal
+// slopes, the other shapes cost the same as without a layout
+static const uint16_t preparedMix[2][FUZZY_NUM_COSTS] = {
+    [TRIANGULAR] = {2, 2, 0, 7, 6, 1, 1, 0},
+    [TRAPEZOIDAL] = {2, 2, 0, 7, 7, 1, 1, 0},
+};
+
+// Every classified set checks for a partition and a layout
+static const uint16_t setMix[FUZZY_NUM_COSTS] = {0, 0, 0, 2, 2, 0, 2, 0};
+
+// Every op is loaded and dispatched, the leaves read one membership value and
+// the NOT leaves take its complement
+static const uint16_t opMix[FUZZY_NUM_OP_CODES][FUZZY_NUM_COSTS] = {
+    [FUZZY_OP_RULE] = {0, 0, 0, 0, 1, 0, 2, 0},
+    [FUZZY_OP_ALL_OF] = {0, 0, 0, 0, 1, 0, 2, 0},
+    [FUZZY_OP_ANY_OF] = {0, 0, 0, 0, 1, 0, 2, 0},
+    [FUZZY_OP_MIN] = {0, 0, 0, 0, 3, 0, 2, 0},
+    [FUZZY_OP_MIN_NOT] = {1, 0, 0, 0, 3, 0, 2, 0},
+    [FUZZY_OP_MAX] = {0, 0, 0, 0, 3, 0, 2, 0},
+    [FUZZY_OP_MAX_NOT] = {1, 0, 0, 0, 3, 0, 2, 0},
+    [FUZZY_OP_REDUCE] = {0, 0, 0, 0, 1, 0, 2, 0},
+    [FUZZY_OP_ACCUMULATE] = {0, 0, 0, 0, 3, 1, 2, 0},
+    [FUZZY_OP_STORE] = {0, 0, 0, 0, 2, 1, 2, 0},
+    [FUZZY_OP_LOAD] = {0, 0, 0, 0, 3, 0, 2, 0},
+};
+
+// The t-norms and s-norms of the operator families, see FuzzyNorm_e, and the
+// sum of Takagi-Sugeno weights
+static const uint16_t tNormMix[FUZZY_NORM_HAMACHER + 1][FUZZY_NUM_COSTS] = {
+    [FUZZY_NORM_MIN_MAX] = {0, 0, 0, 1, 0, 0, 0, 0},
+    [FUZZY_NORM_PRODUCT] = {0, 1, 0, 0, 0, 0, 0, 0},
+    [FUZZY_NORM_LUKASIEWICZ] = {2, 0, 0, 1, 0, 0, 0, 0},
+    [FUZZY_NORM_HAMACHER] = {2, 1, 1, 1, 0, 0, 0, 0},
+};
+static const uint16_t sNormMix[FUZZY_NORM_HAMACHER + 1][FUZZY_NUM_COSTS] = {
+    [FUZZY_NORM_MIN_MAX] = {0, 0, 0, 1, 0, 0, 0, 0},
+    [FUZZY_NORM_PRODUCT] = {2, 1, 0, 0, 0, 0, 0, 0},
+    [FUZZY_NORM_LUKASIEWICZ] = {1, 0, 0, 1, 0, 0, 0, 0},
+    [FUZZY_NORM_HAMACHER] = {3, 2, 1, 1, 0, 0, 0, 0},
+};
+static const uint16_t sumMix[FUZZY_NUM_COSTS] = {1, 0, 0, 0, 0, 0, 0, 0};
+
+// Resetting a membership value, and scanning an op for ACCUMULATE in
+// FUZZY_NORMALIZE_PER_RULE programs
+static const uint16_t resetMix[FUZZY_NUM_COSTS] = {0, 0, 0, 0, 0, 1, 1, 0};
+static const uint16_t scanMix[FUZZY_NUM_COSTS] = {0, 0, 0, 1, 1, 0, 1, 0};
+
+// Normalizing a set: the sum and the zero check once, then every value is
+// summed and scaled
+static const uint16_t normalizeSetMix[FUZZY_NUM_COSTS] = {
+#ifdef FUZZY_DIVISION_FREE
+    0, 0, 1, 2, 0, 0, 1, 0
+#else
+    0, 0, 0, 2, 0, 0, 1, 0
+#endif
+};
+static const uint16_t normalizeValueMix[FUZZY_NUM_COSTS] = {
+#ifdef FUZZY_DIVISION_FREE
+    1, 1, 0, 1, 2, 1, 2, 0
+#else
+    1, 0, 1, 1, 2, 1, 2, 0
+#endif
+};
+
+// The centroid of every membership function, selected by the defuzzifier
+static const uint16_t centroidMix[FUZZY_NUM_MEMBERSHIP_TYPES]
+                                 [FUZZY_NUM_COSTS] = {
+    [TRIANGULAR] = {2, 0, 1, 4, 3, 0, 1, 0},
+    [TRAPEZOIDAL] = {4, 0, 2, 4, 4, 0, 1, 0},
+    [RECTANGULAR] = {1, 0, 1, 1, 2, 0, 1, 0},
+    [GAUSSIAN] = {0, 0, 0, 1, 1, 0, 1, 0},
+    [SIGMOID] = {0, 0, 0, 1, 1, 0, 1, 0},
+    [BELL] = {0, 0, 0, 1, 1, 0, 1, 0},
+    [SINGLETON] = {0, 0, 0, 1, 1, 0, 1, 0},
+};
+
+// The clipped area and moment of every membership function, sigmoids and
+// singletons add none
+static const uint16_t areaMix[FUZZY_NUM_MEMBERSHIP_TYPES][FUZZY_NUM_COSTS] = {
+    [TRIANGULAR] = {16, 9, 5, 0, 4, 0, 1, 0},
+    [TRAPEZOIDAL] = {16, 9, 5, 0, 4, 0, 1, 0},
+    [RECTANGULAR] = {16, 9, 5, 0, 4, 0, 1, 0},
+    [GAUSSIAN] = {3, 6, 1, 4, 2, 0, 2, 3},
+    [SIGMOID] = {0, 0, 0, 0, 0, 0, 0, 0},
+    [BELL] = {0, 5, 2, 1, 3, 0, 2, 1},
+    [SINGLETON] = {0, 0, 0, 0, 0, 0, 0, 0},
+};
+
+// Weighted sums of one value: centroids and singletons, clipped areas, and
+// the Takagi-Sugeno weights and consequent rows
+static const uint16_t weightedMix[FUZZY_NUM_COSTS] = {2, 1, 0, 0, 2, 0, 1, 0};
+static const uint16_t clippedMix[FUZZY_NUM_COSTS] = {2, 0, 0, 1, 1, 0, 2, 0};
+static const uint16_t weightMix[FUZZY_NUM_COSTS] = {1, 0, 0, 0, 1, 0, 1, 0};
+static const uint16_t rowMix[FUZZY_NUM_COSTS] = {1, 1, 0, 0, 2, 0, 1, 0};
+
+// Dispatching a defuzzifier and its final quotient
+static const uint16_t outputMix[FUZZY_NUM_COSTS] = {0, 0, 1, 3, 2, 1, 2, 0};
+
+static const char *const primitiveNames[FUZZY_NUM_COSTS] = {
+    "add", "mul", "div", "compare", "load", "store", "branch", "math"};
+static const char *const stageNames[FUZZY_NUM_COST_STAGES] = {
+    "classify", "inference", "defuzzify"};
+static const char *const functionNames[FUZZY_NUM_MEMBERSHIP_TYPES] = {
+    "TRIANGULAR", "TRAPEZOIDAL", "RECTANGULAR", "GAUSSIAN",
+    "SIGMOID",    "BELL",        "SINGLETON"};
+static const char *const opNames[FUZZY_NUM_OP_CODES] = {
+    "RULE",    "ALL_OF", "ANY_OF",     "MIN",   "MIN_NOT", "MAX",
+    "MAX_NOT", "REDUCE", "ACCUMULATE", "STORE", "LOAD"};
+
+static void addMix(uint64_t *primitives, const uint16_t *mix,
+                   uint64_t times) {
+    for (int p = 0; p < FUZZY_NUM_COSTS; p++) {
+        primitives[p] += mix[p] * times;
+    }
+}
+
+static void classifyCost(const FuzzySet_t *set, FuzzyCost_t *cost) {
+    uint64_t *primitives = cost->primitives[FUZZY_COST_CLASSIFY];
+
+    addMix(primitives, setMix, 1);
+    for (int i = 0; i < set->length; i++) {
+        const MembershipFunctionType_e type = set->membershipFunctions[i].type;
+        cost->functions[type]++;
+        if (set->layout != NULL && type <= TRAPEZOIDAL) {
+            addMix(primitives, preparedMix[type], 1);
+        } else {
+            addMix(primitives, classifyMix[type], 1);
+        }
+    }
+}
+
+static void normalizeCost(const FuzzySet_t *set, FuzzyCost_t *cost) {
+    uint64_t *primitives = cost->primitives[FUZZY_COST_INFERENCE];
+
+    addMix(primitives, normalizeSetMix, 1);
+    addMix(primitives, normalizeValueMix, set->length);
+    cost->normalized += set->length;
+}
+
+static void inferenceCost(const FuzzyModel_t *model, FuzzyCost_t *cost) {
+    const FuzzyProgram_t *program = &model->program;
+    uint64_t *primitives = cost->primitives[FUZZY_COST_INFERENCE];
+    const bool perRule = model->tsk == NULL &&
+                         program->normalization == FUZZY_NORMALIZE_PER_RULE;
+
+    if (!perRule) {
+        for (int i = 0; i < program->numOutputs; i++) {
+            const FuzzySet_t *set = program->sets[program->outputs[i]];
+            addMix(primitives, resetMix, set->length);
+            if (model->tsk == NULL) {
+                normalizeCost(set, cost);
+            }
+        }
+    }
+
+    for (int i = 0; i < program->numOps; i++) {
+        const FuzzyOp_t *op = &program->ops[i];
+        cost->ops[op->code]++;
+        addMix(primitives, opMix[op->code], 1);
+
+        switch (op->code) {
+        case FUZZY_OP_MIN:
+        case FUZZY_OP_MIN_NOT:
+        case FUZZY_OP_REDUCE:
+        case FUZZY_OP_LOAD:
+            addMix(primitives, tNormMix[program->norm], 1);
+            break;
+        case FUZZY_OP_MAX:
+        case FUZZY_OP_MAX_NOT:
+            addMix(primitives, sNormMix[program->norm], 1);
+            break;
+        case FUZZY_OP_ACCUMULATE:
+            addMix(primitives,
+                   model->tsk != NULL ? sumMix : sNormMix[program->norm], 1);
+            break;
+        default:
+            break;
+        }
+
+        // Per rule programs scan the ops twice, to reset the consequents and
+        // to normalize their sets
+        if (perRule) {
+            addMix(primitives, scanMix, 2);
+            if (op->code == FUZZY_OP_ACCUMULATE) {
+                addMix(primitives, resetMix, 1);
+                normalizeCost(program->sets[op->set], cost);
+            }
+        }
+    }
+}
+
+static void defuzzifyCost(const FuzzyModel_t *model, int output,
+                          FuzzyCost_t *cost) {
+    const FuzzySet_t *set = model->program.sets[model->numInputs + output];
+    uint64_t *primitives = cost->primitives[FUZZY_COST_DEFUZZIFY];
+
+    addMix(primitives, outputMix, 1);
+    cost->defuzzified += set->length;
+
+    if (model->tsk != NULL) {
+        const int rows = model->tsk->linear ? 1 + model->numInputs : 1;
+        addMix(primitives, weightMix, set->length);
+        addMix(primitives, rowMix, (uint64_t)rows * set->length);
+        return;
+    }
+
+    for (int i = 0; i < set->length; i++) {
+        const MembershipFunctionType_e type = set->membershipFunctions[i].type;
+
+        switch (model->defuzzifier) {
+        case FUZZY_DEFUZZIFY_AREA:
+            addMix(primitives, clippedMix, 1);
+            addMix(primitives, areaMix[type], 1);
+            break;
+        case FUZZY_DEFUZZIFY_SINGLETONS:
+            addMix(primitives, weightedMix, 1);
+            break;
+        default:
+            addMix(primitives, weightedMix, 1);
+            if (set->layout == NULL) {
+                addMix(primitives, centroidMix[type], 1);
+            }
+            break;
+        }
+    }
+}
+
+/**
+ * Counts the work of one evaluation of a model.
+ *
+ * The counts are those of FuzzyEvaluate() in a FUZZY_WCET build (see
+ * real.h), where they do not depend on the inputs: every membership function
+ * of every input is evaluated, every op of the program is executed and every
+ * value of the outputs is defuzzified, so the counts only depend on the sizes
+ * and shapes the model was built with. The primitives follow the scalar code
+ * of every path; vector loops do the same work in fewer instructions. Other
+ * builds may skip work, but sparse programs can also run a rule once per
+ * gate, so they are not bounded by the counts.
+ *
+ * @param model The FuzzyModel_t to analyze.
+ * @param cost Receives the operation counts.
+ */
+void FuzzyModelCost(const FuzzyModel_t *model, FuzzyCost_t *cost) {
+    memset(cost, 0, sizeof(*cost));
+
+    for (int i = 0; i < model->numInputs; i++) {
+        classifyCost(model->program.sets[i], cost);
+    }
+    inferenceCost(model, cost);
+    for (int i = 0; i < model->numOutputs; i++) {
+        defuzzifyCost(model, i, cost);
+    }
+}
+
+/**
+ * Estimates the cycles of one stage of an evaluation.
+ *
+ * @param cost The counts from FuzzyModelCost().
+ * @param stage The stage to estimate.
+ * @param cycles The cycles of every primitive, by FuzzyCostPrimitive_e, see
+ * FUZZY_COST_DEFAULT_CYCLES.
+ * @return The sum of the primitive counts of the stage times their cycles.
+ */
+uint64_t FuzzyCostStageCycles(const FuzzyCost_t *cost, FuzzyCostStage_e stage,
+                              const uint32_t *cycles) {
+    uint64_t total = 0;
+    for (int p = 0; p < FUZZY_NUM_COSTS; p++) {
+        total += cost->primitives[stage][p] * cycles[p];
+    }
+    return total;
+}
+
+/**
+ * Estimates the cycles of an evaluation.
+ *
+ * The estimate is a bound for cores which issue one primitive at a time and
+ * take at most the given cycles for each, without cache misses or
+ * interrupts.
+ *
+ * @param cost The counts from FuzzyModelCost().
+ * @param cycles The cycles of every primitive, by FuzzyCostPrimitive_e, see
+ * FUZZY_COST_DEFAULT_CYCLES.
+ * @return The estimated cycles of all stages.
+ */
+uint64_t FuzzyCostCycles(const FuzzyCost_t *cost, const uint32_t *cycles) {
+    uint64_t total = 0;
+    for (int s = 0; s < FUZZY_NUM_COST_STAGES; s++) {
+        total += FuzzyCostStageCycles(cost, (FuzzyCostStage_e)s, cycles);
+    }
+    return total;
+}
+
+/**
+ * Looks up a primitive by its name.
+ *
+ * @param name The name, e.g. "div".
+ * @return The FuzzyCostPrimitive_e, or -1 if no primitive has the name.
+ */
+int FuzzyCostPrimitive(const char *name) {
+    for (int p = 0; p < FUZZY_NUM_COSTS; p++) {
+        if (strcmp(name, primitiveNames[p]) == 0) {
+            return p;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Prints the counts of a model and their estimated cycles.
+ *
+ * @param cost The counts from FuzzyModelCost().
+ * @param cycles The cycles of every primitive, by FuzzyCostPrimitive_e.
+ */
+void FuzzyCostPrint(const FuzzyCost_t *cost, const uint32_t *cycles) {
+    printf("membership functions:");
+    for (int t = 0; t < FUZZY_NUM_MEMBERSHIP_TYPES; t++) {
+        if (cost->functions[t] != 0) {
+            printf(" %s %u", functionNames[t], cost->functions[t]);
+        }
+    }
+    printf("\nprogram ops:");
+    for (int op = 0; op < FUZZY_NUM_OP_CODES; op++) {
+        if (cost->ops[op] != 0) {
+            printf(" %s %u", opNames[op], cost->ops[op]);
+        }
+    }
+    printf("\nnormalized values: %u\ndefuzzified values: %u\n\n",
+           cost->normalized, cost->defuzzified);
+
+    printf("%-10s", "");
+    for (int p = 0; p < FUZZY_NUM_COSTS; p++) {
+        printf(" %8s", primitiveNames[p]);
+    }
+    printf(" %10s\n", "cycles");
+    for (int s = 0; s < FUZZY_NUM_COST_STAGES; s++) {
+        printf("%-10s", stageNames[s]);
+        for (int p = 0; p < FUZZY_NUM_COSTS; p++) {
+            printf(" %8llu", (unsigned long long)cost->primitives[s][p]);
+        }
+        printf(" %10llu\n", (unsigned long long)FuzzyCostStageCycles(
+                                cost, (FuzzyCostStage_e)s, cycles));
+    }
+
+    printf("\ncycles per primitive:");
+    for (int p = 0; p < FUZZY_NUM_COSTS; p++) {
+        printf(" %s=%u", primitiveNames[p], cycles[p]);
+    }
+    printf("\ncycle bound: %llu\n",
+           (unsigned long long)FuzzyCostCycles(cost, cycles));
+}
@@ -14,6 +14,24 @@
 #include "class.h"
 #include "classifier.h"
 #include "membership_function.h"
+#include "stats.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define FUZZY_PI 3.14159265358979323846
+
+/**
+ * Divides a weighted sum by its weight, 0 if the weight is zero.
+ *
+ * The quotient is always calculated and selected, so the cost does not depend
+ * on the weights.
+ */
+static inline FuzzyReal_t fuzzyQuotient(FuzzyReal_t sum, FuzzyReal_t weight) {
+    const FuzzyReal_t quotient = sum / weight;
+    return weight != FUZZY_REAL_C(0.0) ? quotient : FUZZY_REAL_C(0.0);
+}
 
 /**
  * Calculate the centroid of a triangular membership function.
@@ -23,26 +41,17 @@
  * @param membership The membership value of the function.
  * @return The centroid of the triangular membership function.
  */
-double calculateTriangularCentroid(MembershipFunction_t function,
-                                   double membership) {
-    double a = function.a;
-    double b = function.b;
-    double c = function.c;
+FuzzyReal_t calculateTriangularCentroid(MembershipFunction_t function,
+                                        FuzzyReal_t membership) {
+    FuzzyReal_t a = function.a;
+    FuzzyReal_t b = function.b;
+    FuzzyReal_t c = function.c;
 
-    if (membership == 0.0) {
-        return 0.0;
-    }
-
-    if (a == b) {
-        return b;
-    }
-
-    if (c == b) {
-        return b;
-    }
-
-    double centroid = (a + b + c) / 3.0;
-    return centroid;
+    // Zero memberships select a zero centroid rather than returning early, so
+    // the cost does not depend on the membership
+    FuzzyReal_t centroid =
+        (a == b || c == b) ? b : (a + b + c) / FUZZY_REAL_C(3.0);
+    return membership == FUZZY_REAL_C(0.0) ? FUZZY_REAL_C(0.0) : centroid;
 }
 
 /**
@@ -53,23 +62,17 @@ double calculateTriangularCentroid(MembershipFunction_t function,
  * @param membership The membership value of the function.
  * @return The centroid of the trapezoidal membership function.
  */
-double calculateTrapezoidalCentroid(MembershipFunction_t function,
-                                    double membership) {
-    double a = function.a;
-    double b = function.b;
-    double c = function.c;
-    double d = function.d;
-
-    if (membership == 0.0) {
-        return 0.0;
-    }
+FuzzyReal_t calculateTrapezoidalCentroid(MembershipFunction_t function,
+                                         FuzzyReal_t membership) {
+    FuzzyReal_t a = function.a;
+    FuzzyReal_t b = function.b;
+    FuzzyReal_t c = function.c;
+    FuzzyReal_t d = function.d;
 
-    if (a == b && c == d) {
-        return (b + c) / 2.0;
-    }
-
-    double centroid = (a + b + c + d) / 4.0;
-    return centroid;
+    FuzzyReal_t centroid = (a == b && c == d)
+                               ? (b + c) / FUZZY_REAL_C(2.0)
+                               : (a + b + c + d) / FUZZY_REAL_C(4.0);
+    return membership == FUZZY_REAL_C(0.0) ? FUZZY_REAL_C(0.0) : centroid;
 }
 
 /**
@@ -80,17 +83,29 @@ double calculateTrapezoidalCentroid(MembershipFunction_t function,
  * @param membership The membership value of the function.
  * @return The centroid of the rectangular membership function.
  */
-double calculateRectangularCentroid(MembershipFunction_t function,
-                                    double membership) {
-    double a = function.a;
-    double b = function.b;
+FuzzyReal_t calculateRectangularCentroid(MembershipFunction_t function,
+                                         FuzzyReal_t membership) {
+    FuzzyReal_t a = function.a;
+    FuzzyReal_t b = function.b;
 
-    if (membership == 0.0) {
-        return 0.0;
-    }
+    FuzzyReal_t centroid = (a + b) / FUZZY_REAL_C(2.0);
+    return membership == FUZZY_REAL_C(0.0) ? FUZZY_REAL_C(0.0) : centroid;
+}
 
-    double centroid = (a + b) / 2.0;
-    return centroid;
+/**
+ * Calculate the centroid of a symmetric membership function.
+ *
+ * Gaussians and bells are symmetric around their center and a singleton is
+ * its point. Sigmoids are not bounded, their crossover point is taken as
+ * their centroid.
+ *
+ * @param center The center of the membership function.
+ * @param membership The membership value of the function.
+ * @return The centroid of the membership function.
+ */
+static FuzzyReal_t calculateSymmetricCentroid(FuzzyReal_t center,
+                                              FuzzyReal_t membership) {
+    return membership == FUZZY_REAL_C(0.0) ? FUZZY_REAL_C(0.0) : center;
 }
 
 /**
@@ -100,7 +115,8 @@ double calculateRectangularCentroid(MembershipFunction_t function,
  * @param membership The membership value of the function.
  * @return The centroid of the membership function.
  */
-double calculateCentroid(MembershipFunction_t function, double membership) {
+FuzzyReal_t calculateCentroid(MembershipFunction_t function,
+                              FuzzyReal_t membership) {
     switch (function.type) {
     case TRIANGULAR:
         return calculateTriangularCentroid(function, membership);
@@ -108,6 +124,13 @@ double calculateCentroid(MembershipFunction_t function, double membership) {
         return calculateTrapezoidalCentroid(function, membership);
     case RECTANGULAR:
         return calculateRectangularCentroid(function, membership);
+    case GAUSSIAN:
+    case SINGLETON:
+        return calculateSymmetricCentroid(function.a, membership);
+    case SIGMOID:
+        return calculateSymmetricCentroid(function.b, membership);
+    case BELL:
+        return calculateSymmetricCentroid(function.c, membership);
     default:
         // Handle unknown membership function type
         return 0.0;
@@ -120,22 +143,442 @@ double calculateCentroid(MembershipFunction_t function, double membership) {
  * @param set The FuzzzySet to calculate the centroid for.
  * @return The centroid of the fuzzy class.
  */
-double defuzzification(FuzzySet_t *set) {
-    double sum = 0.0;
-    double sumOfMemberships = 0.0;
+FuzzyReal_t defuzzification(FuzzySet_t *set) {
+    return defuzzificationValues(set, set->membershipValues);
+}
+
+/**
+ * Calculate the centroid of membership values of a fuzzy class.
+ *
+ * This function works like defuzzification() but reads the membership values
+ * from the values array instead of the set. Sets with a layout (see
+ * FuzzySetEnableLayout()) read the prepared centroids, which gives the same
+ * result without a division per function.
+ *
+ * @param set The FuzzzySet providing the membership functions.
+ * @param values The membership values, must hold set->length values.
+ * @return The centroid of the fuzzy class.
+ */
+FuzzyReal_t defuzzificationValues(const FuzzySet_t *set,
+                                  const FuzzyReal_t *values) {
+    FUZZY_STATS_BEGIN();
+    FuzzyReal_t sum = 0.0;
+    FuzzyReal_t sumOfMemberships = 0.0;
+
+    if (set->layout != NULL) {
+        // A centroid with no membership adds a zero like the zero centroid
+        const FuzzyReal_t *centroids = set->layout->centroids;
+        for (int i = 0; i < set->length; i++) {
+            sum += centroids[i] * values[i];
+            sumOfMemberships += values[i];
+        }
+    } else {
+        for (int i = 0; i < set->length; i++) {
+            FuzzyReal_t membership = values[i];
+            FuzzyReal_t x =
+                calculateCentroid(set->membershipFunctions[i], membership);
+            sum += x * membership;
+            sumOfMemberships += membership;
+        }
+    }
+
+    // Handle the case where the sum of memberships is zero
+    // This can happen if the input is not a member of any fuzzy set
+    const FuzzyReal_t result = fuzzyQuotient(sum, sumOfMemberships);
+
+    FUZZY_STATS_END(FUZZY_STAGE_DEFUZZIFY);
+    return result;
+}
+
+/**
+ * Calculate the centroid of the membership values of a set of singletons.
+ *
+ * Every membership function is taken as a singleton at its parameter a, so
+ * the centroid is the dot product of the points and the membership values
+ * divided by their sum (Sugeno style defuzzification). For sets of
+ * SINGLETON functions this equals defuzzificationValues() without the
+ * dispatch on the shape of every function.
+ *
+ * @param set The FuzzzySet providing the membership functions.
+ * @param values The membership values, must hold set->length values.
+ * @return The weighted average of the singletons, or 0 if no function is
+ * activated.
+ */
+FuzzyReal_t defuzzificationSingletons(const FuzzySet_t *set,
+                                      const FuzzyReal_t *values) {
+    FUZZY_STATS_BEGIN();
+    const MembershipFunction_t *functions = set->membershipFunctions;
+    FuzzyReal_t sum = 0.0;
+    FuzzyReal_t sumOfMemberships = 0.0;
 
     for (int i = 0; i < set->length; i++) {
-        double membership = set->membershipValues[i];
-        double x = calculateCentroid(set->membershipFunctions[i], membership);
-        sum += x * membership;
-        sumOfMemberships += membership;
+        sum += functions[i].a * values[i];
+        sumOfMemberships += values[i];
     }
 
-    if (sumOfMemberships == 0.0) {
-        // Handle the case where the sum of memberships is zero
-        // This can happen if the input is not a member of any fuzzy set
+    const FuzzyReal_t result = fuzzyQuotient(sum, sumOfMemberships);
+
+    FUZZY_STATS_END(FUZZY_STAGE_DEFUZZIFY);
+    return result;
+}
+
+/**
+ * Calculate the area and first moment of a clipped trapezoid.
+ *
+ * The trapezoid a, b, c, d is cut off at the given height, which leaves a
+ * rising edge, a plateau and a falling edge. Triangles and rectangles are
+ * trapezoids with b == c and a == b, c == d respectively.
+ *
+ * @param a The start point of the trapezoid.
+ * @param b The peak start point of the trapezoid.
+ * @param c The peak end point of the trapezoid.
+ * @param d The end point of the trapezoid.
+ * @param height The height to clip the trapezoid at.
+ * @param moment Receives the first moment of the clipped shape.
+ * @return The area of the clipped shape.
+ */
+static FuzzyReal_t clippedTrapezoid(FuzzyReal_t a, FuzzyReal_t b, FuzzyReal_t c,
+                                    FuzzyReal_t d, FuzzyReal_t height,
+                                    FuzzyReal_t *moment) {
+    // Points where the clipped shape reaches and leaves its plateau
+    const FuzzyReal_t rise = a + height * (b - a);
+    const FuzzyReal_t fall = d - height * (d - c);
+
+    const FuzzyReal_t riseArea = height * (rise - a) / FUZZY_REAL_C(2.0);
+    const FuzzyReal_t plateauArea = height * (fall - rise);
+    const FuzzyReal_t fallArea = height * (d - fall) / FUZZY_REAL_C(2.0);
+
+    *moment =
+        riseArea * (a + FUZZY_REAL_C(2.0) * (rise - a) / FUZZY_REAL_C(3.0)) +
+              plateauArea * (rise + fall) / FUZZY_REAL_C(2.0) +
+              fallArea * (fall + (d - fall) / FUZZY_REAL_C(3.0));
+    return riseArea + plateauArea + fallArea;
+}
+
+/**
+ * Calculate the area of a clipped Gaussian.
+ *
+ * The Gaussian is cut off at the given height, it reaches the height at a
+ * distance w of its center, so the area is the plateau of width 2w plus both
+ * tails beyond w. The clipped shape is symmetric, its moment is the area
+ * times the center.
+ *
+ * @param a The center of the Gaussian.
+ * @param b The standard deviation of the Gaussian.
+ * @param height The height to clip the Gaussian at.
+ * @param moment Receives the first moment of the clipped shape.
+ * @return The area of the clipped shape.
+ */
+static FuzzyReal_t clippedGaussian(FuzzyReal_t a, FuzzyReal_t b,
+                                   FuzzyReal_t height, FuzzyReal_t *moment) {
+    const double sigma = fabs((double)b);
+    if (sigma == 0.0) {
+        *moment = 0.0;
         return 0.0;
     }
+    // Heights of zero evaluate an unclipped Gaussian and select no area, so
+    // the cost does not depend on the height
+    const bool active = height > FUZZY_REAL_C(0.0);
+    const double h =
+        active && height < FUZZY_REAL_C(1.0) ? (double)height : 1.0;
+    const double w = sigma * sqrt(-2.0 * log(h));
+    const double clipped = 2.0 * h * w + sigma * sqrt(2.0 * FUZZY_PI) *
+                                             erfc(w / (sigma * sqrt(2.0)));
+    const double area = active ? clipped : 0.0;
+
+    *moment = (FuzzyReal_t)(area * a);
+    return (FuzzyReal_t)area;
+}
 
-    return sum / sumOfMemberships;
+/**
+ * Calculate the area of a clipped generalized bell.
+ *
+ * The clipped bell has no closed form area, so the area of the whole bell,
+ * pi a / (b sin(pi / 2b)), is scaled by the height instead. Bells with a
+ * shape of 0.5 or less have no finite area and are skipped.
+ *
+ * @param a The half width of the bell.
+ * @param b The shape of the bell.
+ * @param c The center of the bell.
+ * @param height The height to clip the bell at.
+ * @param moment Receives the first moment of the clipped shape.
+ * @return The area of the clipped shape.
+ */
+static FuzzyReal_t clippedBell(FuzzyReal_t a, FuzzyReal_t b, FuzzyReal_t c,
+                               FuzzyReal_t height, FuzzyReal_t *moment) {
+    if (b <= FUZZY_REAL_C(0.5)) {
+        *moment = 0.0;
+        return 0.0;
+    }
+    const double area = height * FUZZY_PI * fabs((double)a) /
+                        ((double)b * sin(FUZZY_PI / (2.0 * (double)b)));
+
+    *moment = (FuzzyReal_t)(area * c);
+    return (FuzzyReal_t)area;
+}
+
+/**
+ * Calculate the center of area of a fuzzy class.
+ *
+ * Every membership function is clipped at its membership value (Mamdani
+ * min-implication) and the areas and first moments of the clipped shapes are
+ * calculated in closed form. Overlapping shapes are summed rather than
+ * max-aggregated (center of sums), which keeps the cost at one closed form
+ * per membership function. Unlike defuzzification() the result honors the
+ * clipping, e.g. a fully activated shape pulls harder than a barely activated
+ * one of the same width. Gaussians are clipped in closed form as well, bells
+ * are weighted by their area scaled by the membership value. Sigmoids have
+ * no finite area and singletons none at all, both are skipped; use
+ * defuzzificationSingletons() for singleton outputs.
+ *
+ * @param set The FuzzzySet providing the membership functions.
+ * @param values The membership values, must hold set->length values.
+ * @return The center of area of the fuzzy class, or 0 if no function is
+ * activated.
+ */
+FuzzyReal_t defuzzificationArea(const FuzzySet_t *set,
+                                const FuzzyReal_t *values) {
+    FUZZY_STATS_BEGIN();
+    FuzzyReal_t area = 0.0;
+    FuzzyReal_t moment = 0.0;
+
+    for (int i = 0; i < set->length; i++) {
+        const MembershipFunction_t *mf = &set->membershipFunctions[i];
+        FuzzyReal_t height = values[i];
+        FuzzyReal_t shapeMoment = 0.0;
+
+#ifdef FUZZY_WCET
+        // Inactive functions are clipped at a height of zero instead of
+        // skipped, which adds no area
+        height = height > FUZZY_REAL_C(0.0) ? height : FUZZY_REAL_C(0.0);
+#else
+        if (height <= FUZZY_REAL_C(0.0)) {
+            continue;
+        }
+#endif
+
+        switch (mf->type) {
+        case TRIANGULAR:
+            area += clippedTrapezoid(mf->a, mf->b, mf->b, mf->c, height,
+                                     &shapeMoment);
+            break;
+        case TRAPEZOIDAL:
+            area += clippedTrapezoid(mf->a, mf->b, mf->c, mf->d, height,
+                                     &shapeMoment);
+            break;
+        case RECTANGULAR:
+            area += clippedTrapezoid(mf->a, mf->a, mf->b, mf->b, height,
+                                     &shapeMoment);
+            break;
+        case GAUSSIAN:
+            area += clippedGaussian(mf->a, mf->b, height, &shapeMoment);
+            break;
+        case BELL:
+            area += clippedBell(mf->a, mf->b, mf->c, height, &shapeMoment);
+            break;
+        default:
+            break;
+        }
+        moment += shapeMoment;
+    }
+
+    const FuzzyReal_t result = fuzzyQuotient(moment, area);
+
+    FUZZY_STATS_END(FUZZY_STAGE_DEFUZZIFY);
+    return result;
+}
+
+/**
+ * Initializes a FuzzyUniverse_t struct.
+ *
+ * The universe [min, max] of the set is sampled at resolution evenly spaced
+ * points and the membership degree of every membership function is
+ * precomputed at every point. The universe must be released with
+ * FuzzyUniverseFree(), also if the initialization failed.
+ *
+ * @param universe The FuzzyUniverse_t struct to initialize.
+ * @param set The FuzzySet_t providing the membership functions.
+ * @param min The lower end of the universe.
+ * @param max The upper end of the universe, larger than min.
+ * @param resolution The number of sample points, at least 2.
+ * @return false if the universe is invalid or too large, or allocating
+ * failed. The universe is then empty and defuzzificationUniverse() returns 0.
+ */
+bool FuzzyUniverseInit(FuzzyUniverse_t *universe, const FuzzySet_t *set,
+                       FuzzyReal_t min, FuzzyReal_t max, int resolution) {
+    universe->set = set;
+    universe->min = min;
+    universe->max = max;
+    universe->resolution = 0;
+    universe->table = NULL;
+    if (resolution < 2 || set->length < 0 || !(max > min) ||
+        !isfinite(max - min)) {
+        return false;
+    }
+    if ((size_t)set->length >
+        SIZE_MAX / sizeof(FuzzyReal_t) / (size_t)resolution - 1) {
+        return false;
+    }
+
+    FuzzyReal_t *table = (FuzzyReal_t *)malloc(
+        (size_t)resolution * set->length * sizeof(FuzzyReal_t) + 1);
+    FuzzyReal_t *xs =
+        (FuzzyReal_t *)malloc((size_t)resolution * sizeof(FuzzyReal_t));
+    if (table == NULL || xs == NULL) {
+        free(table);
+        free(xs);
+        return false;
+    }
+    for (int k = 0; k < resolution; k++) {
+        xs[k] = min + (max - min) * k / (resolution - 1);
+    }
+    FuzzyClassifierBatch(xs, resolution, set, table);
+    free(xs);
+
+    universe->resolution = resolution;
+    universe->table = table;
+    return true;
+}
+
+/**
+ * Frees the memory allocated for a FuzzyUniverse_t struct.
+ *
+ * @param universe The FuzzyUniverse_t struct to free.
+ */
+void FuzzyUniverseFree(FuzzyUniverse_t *universe) { free(universe->table); }
+
+/**
+ * Aggregates the membership functions of a universe clipped at their
+ * membership values at sample point k.
+ */
+static inline FuzzyReal_t aggregateSample(const FuzzyUniverse_t *universe,
+                                          const FuzzyReal_t *values, int k) {
+    const int length = universe->set->length;
+    const FuzzyReal_t *degrees = &universe->table[(size_t)k * length];
+    FuzzyReal_t membership = 0.0;
+    for (int i = 0; i < length; i++) {
+        FuzzyReal_t clipped = degrees[i] < values[i] ? degrees[i] : values[i];
+        membership = clipped > membership ? clipped : membership;
+    }
+    return membership;
+}
+
+/**
+ * Finds the point splitting the aggregated area of a universe in two halves.
+ *
+ * The samples are walked again until half of the area is covered. FUZZY_WCET
+ * builds walk all samples, whichever one covers the half.
+ */
+static FuzzyReal_t bisectUniverse(const FuzzyUniverse_t *universe,
+                                  const FuzzyReal_t *values, FuzzyReal_t area) {
+    const int resolution = universe->resolution;
+    const FuzzyReal_t step = (universe->max - universe->min) / (resolution - 1);
+    const FuzzyReal_t half = area / FUZZY_REAL_C(2.0);
+    FuzzyReal_t covered = 0.0;
+    int crossing = resolution;
+    FuzzyReal_t before = 0.0;
+    FuzzyReal_t crossed = 0.0;
+
+    for (int k = 0; k < resolution; k++) {
+        const FuzzyReal_t membership = aggregateSample(universe, values, k);
+        if (crossing == resolution && covered + membership >= half) {
+            crossing = k;
+            before = covered;
+            crossed = membership;
+#ifndef FUZZY_WCET
+            break;
+#endif
+        }
+        covered += membership;
+    }
+    if (crossing == resolution) {
+        return universe->max;
+    }
+
+    // Interpolate within the sample
+    const FuzzyReal_t fraction = (half - before) / crossed;
+    const FuzzyReal_t x =
+        universe->min + step * (crossing - FUZZY_REAL_C(0.5) + fraction);
+    return x < universe->min ? universe->min : x;
+}
+
+/**
+ * Defuzzify membership values on a sampled universe, see
+ * defuzzificationUniverse().
+ */
+static FuzzyReal_t defuzzifyUniverse(const FuzzyUniverse_t *universe,
+                                     const FuzzyReal_t *values,
+                                     FuzzyDefuzzifyMethod_e method) {
+    const int resolution = universe->resolution;
+    const FuzzyReal_t step = (universe->max - universe->min) / (resolution - 1);
+
+    FuzzyReal_t area = 0.0;
+    FuzzyReal_t moment = 0.0;
+    FuzzyReal_t maximum = 0.0;
+    FuzzyReal_t maximumSum = 0.0;
+    int maximumCount = 0;
+
+    // Aggregate the clipped membership functions at every sample point
+    for (int k = 0; k < resolution; k++) {
+        const FuzzyReal_t membership = aggregateSample(universe, values, k);
+        const FuzzyReal_t x = universe->min + step * k;
+        area += membership;
+        moment += membership * x;
+
+        if (membership > maximum) {
+            maximum = membership;
+            maximumSum = x;
+            maximumCount = 1;
+        } else if (membership == maximum && membership > FUZZY_REAL_C(0.0)) {
+            maximumSum += x;
+            maximumCount++;
+        }
+    }
+
+#ifndef FUZZY_WCET
+    if (area == FUZZY_REAL_C(0.0)) {
+        return 0.0;
+    }
+#endif
+
+    FuzzyReal_t result;
+    switch (method) {
+    case FUZZY_DEFUZZIFY_MEAN_OF_MAX:
+        result = maximumSum / maximumCount;
+        break;
+    case FUZZY_DEFUZZIFY_BISECTOR:
+        result = bisectUniverse(universe, values, area);
+        break;
+    default:
+        result = moment / area;
+        break;
+    }
+    // FUZZY_WCET builds calculate the result of an empty area as well
+    return area == FUZZY_REAL_C(0.0) ? FUZZY_REAL_C(0.0) : result;
+}
+
+/**
+ * Defuzzify membership values on a sampled universe.
+ *
+ * The membership functions are clipped at their membership values and
+ * max-aggregated at every sample point of the universe, so the cost is a
+ * fixed resolution x set->length min/max operations per call.
+ *
+ * FUZZY_DEFUZZIFY_CENTROID returns the center of area, FUZZY_DEFUZZIFY_BISECTOR
+ * the point splitting the area in two halves and FUZZY_DEFUZZIFY_MEAN_OF_MAX
+ * the mean of the points with the largest aggregated membership. Other
+ * methods fall back to the centroid.
+ *
+ * @param universe The FuzzyUniverse_t of the set.
+ * @param values The membership values, must hold set->length values.
+ * @param method The defuzzification method.
+ * @return The crisp value, or 0 if no function is activated.
+ */
+FuzzyReal_t defuzzificationUniverse(const FuzzyUniverse_t *universe,
+                                    const FuzzyReal_t *values,
+                                    FuzzyDefuzzifyMethod_e method) {
+    FUZZY_STATS_BEGIN();
+    const FuzzyReal_t result = defuzzifyUniverse(universe, values, method);
+    FUZZY_STATS_END(FUZZY_STAGE_DEFUZZIFY);
+    return result;
 }
@@ -0,0 +1,210 @@
+/**
+ * @file fast_math.h
+ * @brief Fuzzy Logic fast exponential and smooth membership shapes (library
+ * internal).
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#ifndef FUZZY_FAST_MATH_H
+#define FUZZY_FAST_MATH_H
+#pragma once
+
+#include "real.h"
+#include "simd.h"
+
+#include <stdint.h>
+#include <string.h>
+
+// Branch-free approximations of exp() and log() for the smooth membership
+// functions. They only use multiplies, adds, bit blends and integer operations
+// of the width of FuzzyReal_t, so loops over them vectorize, and the scalar,
+// batch and layout paths of a shape all share these inline functions and get
+// the same bits.
+//
+// fuzzyExp() reduces y to r = y - n ln 2 with |r| <= ln 2 / 2 and evaluates a
+// degree 7 Taylor polynomial of e^r, whose relative error is below 7.5e-9
+// before rounding (the largest at r = -ln 2 / 2), times 2^n built from the
+// exponent bits. Results below e^-87 are flushed to zero and arguments above
+// 88 saturate, so all results are normal floats. fuzzyLog() splits off the
+// binary exponent and evaluates the atanh series of the mantissa in
+// [sqrt(1/2), sqrt(2)], with an absolute error below 1e-9 before rounding.
+
+#ifdef FUZZY_SIMD_FLOAT
+typedef uint32_t fuzzy_bits_t;
+#define FUZZY_MANTISSA_BITS 23
+#define FUZZY_EXPONENT_BIAS 127
+#define FUZZY_BITS_SHIFTER 0x1.8p23f
+#else
+typedef uint64_t fuzzy_bits_t;
+#define FUZZY_MANTISSA_BITS 52
+#define FUZZY_EXPONENT_BIAS 1023
+#define FUZZY_BITS_SHIFTER 0x1.8p52
+#endif
+
+// FUZZY_SIMD_FLOAT is only detected for the literal -DFUZZY_REAL=float, see
+// simd.h, so a float spelled differently (e.g. through a typedef) or a wider
+// type would get bit operations of the wrong width
+_Static_assert(sizeof(fuzzy_bits_t) == sizeof(FuzzyReal_t),
+               "FUZZY_REAL must be the literal float or double");
+
+#define FUZZY_EXP_MIN FUZZY_REAL_C(-87.0)
+#define FUZZY_EXP_MAX FUZZY_REAL_C(88.0)
+// ln 2 split into a head with few bits, so n * head is exact, and the rest
+#define FUZZY_LN2_HI FUZZY_REAL_C(0.693145751953125)
+#define FUZZY_LN2_LO FUZZY_REAL_C(1.42860682030941723212e-6)
+#define FUZZY_LOG2E FUZZY_REAL_C(1.44269504088896340736)
+#define FUZZY_SQRT2 FUZZY_REAL_C(1.41421356237309504880)
+
+static inline fuzzy_bits_t fuzzyToBits(FuzzyReal_t x) {
+    fuzzy_bits_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits;
+}
+
+static inline FuzzyReal_t fuzzyFromBits(fuzzy_bits_t bits) {
+    FuzzyReal_t x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+// All bits set if the condition holds, none otherwise
+static inline fuzzy_bits_t fuzzyMask(int condition) {
+    return (fuzzy_bits_t)0 - (fuzzy_bits_t)condition;
+}
+
+/**
+ * Picks t where mask is set and f elsewhere.
+ *
+ * A ?: with a constant operand lets the compiler fold the operations after
+ * it on one path and move the others into a branch, which it then cannot
+ * vectorize because floating point operations might trap. Blending the bits
+ * keeps every operation unconditional.
+ */
+static inline FuzzyReal_t fuzzyBlend(fuzzy_bits_t mask, FuzzyReal_t t,
+                                     FuzzyReal_t f) {
+    return fuzzyFromBits((fuzzyToBits(t) & mask) | (fuzzyToBits(f) & ~mask));
+}
+
+/**
+ * Approximates e^y. NaN is passed through.
+ */
+static inline FuzzyReal_t fuzzyExp(FuzzyReal_t y) {
+    const fuzzy_bits_t below = fuzzyMask(y < FUZZY_EXP_MIN);
+    const fuzzy_bits_t above = fuzzyMask(y > FUZZY_EXP_MAX);
+    const FuzzyReal_t clamped =
+        fuzzyBlend(below, FUZZY_EXP_MIN, fuzzyBlend(above, FUZZY_EXP_MAX, y));
+
+    // k holds round(y / ln 2) in its low mantissa bits
+    const FuzzyReal_t k = clamped * FUZZY_LOG2E + FUZZY_BITS_SHIFTER;
+    const FuzzyReal_t n = k - FUZZY_BITS_SHIFTER;
+    const FuzzyReal_t r = (clamped - n * FUZZY_LN2_HI) - n * FUZZY_LN2_LO;
+
+    FuzzyReal_t p = FUZZY_REAL_C(1.0 / 5040.0);
+    p = p * r + FUZZY_REAL_C(1.0 / 720.0);
+    p = p * r + FUZZY_REAL_C(1.0 / 120.0);
+    p = p * r + FUZZY_REAL_C(1.0 / 24.0);
+    p = p * r + FUZZY_REAL_C(1.0 / 6.0);
+    p = p * r + FUZZY_REAL_C(0.5);
+    p = p * r + FUZZY_REAL_C(1.0);
+    p = p * r + FUZZY_REAL_C(1.0);
+
+    // 2^n, the shifter bits above the exponent field are shifted out
+    const FuzzyReal_t scale = fuzzyFromBits(
+        (fuzzyToBits(k) + FUZZY_EXPONENT_BIAS) << FUZZY_MANTISSA_BITS);
+    return fuzzyFromBits(fuzzyToBits(p * scale) & ~below);
+}
+
+/**
+ * Approximates ln(x) for positive, normal x. NaN is passed through.
+ */
+static inline FuzzyReal_t fuzzyLog(FuzzyReal_t x) {
+    const fuzzy_bits_t mantissaMask =
+        ((fuzzy_bits_t)1 << FUZZY_MANTISSA_BITS) - 1;
+    const fuzzy_bits_t bits = fuzzyToBits(x);
+
+    // Split x into 2^e * m with m in [1, 2), the exponent is converted back
+    // through the shifter
+    FuzzyReal_t e = fuzzyFromBits(fuzzyToBits(FUZZY_BITS_SHIFTER) |
+                                  (bits >> FUZZY_MANTISSA_BITS)) -
+                    FUZZY_BITS_SHIFTER - FUZZY_EXPONENT_BIAS;
+    FuzzyReal_t m = fuzzyFromBits((bits & mantissaMask) |
+                                  ((fuzzy_bits_t)FUZZY_EXPONENT_BIAS
+                                   << FUZZY_MANTISSA_BITS));
+    const fuzzy_bits_t high = fuzzyMask(m > FUZZY_SQRT2);
+    e = fuzzyBlend(high, e + FUZZY_REAL_C(1.0), e);
+    m = fuzzyBlend(high, m * FUZZY_REAL_C(0.5), m);
+
+    // ln m = 2 atanh(s)
+    const FuzzyReal_t s = (m - FUZZY_REAL_C(1.0)) / (m + FUZZY_REAL_C(1.0));
+    const FuzzyReal_t s2 = s * s;
+    FuzzyReal_t p = FUZZY_REAL_C(1.0 / 9.0);
+    p = p * s2 + FUZZY_REAL_C(1.0 / 7.0);
+    p = p * s2 + FUZZY_REAL_C(1.0 / 5.0);
+    p = p * s2 + FUZZY_REAL_C(1.0 / 3.0);
+    p = p * s2 + FUZZY_REAL_C(1.0);
+
+    const FuzzyReal_t result =
+        e * FUZZY_LN2_HI + (e * FUZZY_LN2_LO + FUZZY_REAL_C(2.0) * s * p);
+    return fuzzyBlend(fuzzyMask(x == x), result, x);
+}
+
+/**
+ * Calculates 1 / (1 + e^z), flushing results below 1 / (1 + e^88) to zero.
+ */
+static inline FuzzyReal_t fuzzyLogistic(FuzzyReal_t z) {
+    const FuzzyReal_t value =
+        FUZZY_REAL_C(1.0) / (FUZZY_REAL_C(1.0) + fuzzyExp(z));
+    return fuzzyFromBits(fuzzyToBits(value) & ~fuzzyMask(z > FUZZY_EXP_MAX));
+}
+
+/**
+ * Gaussian with center a and standard deviation b, see GAUSSIAN.
+ */
+static inline FuzzyReal_t fuzzyGaussian(FuzzyReal_t x, FuzzyReal_t a,
+                                        FuzzyReal_t b) {
+    const FuzzyReal_t d = x - a;
+    const FuzzyReal_t y = -(d * d) / (FUZZY_REAL_C(2.0) * b * b);
+    // A zero width Gaussian is a singleton
+    return fuzzyBlend(fuzzyMask(d == FUZZY_REAL_C(0.0)), FUZZY_REAL_C(1.0),
+                      fuzzyExp(y));
+}
+
+/**
+ * Sigmoid with slope a and crossover point b, see SIGMOID.
+ */
+static inline FuzzyReal_t fuzzySigmoid(FuzzyReal_t x, FuzzyReal_t a,
+                                       FuzzyReal_t b) {
+    return fuzzyLogistic(-a * (x - b));
+}
+
+/**
+ * Generalized bell with half width a, shape b and center c, see BELL.
+ */
+static inline FuzzyReal_t fuzzyBell(FuzzyReal_t x, FuzzyReal_t a,
+                                    FuzzyReal_t b, FuzzyReal_t c) {
+    const FuzzyReal_t t = (x - c) / a;
+    const fuzzy_bits_t signMask = ~(~(fuzzy_bits_t)0 >> 1);
+    const FuzzyReal_t u = fuzzyFromBits(fuzzyToBits(t) & ~signMask);
+    // |t|^2b, where tiny and subnormal |t| are taken as the smallest normal
+    const FuzzyReal_t smallest = fuzzyFromBits((fuzzy_bits_t)1
+                                               << FUZZY_MANTISSA_BITS);
+    const FuzzyReal_t z =
+        FUZZY_REAL_C(2.0) * b *
+        fuzzyLog(fuzzyBlend(fuzzyMask(u < smallest), smallest, u));
+    // Also covers a zero width bell, where t is 0 / 0
+    return fuzzyBlend(fuzzyMask(x == c), FUZZY_REAL_C(1.0), fuzzyLogistic(z));
+}
+
+/**
+ * Singleton at a, see SINGLETON.
+ */
+static inline FuzzyReal_t fuzzySingleton(FuzzyReal_t x, FuzzyReal_t a) {
+    return x == a ? FUZZY_REAL_C(1.0) : FUZZY_REAL_C(0.0);
+}
+
+#endif
@@ -0,0 +1,557 @@
+/**
+ * @file fixed_point.c
+ * @brief Fuzzy Logic fixed point (Q15/Q31) implementation.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "fixed_point.h"
+
+#include "defuzzifier.h"
+#include "membership_function.h"
+#include "program.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The conversions below run once while preparing a model, so they use double
+// regardless of FuzzyReal_t to keep the full Q31 precision.
+
+/**
+ * Maps a crisp value from [min, max] onto [-1, 1) in units of 2^-bits.
+ */
+static int64_t toFixed(FuzzyReal_t x, FuzzyReal_t min, FuzzyReal_t max,
+                       int bits) {
+    const double scale = (double)((int64_t)1 << bits);
+    double t =
+        ((double)x - (double)min) / ((double)max - (double)min) * 2.0 - 1.0;
+    double q = t * scale;
+    if (q >= scale - 1.0) {
+        return (int64_t)scale - 1;
+    }
+    if (q <= -scale) {
+        return -(int64_t)scale;
+    }
+    return (int64_t)(q >= 0.0 ? q + 0.5 : q - 0.5);
+}
+
+/**
+ * Maps a value in units of 2^-bits from [-1, 1) back onto [min, max].
+ */
+static FuzzyReal_t fromFixed(int64_t x, FuzzyReal_t min, FuzzyReal_t max,
+                             int bits) {
+    const double scale = (double)((int64_t)1 << bits);
+    return (FuzzyReal_t)((double)min + ((double)x / scale + 1.0) / 2.0 *
+                                           ((double)max - (double)min));
+}
+
+/**
+ * Converts a crisp value in [min, max] to Q15, saturating values outside.
+ *
+ * @param x The crisp value.
+ * @param min The lower end of the universe.
+ * @param max The upper end of the universe.
+ * @return The Q15 value, min maps to -1 and max to 1 - 2^-15.
+ */
+FuzzyQ15_t FuzzyQ15FromReal(FuzzyReal_t x, FuzzyReal_t min, FuzzyReal_t max) {
+    return (FuzzyQ15_t)toFixed(x, min, max, 15);
+}
+
+/**
+ * Converts a Q15 value back to a crisp value in [min, max].
+ *
+ * @param x The Q15 value.
+ * @param min The lower end of the universe.
+ * @param max The upper end of the universe.
+ * @return The crisp value.
+ */
+FuzzyReal_t FuzzyQ15ToReal(FuzzyQ15_t x, FuzzyReal_t min, FuzzyReal_t max) {
+    return fromFixed(x, min, max, 15);
+}
+
+/**
+ * Converts a crisp value in [min, max] to Q31, saturating values outside.
+ *
+ * @param x The crisp value.
+ * @param min The lower end of the universe.
+ * @param max The upper end of the universe.
+ * @return The Q31 value, min maps to -1 and max to 1 - 2^-31.
+ */
+FuzzyQ31_t FuzzyQ31FromReal(FuzzyReal_t x, FuzzyReal_t min, FuzzyReal_t max) {
+    return (FuzzyQ31_t)toFixed(x, min, max, 31);
+}
+
+/**
+ * Converts a Q31 value back to a crisp value in [min, max].
+ *
+ * @param x The Q31 value.
+ * @param min The lower end of the universe.
+ * @param max The upper end of the universe.
+ * @return The crisp value.
+ */
+FuzzyReal_t FuzzyQ31ToReal(FuzzyQ31_t x, FuzzyReal_t min, FuzzyReal_t max) {
+    return fromFixed(x, min, max, 31);
+}
+
+/**
+ * Finds the multiplier and shift to scale a distance to a degree.
+ *
+ * The slope one / span is represented as multiplier / 2^shift with the
+ * largest shift for which the multiplier still fits below limit, so that
+ * ((x - a) * multiplier) >> shift needs no division.
+ *
+ * @param one The fixed point representation of a degree of 1.
+ * @param span The length of the slope, 0 for a vertical edge.
+ * @param limit The largest multiplier.
+ * @param maxShift The largest shift.
+ * @param multiplier Receives the multiplier.
+ * @param shift Receives the shift.
+ */
+static void slopeMultiplier(uint64_t one, uint64_t span, uint64_t limit,
+                            int maxShift, uint64_t *multiplier,
+                            uint8_t *shift) {
+    *multiplier = 0;
+    *shift = 0;
+    if (span == 0) {
+        return;
+    }
+
+    for (int s = 0; s <= maxShift; s++) {
+        uint64_t m = ((one << s) + span / 2) / span;
+        if (m > limit) {
+            break;
+        }
+        *multiplier = m;
+        *shift = (uint8_t)s;
+    }
+}
+
+/**
+ * Checks whether a membership function can be prepared for fixed point
+ * evaluation: a piecewise linear shape with ordered breakpoints in a universe
+ * which is not empty.
+ */
+static bool supportedFunction(MembershipFunction_t mf, FuzzyReal_t min,
+                              FuzzyReal_t max) {
+    if (!(max > min)) {
+        return false;
+    }
+    switch (mf.type) {
+    case TRIANGULAR:
+        return mf.a <= mf.b && mf.b <= mf.c;
+    case TRAPEZOIDAL:
+        return mf.a <= mf.b && mf.b <= mf.c && mf.c <= mf.d;
+    case RECTANGULAR:
+        return mf.a <= mf.b;
+    default:
+        return false;
+    }
+}
+
+/**
+ * Prepares a membership function for Q15 evaluation.
+ *
+ * Only the piecewise linear shapes TRIANGULAR, TRAPEZOIDAL and RECTANGULAR
+ * with ordered breakpoints are supported. Other functions are rejected and
+ * prepared to have no membership.
+ *
+ * @param function The FuzzyQ15Function_t to initialize.
+ * @param mf The membership function.
+ * @param min The lower end of the universe of the set.
+ * @param max The upper end of the universe of the set, greater than min.
+ * @return false if the shape is not supported, its breakpoints are not
+ * ordered or the universe is empty.
+ */
+bool FuzzyQ15FunctionInit(FuzzyQ15Function_t *function,
+                          MembershipFunction_t mf, FuzzyReal_t min,
+                          FuzzyReal_t max) {
+    uint64_t rise, fall;
+
+    if (!supportedFunction(mf, min, max)) {
+        *function = (FuzzyQ15Function_t){.type = FUZZY_NUM_MEMBERSHIP_TYPES};
+        return false;
+    }
+
+    function->a = FuzzyQ15FromReal(mf.a, min, max);
+    function->b = FuzzyQ15FromReal(mf.b, min, max);
+    function->c = FuzzyQ15FromReal(mf.c, min, max);
+    function->d = FuzzyQ15FromReal(mf.d, min, max);
+    function->type = (uint8_t)mf.type;
+
+    // The falling edge of a triangle ends in c, that of a trapezoid in d
+    const int32_t end = mf.type == TRIANGULAR ? function->c : function->d;
+    const int32_t top = mf.type == TRIANGULAR ? function->b : function->c;
+    slopeMultiplier(FUZZY_Q15_ONE, (uint64_t)(function->b - function->a),
+                    UINT16_MAX, 31, &rise, &function->riseShift);
+    slopeMultiplier(FUZZY_Q15_ONE, (uint64_t)(end > top ? end - top : 0),
+                    UINT16_MAX, 31, &fall, &function->fallShift);
+    function->rise = (uint16_t)rise;
+    function->fall = (uint16_t)fall;
+    return true;
+}
+
+/**
+ * Prepares a membership function for Q31 evaluation.
+ *
+ * See FuzzyQ15FunctionInit().
+ *
+ * @param function The FuzzyQ31Function_t to initialize.
+ * @param mf The membership function.
+ * @param min The lower end of the universe of the set.
+ * @param max The upper end of the universe of the set, greater than min.
+ * @return false if the shape is not supported, its breakpoints are not
+ * ordered or the universe is empty.
+ */
+bool FuzzyQ31FunctionInit(FuzzyQ31Function_t *function,
+                          MembershipFunction_t mf, FuzzyReal_t min,
+                          FuzzyReal_t max) {
+    uint64_t rise, fall;
+
+    if (!supportedFunction(mf, min, max)) {
+        *function = (FuzzyQ31Function_t){.type = FUZZY_NUM_MEMBERSHIP_TYPES};
+        return false;
+    }
+
+    function->a = FuzzyQ31FromReal(mf.a, min, max);
+    function->b = FuzzyQ31FromReal(mf.b, min, max);
+    function->c = FuzzyQ31FromReal(mf.c, min, max);
+    function->d = FuzzyQ31FromReal(mf.d, min, max);
+    function->type = (uint8_t)mf.type;
+
+    const int64_t end = mf.type == TRIANGULAR ? function->c : function->d;
+    const int64_t top = mf.type == TRIANGULAR ? function->b : function->c;
+    slopeMultiplier(FUZZY_Q31_ONE,
+                    (uint64_t)((int64_t)function->b - function->a),
+                    UINT32_MAX, 32, &rise, &function->riseShift);
+    slopeMultiplier(FUZZY_Q31_ONE, (uint64_t)(end > top ? end - top : 0),
+                    UINT32_MAX, 32, &fall, &function->fallShift);
+    function->rise = (uint32_t)rise;
+    function->fall = (uint32_t)fall;
+    return true;
+}
+
+/**
+ * Converts the centroids of membership functions to Q15.
+ *
+ * @param mfs The membership functions of the output set.
+ * @param length The number of membership functions.
+ * @param min The lower end of the universe of the set.
+ * @param max The upper end of the universe of the set.
+ * @param centroids The output buffer, must hold length values.
+ */
+void FuzzyQ15Centroids(const MembershipFunction_t *mfs, int length,
+                       FuzzyReal_t min, FuzzyReal_t max,
+                       FuzzyQ15_t *centroids) {
+    for (int i = 0; i < length; i++) {
+        centroids[i] =
+            FuzzyQ15FromReal(calculateCentroid(mfs[i], 1.0), min, max);
+    }
+}
+
+/**
+ * Converts the centroids of membership functions to Q31.
+ *
+ * @param mfs The membership functions of the output set.
+ * @param length The number of membership functions.
+ * @param min The lower end of the universe of the set.
+ * @param max The upper end of the universe of the set.
+ * @param centroids The output buffer, must hold length values.
+ */
+void FuzzyQ31Centroids(const MembershipFunction_t *mfs, int length,
+                       FuzzyReal_t min, FuzzyReal_t max,
+                       FuzzyQ31_t *centroids) {
+    for (int i = 0; i < length; i++) {
+        centroids[i] =
+            FuzzyQ31FromReal(calculateCentroid(mfs[i], 1.0), min, max);
+    }
+}
+
+/**
+ * Scales the distance from a breakpoint to a Q15 degree, saturating at 1.
+ */
+static inline FuzzyQ15_t q15Slope(int32_t distance, uint16_t multiplier,
+                                  uint8_t shift) {
+    uint32_t degree = ((uint32_t)distance * multiplier) >> shift;
+    return degree > FUZZY_Q15_ONE ? FUZZY_Q15_ONE : (FuzzyQ15_t)degree;
+}
+
+/**
+ * Scales the distance from a breakpoint to a Q31 degree, saturating at 1.
+ */
+static inline FuzzyQ31_t q31Slope(int64_t distance, uint32_t multiplier,
+                                  uint8_t shift) {
+    uint64_t degree = ((uint64_t)distance * multiplier) >> shift;
+    return degree > FUZZY_Q31_ONE ? FUZZY_Q31_ONE : (FuzzyQ31_t)degree;
+}
+
+/**
+ * Calculates the Q15 membership degree of a prepared membership function.
+ *
+ * The function mirrors membershipFunction(), with the same comparisons
+ * deciding which edge applies, so zero and full membership are exact and the
+ * slopes are within one or two units in the last place.
+ *
+ * @param x The Q15 input value.
+ * @param function The prepared FuzzyQ15Function_t.
+ * @return The Q15 membership degree in [0, FUZZY_Q15_ONE].
+ */
+FuzzyQ15_t FuzzyQ15Membership(FuzzyQ15_t x,
+                              const FuzzyQ15Function_t *function) {
+    const FuzzyQ15Function_t *f = function;
+
+    switch (f->type) {
+    case TRIANGULAR:
+        if (x < f->a || x > f->c) {
+            return 0;
+        } else if (x <= f->b) {
+            if (f->a == f->b) {
+                return FUZZY_Q15_ONE;
+            }
+            return q15Slope(x - f->a, f->rise, f->riseShift);
+        }
+        return q15Slope(f->c - x, f->fall, f->fallShift);
+    case TRAPEZOIDAL:
+        if (x <= f->a || x >= f->d) {
+            return 0;
+        } else if (x <= f->b) {
+            return q15Slope(x - f->a, f->rise, f->riseShift);
+        } else if (x >= f->c) {
+            return q15Slope(f->d - x, f->fall, f->fallShift);
+        }
+        return FUZZY_Q15_ONE;
+    case RECTANGULAR:
+        return (x < f->a || x >= f->b) ? 0 : FUZZY_Q15_ONE;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Calculates the Q31 membership degree of a prepared membership function.
+ *
+ * @param x The Q31 input value.
+ * @param function The prepared FuzzyQ31Function_t.
+ * @return The Q31 membership degree in [0, FUZZY_Q31_ONE].
+ */
+FuzzyQ31_t FuzzyQ31Membership(FuzzyQ31_t x,
+                              const FuzzyQ31Function_t *function) {
+    const FuzzyQ31Function_t *f = function;
+
+    switch (f->type) {
+    case TRIANGULAR:
+        if (x < f->a || x > f->c) {
+            return 0;
+        } else if (x <= f->b) {
+            if (f->a == f->b) {
+                return FUZZY_Q31_ONE;
+            }
+            return q31Slope((int64_t)x - f->a, f->rise, f->riseShift);
+        }
+        return q31Slope((int64_t)f->c - x, f->fall, f->fallShift);
+    case TRAPEZOIDAL:
+        if (x <= f->a || x >= f->d) {
+            return 0;
+        } else if (x <= f->b) {
+            return q31Slope((int64_t)x - f->a, f->rise, f->riseShift);
+        } else if (x >= f->c) {
+            return q31Slope((int64_t)f->d - x, f->fall, f->fallShift);
+        }
+        return FUZZY_Q31_ONE;
+    case RECTANGULAR:
+        return (x < f->a || x >= f->b) ? 0 : FUZZY_Q31_ONE;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Performs fuzzy classification of a Q15 input value.
+ *
+ * @param x The Q15 input value.
+ * @param functions The prepared membership functions of the set.
+ * @param length The number of membership functions.
+ * @param values The output buffer, must hold length values.
+ */
+void FuzzyQ15Classify(FuzzyQ15_t x, const FuzzyQ15Function_t *functions,
+                      int length, FuzzyQ15_t *values) {
+    for (int i = 0; i < length; i++) {
+        values[i] = FuzzyQ15Membership(x, &functions[i]);
+    }
+}
+
+/**
+ * Performs fuzzy classification of a Q31 input value.
+ *
+ * @param x The Q31 input value.
+ * @param functions The prepared membership functions of the set.
+ * @param length The number of membership functions.
+ * @param values The output buffer, must hold length values.
+ */
+void FuzzyQ31Classify(FuzzyQ31_t x, const FuzzyQ31Function_t *functions,
+                      int length, FuzzyQ31_t *values) {
+    for (int i = 0; i < length; i++) {
+        values[i] = FuzzyQ31Membership(x, &functions[i]);
+    }
+}
+
+// Generates the interpreter of a compiled program for one fixed point type,
+// see executeOps() in program.c for the double version
+#define FUZZY_DEFINE_FIXED_RUN(_name, _type, _one, _min, _max)                 \
+    bool _name(const FuzzyProgram_t *program, _type *const *values) {          \
+        const FuzzyOp_t *end = program->ops + program->numOps;                 \
+        _type strength = _one;                                                 \
+        _type group = _one;                                                    \
+                                                                               \
+        if (program->norm != FUZZY_NORM_MIN_MAX) {                             \
+            return false;                                                      \
+        }                                                                      \
+        for (int i = 0; i < program->numOutputs; i++) {                        \
+            const int set = program->outputs[i];                               \
+            for (int j = 0; j < program->sets[set]->length; j++) {             \
+                values[set][j] = 0;                                            \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        for (const FuzzyOp_t *op = program->ops; op < end; op++) {             \
+            const _type value =                                                \
+                op->code == FUZZY_OP_RULE ? 0 : values[op->set][op->value];    \
+            switch (op->code) {                                                \
+            case FUZZY_OP_RULE:                                                \
+                strength = _one;                                               \
+                break;                                                         \
+            case FUZZY_OP_ALL_OF:                                              \
+                group = _one;                                                  \
+                break;                                                         \
+            case FUZZY_OP_ANY_OF:                                              \
+                group = 0;                                                     \
+                break;                                                         \
+            case FUZZY_OP_MIN:                                                 \
+                group = _min(group, value);                                    \
+                break;                                                         \
+            case FUZZY_OP_MIN_NOT:                                             \
+                group = _min(group, (_type)(_one - value));                    \
+                break;                                                         \
+            case FUZZY_OP_MAX:                                                 \
+                group = _max(group, value);                                    \
+                break;                                                         \
+            case FUZZY_OP_MAX_NOT:                                             \
+                group = _max(group, (_type)(_one - value));                    \
+                break;                                                         \
+            case FUZZY_OP_REDUCE:                                              \
+                strength = _min(strength, group);                              \
+                break;                                                         \
+            case FUZZY_OP_ACCUMULATE:                                          \
+                values[op->set][op->value] = _max(value, strength);            \
+                break;                                                         \
+            case FUZZY_OP_STORE:                                               \
+                values[op->set][op->value] = group;                            \
+                break;                                                         \
+            case FUZZY_OP_LOAD:                                                \
+                strength = _min(strength, value);                              \
+                break;                                                         \
+            default:                                                           \
+                break;                                                         \
+            }                                                                  \
+        }                                                                      \
+        return true;                                                           \
+    }
+
+/**
+ * Runs a compiled program on Q15 membership values.
+ *
+ * Works like FuzzyProgramRunValues() with integer min and max, so only
+ * programs of the FUZZY_NORM_MIN_MAX family are supported (see FuzzyNorm_e).
+ * Degrees are never negative, so the complement of NOT() can not overflow.
+ * The output sets are reset but not normalized: the weighted centroid of
+ * FuzzyQ15Defuzzify() does not depend on the scale of the degrees, and
+ * leaving out the normalization saves a division per output value.
+ *
+ * @param program The compiled FuzzyProgram_t to run.
+ * @param values The Q15 membership value arrays, one per set of the program.
+ * @return false if the program uses another operator family, the values are
+ * left untouched then.
+ */
+FUZZY_DEFINE_FIXED_RUN(FuzzyProgramRunQ15, FuzzyQ15_t, FUZZY_Q15_ONE,
+                       fuzzyQ15Min, fuzzyQ15Max)
+
+/**
+ * Runs a compiled program on Q31 membership values.
+ *
+ * See FuzzyProgramRunQ15().
+ *
+ * @param program The compiled FuzzyProgram_t to run.
+ * @param values The Q31 membership value arrays, one per set of the program.
+ * @return false if the program uses another operator family, the values are
+ * left untouched then.
+ */
+FUZZY_DEFINE_FIXED_RUN(FuzzyProgramRunQ31, FuzzyQ31_t, FUZZY_Q31_ONE,
+                       fuzzyQ31Min, fuzzyQ31Max)
+
+/**
+ * Calculates the weighted centroid of Q15 membership values.
+ *
+ * This is the fixed point version of defuzzificationValues() and takes a
+ * single division.
+ *
+ * @param values The Q15 membership values of the output set.
+ * @param centroids The Q15 centroids, see FuzzyQ15Centroids().
+ * @param length The number of membership values.
+ * @return The Q15 crisp value, 0 (the center of the universe) if no value is
+ * set.
+ */
+FuzzyQ15_t FuzzyQ15Defuzzify(const FuzzyQ15_t *values,
+                             const FuzzyQ15_t *centroids, int length) {
+    int64_t sum = 0;
+    int32_t sumOfMemberships = 0;
+
+    for (int i = 0; i < length; i++) {
+        sum += (int32_t)values[i] * centroids[i];
+        sumOfMemberships += values[i];
+    }
+
+    if (sumOfMemberships == 0) {
+        return 0;
+    }
+
+    int64_t half = sumOfMemberships / 2;
+    return fuzzyQ15Saturate(
+        (int32_t)((sum >= 0 ? sum + half : sum - half) / sumOfMemberships));
+}
+
+/**
+ * Calculates the weighted centroid of Q31 membership values.
+ *
+ * See FuzzyQ15Defuzzify(). The degrees are truncated so that the sum of
+ * products fits 64 bits: to 23 bits for sets of up to 256 functions and to 15
+ * bits for larger ones.
+ *
+ * @param values The Q31 membership values of the output set.
+ * @param centroids The Q31 centroids, see FuzzyQ31Centroids().
+ * @param length The number of membership values.
+ * @return The Q31 crisp value, 0 (the center of the universe) if no value is
+ * set.
+ */
+FuzzyQ31_t FuzzyQ31Defuzzify(const FuzzyQ31_t *values,
+                             const FuzzyQ31_t *centroids, int length) {
+    const int shift = length <= 256 ? 8 : 16;
+    int64_t sum = 0;
+    int64_t sumOfMemberships = 0;
+
+    for (int i = 0; i < length; i++) {
+        const int32_t weight = values[i] >> shift;
+        sum += (int64_t)weight * centroids[i];
+        sumOfMemberships += weight;
+    }
+
+    if (sumOfMemberships == 0) {
+        return 0;
+    }
+
+    int64_t half = sumOfMemberships / 2;
+    return fuzzyQ31Saturate((sum >= 0 ? sum + half : sum - half) /
+                            sumOfMemberships);
+}
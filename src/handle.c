@@ -0,0 +1,291 @@
+/**
+ * @file handle.c
+ * @brief Fuzzy Logic hot swappable model handle implementation.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "handle.h"
+
+#include "model.h"
+
+#include <stdlib.h>
+
+/**
+ * Initializes a FuzzyModelHandle_t struct.
+ *
+ * @param handle The FuzzyModelHandle_t struct to initialize.
+ * @param model The initial model.
+ * @param numReaders The number of reader slots, one per evaluating thread.
+ * @param release Called with every model the handle is done with, may be
+ * NULL.
+ * @param context Passed to release.
+ * @return false if allocating the reader slots failed.
+ */
+bool FuzzyModelHandleInit(FuzzyModelHandle_t *handle, const FuzzyModel_t *model,
+                          int numReaders, FuzzyModelRelease_t release,
+                          void *context) {
+    FuzzyReader_t *readers = (FuzzyReader_t *)aligned_alloc(
+        _Alignof(FuzzyReader_t), numReaders * sizeof(FuzzyReader_t));
+    if (readers == NULL) {
+        return false;
+    }
+    for (int i = 0; i < numReaders; i++) {
+        atomic_init(&readers[i].epoch, 0);
+        readers[i].stateEpoch = 0;
+    }
+
+    atomic_init(&handle->model, model);
+    atomic_init(&handle->epoch, 2);
+    handle->readers = readers;
+    handle->numReaders = numReaders;
+    handle->release = release;
+    handle->context = context;
+    atomic_flag_clear(&handle->lock);
+    handle->retired = NULL;
+    handle->numRetired = 0;
+    handle->capacity = 0;
+    return true;
+}
+
+static void releaseModel(FuzzyModelHandle_t *handle,
+                         const FuzzyModel_t *model) {
+    if (handle->release != NULL) {
+        handle->release(model, handle->context);
+    }
+}
+
+/**
+ * Frees the memory allocated for a FuzzyModelHandle_t struct.
+ *
+ * The current model and all retired models are released. No reader may be
+ * evaluating the handle anymore.
+ *
+ * @param handle The FuzzyModelHandle_t struct to free.
+ */
+void FuzzyModelHandleFree(FuzzyModelHandle_t *handle) {
+    for (int i = 0; i < handle->numRetired; i++) {
+        releaseModel(handle, handle->retired[i].model);
+    }
+    releaseModel(handle, atomic_load(&handle->model));
+
+    for (int i = 0; i < handle->numReaders; i++) {
+        if (handle->readers[i].stateEpoch != 0) {
+            FuzzyStateFree(&handle->readers[i].state);
+        }
+    }
+    free(handle->readers);
+    free(handle->retired);
+}
+
+/**
+ * Announces a reader and loads the current model with its epoch.
+ *
+ * The epoch is announced before the model is loaded, so a swap which does
+ * not see the announcement has already published its model. The pair is
+ * retried until no swap ran in between, so the model is the one published
+ * under the epoch.
+ */
+static const FuzzyModel_t *enter(FuzzyModelHandle_t *handle,
+                                 FuzzyReader_t *reader, uint64_t *epoch) {
+    const FuzzyModel_t *model;
+    uint64_t current;
+
+    do {
+        current = atomic_load(&handle->epoch);
+        if (current & 1) {
+            continue;
+        }
+        atomic_store(&reader->epoch, current);
+        model = atomic_load(&handle->model);
+    } while ((current & 1) || atomic_load(&handle->epoch) != current);
+
+    *epoch = current;
+    return model;
+}
+
+/**
+ * Enters a read side critical section and returns the current model.
+ *
+ * The model stays valid until FuzzyModelHandleExit() with the same reader,
+ * even if it is swapped out in between. Every thread must use its own reader
+ * slot and sections of one reader must not nest.
+ *
+ * @param handle The FuzzyModelHandle_t to read.
+ * @param reader The reader slot of the calling thread.
+ * @return The current model.
+ */
+const FuzzyModel_t *FuzzyModelHandleEnter(FuzzyModelHandle_t *handle,
+                                          int reader) {
+    uint64_t epoch;
+    return enter(handle, &handle->readers[reader], &epoch);
+}
+
+/**
+ * Leaves a read side critical section.
+ *
+ * @param handle The FuzzyModelHandle_t read.
+ * @param reader The reader slot of the calling thread.
+ */
+void FuzzyModelHandleExit(FuzzyModelHandle_t *handle, int reader) {
+    atomic_store_explicit(&handle->readers[reader].epoch, 0,
+                          memory_order_release);
+}
+
+/**
+ * Evaluates the current model of a handle.
+ *
+ * This function works like FuzzyEvaluate() on the model current when it is
+ * called, using the state of the reader slot. The state is laid out again on
+ * the first evaluation after a swap, which is the only time this function
+ * allocates.
+ *
+ * @param handle The FuzzyModelHandle_t to evaluate.
+ * @param reader The reader slot of the calling thread.
+ * @param inputs The crisp inputs, one per input set of the model.
+ * @param outputs The crisp outputs, one per output set of the model.
+ * @return false if allocating the state failed, no outputs are written then
+ * and the next evaluation tries again.
+ */
+bool FuzzyModelHandleEvaluate(FuzzyModelHandle_t *handle, int reader,
+                              const FuzzyReal_t *inputs, FuzzyReal_t *outputs) {
+    FuzzyReader_t *slot = &handle->readers[reader];
+    uint64_t epoch;
+    const FuzzyModel_t *model = enter(handle, slot, &epoch);
+
+    if (slot->stateEpoch != epoch) {
+        if (slot->stateEpoch != 0) {
+            FuzzyStateFree(&slot->state);
+        }
+        slot->stateEpoch = 0;
+        if (!FuzzyStateInit(&slot->state, model)) {
+            FuzzyModelHandleExit(handle, reader);
+            return false;
+        }
+        slot->stateEpoch = epoch;
+    }
+    FuzzyEvaluate(model, &slot->state, inputs, outputs);
+
+    FuzzyModelHandleExit(handle, reader);
+    return true;
+}
+
+static void lock(FuzzyModelHandle_t *handle) {
+    while (atomic_flag_test_and_set_explicit(&handle->lock,
+                                             memory_order_acquire)) {
+    }
+}
+
+static void unlock(FuzzyModelHandle_t *handle) {
+    atomic_flag_clear_explicit(&handle->lock, memory_order_release);
+}
+
+/**
+ * Returns the oldest epoch announced by a reader, UINT64_MAX if none is
+ * inside a critical section.
+ */
+static uint64_t oldestReader(const FuzzyModelHandle_t *handle) {
+    uint64_t oldest = UINT64_MAX;
+    for (int i = 0; i < handle->numReaders; i++) {
+        const uint64_t epoch = atomic_load(&handle->readers[i].epoch);
+        if (epoch != 0 && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+    return oldest;
+}
+
+/**
+ * Releases the retired models no reader can reference, with the lock held.
+ *
+ * @return The number of models still retired.
+ */
+static int reclaim(FuzzyModelHandle_t *handle) {
+    const uint64_t oldest = oldestReader(handle);
+    int kept = 0;
+
+    for (int i = 0; i < handle->numRetired; i++) {
+        if (handle->retired[i].epoch <= oldest) {
+            releaseModel(handle, handle->retired[i].model);
+        } else {
+            handle->retired[kept++] = handle->retired[i];
+        }
+    }
+    handle->numRetired = kept;
+    return kept;
+}
+
+/**
+ * Replaces the model of a handle.
+ *
+ * Evaluations starting after this call use the new model, evaluations still
+ * running on the old model finish on it. The old model is released as soon
+ * as no reader can reference it anymore, by this or a later swap or by
+ * FuzzyModelHandleReclaim(). Readers are never blocked. Must not be called
+ * inside a read side critical section.
+ *
+ * @param handle The FuzzyModelHandle_t to update.
+ * @param model The new model.
+ */
+void FuzzyModelHandleSwap(FuzzyModelHandle_t *handle,
+                          const FuzzyModel_t *model) {
+    lock(handle);
+
+    atomic_fetch_add(&handle->epoch, 1);
+    const FuzzyModel_t *old = atomic_exchange(&handle->model, model);
+    const uint64_t epoch = atomic_fetch_add(&handle->epoch, 1) + 1;
+
+    if (handle->numRetired == handle->capacity) {
+        const int capacity = handle->capacity ? 2 * handle->capacity : 4;
+        FuzzyRetiredModel_t *retired = (FuzzyRetiredModel_t *)realloc(
+            handle->retired, capacity * sizeof(FuzzyRetiredModel_t));
+        if (retired != NULL) {
+            handle->retired = retired;
+            handle->capacity = capacity;
+        }
+    }
+
+    if (handle->numRetired < handle->capacity) {
+        handle->retired[handle->numRetired++] =
+            (FuzzyRetiredModel_t){.model = old, .epoch = epoch};
+    } else {
+        // Without room to retire the model wait for its readers instead
+        while (oldestReader(handle) < epoch) {
+        }
+        releaseModel(handle, old);
+    }
+    reclaim(handle);
+
+    unlock(handle);
+}
+
+/**
+ * Releases the retired models no reader can reference anymore.
+ *
+ * @param handle The FuzzyModelHandle_t to reclaim.
+ * @return The number of models still waiting for readers.
+ */
+int FuzzyModelHandleReclaim(FuzzyModelHandle_t *handle) {
+    lock(handle);
+    const int pending = reclaim(handle);
+    unlock(handle);
+    return pending;
+}
+
+/**
+ * Waits until every retired model has been released.
+ *
+ * Readers only hold a model for one evaluation, so this returns as soon as
+ * the evaluations running at the time of the last swap have finished. Must
+ * not be called inside a read side critical section.
+ *
+ * @param handle The FuzzyModelHandle_t to reclaim.
+ */
+void FuzzyModelHandleSynchronize(FuzzyModelHandle_t *handle) {
+    while (FuzzyModelHandleReclaim(handle) > 0) {
+    }
+}
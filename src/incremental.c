@@ -0,0 +1,341 @@
+/**
+ * @file incremental.c
+ * @brief Fuzzy Logic incremental evaluation implementation.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "incremental.h"
+
+#include "class.h"
+#include "classifier.h"
+#include "model.h"
+#include "program.h"
+
+#include <stdlib.h>
+
+/**
+ * Initializes a FuzzyContext_t struct for a model.
+ *
+ * This function allocates the caches and builds the dependencies between the
+ * inputs, rules and output sets of the model. Models whose rules read sets
+ * other than the inputs, or which use FUZZY_NORMALIZE_PER_RULE, depend on the
+ * order of evaluation and are fully evaluated every time instead, as are
+ * models with Takagi-Sugeno consequents or operators other than min and max,
+ * and every model in FUZZY_WCET builds. The first evaluation always computes
+ * everything.
+ *
+ * @param context The FuzzyContext_t struct to initialize.
+ * @param model The FuzzyModel_t to evaluate, must outlive the context.
+ */
+void FuzzyContextInit(FuzzyContext_t *context, const FuzzyModel_t *model) {
+    const FuzzyProgram_t *program = &model->program;
+    const FuzzyOp_t *end = program->ops + program->numOps;
+
+    context->model = model;
+    FuzzyStateInit(&context->state, model);
+    context->inputs =
+        (FuzzyReal_t *)calloc(model->numInputs, sizeof(FuzzyReal_t));
+    context->outputs =
+        (FuzzyReal_t *)calloc(model->numOutputs, sizeof(FuzzyReal_t));
+    context->dirtyInputs = (bool *)calloc(model->numInputs, sizeof(bool));
+    context->dirtyAll = true;
+    context->stamp = 0;
+
+    // Find the rules and check whether they only depend on the inputs
+    bool incremental = program->normalization == FUZZY_NORMALIZE_ONCE &&
+                       program->norm == FUZZY_NORM_MIN_MAX &&
+                       model->tsk == NULL;
+#ifdef FUZZY_WCET
+    // Skipping unchanged rules makes the cost depend on the inputs
+    incremental = false;
+#endif
+    int numRules = 0;
+    for (const FuzzyOp_t *op = program->ops; op < end; op++) {
+        if (op->code == FUZZY_OP_RULE) {
+            numRules++;
+        } else if (op->code >= FUZZY_OP_MIN && op->code <= FUZZY_OP_MAX_NOT &&
+                   op->set >= model->numInputs) {
+            incremental = false;
+        } else if (op->code == FUZZY_OP_STORE) {
+            // shared groups are not tracked per input
+            incremental = false;
+        }
+    }
+    context->incremental = incremental;
+    context->numRules = numRules;
+
+    uint32_t *ruleStarts =
+        (uint32_t *)malloc((numRules + 1) * sizeof(uint32_t));
+    numRules = 0;
+    for (int i = 0; i < program->numOps; i++) {
+        if (program->ops[i].code == FUZZY_OP_RULE) {
+            ruleStarts[numRules++] = i;
+        }
+    }
+    ruleStarts[numRules] = program->numOps;
+    context->ruleStarts = ruleStarts;
+    context->strengths = (FuzzyReal_t *)calloc(numRules, sizeof(FuzzyReal_t));
+    context->ruleStamps = (uint32_t *)calloc(numRules, sizeof(uint32_t));
+
+    context->outputOfSet = (int *)malloc(program->numSets * sizeof(int));
+    for (int i = 0; i < program->numSets; i++) {
+        context->outputOfSet[i] = -1;
+    }
+    for (int o = 0; o < program->numOutputs; o++) {
+        context->outputOfSet[program->outputs[o]] = o;
+    }
+    context->dirtyOutputs = (bool *)calloc(program->numOutputs, sizeof(bool));
+
+    // List the rules of every input and the consequents of every output in two
+    // passes, counting first. A rule is listed once per input even if it reads
+    // the input several times.
+    uint32_t *inputStarts =
+        (uint32_t *)calloc(model->numInputs + 1, sizeof(uint32_t));
+    uint32_t *outputStarts =
+        (uint32_t *)calloc(program->numOutputs + 1, sizeof(uint32_t));
+    uint32_t *inputRules = NULL;
+    uint32_t *outputRules = NULL;
+    uint16_t *outputValues = NULL;
+    int *lastInput = (int *)malloc(model->numInputs * sizeof(int));
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < model->numInputs; i++) {
+            lastInput[i] = -1;
+        }
+
+        for (int r = 0; r < numRules; r++) {
+            for (uint32_t k = ruleStarts[r]; k < ruleStarts[r + 1]; k++) {
+                const FuzzyOp_t *op = &program->ops[k];
+                if (op->code >= FUZZY_OP_MIN && op->code <= FUZZY_OP_MAX_NOT &&
+                    op->set < model->numInputs && lastInput[op->set] != r) {
+                    lastInput[op->set] = r;
+                    if (pass == 0) {
+                        inputStarts[op->set + 1]++;
+                    } else {
+                        inputRules[inputStarts[op->set]++] = r;
+                    }
+                } else if (op->code == FUZZY_OP_ACCUMULATE) {
+                    const int o = context->outputOfSet[op->set];
+                    if (pass == 0) {
+                        outputStarts[o + 1]++;
+                    } else {
+                        outputRules[outputStarts[o]] = r;
+                        outputValues[outputStarts[o]++] = op->value;
+                    }
+                }
+            }
+        }
+
+        if (pass == 0) {
+            for (int i = 0; i < model->numInputs; i++) {
+                inputStarts[i + 1] += inputStarts[i];
+            }
+            for (int o = 0; o < program->numOutputs; o++) {
+                outputStarts[o + 1] += outputStarts[o];
+            }
+            inputRules = (uint32_t *)malloc(
+                (inputStarts[model->numInputs] + 1) * sizeof(uint32_t));
+            outputRules = (uint32_t *)malloc(
+                (outputStarts[program->numOutputs] + 1) * sizeof(uint32_t));
+            outputValues = (uint16_t *)malloc(
+                (outputStarts[program->numOutputs] + 1) * sizeof(uint16_t));
+        }
+    }
+
+    // The second pass advanced every start to the start of the next list
+    for (int i = model->numInputs; i > 0; i--) {
+        inputStarts[i] = inputStarts[i - 1];
+    }
+    inputStarts[0] = 0;
+    for (int o = program->numOutputs; o > 0; o--) {
+        outputStarts[o] = outputStarts[o - 1];
+    }
+    outputStarts[0] = 0;
+
+    free(lastInput);
+    context->inputStarts = inputStarts;
+    context->inputRules = inputRules;
+    context->outputStarts = outputStarts;
+    context->outputRules = outputRules;
+    context->outputValues = outputValues;
+}
+
+/**
+ * Frees the memory allocated for a FuzzyContext_t struct.
+ *
+ * @param context The FuzzyContext_t struct to free.
+ */
+void FuzzyContextFree(FuzzyContext_t *context) {
+    FuzzyStateFree(&context->state);
+    free(context->inputs);
+    free(context->outputs);
+    free(context->dirtyInputs);
+    free(context->ruleStarts);
+    free(context->strengths);
+    free(context->ruleStamps);
+    free(context->inputStarts);
+    free(context->inputRules);
+    free(context->outputStarts);
+    free(context->outputRules);
+    free(context->outputValues);
+    free(context->outputOfSet);
+    free(context->dirtyOutputs);
+}
+
+/**
+ * Sets a crisp input of an incremental evaluation.
+ *
+ * The input is only marked dirty if its value changed, so calling this
+ * function every tick for every input is cheap.
+ *
+ * @param context The FuzzyContext_t to update.
+ * @param input The index of the input.
+ * @param x The crisp input value.
+ */
+void FuzzyUpdateInput(FuzzyContext_t *context, int input, FuzzyReal_t x) {
+    if (context->inputs[input] != x) {
+        context->inputs[input] = x;
+        context->dirtyInputs[input] = true;
+    }
+}
+
+/**
+ * Recomputes the strength of a rule and marks the outputs it feeds dirty if
+ * the strength changed.
+ */
+static void updateRule(FuzzyContext_t *context, uint32_t rule) {
+    const FuzzyProgram_t *program = &context->model->program;
+
+    if (context->ruleStamps[rule] == context->stamp) {
+        return;
+    }
+    context->ruleStamps[rule] = context->stamp;
+
+    const FuzzyOp_t *op = program->ops + context->ruleStarts[rule];
+    const FuzzyOp_t *end = program->ops + context->ruleStarts[rule + 1];
+    FuzzyReal_t strength = FuzzyRuleStrength(op, end, context->state.values);
+    if (strength == context->strengths[rule] && !context->dirtyAll) {
+        return;
+    }
+
+    context->strengths[rule] = strength;
+    for (; op < end; op++) {
+        if (op->code == FUZZY_OP_ACCUMULATE) {
+            context->dirtyOutputs[context->outputOfSet[op->set]] = true;
+        }
+    }
+}
+
+/**
+ * Recomputes an output set from the cached rule strengths.
+ */
+static void updateOutput(FuzzyContext_t *context, int output) {
+    const FuzzyModel_t *model = context->model;
+    const FuzzyProgram_t *program = &model->program;
+    const int set = program->outputs[output];
+    FuzzyReal_t *values = context->state.values[set];
+
+    for (int j = 0; j < program->sets[set]->length; j++) {
+        values[j] = 0.0;
+    }
+
+    for (uint32_t k = context->outputStarts[output];
+         k < context->outputStarts[output + 1]; k++) {
+        const uint32_t rule = context->outputRules[k];
+        const FuzzyReal_t strength = context->strengths[rule];
+        FuzzyReal_t *value = &values[context->outputValues[k]];
+        *value = *value > strength ? *value : strength;
+    }
+
+    normalizeMembershipValues(values, program->sets[set]->length);
+
+    if (set >= model->numInputs && set < model->numInputs + model->numOutputs) {
+        const int i = set - model->numInputs;
+        context->outputs[i] = FuzzyModelDefuzzify(model, i, values);
+    }
+}
+
+/**
+ * Evaluates a model incrementally.
+ *
+ * Only the dirty inputs are classified and only the rules reading them are
+ * recomputed. Output sets are rebuilt from the cached rule strengths when one
+ * of their rules changed strength, and only those outputs are defuzzified.
+ * For finite inputs the results are identical to FuzzyEvaluate() on the
+ * current inputs.
+ *
+ * @param context The FuzzyContext_t to evaluate.
+ * @param outputs Receives the crisp outputs, one per output set of the model,
+ * may be NULL when only context->outputs is used.
+ */
+void FuzzyContextEvaluate(FuzzyContext_t *context, FuzzyReal_t *outputs) {
+    const FuzzyModel_t *model = context->model;
+    const FuzzyProgram_t *program = &model->program;
+
+    if (!context->incremental) {
+        FuzzyEvaluate(model, &context->state, context->inputs,
+                      context->outputs);
+    } else {
+        // Restart the stamps before they wrap around
+        if (++context->stamp == 0) {
+            for (int r = 0; r < context->numRules; r++) {
+                context->ruleStamps[r] = 0;
+            }
+            context->stamp = 1;
+        }
+
+        // Classify every dirty input before the rules reading them are
+        // recomputed, as a rule may read several dirty inputs
+        for (int i = 0; i < model->numInputs; i++) {
+            if (context->dirtyAll || context->dirtyInputs[i]) {
+                FuzzyClassifierValues(context->inputs[i], program->sets[i],
+                                      context->state.values[i]);
+            }
+        }
+
+        for (int i = 0; i < model->numInputs; i++) {
+            if (!context->dirtyAll && !context->dirtyInputs[i]) {
+                continue;
+            }
+            for (uint32_t k = context->inputStarts[i];
+                 k < context->inputStarts[i + 1]; k++) {
+                updateRule(context, context->inputRules[k]);
+            }
+        }
+
+        if (context->dirtyAll) {
+            // Rules without inputs and outputs no rule feeds
+            for (int r = 0; r < context->numRules; r++) {
+                updateRule(context, r);
+            }
+            for (int i = 0; i < model->numOutputs; i++) {
+                const int set = model->numInputs + i;
+                context->outputs[i] =
+                    FuzzyModelDefuzzify(model, i, context->state.values[set]);
+            }
+        }
+
+        for (int o = 0; o < program->numOutputs; o++) {
+            if (context->dirtyAll || context->dirtyOutputs[o]) {
+                updateOutput(context, o);
+                context->dirtyOutputs[o] = false;
+            }
+        }
+    }
+
+    for (int i = 0; i < model->numInputs; i++) {
+        context->dirtyInputs[i] = false;
+    }
+    context->dirtyAll = false;
+
+    if (outputs != NULL) {
+        for (int i = 0; i < model->numOutputs; i++) {
+            outputs[i] = context->outputs[i];
+        }
+    }
+}
@@ -13,6 +13,7 @@
 
 #include "classifier.h"
 #include "membership_function.h"
+#include "stats.h"
 
 #include <math.h>
 #include <stdbool.h>
@@ -20,30 +21,19 @@
 #include <stdio.h>
 
 /**
- * Performs fuzzy inference on a set of fuzzy rules.
- *
- * This function takes a set of fuzzy rules and calculates the output
- * memberships for each rule. It iterates over each rule, calculates the
- * minimum membership of the inputs, and updates the output memberships
- * accordingly.
+ * Accumulates the strength of every rule into its consequent, the maximum of
+ * the consequent's current membership and the strength.
  *
  * @param rules An array of fuzzy rules.
  * @param numRules The number of fuzzy rules in the array.
  */
-void fuzzyInference(const FuzzyRule_t *rules, int numRules) {
-    // Initialize the output memberships of the consequent to 0
-    for (int i = 0; i < numRules; i++) {
-        rules[i]
-            .consequent.variable->membershipValues[rules[i].consequent.value] =
-            0.0;
-    }
-
+static void accumulateRules(const FuzzyRule_t *rules, int numRules) {
     // Iterate over each rule
     for (int i = 0; i < numRules; i++) {
         const FuzzyRule_t *rule = &rules[i];
 
         // Calculate the membership of the inputs
-        double membership = 1.0; // Initialize membership to 1.0 (maximum)
+        FuzzyReal_t membership = 1.0; // Initialize membership to 1.0 (maximum)
 
         // Iterate over each antecedent in the rule
         for (int j = 0; j < rule->num_antecedents; j++) {
@@ -53,9 +43,9 @@ void fuzzyInference(const FuzzyRule_t *rules, int numRules) {
             if (antecedent->fuzzy_operator== FUZZY_ANY_OF) {
                 // Calculate the maximum membership of the variables in the
                 // ANY_OF fuzzy_operator
-                double orMembership = 0.0;
+                FuzzyReal_t orMembership = 0.0;
                 for (int k = 0; k < antecedent->num_variables; k++) {
-                    double inputMembership;
+                    FuzzyReal_t inputMembership;
 
                     // Check if the variable is inverted (i.e., NOT() macro is
                     // used)
@@ -65,7 +55,7 @@ void fuzzyInference(const FuzzyRule_t *rules, int numRules) {
                         // because the NOT() macro inverts the membership of the
                         // variable
                         inputMembership =
-                            1.0 -
+                            FUZZY_REAL_C(1.0) -
                             antecedent->variables[k].variable->membershipValues
                                 [antecedent->variables[k].value];
                     } else {
@@ -87,9 +77,9 @@ void fuzzyInference(const FuzzyRule_t *rules, int numRules) {
             } else if (antecedent->fuzzy_operator== FUZZY_ALL_OF) {
                 // Calculate the minimum membership of the variables in the
                 // ALL_OF fuzzy_operator
-                double andMembership = 1.0;
+                FuzzyReal_t andMembership = 1.0;
                 for (int k = 0; k < antecedent->num_variables; k++) {
-                    double inputMembership;
+                    FuzzyReal_t inputMembership;
 
                     // Check if the variable is inverted (i.e., NOT() macro is
                     // used)
@@ -99,7 +89,7 @@ void fuzzyInference(const FuzzyRule_t *rules, int numRules) {
                         // because the NOT() macro inverts the membership of the
                         // variable
                         inputMembership =
-                            1.0 -
+                            FUZZY_REAL_C(1.0) -
                             antecedent->variables[k].variable->membershipValues
                                 [antecedent->variables[k].value];
                     } else {
@@ -129,10 +119,100 @@ void fuzzyInference(const FuzzyRule_t *rules, int numRules) {
                      .consequent.variable
                      ->membershipValues[rules[i].consequent.value],
                  membership);
+        FUZZY_STATS_RULE(i, membership);
+    }
+}
+
+/**
+ * Performs fuzzy inference on a set of fuzzy rules.
+ *
+ * This function takes a set of fuzzy rules and calculates the output
+ * memberships for each rule. It iterates over each rule, calculates the
+ * minimum membership of the inputs, and updates the output memberships
+ * accordingly.
+ *
+ * The consequent of every rule is reset and its set is normalized once per
+ * rule, so a set targeted by n rules is normalized n times, see
+ * FUZZY_NORMALIZE_PER_RULE. fuzzyInferenceOnce() resets and normalizes every
+ * output set once instead.
+ *
+ * @param rules An array of fuzzy rules.
+ * @param numRules The number of fuzzy rules in the array.
+ */
+void fuzzyInference(const FuzzyRule_t *rules, int numRules) {
+    FUZZY_STATS_BEGIN();
+
+    // Initialize the output memberships of the consequent to 0
+    for (int i = 0; i < numRules; i++) {
+        rules[i]
+            .consequent.variable->membershipValues[rules[i].consequent.value] =
+            0.0;
     }
 
+    accumulateRules(rules, numRules);
+
     // Normalize the output membership
     for (int i = 0; i < numRules; i++) {
         normalizeClass(rules[i].consequent.variable);
     }
+    FUZZY_STATS_END(FUZZY_STAGE_INFERENCE);
+}
+
+/**
+ * Collects the distinct output sets of a set of fuzzy rules, for
+ * fuzzyInferenceOnce().
+ *
+ * @param rules An array of fuzzy rules.
+ * @param numRules The number of fuzzy rules in the array.
+ * @param sets Receives the consequent sets in the order of their first rule,
+ * room for numRules sets.
+ * @return The number of distinct output sets.
+ */
+int fuzzyOutputSets(const FuzzyRule_t *rules, int numRules, FuzzySet_t **sets) {
+    int numSets = 0;
+    for (int i = 0; i < numRules; i++) {
+        FuzzySet_t *set = rules[i].consequent.variable;
+        int j = 0;
+        while (j < numSets && sets[j] != set) {
+            j++;
+        }
+        if (j == numSets) {
+            sets[numSets++] = set;
+        }
+    }
+    return numSets;
+}
+
+/**
+ * Performs fuzzy inference resetting and normalizing every output set once.
+ *
+ * This function works like fuzzyInference() but takes the distinct output
+ * sets of the rules, e.g. from fuzzyOutputSets() called once, and resets and
+ * normalizes each of them once instead of once per rule, see
+ * FUZZY_NORMALIZE_ONCE. The results agree with fuzzyInference() up to
+ * rounding, since normalizing an already normalized set divides by a sum
+ * which is only 1 within a few ulp. The whole output sets are reset, so values
+ * no rule targets no longer keep memberships of previous inferences.
+ *
+ * @param rules An array of fuzzy rules.
+ * @param numRules The number of fuzzy rules in the array.
+ * @param sets The distinct consequent sets of the rules.
+ * @param numSets The number of sets.
+ */
+void fuzzyInferenceOnce(const FuzzyRule_t *rules, int numRules,
+                        FuzzySet_t *const *sets, int numSets) {
+    FUZZY_STATS_BEGIN();
+
+    for (int s = 0; s < numSets; s++) {
+        for (int i = 0; i < sets[s]->length; i++) {
+            sets[s]->membershipValues[i] = 0.0;
+        }
+    }
+
+    accumulateRules(rules, numRules);
+
+    for (int s = 0; s < numSets; s++) {
+        normalizeClass(sets[s]);
+    }
+    FUZZY_STATS_END(FUZZY_STAGE_INFERENCE);
 }
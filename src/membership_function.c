@@ -11,6 +11,8 @@
 
 #include "membership_function.h"
 
+#include "fast_math.h"
+
 /**
  * Calculates the membership degree of a triangular membership function.
  *
@@ -24,7 +26,17 @@
  * @param c The end point of the triangle.
  * @return The membership degree of the input value.
  */
-double triangularMembershipFunction(double x, double a, double b, double c) {
+FuzzyReal_t triangularMembershipFunction(FuzzyReal_t x, FuzzyReal_t a,
+                                         FuzzyReal_t b, FuzzyReal_t c) {
+#ifdef FUZZY_WCET
+    // Both sides are calculated and selected, so the cost does not depend on
+    // x. The quotients of the side which is not selected may divide by zero.
+    const FuzzyReal_t left =
+        (b - a == 0) ? FUZZY_REAL_C(1.0) : (x - a) / (b - a);
+    const FuzzyReal_t right = (c - x) / (c - b);
+    const FuzzyReal_t value = (x <= b) ? left : right;
+    return (x < a || x > c) ? FUZZY_REAL_C(0.0) : value;
+#else
     // If x is outside the triangle, return 0 (no membership)
     if (x < a || x > c) {
         return 0.0;
@@ -43,6 +55,7 @@ double triangularMembershipFunction(double x, double a, double b, double c) {
     else {
         return (c - x) / (c - b);
     }
+#endif
 }
 
 /**
@@ -59,8 +72,17 @@ double triangularMembershipFunction(double x, double a, double b, double c) {
  * @param d The end point of the trapezoid.
  * @return The membership degree of the input value.
  */
-double trapezoidalMembershipFunction(double x, double a, double b, double c,
-                                     double d) {
+FuzzyReal_t trapezoidalMembershipFunction(FuzzyReal_t x, FuzzyReal_t a,
+                                          FuzzyReal_t b, FuzzyReal_t c,
+                                          FuzzyReal_t d) {
+#ifdef FUZZY_WCET
+    // See triangularMembershipFunction()
+    const FuzzyReal_t left = (x - a) / (b - a);
+    const FuzzyReal_t right = (d - x) / (d - c);
+    const FuzzyReal_t value =
+        (x <= b) ? left : ((x >= c) ? right : FUZZY_REAL_C(1.0));
+    return (x <= a || x >= d) ? FUZZY_REAL_C(0.0) : value;
+#else
     // If x is outside the trapezoid, return 0 (no membership)
     if (x <= a || x >= d) {
         return 0.0;
@@ -79,6 +101,7 @@ double trapezoidalMembershipFunction(double x, double a, double b, double c,
     else {
         return 1.0;
     }
+#endif
 }
 
 /**
@@ -92,7 +115,8 @@ double trapezoidalMembershipFunction(double x, double a, double b, double c,
  * @param b The end point of the rectangle.
  * @return The membership degree of the input value.
  */
-double rectangularMembershipFunction(double x, double a, double b) {
+FuzzyReal_t rectangularMembershipFunction(FuzzyReal_t x, FuzzyReal_t a,
+                                          FuzzyReal_t b) {
     // If x is outside the rectangle, return 0 (no membership)
     if (x < a || x >= b) {
         return 0.0;
@@ -103,21 +127,91 @@ double rectangularMembershipFunction(double x, double a, double b) {
     }
 }
 
+/**
+ * Calculates the membership degree of a Gaussian membership function.
+ *
+ * The Gaussian is centered at a with the standard deviation b. A width of
+ * zero gives a singleton at a.
+ *
+ * @param x The input value to calculate the membership degree for.
+ * @param a The center of the Gaussian.
+ * @param b The standard deviation of the Gaussian.
+ * @return The membership degree of the input value.
+ */
+FuzzyReal_t gaussianMembershipFunction(FuzzyReal_t x, FuzzyReal_t a,
+                                       FuzzyReal_t b) {
+    return fuzzyGaussian(x, a, b);
+}
+
+/**
+ * Calculates the membership degree of a sigmoid membership function.
+ *
+ * The sigmoid rises from 0 to 1 around its crossover point b for a positive
+ * slope a and falls for a negative one.
+ *
+ * @param x The input value to calculate the membership degree for.
+ * @param a The slope of the sigmoid.
+ * @param b The crossover point of the sigmoid, where the degree is 0.5.
+ * @return The membership degree of the input value.
+ */
+FuzzyReal_t sigmoidMembershipFunction(FuzzyReal_t x, FuzzyReal_t a,
+                                      FuzzyReal_t b) {
+    return fuzzySigmoid(x, a, b);
+}
+
+/**
+ * Calculates the membership degree of a generalized bell membership
+ * function.
+ *
+ * The bell is centered at c and has a degree of 0.5 at c - a and c + a, the
+ * shape b sets the steepness of its flanks.
+ *
+ * @param x The input value to calculate the membership degree for.
+ * @param a The half width of the bell.
+ * @param b The shape of the bell.
+ * @param c The center of the bell.
+ * @return The membership degree of the input value.
+ */
+FuzzyReal_t bellMembershipFunction(FuzzyReal_t x, FuzzyReal_t a, FuzzyReal_t b,
+                                   FuzzyReal_t c) {
+    return fuzzyBell(x, a, b, c);
+}
+
+/**
+ * Calculates the membership degree of a singleton membership function.
+ *
+ * Singletons are meant for output sets, where they make the weighted
+ * centroid defuzzification a dot product, see defuzzificationSingletons().
+ *
+ * @param x The input value to calculate the membership degree for.
+ * @param a The point of the singleton.
+ * @return 1 if x is the point of the singleton, 0 otherwise.
+ */
+FuzzyReal_t singletonMembershipFunction(FuzzyReal_t x, FuzzyReal_t a) {
+    return fuzzySingleton(x, a);
+}
+
 /**
  * Calculates the membership degree of a generic membership function.
  *
  * This function takes an input x and a MembershipFunction_t struct as
  * arguments. The MembershipFunction_t struct is not defined in this code
  * snippet, but it is assumed to have a type field that indicates the type of
- * membership function to use (either TRIANGULAR or TRAPEZOIDAL) and fields a,
- * b, c, and d that represent the parameters of the membership function.
+ * membership function to use and fields a, b, c, and d that represent the
+ * parameters of the membership function, see MembershipFunctionType_e.
+ *
+ * The smooth shapes GAUSSIAN, SIGMOID and BELL use a fast exponential instead
+ * of exp(). Gaussians are within a relative error of 1e-8 of exp() of the
+ * same argument (2e-7 for float builds), sigmoids and bells within an absolute
+ * error of 1e-8 (2e-7 for float builds). Degrees below 1e-38 are flushed to
+ * zero.
  *
  * @param x The input value to calculate the membership degree for.
  * @param mf The MembershipFunction_t struct that defines the membership
  * function.
  * @return The membership degree of the input value.
  */
-double membershipFunction(double x, MembershipFunction_t mf) {
+FuzzyReal_t membershipFunction(FuzzyReal_t x, MembershipFunction_t mf) {
     // Use a switch statement to determine which membership function to use
     // based on the type field of the MembershipFunction_t struct
     switch (mf.type) {
@@ -133,9 +227,66 @@ double membershipFunction(double x, MembershipFunction_t mf) {
         // Call the rectangular membership function with the input x and the
         // membership function parameters
         return rectangularMembershipFunction(x, mf.a, mf.b);
+    case GAUSSIAN:
+        return gaussianMembershipFunction(x, mf.a, mf.b);
+    case SIGMOID:
+        return sigmoidMembershipFunction(x, mf.a, mf.b);
+    case BELL:
+        return bellMembershipFunction(x, mf.a, mf.b, mf.c);
+    case SINGLETON:
+        return singletonMembershipFunction(x, mf.a);
     default:
         // If the membership function type is not recognized, return 0 (no
         // membership)
         return 0.0;
     }
 }
+
+/**
+ * Calculates the membership degree of a membership function for many inputs.
+ *
+ * The type dispatch is done once for the whole batch; every shape then runs a
+ * branch-free (and, where available, SIMD) kernel over the samples. The
+ * results are identical to calling membershipFunction() for every sample.
+ *
+ * @param xs The input values to calculate the membership degrees for.
+ * @param n The number of input values.
+ * @param mf The MembershipFunction_t struct that defines the membership
+ * function.
+ * @param out The output buffer, out[i * stride] receives the degree of xs[i].
+ * @param stride The distance between two consecutive outputs.
+ */
+void membershipFunctionBatch(const FuzzyReal_t *xs, size_t n,
+                             MembershipFunction_t mf, FuzzyReal_t *out,
+                             size_t stride) {
+    switch (mf.type) {
+    case TRIANGULAR:
+        triangularMembershipFunctionBatch(xs, n, mf.a, mf.b, mf.c, out, stride);
+        break;
+    case TRAPEZOIDAL:
+        trapezoidalMembershipFunctionBatch(xs, n, mf.a, mf.b, mf.c, mf.d, out,
+                                           stride);
+        break;
+    case RECTANGULAR:
+        rectangularMembershipFunctionBatch(xs, n, mf.a, mf.b, out, stride);
+        break;
+    case GAUSSIAN:
+        gaussianMembershipFunctionBatch(xs, n, mf.a, mf.b, out, stride);
+        break;
+    case SIGMOID:
+        sigmoidMembershipFunctionBatch(xs, n, mf.a, mf.b, out, stride);
+        break;
+    case BELL:
+        bellMembershipFunctionBatch(xs, n, mf.a, mf.b, mf.c, out, stride);
+        break;
+    case SINGLETON:
+        singletonMembershipFunctionBatch(xs, n, mf.a, out, stride);
+        break;
+    default:
+        // Unknown membership function types have no membership
+        for (size_t i = 0; i < n; i++) {
+            out[i * stride] = 0.0;
+        }
+        break;
+    }
+}
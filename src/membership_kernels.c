@@ -0,0 +1,603 @@
+/**
+ * @file membership_kernels.c
+ * @brief Fuzzy Logic branch-free and SIMD membership function kernels.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "membership_function.h"
+
+#include "fast_math.h"
+#include "simd.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The kernels in this file evaluate one membership function for many inputs.
+// Instead of early returns every candidate result (left slope, right slope,
+// plateau and zero) is computed and the final value is picked with selects.
+// The slopes use exactly the same operations as the scalar functions in
+// membership_function.c and the selects use the same comparisons, so the
+// results are bit-for-bit identical, including the x == a, x == b and a == b
+// edge cases. Divisions by zero in lanes which are not selected are harmless.
+
+/**
+ * Branch-free scalar version of triangularMembershipFunction().
+ */
+static inline FuzzyReal_t triangularBranchless(FuzzyReal_t x, FuzzyReal_t a,
+                                               FuzzyReal_t b, FuzzyReal_t c,
+                                               int flatLeft) {
+    FuzzyReal_t left = flatLeft ? FUZZY_REAL_C(1.0) : (x - a) / (b - a);
+    FuzzyReal_t right = (c - x) / (c - b);
+    FuzzyReal_t value = (x <= b) ? left : right;
+    return (x < a || x > c) ? FUZZY_REAL_C(0.0) : value;
+}
+
+/**
+ * Branch-free scalar version of trapezoidalMembershipFunction().
+ */
+static inline FuzzyReal_t trapezoidalBranchless(FuzzyReal_t x, FuzzyReal_t a,
+                                                FuzzyReal_t b, FuzzyReal_t c,
+                                                FuzzyReal_t d) {
+    FuzzyReal_t left = (x - a) / (b - a);
+    FuzzyReal_t right = (d - x) / (d - c);
+    FuzzyReal_t value =
+        (x <= b) ? left : ((x >= c) ? right : FUZZY_REAL_C(1.0));
+    return (x <= a || x >= d) ? FUZZY_REAL_C(0.0) : value;
+}
+
+/**
+ * Branch-free scalar version of rectangularMembershipFunction().
+ */
+static inline FuzzyReal_t rectangularBranchless(FuzzyReal_t x, FuzzyReal_t a,
+                                                FuzzyReal_t b) {
+    return (x < a || x >= b) ? 0.0 : 1.0;
+}
+
+/**
+ * Calculates the membership degrees of a triangular membership function for
+ * many inputs.
+ *
+ * @param xs The input values.
+ * @param n The number of input values.
+ * @param a The start point of the triangle.
+ * @param b The peak point of the triangle.
+ * @param c The end point of the triangle.
+ * @param out The output buffer, out[i * stride] receives the degree of xs[i].
+ * @param stride The distance between two consecutive outputs.
+ */
+void triangularMembershipFunctionBatch(const FuzzyReal_t *xs, size_t n,
+                                       FuzzyReal_t a, FuzzyReal_t b,
+                                       FuzzyReal_t c, FuzzyReal_t *out,
+                                       size_t stride) {
+    const int flatLeft = (b - a == 0);
+    size_t i = 0;
+
+#if FUZZY_SIMD_WIDTH > 1
+    const fuzzy_vec_t va = FUZZY_VSET1(a);
+    const fuzzy_vec_t vb = FUZZY_VSET1(b);
+    const fuzzy_vec_t vc = FUZZY_VSET1(c);
+    const fuzzy_vec_t vba = FUZZY_VSET1(b - a);
+    const fuzzy_vec_t vcb = FUZZY_VSET1(c - b);
+    const fuzzy_vec_t zero = FUZZY_VSET1(0.0);
+    const fuzzy_vec_t one = FUZZY_VSET1(1.0);
+
+    for (; i + FUZZY_SIMD_WIDTH <= n; i += FUZZY_SIMD_WIDTH) {
+        fuzzy_vec_t x = FUZZY_VLOAD(xs + i);
+        fuzzy_vec_t left = flatLeft ? one : FUZZY_VDIV(FUZZY_VSUB(x, va), vba);
+        fuzzy_vec_t right = FUZZY_VDIV(FUZZY_VSUB(vc, x), vcb);
+        fuzzy_vec_t value = FUZZY_VSELECT(FUZZY_VLE(x, vb), left, right);
+        fuzzy_mask_t outside = FUZZY_VOR(FUZZY_VLT(x, va), FUZZY_VGT(x, vc));
+        fuzzyStoreStrided(out + i * stride, stride,
+                          FUZZY_VSELECT(outside, zero, value));
+    }
+#endif
+
+    for (; i < n; i++) {
+        out[i * stride] = triangularBranchless(xs[i], a, b, c, flatLeft);
+    }
+}
+
+/**
+ * Calculates the membership degrees of a trapezoidal membership function for
+ * many inputs.
+ *
+ * @param xs The input values.
+ * @param n The number of input values.
+ * @param a The start point of the trapezoid.
+ * @param b The peak start point of the trapezoid.
+ * @param c The peak end point of the trapezoid.
+ * @param d The end point of the trapezoid.
+ * @param out The output buffer, out[i * stride] receives the degree of xs[i].
+ * @param stride The distance between two consecutive outputs.
+ */
+void trapezoidalMembershipFunctionBatch(const FuzzyReal_t *xs, size_t n,
+                                        FuzzyReal_t a, FuzzyReal_t b,
+                                        FuzzyReal_t c, FuzzyReal_t d,
+                                        FuzzyReal_t *out, size_t stride) {
+    size_t i = 0;
+
+#if FUZZY_SIMD_WIDTH > 1
+    const fuzzy_vec_t va = FUZZY_VSET1(a);
+    const fuzzy_vec_t vb = FUZZY_VSET1(b);
+    const fuzzy_vec_t vc = FUZZY_VSET1(c);
+    const fuzzy_vec_t vd = FUZZY_VSET1(d);
+    const fuzzy_vec_t vba = FUZZY_VSET1(b - a);
+    const fuzzy_vec_t vdc = FUZZY_VSET1(d - c);
+    const fuzzy_vec_t zero = FUZZY_VSET1(0.0);
+    const fuzzy_vec_t one = FUZZY_VSET1(1.0);
+
+    for (; i + FUZZY_SIMD_WIDTH <= n; i += FUZZY_SIMD_WIDTH) {
+        fuzzy_vec_t x = FUZZY_VLOAD(xs + i);
+        fuzzy_vec_t left = FUZZY_VDIV(FUZZY_VSUB(x, va), vba);
+        fuzzy_vec_t right = FUZZY_VDIV(FUZZY_VSUB(vd, x), vdc);
+        fuzzy_vec_t value = FUZZY_VSELECT(FUZZY_VGE(x, vc), right, one);
+        value = FUZZY_VSELECT(FUZZY_VLE(x, vb), left, value);
+        fuzzy_mask_t outside = FUZZY_VOR(FUZZY_VLE(x, va), FUZZY_VGE(x, vd));
+        fuzzyStoreStrided(out + i * stride, stride,
+                          FUZZY_VSELECT(outside, zero, value));
+    }
+#endif
+
+    for (; i < n; i++) {
+        out[i * stride] = trapezoidalBranchless(xs[i], a, b, c, d);
+    }
+}
+
+/**
+ * Calculates the membership degrees of a rectangular membership function for
+ * many inputs.
+ *
+ * @param xs The input values.
+ * @param n The number of input values.
+ * @param a The start point of the rectangle.
+ * @param b The end point of the rectangle.
+ * @param out The output buffer, out[i * stride] receives the degree of xs[i].
+ * @param stride The distance between two consecutive outputs.
+ */
+void rectangularMembershipFunctionBatch(const FuzzyReal_t *xs, size_t n,
+                                        FuzzyReal_t a, FuzzyReal_t b,
+                                        FuzzyReal_t *out, size_t stride) {
+    size_t i = 0;
+
+#if FUZZY_SIMD_WIDTH > 1
+    const fuzzy_vec_t va = FUZZY_VSET1(a);
+    const fuzzy_vec_t vb = FUZZY_VSET1(b);
+    const fuzzy_vec_t zero = FUZZY_VSET1(0.0);
+    const fuzzy_vec_t one = FUZZY_VSET1(1.0);
+
+    for (; i + FUZZY_SIMD_WIDTH <= n; i += FUZZY_SIMD_WIDTH) {
+        fuzzy_vec_t x = FUZZY_VLOAD(xs + i);
+        fuzzy_mask_t outside = FUZZY_VOR(FUZZY_VLT(x, va), FUZZY_VGE(x, vb));
+        fuzzyStoreStrided(out + i * stride, stride,
+                          FUZZY_VSELECT(outside, zero, one));
+    }
+#endif
+
+    for (; i < n; i++) {
+        out[i * stride] = rectangularBranchless(xs[i], a, b);
+    }
+}
+
+// The kernels of the smooth shapes and singletons are plain loops over the
+// inline functions of fast_math.h, which the compiler vectorizes; they are
+// bit-for-bit identical to the scalar functions as well.
+
+/**
+ * Calculates the membership degrees of a Gaussian membership function for many
+ * inputs, see gaussianMembershipFunction().
+ *
+ * @param xs The input values.
+ * @param n The number of input values.
+ * @param a The center of the Gaussian.
+ * @param b The standard deviation of the Gaussian.
+ * @param out The output buffer, out[i * stride] receives the degree of xs[i].
+ * @param stride The distance between two consecutive outputs.
+ */
+void gaussianMembershipFunctionBatch(const FuzzyReal_t *xs, size_t n,
+                                     FuzzyReal_t a, FuzzyReal_t b,
+                                     FuzzyReal_t *out, size_t stride) {
+    for (size_t i = 0; i < n; i++) {
+        out[i * stride] = fuzzyGaussian(xs[i], a, b);
+    }
+}
+
+/**
+ * Calculates the membership degrees of a sigmoid membership function for many
+ * inputs, see sigmoidMembershipFunction().
+ *
+ * @param xs The input values.
+ * @param n The number of input values.
+ * @param a The slope of the sigmoid.
+ * @param b The crossover point of the sigmoid.
+ * @param out The output buffer, out[i * stride] receives the degree of xs[i].
+ * @param stride The distance between two consecutive outputs.
+ */
+void sigmoidMembershipFunctionBatch(const FuzzyReal_t *xs, size_t n,
+                                    FuzzyReal_t a, FuzzyReal_t b,
+                                    FuzzyReal_t *out, size_t stride) {
+    for (size_t i = 0; i < n; i++) {
+        out[i * stride] = fuzzySigmoid(xs[i], a, b);
+    }
+}
+
+/**
+ * Calculates the membership degrees of a generalized bell membership function
+ * for many inputs, see bellMembershipFunction().
+ *
+ * @param xs The input values.
+ * @param n The number of input values.
+ * @param a The half width of the bell.
+ * @param b The shape of the bell.
+ * @param c The center of the bell.
+ * @param out The output buffer, out[i * stride] receives the degree of xs[i].
+ * @param stride The distance between two consecutive outputs.
+ */
+void bellMembershipFunctionBatch(const FuzzyReal_t *xs, size_t n,
+                                 FuzzyReal_t a, FuzzyReal_t b, FuzzyReal_t c,
+                                 FuzzyReal_t *out, size_t stride) {
+    for (size_t i = 0; i < n; i++) {
+        out[i * stride] = fuzzyBell(xs[i], a, b, c);
+    }
+}
+
+/**
+ * Calculates the membership degrees of a singleton membership function for
+ * many inputs.
+ *
+ * @param xs The input values.
+ * @param n The number of input values.
+ * @param a The point of the singleton.
+ * @param out The output buffer, out[i * stride] receives the degree of xs[i].
+ * @param stride The distance between two consecutive outputs.
+ */
+void singletonMembershipFunctionBatch(const FuzzyReal_t *xs, size_t n,
+                                      FuzzyReal_t a, FuzzyReal_t *out,
+                                      size_t stride) {
+    for (size_t i = 0; i < n; i++) {
+        out[i * stride] = fuzzySingleton(xs[i], a);
+    }
+}
+
+// The layout kernels below evaluate all membership functions of a set for a
+// single input, running across the functions of one type instead of across
+// inputs. They multiply by the reciprocal slopes of the layout instead of
+// dividing by the edge widths, which is two roundings instead of one: values
+// on the edges differ from membershipFunction() by at most one ulp. The
+// support bounds and the peaks use the same comparisons, so zeros, ones and
+// NaN inputs are the same. The smooth shapes and singletons use the inline
+// scalar functions and are exact.
+
+/**
+ * Division-free version of triangularBranchless().
+ */
+static inline FuzzyReal_t triangularPrepared(FuzzyReal_t x, FuzzyReal_t a,
+                                             FuzzyReal_t b, FuzzyReal_t c,
+                                             FuzzyReal_t leftSlope,
+                                             FuzzyReal_t rightSlope) {
+    FuzzyReal_t value = (x < b) ? (x - a) * leftSlope : (c - x) * rightSlope;
+    value = (x == b) ? FUZZY_REAL_C(1.0) : value;
+    return (x < a || x > c) ? FUZZY_REAL_C(0.0) : value;
+}
+
+/**
+ * Division-free version of trapezoidalBranchless().
+ */
+static inline FuzzyReal_t trapezoidalPrepared(FuzzyReal_t x, FuzzyReal_t a,
+                                              FuzzyReal_t b, FuzzyReal_t c,
+                                              FuzzyReal_t d,
+                                              FuzzyReal_t leftSlope,
+                                              FuzzyReal_t rightSlope) {
+    FuzzyReal_t value = (x > c) ? (d - x) * rightSlope : FUZZY_REAL_C(1.0);
+    value = (x < b) ? (x - a) * leftSlope : value;
+    return (x <= a || x >= d) ? FUZZY_REAL_C(0.0) : value;
+}
+
+/**
+ * Points the arrays of a layout into an aligned block of 7 * padded values,
+ * followed by 2 * length ints.
+ */
+static void layoutArrays(MembershipLayout_t *layout, FuzzyReal_t *block,
+                         size_t padded, int length) {
+    memset(block, 0, 7 * padded * sizeof(FuzzyReal_t));
+    layout->a = block;
+    layout->b = block + padded;
+    layout->c = block + 2 * padded;
+    layout->d = block + 3 * padded;
+    layout->leftSlope = block + 4 * padded;
+    layout->rightSlope = block + 5 * padded;
+    layout->centroids = block + 6 * padded;
+    layout->order = (int *)(block + 7 * padded);
+    layout->slots = layout->order + length;
+}
+
+/**
+ * Groups the functions into the arrays of a layout and prepares their slopes.
+ */
+static void layoutFill(MembershipLayout_t *layout,
+                       const MembershipFunction_t *functions, int length) {
+    int *order = layout->order;
+
+    // Group the functions by type with a counting sort, keeping their order
+    // within a group
+    int *starts = layout->groupStarts;
+    for (int t = 0; t < FUZZY_NUM_MEMBERSHIP_TYPES + 2; t++) {
+        starts[t] = 0;
+    }
+    for (int i = 0; i < length; i++) {
+        const unsigned type = (unsigned)functions[i].type;
+        starts[(type < FUZZY_NUM_MEMBERSHIP_TYPES ? type
+                                                  : FUZZY_NUM_MEMBERSHIP_TYPES) +
+               1]++;
+    }
+    for (int t = 0; t < FUZZY_NUM_MEMBERSHIP_TYPES + 1; t++) {
+        starts[t + 1] += starts[t];
+    }
+
+    int next[FUZZY_NUM_MEMBERSHIP_TYPES + 1];
+    for (int t = 0; t < FUZZY_NUM_MEMBERSHIP_TYPES + 1; t++) {
+        next[t] = starts[t];
+    }
+    layout->ordered = true;
+    for (int i = 0; i < length; i++) {
+        const MembershipFunction_t mf = functions[i];
+        const unsigned type = (unsigned)mf.type;
+        const int k = next[type < FUZZY_NUM_MEMBERSHIP_TYPES
+                               ? type
+                               : FUZZY_NUM_MEMBERSHIP_TYPES]++;
+        const FuzzyReal_t left = mf.b - mf.a;
+        const FuzzyReal_t right = mf.type == TRIANGULAR ? mf.c - mf.b
+                                                        : mf.d - mf.c;
+
+        layout->a[k] = mf.a;
+        layout->b[k] = mf.b;
+        layout->c[k] = mf.c;
+        layout->d[k] = mf.d;
+        // Zero width edges are never evaluated, their slope is unused
+        layout->leftSlope[k] =
+            left != FUZZY_REAL_C(0.0) ? FUZZY_REAL_C(1.0) / left : 0.0;
+        layout->rightSlope[k] =
+            right != FUZZY_REAL_C(0.0) ? FUZZY_REAL_C(1.0) / right : 0.0;
+        order[k] = i;
+        layout->slots[i] = k;
+        layout->ordered = layout->ordered && k == i;
+    }
+}
+
+/**
+ * Initializes a MembershipLayout_t struct from an array of membership
+ * functions.
+ *
+ * @param layout The MembershipLayout_t struct to initialize.
+ * @param functions The membership functions.
+ * @param length The number of membership functions.
+ * @return false if allocating the arrays failed.
+ */
+bool membershipLayoutInit(MembershipLayout_t *layout,
+                          const MembershipFunction_t *functions, int length) {
+    // Round every array up to whole cache lines, so all of them are aligned
+    const size_t padded = FUZZY_LAYOUT_PADDED(length);
+    const size_t size = 7 * padded * sizeof(FuzzyReal_t) +
+                        2 * (size_t)length * sizeof(int);
+    FuzzyReal_t *block = (FuzzyReal_t *)aligned_alloc(
+        FUZZY_LAYOUT_ALIGNMENT, (size + FUZZY_LAYOUT_ALIGNMENT - 1) /
+                                    FUZZY_LAYOUT_ALIGNMENT *
+                                    FUZZY_LAYOUT_ALIGNMENT);
+    if (block == NULL) {
+        return false;
+    }
+
+    layoutArrays(layout, block, padded, length);
+    layout->ownsStorage = true;
+    layoutFill(layout, functions, length);
+    return true;
+}
+
+/**
+ * Initializes a MembershipLayout_t struct in caller provided storage.
+ *
+ * This function works like membershipLayoutInit() but takes the arrays from
+ * storage instead of allocating them, membershipLayoutFree() leaves the
+ * storage untouched.
+ *
+ * @param layout The MembershipLayout_t struct to initialize.
+ * @param functions The membership functions.
+ * @param length The number of membership functions.
+ * @param storage The storage for the arrays, must hold
+ * FUZZY_LAYOUT_SIZE(length) bytes.
+ */
+void membershipLayoutInitBuffer(MembershipLayout_t *layout,
+                                const MembershipFunction_t *functions,
+                                int length, void *storage) {
+    const uintptr_t alignment = FUZZY_LAYOUT_ALIGNMENT;
+    const uintptr_t start =
+        ((uintptr_t)storage + alignment - 1) & ~(alignment - 1);
+    FuzzyReal_t *block = (FuzzyReal_t *)start;
+
+    layoutArrays(layout, block, FUZZY_LAYOUT_PADDED(length), length);
+    layout->ownsStorage = false;
+    layoutFill(layout, functions, length);
+}
+
+/**
+ * Frees the memory allocated for a MembershipLayout_t struct.
+ *
+ * @param layout The MembershipLayout_t struct to free.
+ */
+void membershipLayoutFree(MembershipLayout_t *layout) {
+    if (layout->ownsStorage) {
+        free(layout->a);
+    }
+}
+
+#if FUZZY_SIMD_WIDTH > 1
+/**
+ * Stores the values of the slots k .. k + FUZZY_SIMD_WIDTH to their functions.
+ */
+static inline void storeSlots(const MembershipLayout_t *layout, int k,
+                              fuzzy_vec_t v, FuzzyReal_t *values) {
+    if (layout->ordered) {
+        FUZZY_VSTORE(values + k, v);
+        return;
+    }
+    FuzzyReal_t lanes[FUZZY_SIMD_WIDTH];
+    FUZZY_VSTORE(lanes, v);
+    for (int i = 0; i < FUZZY_SIMD_WIDTH; i++) {
+        values[layout->order[k + i]] = lanes[i];
+    }
+}
+#endif
+
+/**
+ * Calculates the membership degrees of all functions of a layout for one
+ * input.
+ *
+ * @param x The input value.
+ * @param layout The MembershipLayout_t of the functions.
+ * @param values The output buffer, values[i] receives the degree of function i
+ * of the set the layout was built from.
+ */
+void membershipLayoutValues(FuzzyReal_t x, const MembershipLayout_t *layout,
+                            FuzzyReal_t *values) {
+    const int *starts = layout->groupStarts;
+    const int *order = layout->order;
+    const FuzzyReal_t *a = layout->a;
+    const FuzzyReal_t *b = layout->b;
+    const FuzzyReal_t *c = layout->c;
+    const FuzzyReal_t *d = layout->d;
+    const FuzzyReal_t *leftSlope = layout->leftSlope;
+    const FuzzyReal_t *rightSlope = layout->rightSlope;
+    int k;
+
+#if FUZZY_SIMD_WIDTH > 1
+    const fuzzy_vec_t vx = FUZZY_VSET1(x);
+    const fuzzy_vec_t zero = FUZZY_VSET1(0.0);
+    const fuzzy_vec_t one = FUZZY_VSET1(1.0);
+#endif
+
+    k = starts[TRIANGULAR];
+#if FUZZY_SIMD_WIDTH > 1
+    for (; k + FUZZY_SIMD_WIDTH <= starts[TRIANGULAR + 1];
+         k += FUZZY_SIMD_WIDTH) {
+        const fuzzy_vec_t va = FUZZY_VLOAD(a + k);
+        const fuzzy_vec_t vb = FUZZY_VLOAD(b + k);
+        const fuzzy_vec_t vc = FUZZY_VLOAD(c + k);
+        fuzzy_vec_t left =
+            FUZZY_VMUL(FUZZY_VSUB(vx, va), FUZZY_VLOAD(leftSlope + k));
+        fuzzy_vec_t right =
+            FUZZY_VMUL(FUZZY_VSUB(vc, vx), FUZZY_VLOAD(rightSlope + k));
+        fuzzy_vec_t value = FUZZY_VSELECT(FUZZY_VLT(vx, vb), left, right);
+        value = FUZZY_VSELECT(FUZZY_VEQ(vx, vb), one, value);
+        fuzzy_mask_t outside = FUZZY_VOR(FUZZY_VLT(vx, va), FUZZY_VGT(vx, vc));
+        storeSlots(layout, k, FUZZY_VSELECT(outside, zero, value), values);
+    }
+#endif
+    for (; k < starts[TRIANGULAR + 1]; k++) {
+        values[order[k]] = triangularPrepared(x, a[k], b[k], c[k],
+                                              leftSlope[k], rightSlope[k]);
+    }
+
+    k = starts[TRAPEZOIDAL];
+#if FUZZY_SIMD_WIDTH > 1
+    for (; k + FUZZY_SIMD_WIDTH <= starts[TRAPEZOIDAL + 1];
+         k += FUZZY_SIMD_WIDTH) {
+        const fuzzy_vec_t va = FUZZY_VLOAD(a + k);
+        const fuzzy_vec_t vb = FUZZY_VLOAD(b + k);
+        const fuzzy_vec_t vc = FUZZY_VLOAD(c + k);
+        const fuzzy_vec_t vd = FUZZY_VLOAD(d + k);
+        fuzzy_vec_t left =
+            FUZZY_VMUL(FUZZY_VSUB(vx, va), FUZZY_VLOAD(leftSlope + k));
+        fuzzy_vec_t right =
+            FUZZY_VMUL(FUZZY_VSUB(vd, vx), FUZZY_VLOAD(rightSlope + k));
+        fuzzy_vec_t value = FUZZY_VSELECT(FUZZY_VGT(vx, vc), right, one);
+        value = FUZZY_VSELECT(FUZZY_VLT(vx, vb), left, value);
+        fuzzy_mask_t outside = FUZZY_VOR(FUZZY_VLE(vx, va), FUZZY_VGE(vx, vd));
+        storeSlots(layout, k, FUZZY_VSELECT(outside, zero, value), values);
+    }
+#endif
+    for (; k < starts[TRAPEZOIDAL + 1]; k++) {
+        values[order[k]] = trapezoidalPrepared(
+            x, a[k], b[k], c[k], d[k], leftSlope[k], rightSlope[k]);
+    }
+
+    k = starts[RECTANGULAR];
+#if FUZZY_SIMD_WIDTH > 1
+    for (; k + FUZZY_SIMD_WIDTH <= starts[RECTANGULAR + 1];
+         k += FUZZY_SIMD_WIDTH) {
+        fuzzy_mask_t outside = FUZZY_VOR(FUZZY_VLT(vx, FUZZY_VLOAD(a + k)),
+                                         FUZZY_VGE(vx, FUZZY_VLOAD(b + k)));
+        storeSlots(layout, k, FUZZY_VSELECT(outside, zero, one), values);
+    }
+#endif
+    for (; k < starts[RECTANGULAR + 1]; k++) {
+        values[order[k]] = rectangularBranchless(x, a[k], b[k]);
+    }
+
+    for (k = starts[GAUSSIAN]; k < starts[GAUSSIAN + 1]; k++) {
+        values[order[k]] = fuzzyGaussian(x, a[k], b[k]);
+    }
+    for (k = starts[SIGMOID]; k < starts[SIGMOID + 1]; k++) {
+        values[order[k]] = fuzzySigmoid(x, a[k], b[k]);
+    }
+    for (k = starts[BELL]; k < starts[BELL + 1]; k++) {
+        values[order[k]] = fuzzyBell(x, a[k], b[k], c[k]);
+    }
+    for (k = starts[SINGLETON]; k < starts[SINGLETON + 1]; k++) {
+        values[order[k]] = fuzzySingleton(x, a[k]);
+    }
+
+    // Unknown membership function types have no membership
+    for (k = starts[FUZZY_NUM_MEMBERSHIP_TYPES];
+         k < starts[FUZZY_NUM_MEMBERSHIP_TYPES + 1]; k++) {
+        values[order[k]] = 0.0;
+    }
+}
+
+/**
+ * Calculates the membership degree of one function of a layout.
+ *
+ * The degree equals the one membershipLayoutValues() calculates, so the
+ * functions evaluated through a partition index use the prepared slopes, too.
+ *
+ * @param x The input value.
+ * @param layout The MembershipLayout_t of the functions.
+ * @param i The index of the function in the set the layout was built from.
+ * @return The membership degree of x in function i.
+ */
+FuzzyReal_t membershipLayoutValue(FuzzyReal_t x,
+                                  const MembershipLayout_t *layout, int i) {
+    const int k = layout->slots[i];
+    int type = 0;
+    while (k >= layout->groupStarts[type + 1]) {
+        type++;
+    }
+
+    switch (type) {
+    case TRIANGULAR:
+        return triangularPrepared(x, layout->a[k], layout->b[k], layout->c[k],
+                                  layout->leftSlope[k], layout->rightSlope[k]);
+    case TRAPEZOIDAL:
+        return trapezoidalPrepared(x, layout->a[k], layout->b[k], layout->c[k],
+                                   layout->d[k], layout->leftSlope[k],
+                                   layout->rightSlope[k]);
+    case RECTANGULAR:
+        return rectangularBranchless(x, layout->a[k], layout->b[k]);
+    case GAUSSIAN:
+        return fuzzyGaussian(x, layout->a[k], layout->b[k]);
+    case SIGMOID:
+        return fuzzySigmoid(x, layout->a[k], layout->b[k]);
+    case BELL:
+        return fuzzyBell(x, layout->a[k], layout->b[k], layout->c[k]);
+    case SINGLETON:
+        return fuzzySingleton(x, layout->a[k]);
+    default:
+        // Unknown membership function types have no membership
+        return 0.0;
+    }
+}
@@ -0,0 +1,147 @@
+/**
+ * @file memo.c
+ * @brief Fuzzy Logic memoization cache implementation.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "memo.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Initializes a FuzzyMemo_t struct.
+ *
+ * FUZZY_WCET builds have no caches, as a hit skips work depending on the
+ * inputs.
+ *
+ * @param memo The FuzzyMemo_t struct to initialize.
+ * @param numEntries The number of entries, rounded up to a power of two, at
+ * most INT_MAX / 2 + 1.
+ * @param keyLength The number of crisp values forming a key.
+ * @param valueLength The number of values stored per key.
+ * @return false if the sizes are out of range, allocating the cache failed or
+ * in FUZZY_WCET builds, the cache is empty then.
+ */
+bool FuzzyMemoInit(FuzzyMemo_t *memo, int numEntries, int keyLength,
+                   int valueLength) {
+#ifdef FUZZY_WCET
+    *memo = (FuzzyMemo_t){0};
+    return false;
+#endif
+    // Rounding up larger counts would overflow
+    if (numEntries > INT_MAX / 2 + 1 || keyLength < 0 || valueLength < 0) {
+        *memo = (FuzzyMemo_t){0};
+        return false;
+    }
+    int entries = 1;
+    while (entries < numEntries) {
+        entries *= 2;
+    }
+    const size_t maxLength = SIZE_MAX / sizeof(FuzzyReal_t) / (size_t)entries;
+    if ((size_t)keyLength > maxLength || (size_t)valueLength > maxLength) {
+        *memo = (FuzzyMemo_t){0};
+        return false;
+    }
+
+    memo->numEntries = entries;
+    memo->keyLength = keyLength;
+    memo->valueLength = valueLength;
+    memo->keys = (FuzzyReal_t *)malloc((size_t)entries * keyLength *
+                                       sizeof(FuzzyReal_t));
+    memo->values = (FuzzyReal_t *)malloc((size_t)entries * valueLength *
+                                         sizeof(FuzzyReal_t));
+    memo->valid = (bool *)calloc(entries, sizeof(bool));
+    memo->hits = 0;
+    memo->misses = 0;
+
+    if (memo->keys == NULL || memo->values == NULL || memo->valid == NULL) {
+        FuzzyMemoFree(memo);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Frees the memory allocated for a FuzzyMemo_t struct.
+ *
+ * @param memo The FuzzyMemo_t struct to free.
+ */
+void FuzzyMemoFree(FuzzyMemo_t *memo) {
+    free(memo->keys);
+    free(memo->values);
+    free(memo->valid);
+    memo->keys = NULL;
+    memo->values = NULL;
+    memo->valid = NULL;
+    memo->numEntries = 0;
+}
+
+/**
+ * Invalidates all entries of a cache and resets its counters.
+ *
+ * Call this whenever the computation behind the cache changes, for example
+ * after editing the membership functions or rules.
+ *
+ * @param memo The FuzzyMemo_t struct to clear.
+ */
+void FuzzyMemoClear(FuzzyMemo_t *memo) {
+    for (int i = 0; i < memo->numEntries; i++) {
+        memo->valid[i] = false;
+    }
+    memo->hits = 0;
+    memo->misses = 0;
+}
+
+/**
+ * Hashes the bit patterns of a key.
+ */
+static uint32_t hashKey(const FuzzyReal_t *key, int length) {
+    uint64_t hash = 0;
+    for (int i = 0; i < length; i++) {
+        uint64_t bits = 0;
+        memcpy(&bits, &key[i], sizeof(FuzzyReal_t));
+        hash = (hash ^ bits) * UINT64_C(0x9E3779B97F4A7C15);
+        hash ^= hash >> 29;
+    }
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+/**
+ * Looks up the entry of a key.
+ *
+ * On a hit the cached values are returned. On a miss the entry of the key is
+ * claimed, replacing whatever it held, and its value buffer is returned for
+ * the caller to fill before the next lookup. Either way this costs one probe.
+ *
+ * @param memo The FuzzyMemo_t to search.
+ * @param key The key, memo->keyLength crisp values.
+ * @param hit Receives true if the values were cached.
+ * @return The memo->valueLength values of the key.
+ */
+FuzzyReal_t *FuzzyMemoLookup(FuzzyMemo_t *memo, const FuzzyReal_t *key,
+                             bool *hit) {
+    const size_t keySize = memo->keyLength * sizeof(FuzzyReal_t);
+    const uint32_t entry =
+        hashKey(key, memo->keyLength) & (uint32_t)(memo->numEntries - 1);
+    FuzzyReal_t *keys = &memo->keys[(size_t)entry * memo->keyLength];
+    FuzzyReal_t *values = &memo->values[(size_t)entry * memo->valueLength];
+
+    if (memo->valid[entry] && memcmp(keys, key, keySize) == 0) {
+        memo->hits++;
+        *hit = true;
+        return values;
+    }
+
+    memo->misses++;
+    memcpy(keys, key, keySize);
+    memo->valid[entry] = true;
+    *hit = false;
+    return values;
+}
@@ -0,0 +1,472 @@
+/**
+ * @file model.c
+ * @brief Fuzzy Logic reentrant model and evaluation state implementation.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "model.h"
+
+#include "arena.h"
+#include "class.h"
+#include "classifier.h"
+#include "defuzzifier.h"
+#include "program.h"
+#include "simd.h"
+#include "stats.h"
+
+#include <stdlib.h>
+
+/**
+ * Sums up the membership values of all sets of a model.
+ */
+static void countValues(FuzzyModel_t *model) {
+    model->numValues = 0;
+    for (int i = 0; i < model->program.numSets; i++) {
+        model->numValues += model->program.sets[i]->length;
+    }
+}
+
+/**
+ * Initializes a FuzzyModel_t struct.
+ *
+ * This function compiles the rules into the model. Only the membership
+ * functions and lengths of the given sets are used, their membership values
+ * are never read or written by the model. The outputs are defuzzified with
+ * FUZZY_DEFUZZIFY_WEIGHTED_CENTROIDS unless model->defuzzifier is changed to
+ * FUZZY_DEFUZZIFY_AREA or FUZZY_DEFUZZIFY_SINGLETONS, or the model is switched
+ * to Takagi-Sugeno inference with FuzzyModelEnableTsk().
+ *
+ * @param model The FuzzyModel_t struct to initialize.
+ * @param rules An array of fuzzy rules.
+ * @param numRules The number of fuzzy rules in the array.
+ * @param inputs The input sets, in the order of the crisp inputs.
+ * @param numInputs The number of input sets.
+ * @param outputs The output sets, in the order of the crisp outputs.
+ * @param numOutputs The number of output sets.
+ * @return false if the rules can not be compiled (see FuzzyCompileRules())
+ * or allocating failed. The model is then empty, without inputs and outputs,
+ * and must still be released with FuzzyModelFree().
+ */
+bool FuzzyModelInit(FuzzyModel_t *model, const FuzzyRule_t *rules,
+                    int numRules, const FuzzySet_t *const *inputs,
+                    int numInputs, const FuzzySet_t *const *outputs,
+                    int numOutputs) {
+    model->numInputs = 0;
+    model->numOutputs = 0;
+    model->defuzzifier = FUZZY_DEFUZZIFY_WEIGHTED_CENTROIDS;
+    model->tsk = NULL;
+
+    const FuzzySet_t **sets = (const FuzzySet_t **)malloc(
+        (numInputs + numOutputs) * sizeof(FuzzySet_t *) + 1);
+    bool compiled = false;
+    if (sets != NULL) {
+        for (int i = 0; i < numInputs; i++) {
+            sets[i] = inputs[i];
+        }
+        for (int i = 0; i < numOutputs; i++) {
+            sets[numInputs + i] = outputs[i];
+        }
+        compiled = FuzzyCompileRulesWithSets(rules, numRules, &model->program,
+                                             sets, numInputs + numOutputs);
+        free(sets);
+    } else {
+        model->program = (FuzzyProgram_t){0};
+    }
+
+    if (compiled) {
+        model->numInputs = numInputs;
+        model->numOutputs = numOutputs;
+    }
+    countValues(model);
+    return compiled;
+}
+
+/**
+ * Evaluates the antecedent groups shared by several rules of a model only
+ * once, see FuzzyProgramShareAntecedents().
+ *
+ * The temporaries of the shared groups are part of the state, so states of
+ * the model have to be initialized after this call. Only models using
+ * FUZZY_NORM_MIN_MAX can share their antecedents.
+ *
+ * @param model The FuzzyModel_t to optimize.
+ * @return false if the model does not use FUZZY_NORM_MIN_MAX or allocating
+ * failed, the model is left unchanged then.
+ */
+bool FuzzyModelShareAntecedents(FuzzyModel_t *model) {
+    if (!FuzzyProgramShareAntecedents(&model->program)) {
+        return false;
+    }
+    countValues(model);
+    return true;
+}
+
+/**
+ * Frees the consequents of Takagi-Sugeno inference.
+ */
+static void freeTsk(FuzzyTsk_t *tsk) {
+    if (tsk != NULL) {
+        free(tsk->coefficients);
+        free(tsk->offsets);
+        free(tsk);
+    }
+}
+
+/**
+ * Switches a model to Takagi-Sugeno inference.
+ *
+ * Every membership function of the output sets becomes the consequent of the
+ * rules targeting it, a constant or a linear function of the crisp inputs.
+ * An output is then the average of the consequents of all rules weighted by
+ * their strengths, without aggregating the output sets, normalizing or
+ * defuzzifying them; model->defuzzifier is ignored.
+ *
+ * The coefficients hold numInputs + 1 values for every membership function of
+ * the output sets, outputs in order: the constant, then the factor of every
+ * input. With NULL the consequents are zero-order constants at the centroids
+ * of the membership functions, e.g. the points of SINGLETON functions. The
+ * coefficients are copied, a consequent table set before is replaced.
+ *
+ * @param model The FuzzyModel_t to switch.
+ * @param coefficients The consequents, or NULL for the centroids.
+ * @return false if allocating failed, the model is left unchanged then.
+ */
+bool FuzzyModelEnableTsk(FuzzyModel_t *model, const FuzzyReal_t *coefficients) {
+    const FuzzyProgram_t *program = &model->program;
+    const int stride = model->numInputs + 1;
+    int numConsequents = 0;
+    for (int i = 0; i < model->numOutputs; i++) {
+        numConsequents += program->sets[model->numInputs + i]->length;
+    }
+
+    FuzzyTsk_t *tsk = (FuzzyTsk_t *)malloc(sizeof(FuzzyTsk_t));
+    if (tsk != NULL) {
+        tsk->coefficients = (FuzzyReal_t *)calloc(
+            (size_t)numConsequents * stride, sizeof(FuzzyReal_t));
+        tsk->offsets = (int *)malloc(model->numOutputs * sizeof(int));
+        tsk->linear = false;
+    }
+    if (tsk == NULL || tsk->coefficients == NULL || tsk->offsets == NULL) {
+        freeTsk(tsk);
+        return false;
+    }
+
+    // Transpose the consequents of every output into rows by coefficient
+    int consequent = 0;
+    for (int i = 0; i < model->numOutputs; i++) {
+        const FuzzySet_t *set = program->sets[model->numInputs + i];
+        FuzzyReal_t *rows = tsk->coefficients + consequent * stride;
+        tsk->offsets[i] = consequent * stride;
+
+        for (int j = 0; j < set->length; j++, consequent++) {
+            if (coefficients == NULL) {
+                rows[j] = calculateCentroid(set->membershipFunctions[j], 1.0);
+                continue;
+            }
+            const FuzzyReal_t *row = coefficients + consequent * stride;
+            for (int k = 0; k < stride; k++) {
+                rows[k * set->length + j] = row[k];
+                tsk->linear = tsk->linear ||
+                              (k > 0 && row[k] != FUZZY_REAL_C(0.0));
+            }
+        }
+    }
+
+    freeTsk(model->tsk);
+    model->tsk = tsk;
+    return true;
+}
+
+/**
+ * Frees the memory allocated for a FuzzyModel_t struct.
+ *
+ * @param model The FuzzyModel_t struct to free.
+ */
+void FuzzyModelFree(FuzzyModel_t *model) {
+    FuzzyProgramFree(&model->program);
+    freeTsk(model->tsk);
+    model->tsk = NULL;
+}
+
+/**
+ * Assigns the membership value arrays of a state to its buffer.
+ */
+static void layoutState(FuzzyState_t *state, const FuzzyModel_t *model) {
+    const FuzzyProgram_t *program = &model->program;
+
+    FuzzyReal_t *values = state->buffer;
+    for (int i = 0; i < program->numSets; i++) {
+        state->values[i] = values;
+        values += program->sets[i]->length;
+    }
+}
+
+/**
+ * Initializes a FuzzyState_t struct for a model.
+ *
+ * This function allocates zeroed memory for the membership values of every
+ * set of the model. Each thread evaluating the model needs its own state.
+ *
+ * @param state The FuzzyState_t struct to initialize.
+ * @param model The FuzzyModel_t the state is used with.
+ * @return false if allocating failed, the state is empty then and must not be
+ * evaluated, FuzzyStateFree() is a no-op on it.
+ */
+bool FuzzyStateInit(FuzzyState_t *state, const FuzzyModel_t *model) {
+    state->buffer =
+        (FuzzyReal_t *)calloc(model->numValues + 1, sizeof(FuzzyReal_t));
+    state->values = (FuzzyReal_t **)malloc(
+        (model->program.numSets + 1) * sizeof(FuzzyReal_t *));
+    state->ownsStorage = true;
+    if (state->buffer == NULL || state->values == NULL) {
+        free(state->buffer);
+        free(state->values);
+        state->buffer = NULL;
+        state->values = NULL;
+        return false;
+    }
+    layoutState(state, model);
+    return true;
+}
+
+/**
+ * Returns the number of bytes a state of a model needs.
+ *
+ * @param model The FuzzyModel_t the state is used with.
+ * @return The size of the buffer to pass to FuzzyStateInitBuffer().
+ */
+size_t FuzzyStateSize(const FuzzyModel_t *model) {
+    return FUZZY_STATE_SIZE(model->program.numSets, model->numValues);
+}
+
+/**
+ * Initializes a FuzzyState_t struct without allocating memory.
+ *
+ * The buffer must hold FuzzyStateSize() bytes, be aligned for FuzzyReal_t and
+ * FuzzyReal_t * and outlive the state, see FUZZY_STATE_STORAGE(). The
+ * membership values are zeroed by this function.
+ *
+ * @param state The FuzzyState_t struct to initialize.
+ * @param model The FuzzyModel_t the state is used with.
+ * @param buffer The storage for the state.
+ */
+void FuzzyStateInitBuffer(FuzzyState_t *state, const FuzzyModel_t *model,
+                          void *buffer) {
+    // The pointer table comes first, the values follow it at an offset
+    // padded to their alignment, whatever the number of values
+    const size_t offset = FUZZY_STATE_VALUES_OFFSET(model->program.numSets);
+    state->values = (FuzzyReal_t **)buffer;
+    state->buffer = (FuzzyReal_t *)((unsigned char *)buffer + offset);
+    state->ownsStorage = false;
+
+    for (int i = 0; i < model->numValues; i++) {
+        state->buffer[i] = 0.0;
+    }
+    layoutState(state, model);
+}
+
+/**
+ * Initializes a FuzzyState_t struct with storage from an arena.
+ *
+ * @param state The FuzzyState_t struct to initialize.
+ * @param model The FuzzyModel_t the state is used with.
+ * @param arena The FuzzyArena_t to allocate from.
+ * @return false if the arena is exhausted, the state is left untouched then.
+ */
+bool FuzzyStateInitArena(FuzzyState_t *state, const FuzzyModel_t *model,
+                         FuzzyArena_t *arena) {
+    void *buffer = FuzzyArenaAlloc(arena, FuzzyStateSize(model));
+    if (buffer == NULL) {
+        return false;
+    }
+
+    FuzzyStateInitBuffer(state, model, buffer);
+    return true;
+}
+
+/**
+ * Frees the memory allocated for a FuzzyState_t struct.
+ *
+ * States with borrowed storage are left untouched.
+ *
+ * @param state The FuzzyState_t struct to free.
+ */
+void FuzzyStateFree(FuzzyState_t *state) {
+    if (!state->ownsStorage) {
+        return;
+    }
+    free(state->buffer);
+    free(state->values);
+}
+
+/**
+ * Defuzzifies one output of a model with the defuzzifier of the model.
+ *
+ * @param model The FuzzyModel_t the output belongs to.
+ * @param output The index of the output.
+ * @param values The membership values of the output set.
+ * @return The crisp output.
+ */
+FuzzyReal_t FuzzyModelDefuzzify(const FuzzyModel_t *model, int output,
+                                const FuzzyReal_t *values) {
+    const FuzzySet_t *set = model->program.sets[model->numInputs + output];
+    if (model->defuzzifier == FUZZY_DEFUZZIFY_AREA) {
+        return defuzzificationArea(set, values);
+    }
+    if (model->defuzzifier == FUZZY_DEFUZZIFY_SINGLETONS) {
+        return defuzzificationSingletons(set, values);
+    }
+    return defuzzificationValues(set, values);
+}
+
+/**
+ * Calculates one output of a model with Takagi-Sugeno consequents.
+ *
+ * The weights are the summed rule strengths of every consequent, see
+ * FuzzyProgramRunWeights(). The output is the dot product of the weights with
+ * the constants plus every input times the dot product of the weights with
+ * its factors, divided by the sum of the weights.
+ *
+ * @param model The FuzzyModel_t the output belongs to, see
+ * FuzzyModelEnableTsk().
+ * @param output The index of the output.
+ * @param inputs The crisp inputs, one per input set of the model.
+ * @param weights The weights of the consequents of the output.
+ * @return The crisp output, or 0 if no rule fires.
+ */
+FuzzyReal_t FuzzyModelTskOutput(const FuzzyModel_t *model, int output,
+                                const FuzzyReal_t *inputs,
+                                const FuzzyReal_t *weights) {
+    FUZZY_STATS_BEGIN();
+    const FuzzyTsk_t *tsk = model->tsk;
+    const int length = model->program.sets[model->numInputs + output]->length;
+    const FuzzyReal_t *rows = tsk->coefficients + tsk->offsets[output];
+    FuzzyReal_t sumOfWeights = 0.0;
+
+    for (int j = 0; j < length; j++) {
+        sumOfWeights += weights[j];
+    }
+    // The consequents are averaged even if no rule fires, so the cost does not
+    // depend on the weights
+    FuzzyReal_t sum = fuzzyDot(weights, rows, length);
+    if (tsk->linear) {
+        for (int i = 0; i < model->numInputs; i++) {
+            rows += length;
+            sum += inputs[i] * fuzzyDot(weights, rows, length);
+        }
+    }
+    const FuzzyReal_t result =
+        sumOfWeights != FUZZY_REAL_C(0.0) ? sum / sumOfWeights
+                                          : FUZZY_REAL_C(0.0);
+
+    FUZZY_STATS_END(FUZZY_STAGE_DEFUZZIFY);
+    return result;
+}
+
+/**
+ * Runs the rules of a model on classified inputs and calculates its outputs.
+ *
+ * Mamdani models run FuzzyProgramRunValues() and defuzzify every output set,
+ * models with Takagi-Sugeno consequents run FuzzyProgramRunWeights() and
+ * average the consequents.
+ *
+ * @param model The FuzzyModel_t to evaluate.
+ * @param values The membership value arrays, one per set of the program, with
+ * the input sets classified.
+ * @param inputs The crisp inputs, only read by first-order consequents.
+ * @param outputs The crisp outputs, one per output set of the model.
+ */
+void FuzzyModelInfer(const FuzzyModel_t *model, FuzzyReal_t *const *values,
+                     const FuzzyReal_t *inputs, FuzzyReal_t *outputs) {
+    if (model->tsk != NULL) {
+        FuzzyProgramRunWeights(&model->program, values);
+        for (int i = 0; i < model->numOutputs; i++) {
+            outputs[i] = FuzzyModelTskOutput(model, i, inputs,
+                                             values[model->numInputs + i]);
+        }
+        return;
+    }
+
+    FuzzyProgramRunValues(&model->program, values);
+    for (int i = 0; i < model->numOutputs; i++) {
+        outputs[i] =
+            FuzzyModelDefuzzify(model, i, values[model->numInputs + i]);
+    }
+}
+
+/**
+ * Evaluates a model for one set of crisp inputs.
+ *
+ * This function classifies the inputs, runs the compiled rules and
+ * defuzzifies the outputs, using only the given state for intermediate
+ * values. Concurrent calls on the same model are safe as long as every call
+ * uses its own state.
+ *
+ * @param model The FuzzyModel_t to evaluate.
+ * @param state The FuzzyState_t to use for the membership values.
+ * @param inputs The crisp inputs, one per input set of the model.
+ * @param outputs The crisp outputs, one per output set of the model.
+ */
+void FuzzyEvaluate(const FuzzyModel_t *model, FuzzyState_t *state,
+                   const FuzzyReal_t *inputs, FuzzyReal_t *outputs) {
+    const FuzzyProgram_t *program = &model->program;
+
+    // Classify the inputs
+    for (int i = 0; i < model->numInputs; i++) {
+        FuzzyClassifierValues(inputs[i], program->sets[i], state->values[i]);
+    }
+
+    // Perform fuzzy inference and defuzzify the outputs
+    FuzzyModelInfer(model, state->values, inputs, outputs);
+}
+
+/**
+ * Initializes a whole-pipeline cache for a model.
+ *
+ * The cache maps the tuple of crisp inputs of the model to its crisp outputs,
+ * see FuzzyEvaluateMemo().
+ *
+ * @param memo The FuzzyMemo_t struct to initialize.
+ * @param model The FuzzyModel_t to cache.
+ * @param numEntries The number of cached input tuples, rounded up to a power
+ * of two.
+ * @return false if allocating the cache failed.
+ */
+bool FuzzyModelMemoInit(FuzzyMemo_t *memo, const FuzzyModel_t *model,
+                        int numEntries) {
+    return FuzzyMemoInit(memo, numEntries, model->numInputs, model->numOutputs);
+}
+
+/**
+ * Evaluates a model for one set of crisp inputs through a cache.
+ *
+ * This function works like FuzzyEvaluate(), but first looks up the exact
+ * tuple of inputs in the cache. A hit copies the cached outputs and costs a
+ * single probe instead of classifying, running the rules and defuzzifying; the
+ * state is left untouched then. Misses are evaluated and cached. The cache is
+ * written on every miss, so concurrent calls need a cache each.
+ *
+ * @param model The FuzzyModel_t to evaluate.
+ * @param state The FuzzyState_t to use for the membership values.
+ * @param memo The cache, see FuzzyModelMemoInit().
+ * @param inputs The crisp inputs, one per input set of the model.
+ * @param outputs The crisp outputs, one per output set of the model.
+ */
+void FuzzyEvaluateMemo(const FuzzyModel_t *model, FuzzyState_t *state,
+                       FuzzyMemo_t *memo, const FuzzyReal_t *inputs,
+                       FuzzyReal_t *outputs) {
+    bool hit;
+    FuzzyReal_t *cached = FuzzyMemoLookup(memo, inputs, &hit);
+    if (!hit) {
+        FuzzyEvaluate(model, state, inputs, cached);
+    }
+
+    for (int i = 0; i < model->numOutputs; i++) {
+        outputs[i] = cached[i];
+    }
+}
@@ -0,0 +1,472 @@
+/**
+ * @file model_file.c
+ * @brief Fuzzy Logic binary model file implementation.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "model_file.h"
+
+#include "class.h"
+#include "defuzzifier.h"
+#include "model.h"
+#include "program.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Places a section of count elements of the given size at the end of the
+ * image.
+ *
+ * @return The new end of the image.
+ */
+static uint32_t placeSection(FuzzyModelSection_t *section, uint32_t end,
+                             size_t count, size_t size) {
+    end = (end + FUZZY_MODEL_ALIGNMENT - 1) & ~(FUZZY_MODEL_ALIGNMENT - 1);
+    section->offset = end;
+    section->count = (uint32_t)count;
+    return end + (uint32_t)(count * size);
+}
+
+/**
+ * Fills the header of the image of a model.
+ */
+static void layoutImage(const FuzzyModel_t *model, FuzzyModelHeader_t *header) {
+    const FuzzyProgram_t *program = &model->program;
+    const FuzzyRuleIndex_t *index = &program->index;
+
+    size_t numFunctions = 0;
+    for (int i = 0; i < program->numSets; i++) {
+        numFunctions += program->sets[i]->length;
+    }
+
+    size_t numRuleStarts = 0;
+    size_t numGated = 0;
+    if (index->ruleStarts != NULL) {
+        numRuleStarts = index->numRules + 1;
+        for (int g = 0; g < index->numGates; g++) {
+            const FuzzyGate_t *gate = &index->gates[g];
+            if (gate->first + gate->count > numGated) {
+                numGated = gate->first + gate->count;
+            }
+        }
+    }
+
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, FUZZY_MODEL_MAGIC, sizeof(header->magic));
+    header->version = FUZZY_MODEL_VERSION;
+    header->realSize = sizeof(FuzzyReal_t);
+    header->functionSize = sizeof(MembershipFunction_t);
+    header->numInputs = (uint16_t)model->numInputs;
+    header->numOutputs = (uint16_t)model->numOutputs;
+    header->defuzzifier = (uint16_t)model->defuzzifier;
+    header->normalization = (uint16_t)program->normalization;
+    header->sparse = program->sparse;
+    header->norm = (uint16_t)program->norm;
+
+    uint32_t end = sizeof(*header);
+    end = placeSection(&header->sets, end, program->numSets,
+                       sizeof(FuzzyModelSet_t));
+    end = placeSection(&header->functions, end, numFunctions,
+                       sizeof(MembershipFunction_t));
+    end = placeSection(&header->ops, end, program->numOps, sizeof(FuzzyOp_t));
+    end = placeSection(&header->outputs, end, program->numOutputs,
+                       sizeof(uint16_t));
+    end = placeSection(&header->ruleStarts, end, numRuleStarts,
+                       sizeof(uint32_t));
+    end = placeSection(&header->gates, end,
+                       index->ruleStarts != NULL ? index->numGates : 0,
+                       sizeof(FuzzyGate_t));
+    end = placeSection(&header->gatedRules, end, numGated, sizeof(uint32_t));
+    end = placeSection(&header->ungatedRules, end,
+                       index->ruleStarts != NULL ? index->numUngated : 0,
+                       sizeof(uint32_t));
+    header->size = end;
+}
+
+/**
+ * Returns the number of bytes the image of a model takes.
+ *
+ * @param model The FuzzyModel_t to write.
+ * @return The size of the buffer to pass to FuzzyModelWriteImage().
+ */
+size_t FuzzyModelImageSize(const FuzzyModel_t *model) {
+    FuzzyModelHeader_t header;
+    layoutImage(model, &header);
+    return header.size;
+}
+
+/**
+ * Writes the image of a model.
+ *
+ * The image holds the membership functions of every set of the model, the
+ * compiled rules and their index. Partitions and caches enabled on the sets
+ * of the model are not part of the image, nor are Takagi-Sugeno consequents.
+ *
+ * @param model The FuzzyModel_t to write.
+ * @param image The buffer of FuzzyModelImageSize() bytes to write to.
+ */
+void FuzzyModelWriteImage(const FuzzyModel_t *model, void *image) {
+    const FuzzyProgram_t *program = &model->program;
+    const FuzzyRuleIndex_t *index = &program->index;
+    uint8_t *bytes = (uint8_t *)image;
+    FuzzyModelHeader_t header;
+
+    layoutImage(model, &header);
+    memset(bytes, 0, header.size);
+    memcpy(bytes, &header, sizeof(header));
+
+    FuzzyModelSet_t *sets = (FuzzyModelSet_t *)(bytes + header.sets.offset);
+    MembershipFunction_t *functions =
+        (MembershipFunction_t *)(bytes + header.functions.offset);
+    uint32_t first = 0;
+    for (int i = 0; i < program->numSets; i++) {
+        const FuzzySet_t *set = program->sets[i];
+        sets[i].first = first;
+        sets[i].length = set->length;
+        memcpy(functions + first, set->membershipFunctions,
+               set->length * sizeof(MembershipFunction_t));
+        first += set->length;
+    }
+
+    memcpy(bytes + header.ops.offset, program->ops,
+           header.ops.count * sizeof(FuzzyOp_t));
+    memcpy(bytes + header.outputs.offset, program->outputs,
+           header.outputs.count * sizeof(uint16_t));
+    if (index->ruleStarts != NULL) {
+        memcpy(bytes + header.ruleStarts.offset, index->ruleStarts,
+               header.ruleStarts.count * sizeof(uint32_t));
+        memcpy(bytes + header.gates.offset, index->gates,
+               header.gates.count * sizeof(FuzzyGate_t));
+        memcpy(bytes + header.gatedRules.offset, index->gatedRules,
+               header.gatedRules.count * sizeof(uint32_t));
+        memcpy(bytes + header.ungatedRules.offset, index->ungatedRules,
+               header.ungatedRules.count * sizeof(uint32_t));
+    }
+}
+
+/**
+ * Writes the image of a model to a file.
+ *
+ * @param model The FuzzyModel_t to write.
+ * @param path The file to create or replace.
+ * @return false if allocating or writing failed, or the model has
+ * Takagi-Sugeno consequents, which an image can not hold.
+ */
+bool FuzzyModelSave(const FuzzyModel_t *model, const char *path) {
+    if (model->tsk != NULL) {
+        return false;
+    }
+    const size_t size = FuzzyModelImageSize(model);
+    void *image = malloc(size);
+    if (image == NULL) {
+        return false;
+    }
+    FuzzyModelWriteImage(model, image);
+
+    bool saved = false;
+    FILE *stream = fopen(path, "wb");
+    if (stream != NULL) {
+        saved = fwrite(image, 1, size, stream) == size;
+        saved = fclose(stream) == 0 && saved;
+    }
+    free(image);
+    return saved;
+}
+
+/**
+ * Checks that a section lies within the image and is aligned.
+ */
+static bool validSection(const FuzzyModelSection_t *section, size_t size,
+                         size_t imageSize) {
+    return section->offset % FUZZY_MODEL_ALIGNMENT == 0 &&
+           section->offset <= imageSize &&
+           section->count <= (imageSize - section->offset) / size;
+}
+
+/**
+ * Checks that a membership value reference is within the sets of an image.
+ */
+static bool validValue(const FuzzyModelSet_t *sets, uint32_t numSets,
+                       uint16_t set, uint16_t value) {
+    return set < numSets && value < sets[set].length;
+}
+
+/**
+ * Checks every offset and index of an image, so evaluating a model loaded
+ * from it never reads outside of the image or the state.
+ */
+static bool validImage(const uint8_t *bytes, size_t size) {
+    const FuzzyModelHeader_t *header = (const FuzzyModelHeader_t *)bytes;
+
+    if (size < sizeof(*header) ||
+        memcmp(header->magic, FUZZY_MODEL_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != FUZZY_MODEL_VERSION ||
+        header->realSize != sizeof(FuzzyReal_t) ||
+        header->functionSize != sizeof(MembershipFunction_t) ||
+        header->size > size) {
+        return false;
+    }
+    size = header->size;
+
+    if (!validSection(&header->sets, sizeof(FuzzyModelSet_t), size) ||
+        !validSection(&header->functions, sizeof(MembershipFunction_t),
+                      size) ||
+        !validSection(&header->ops, sizeof(FuzzyOp_t), size) ||
+        !validSection(&header->outputs, sizeof(uint16_t), size) ||
+        !validSection(&header->ruleStarts, sizeof(uint32_t), size) ||
+        !validSection(&header->gates, sizeof(FuzzyGate_t), size) ||
+        !validSection(&header->gatedRules, sizeof(uint32_t), size) ||
+        !validSection(&header->ungatedRules, sizeof(uint32_t), size)) {
+        return false;
+    }
+
+    const uint32_t numSets = header->sets.count;
+    if (numSets == 0 || numSets > UINT16_MAX ||
+        header->numInputs + header->numOutputs > numSets ||
+        (header->defuzzifier != FUZZY_DEFUZZIFY_WEIGHTED_CENTROIDS &&
+         header->defuzzifier != FUZZY_DEFUZZIFY_AREA &&
+         header->defuzzifier != FUZZY_DEFUZZIFY_SINGLETONS) ||
+        header->normalization > FUZZY_NORMALIZE_PER_RULE ||
+        header->norm > FUZZY_NORM_HAMACHER) {
+        return false;
+    }
+
+    const FuzzyModelSet_t *sets =
+        (const FuzzyModelSet_t *)(bytes + header->sets.offset);
+    for (uint32_t i = 0; i < numSets; i++) {
+        if (sets[i].length > INT32_MAX ||
+            sets[i].first > header->functions.count ||
+            sets[i].length > header->functions.count - sets[i].first) {
+            return false;
+        }
+    }
+
+    const FuzzyOp_t *ops = (const FuzzyOp_t *)(bytes + header->ops.offset);
+    for (uint32_t i = 0; i < header->ops.count; i++) {
+        const FuzzyOp_t *op = &ops[i];
+        if (op->code > FUZZY_OP_LOAD) {
+            return false;
+        }
+        const bool leaf = op->code >= FUZZY_OP_MIN &&
+                          op->code <= FUZZY_OP_MAX_NOT;
+        if ((leaf || op->code >= FUZZY_OP_ACCUMULATE) &&
+            !validValue(sets, numSets, op->set, op->value)) {
+            return false;
+        }
+    }
+
+    const uint16_t *outputs =
+        (const uint16_t *)(bytes + header->outputs.offset);
+    for (uint32_t i = 0; i < header->outputs.count; i++) {
+        if (outputs[i] >= numSets) {
+            return false;
+        }
+    }
+
+    // The rule index is either complete or absent
+    if (header->ruleStarts.count == 0) {
+        return header->gates.count == 0 && header->gatedRules.count == 0 &&
+               header->ungatedRules.count == 0;
+    }
+
+    const uint32_t numRules = header->ruleStarts.count - 1;
+    const uint32_t *ruleStarts =
+        (const uint32_t *)(bytes + header->ruleStarts.offset);
+    for (uint32_t r = 0; r < numRules; r++) {
+        if (ruleStarts[r] > ruleStarts[r + 1]) {
+            return false;
+        }
+    }
+    if (ruleStarts[numRules] != header->ops.count) {
+        return false;
+    }
+
+    const FuzzyGate_t *gates =
+        (const FuzzyGate_t *)(bytes + header->gates.offset);
+    for (uint32_t g = 0; g < header->gates.count; g++) {
+        const FuzzyGate_t *gate = &gates[g];
+        if (!validValue(sets, numSets, gate->set, gate->value) ||
+            gate->first > header->gatedRules.count ||
+            gate->count > header->gatedRules.count - gate->first) {
+            return false;
+        }
+    }
+
+    const uint32_t *gatedRules =
+        (const uint32_t *)(bytes + header->gatedRules.offset);
+    for (uint32_t i = 0; i < header->gatedRules.count; i++) {
+        if (gatedRules[i] >= numRules) {
+            return false;
+        }
+    }
+    const uint32_t *ungatedRules =
+        (const uint32_t *)(bytes + header->ungatedRules.offset);
+    for (uint32_t i = 0; i < header->ungatedRules.count; i++) {
+        if (ungatedRules[i] >= numRules) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Loads a model from an image in memory.
+ *
+ * The image is validated and then used in place: the membership functions,
+ * operations and rule index of the model point into it, only the set table is
+ * allocated. Builds with FUZZY_DIVISION_FREE also enable the layouts of the
+ * sets, see FuzzySetEnableLayout(). The image must be aligned to
+ * FUZZY_MODEL_ALIGNMENT and outlive the model. Sets are ordered as in the
+ * model the image was written from, inputs first, then outputs.
+ *
+ * @param file The FuzzyModelFile_t struct to initialize.
+ * @param image The image, see FuzzyModelWriteImage().
+ * @param size The size of the image in bytes.
+ * @return false if the image is malformed, was written for another
+ * FuzzyReal_t or allocating failed. The file is left untouched then.
+ */
+bool FuzzyModelLoad(FuzzyModelFile_t *file, const void *image, size_t size) {
+    const uint8_t *bytes = (const uint8_t *)image;
+    if ((uintptr_t)bytes % FUZZY_MODEL_ALIGNMENT != 0 ||
+        !validImage(bytes, size)) {
+        return false;
+    }
+    const FuzzyModelHeader_t *header = (const FuzzyModelHeader_t *)bytes;
+
+    const int numSets = (int)header->sets.count;
+    FuzzySet_t *sets = (FuzzySet_t *)malloc(numSets * sizeof(FuzzySet_t));
+    const FuzzySet_t **table =
+        (const FuzzySet_t **)malloc(numSets * sizeof(FuzzySet_t *));
+    if (sets == NULL || table == NULL) {
+        free(sets);
+        free(table);
+        return false;
+    }
+
+    const FuzzyModelSet_t *entries =
+        (const FuzzyModelSet_t *)(bytes + header->sets.offset);
+    const MembershipFunction_t *functions =
+        (const MembershipFunction_t *)(bytes + header->functions.offset);
+    FuzzyModel_t *model = &file->model;
+    model->numValues = 0;
+    for (int i = 0; i < numSets; i++) {
+        sets[i] = (FuzzySet_t){
+            .membershipValues = NULL,
+            .membershipFunctions = functions + entries[i].first,
+            .length = (int)entries[i].length,
+            .ownsStorage = false,
+            .partition = NULL,
+            .memo = NULL,
+            .layout = NULL};
+#ifdef FUZZY_DIVISION_FREE
+        // Without memory for the layout the set is classified by division
+        FuzzySetEnableLayout(&sets[i]);
+#endif
+        table[i] = &sets[i];
+        model->numValues += sets[i].length;
+    }
+
+    FuzzyProgram_t *program = &model->program;
+    program->ops = (const FuzzyOp_t *)(bytes + header->ops.offset);
+    program->numOps = (int)header->ops.count;
+    program->sets = table;
+    program->numSets = numSets;
+    program->outputs = (const uint16_t *)(bytes + header->outputs.offset);
+    program->numOutputs = (int)header->outputs.count;
+    program->normalization = (FuzzyNormalization_e)header->normalization;
+    program->sparse = header->sparse != 0;
+    program->norm = (FuzzyNorm_e)header->norm;
+    program->values = NULL;
+    program->temporaries = NULL;
+
+    program->index = (FuzzyRuleIndex_t){0};
+    if (header->ruleStarts.count > 0) {
+        FuzzyRuleIndex_t *index = &program->index;
+        index->numRules = (int)header->ruleStarts.count - 1;
+        index->ruleStarts =
+            (const uint32_t *)(bytes + header->ruleStarts.offset);
+        index->gates = (const FuzzyGate_t *)(bytes + header->gates.offset);
+        index->numGates = (int)header->gates.count;
+        index->gatedRules =
+            (const uint32_t *)(bytes + header->gatedRules.offset);
+        index->ungatedRules =
+            (const uint32_t *)(bytes + header->ungatedRules.offset);
+        index->numUngated = (int)header->ungatedRules.count;
+    }
+
+    model->numInputs = header->numInputs;
+    model->numOutputs = header->numOutputs;
+    model->defuzzifier = (FuzzyDefuzzifyMethod_e)header->defuzzifier;
+    model->tsk = NULL;
+
+    file->sets = sets;
+    file->image = image;
+    file->size = size;
+    file->mapped = false;
+    return true;
+}
+
+/**
+ * Loads a model from a file.
+ *
+ * The file is mapped read-only and loaded with FuzzyModelLoad(), so its pages
+ * are shared by every process using the same model and nothing beyond the
+ * set table is copied.
+ *
+ * @param file The FuzzyModelFile_t struct to initialize.
+ * @param path The file to load, see FuzzyModelSave().
+ * @return false if the file can not be mapped or is not a valid image.
+ */
+bool FuzzyModelOpen(FuzzyModelFile_t *file, const char *path) {
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    void *image = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        image = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (image == MAP_FAILED) {
+        return false;
+    }
+
+    if (!FuzzyModelLoad(file, image, (size_t)info.st_size)) {
+        munmap(image, (size_t)info.st_size);
+        return false;
+    }
+    file->mapped = true;
+    return true;
+}
+
+/**
+ * Frees a model loaded by FuzzyModelLoad() or FuzzyModelOpen().
+ *
+ * The partitions, caches and layouts enabled on the sets are freed and a
+ * mapped file is unmapped. No state of the model may be evaluated afterwards.
+ *
+ * @param file The FuzzyModelFile_t struct to free.
+ */
+void FuzzyModelClose(FuzzyModelFile_t *file) {
+    for (int i = 0; i < file->model.program.numSets; i++) {
+        FuzzySetFree(&file->sets[i]);
+    }
+    free(file->sets);
+    free((void *)file->model.program.sets);
+    if (file->mapped) {
+        munmap((void *)file->image, file->size);
+    }
+}
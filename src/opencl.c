@@ -0,0 +1,529 @@
+/**
+ * @file opencl.c
+ * @brief Fuzzy Logic OpenCL batch evaluation implementation.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "opencl.h"
+
+#ifdef FUZZY_ENABLE_OPENCL
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The kernel evaluates one row per work item. The sizes of the model are
+// compile time constants of the kernel (see buildOptions()), so the
+// membership values fit a private array and the loops have fixed bounds. The
+// inputs and outputs are stored by column, input i of row j at
+// inputs[i * count + j], so neighbouring work items read neighbouring values.
+// The shapes and operators follow membership_function.c and program.c; the
+// smooth shapes use the exp() and pow() of the device.
+static const char *const kernelSource =
+    "#if FUZZY_CL_DOUBLE\n"
+    "#pragma OPENCL EXTENSION cl_khr_fp64 : enable\n"
+    "typedef double real;\n"
+    "#else\n"
+    "typedef float real;\n"
+    "#endif\n"
+    "\n"
+    "real tNorm(real a, real b) {\n"
+    "#if FUZZY_CL_NORM == 1\n"
+    "    return a * b;\n"
+    "#elif FUZZY_CL_NORM == 2\n"
+    "    const real value = a + b - (real)1;\n"
+    "    return value > (real)0 ? value : (real)0;\n"
+    "#elif FUZZY_CL_NORM == 3\n"
+    "    const real product = a * b;\n"
+    "    const real denominator = a + b - product;\n"
+    "    return denominator > (real)0 ? product / denominator : (real)0;\n"
+    "#else\n"
+    "    return a < b ? a : b;\n"
+    "#endif\n"
+    "}\n"
+    "\n"
+    "real sNorm(real a, real b) {\n"
+    "#if FUZZY_CL_NORM == 1\n"
+    "    return a + b - a * b;\n"
+    "#elif FUZZY_CL_NORM == 2\n"
+    "    const real value = a + b;\n"
+    "    return value < (real)1 ? value : (real)1;\n"
+    "#elif FUZZY_CL_NORM == 3\n"
+    "    const real product = a * b;\n"
+    "    const real denominator = (real)1 - product;\n"
+    "    return denominator > (real)0\n"
+    "               ? (a + b - (real)2 * product) / denominator\n"
+    "               : (real)1;\n"
+    "#else\n"
+    "    return a > b ? a : b;\n"
+    "#endif\n"
+    "}\n"
+    "\n"
+    "real membership(real x, __global const real *p, uchar type) {\n"
+    "    const real a = p[0], b = p[1], c = p[2], d = p[3];\n"
+    "    switch (type) {\n"
+    "    case 0:\n"
+    "        if (x < a || x > c) return (real)0;\n"
+    "        if (x <= b)\n"
+    "            return b - a == (real)0 ? (real)1 : (x - a) / (b - a);\n"
+    "        return (c - x) / (c - b);\n"
+    "    case 1:\n"
+    "        if (x <= a || x >= d) return (real)0;\n"
+    "        if (x <= b) return (x - a) / (b - a);\n"
+    "        if (x >= c) return (d - x) / (d - c);\n"
+    "        return (real)1;\n"
+    "    case 2:\n"
+    "        return x < a || x >= b ? (real)0 : (real)1;\n"
+    "    case 3:\n"
+    "        return x == a ? (real)1\n"
+    "                      : exp(-((x - a) * (x - a)) / ((real)2 * b * b));\n"
+    "    case 4:\n"
+    "        return (real)1 / ((real)1 + exp(-a * (x - b)));\n"
+    "    case 5:\n"
+    "        return x == c ? (real)1\n"
+    "                      : (real)1 / ((real)1 +\n"
+    "                                   pow(fabs((x - c) / a), (real)2 * b));\n"
+    "    case 6:\n"
+    "        return x == a ? (real)1 : (real)0;\n"
+    "    default:\n"
+    "        return (real)0;\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "void normalize(real *values, int length) {\n"
+    "    real sum = (real)0;\n"
+    "    for (int i = 0; i < length; i++) sum += values[i];\n"
+    "    for (int i = 0; i < length; i++)\n"
+    "        values[i] = sum == (real)0 ? (real)0 : values[i] / sum;\n"
+    "}\n"
+    "\n"
+    "__kernel void fuzzyEvaluate(__global const real *inputs,\n"
+    "                            __global real *outputs, const uint count,\n"
+    "                            __global const real *parameters,\n"
+    "                            __global const uchar *types,\n"
+    "                            __global const int *offsets,\n"
+    "                            __global const ushort *ops,\n"
+    "                            __global const ushort *targets,\n"
+    "                            __global const real *centroids) {\n"
+    "    const uint row = get_global_id(0);\n"
+    "    if (row >= count) return;\n"
+    "\n"
+    "    real values[FUZZY_CL_NUM_VALUES];\n"
+    "    for (int k = 0; k < FUZZY_CL_NUM_VALUES; k++) values[k] = (real)0;\n"
+    "    for (int i = 0; i < FUZZY_CL_NUM_INPUTS; i++) {\n"
+    "        const real x = inputs[i * count + row];\n"
+    "        for (int k = offsets[i]; k < offsets[i + 1]; k++)\n"
+    "            values[k] = membership(x, parameters + 4 * k, types[k]);\n"
+    "    }\n"
+    "\n"
+    "    real strength = (real)1, group = (real)1;\n"
+    "    for (int i = 0; i < FUZZY_CL_NUM_OPS; i++) {\n"
+    "        const ushort code = ops[3 * i];\n"
+    "        real *value = &values[offsets[ops[3 * i + 1]] + ops[3 * i + 2]];\n"
+    "        switch (code) {\n"
+    "        case 0: strength = (real)1; break;\n"
+    "        case 1: group = (real)1; break;\n"
+    "        case 2: group = (real)0; break;\n"
+    "        case 3: group = tNorm(group, *value); break;\n"
+    "        case 4: group = tNorm(group, (real)1 - *value); break;\n"
+    "        case 5: group = sNorm(group, *value); break;\n"
+    "        case 6: group = sNorm(group, (real)1 - *value); break;\n"
+    "        case 7: strength = tNorm(strength, group); break;\n"
+    "        case 8: *value = sNorm(*value, strength); break;\n"
+    "        case 9: *value = group; break;\n"
+    "        case 10: strength = tNorm(strength, *value); break;\n"
+    "        }\n"
+    "    }\n"
+    "#if FUZZY_CL_PER_RULE\n"
+    "    for (int i = 0; i < FUZZY_CL_NUM_OPS; i++) {\n"
+    "        const int set = ops[3 * i + 1];\n"
+    "        if (ops[3 * i] == 8)\n"
+    "            normalize(&values[offsets[set]],\n"
+    "                      offsets[set + 1] - offsets[set]);\n"
+    "    }\n"
+    "#else\n"
+    "    for (int i = 0; i < FUZZY_CL_NUM_TARGETS; i++)\n"
+    "        normalize(&values[offsets[targets[i]]],\n"
+    "                  offsets[targets[i] + 1] - offsets[targets[i]]);\n"
+    "#endif\n"
+    "\n"
+    "    for (int o = 0; o < FUZZY_CL_NUM_OUTPUTS; o++) {\n"
+    "        const int set = FUZZY_CL_NUM_INPUTS + o;\n"
+    "        real sum = (real)0, weight = (real)0;\n"
+    "        for (int k = offsets[set]; k < offsets[set + 1]; k++) {\n"
+    "            sum += centroids[k] * values[k];\n"
+    "            weight += values[k];\n"
+    "        }\n"
+    "        outputs[o * count + row] = weight == (real)0 ? (real)0\n"
+    "                                                     : sum / weight;\n"
+    "    }\n"
+    "}\n";
+
+/**
+ * Writes the build options of the kernel for a model.
+ */
+static void buildOptions(const FuzzyModel_t *model, char *options,
+                         size_t size) {
+    const FuzzyProgram_t *program = &model->program;
+    snprintf(options, size,
+             "-cl-std=CL1.2 -DFUZZY_CL_DOUBLE=%d -DFUZZY_CL_NORM=%d "
+             "-DFUZZY_CL_PER_RULE=%d -DFUZZY_CL_NUM_VALUES=%d "
+             "-DFUZZY_CL_NUM_INPUTS=%d -DFUZZY_CL_NUM_OUTPUTS=%d "
+             "-DFUZZY_CL_NUM_OPS=%d -DFUZZY_CL_NUM_TARGETS=%d",
+             sizeof(FuzzyReal_t) == sizeof(double), (int)program->norm,
+             program->normalization == FUZZY_NORMALIZE_PER_RULE,
+             model->numValues, model->numInputs, model->numOutputs,
+             program->numOps, program->numOutputs);
+}
+
+/**
+ * Picks a device: the first GPU of any platform, otherwise the first device.
+ */
+static cl_device_id defaultDevice(void) {
+    cl_platform_id platforms[8];
+    cl_uint numPlatforms = 0;
+    if (clGetPlatformIDs(8, platforms, &numPlatforms) != CL_SUCCESS) {
+        return NULL;
+    }
+    if (numPlatforms > 8) {
+        numPlatforms = 8;
+    }
+
+    const cl_device_type types[] = {CL_DEVICE_TYPE_GPU, CL_DEVICE_TYPE_ALL};
+    for (int t = 0; t < 2; t++) {
+        for (cl_uint p = 0; p < numPlatforms; p++) {
+            cl_device_id device;
+            if (clGetDeviceIDs(platforms[p], types[t], 1, &device, NULL) ==
+                CL_SUCCESS) {
+                return device;
+            }
+        }
+    }
+    return NULL;
+}
+
+static bool supportsDouble(cl_device_id device) {
+    char extensions[4096] = {0};
+    clGetDeviceInfo(device, CL_DEVICE_EXTENSIONS, sizeof(extensions) - 1,
+                    extensions, NULL);
+    return strstr(extensions, "cl_khr_fp64") != NULL;
+}
+
+/**
+ * Creates a read-only device buffer initialized from host memory.
+ */
+static cl_mem upload(FuzzyCl_t *cl, const void *data, size_t size) {
+    cl_int error;
+    cl_mem buffer =
+        clCreateBuffer(cl->context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                       size, (void *)data, &error);
+    return error == CL_SUCCESS ? buffer : NULL;
+}
+
+/**
+ * Flattens the model into device buffers.
+ */
+static bool uploadModel(FuzzyCl_t *cl) {
+    const FuzzyModel_t *model = cl->model;
+    const FuzzyProgram_t *program = &model->program;
+    const int numValues = model->numValues;
+
+    FuzzyReal_t *parameters = malloc(4 * numValues * sizeof(FuzzyReal_t));
+    cl_uchar *types = malloc(numValues * sizeof(cl_uchar));
+    cl_int *offsets = malloc((program->numSets + 1) * sizeof(cl_int));
+    FuzzyReal_t *centroids = malloc(numValues * sizeof(FuzzyReal_t));
+    cl_ushort *ops = malloc(3 * program->numOps * sizeof(cl_ushort));
+    bool uploaded = false;
+
+    if (parameters != NULL && types != NULL && offsets != NULL &&
+        centroids != NULL && ops != NULL) {
+        int k = 0;
+        for (int i = 0; i < program->numSets; i++) {
+            const FuzzySet_t *set = program->sets[i];
+            offsets[i] = k;
+            for (int j = 0; j < set->length; j++, k++) {
+                const MembershipFunction_t function =
+                    set->membershipFunctions[j];
+                parameters[4 * k] = function.a;
+                parameters[4 * k + 1] = function.b;
+                parameters[4 * k + 2] = function.c;
+                parameters[4 * k + 3] = function.d;
+                types[k] = (cl_uchar)function.type;
+                // A centroid with no membership adds a zero either way, see
+                // defuzzificationValues()
+                centroids[k] =
+                    model->defuzzifier == FUZZY_DEFUZZIFY_SINGLETONS
+                        ? function.a
+                        : calculateCentroid(function, FUZZY_REAL_C(1.0));
+            }
+        }
+        offsets[program->numSets] = k;
+
+        for (int i = 0; i < program->numOps; i++) {
+            ops[3 * i] = program->ops[i].code;
+            ops[3 * i + 1] = program->ops[i].set;
+            ops[3 * i + 2] = program->ops[i].value;
+        }
+
+        cl->parameters =
+            upload(cl, parameters, 4 * numValues * sizeof(FuzzyReal_t));
+        cl->types = upload(cl, types, numValues * sizeof(cl_uchar));
+        cl->offsets =
+            upload(cl, offsets, (program->numSets + 1) * sizeof(cl_int));
+        cl->ops = upload(cl, ops, 3 * program->numOps * sizeof(cl_ushort));
+        cl->targets = upload(cl, program->outputs,
+                             program->numOutputs * sizeof(cl_ushort));
+        cl->centroids =
+            upload(cl, centroids, numValues * sizeof(FuzzyReal_t));
+        uploaded = cl->parameters != NULL && cl->types != NULL &&
+                   cl->offsets != NULL && cl->ops != NULL &&
+                   cl->targets != NULL && cl->centroids != NULL;
+    }
+
+    free(parameters);
+    free(types);
+    free(offsets);
+    free(centroids);
+    free(ops);
+    return uploaded;
+}
+
+static bool buildKernel(FuzzyCl_t *cl) {
+    const char *source = kernelSource;
+    cl_int error;
+    cl->program =
+        clCreateProgramWithSource(cl->context, 1, &source, NULL, &error);
+    if (error != CL_SUCCESS) {
+        return false;
+    }
+
+    char options[512];
+    buildOptions(cl->model, options, sizeof(options));
+    if (clBuildProgram(cl->program, 1, &cl->device, options, NULL, NULL) !=
+        CL_SUCCESS) {
+        return false;
+    }
+
+    cl->kernel = clCreateKernel(cl->program, "fuzzyEvaluate", &error);
+    return error == CL_SUCCESS;
+}
+
+static bool createSlots(FuzzyCl_t *cl) {
+    const FuzzyModel_t *model = cl->model;
+    for (int s = 0; s < FUZZY_CL_SLOTS; s++) {
+        FuzzyClSlot_t *slot = &cl->slots[s];
+        cl_int error;
+
+        slot->queue = clCreateCommandQueue(cl->context, cl->device, 0, &error);
+        if (error != CL_SUCCESS) {
+            return false;
+        }
+        slot->inputs = clCreateBuffer(
+            cl->context, CL_MEM_READ_ONLY,
+            cl->capacity * model->numInputs * sizeof(FuzzyReal_t), NULL,
+            &error);
+        if (error != CL_SUCCESS) {
+            return false;
+        }
+        slot->outputs = clCreateBuffer(
+            cl->context, CL_MEM_WRITE_ONLY,
+            cl->capacity * model->numOutputs * sizeof(FuzzyReal_t), NULL,
+            &error);
+        if (error != CL_SUCCESS) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Initializes a FuzzyCl_t struct.
+ *
+ * The model is flattened and uploaded once and the kernel is built for its
+ * sizes, operator family and normalization. Every slot gets its own command
+ * queue and buffers for capacity rows. Only Mamdani models defuzzified with
+ * FUZZY_DEFUZZIFY_WEIGHTED_CENTROIDS or FUZZY_DEFUZZIFY_SINGLETONS are
+ * supported; double builds need a device with cl_khr_fp64. The model must
+ * outlive the FuzzyCl_t.
+ *
+ * @param cl The FuzzyCl_t struct to initialize.
+ * @param model The FuzzyModel_t to upload.
+ * @param device The device to use, NULL for the first GPU or else the first
+ * device of any platform.
+ * @param capacity The maximum number of rows of a batch.
+ * @return false if the model is not supported, no device was found or a call
+ * of OpenCL failed, the struct is released then.
+ */
+bool FuzzyClInit(FuzzyCl_t *cl, const FuzzyModel_t *model, cl_device_id device,
+                 size_t capacity) {
+    memset(cl, 0, sizeof(*cl));
+    cl->model = model;
+    cl->capacity = capacity;
+
+    if (model->tsk != NULL ||
+        (model->defuzzifier != FUZZY_DEFUZZIFY_WEIGHTED_CENTROIDS &&
+         model->defuzzifier != FUZZY_DEFUZZIFY_SINGLETONS)) {
+        return false;
+    }
+
+    cl->device = device != NULL ? device : defaultDevice();
+    const bool needsDouble = sizeof(FuzzyReal_t) == sizeof(double);
+    if (cl->device == NULL || (needsDouble && !supportsDouble(cl->device))) {
+        return false;
+    }
+
+    cl_int error;
+    cl->context = clCreateContext(NULL, 1, &cl->device, NULL, NULL, &error);
+    if (error != CL_SUCCESS) {
+        cl->context = NULL;
+        return false;
+    }
+
+    if (!uploadModel(cl) || !buildKernel(cl) || !createSlots(cl)) {
+        FuzzyClFree(cl);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Frees the device resources of a FuzzyCl_t struct.
+ *
+ * Batches still in flight are waited for.
+ *
+ * @param cl The FuzzyCl_t struct to free.
+ */
+void FuzzyClFree(FuzzyCl_t *cl) {
+    FuzzyClFinish(cl);
+
+    for (int s = 0; s < FUZZY_CL_SLOTS; s++) {
+        FuzzyClSlot_t *slot = &cl->slots[s];
+        if (slot->inputs != NULL) {
+            clReleaseMemObject(slot->inputs);
+        }
+        if (slot->outputs != NULL) {
+            clReleaseMemObject(slot->outputs);
+        }
+        if (slot->queue != NULL) {
+            clReleaseCommandQueue(slot->queue);
+        }
+    }
+
+    cl_mem buffers[] = {cl->parameters, cl->types,   cl->offsets,
+                        cl->ops,        cl->targets, cl->centroids};
+    for (size_t i = 0; i < sizeof(buffers) / sizeof(buffers[0]); i++) {
+        if (buffers[i] != NULL) {
+            clReleaseMemObject(buffers[i]);
+        }
+    }
+    if (cl->kernel != NULL) {
+        clReleaseKernel(cl->kernel);
+    }
+    if (cl->program != NULL) {
+        clReleaseProgram(cl->program);
+    }
+    if (cl->context != NULL) {
+        clReleaseContext(cl->context);
+    }
+    memset(cl, 0, sizeof(*cl));
+}
+
+/**
+ * Waits for the batch in a slot and releases its event.
+ */
+static bool waitSlot(FuzzyClSlot_t *slot) {
+    if (!slot->busy) {
+        return true;
+    }
+    const bool done = clWaitForEvents(1, &slot->done) == CL_SUCCESS;
+    clReleaseEvent(slot->done);
+    slot->busy = false;
+    return done;
+}
+
+/**
+ * Submits a batch for evaluation without waiting for it.
+ *
+ * The inputs are stored by column, input i of row j at inputs[i * count + j],
+ * and the outputs are written the same way, output o of row j at
+ * outputs[o * count + j]. The batch is uploaded, evaluated and downloaded
+ * asynchronously in the next slot, so while the device evaluates one batch
+ * the next one is already uploaded. Submitting waits only if the slot still
+ * holds the batch submitted FUZZY_CL_SLOTS calls earlier. The inputs and
+ * outputs must stay valid until then or until FuzzyClFinish().
+ *
+ * @param cl The FuzzyCl_t to evaluate with.
+ * @param inputs The crisp inputs, model->numInputs columns of count values.
+ * @param outputs The crisp outputs, model->numOutputs columns of count values.
+ * @param count The number of rows, at most the capacity.
+ * @return false if count exceeds the capacity or a call of OpenCL failed.
+ */
+bool FuzzyClSubmit(FuzzyCl_t *cl, const FuzzyReal_t *inputs,
+                   FuzzyReal_t *outputs, size_t count) {
+    FuzzyClSlot_t *slot = &cl->slots[cl->next];
+    if (count > cl->capacity || !waitSlot(slot)) {
+        return false;
+    }
+    if (count == 0) {
+        return true;
+    }
+
+    const FuzzyModel_t *model = cl->model;
+    const cl_uint rows = (cl_uint)count;
+    if (clEnqueueWriteBuffer(slot->queue, slot->inputs, CL_FALSE, 0,
+                             count * model->numInputs * sizeof(FuzzyReal_t),
+                             inputs, 0, NULL, NULL) != CL_SUCCESS) {
+        return false;
+    }
+
+    // The arguments are captured when the kernel is enqueued, so the slots
+    // can share the kernel
+    const cl_mem arguments[] = {slot->inputs, slot->outputs};
+    cl_int error = CL_SUCCESS;
+    error |= clSetKernelArg(cl->kernel, 0, sizeof(cl_mem), &arguments[0]);
+    error |= clSetKernelArg(cl->kernel, 1, sizeof(cl_mem), &arguments[1]);
+    error |= clSetKernelArg(cl->kernel, 2, sizeof(cl_uint), &rows);
+    error |= clSetKernelArg(cl->kernel, 3, sizeof(cl_mem), &cl->parameters);
+    error |= clSetKernelArg(cl->kernel, 4, sizeof(cl_mem), &cl->types);
+    error |= clSetKernelArg(cl->kernel, 5, sizeof(cl_mem), &cl->offsets);
+    error |= clSetKernelArg(cl->kernel, 6, sizeof(cl_mem), &cl->ops);
+    error |= clSetKernelArg(cl->kernel, 7, sizeof(cl_mem), &cl->targets);
+    error |= clSetKernelArg(cl->kernel, 8, sizeof(cl_mem), &cl->centroids);
+    if (error != CL_SUCCESS) {
+        return false;
+    }
+
+    if (clEnqueueNDRangeKernel(slot->queue, cl->kernel, 1, NULL, &count, NULL,
+                               0, NULL, NULL) != CL_SUCCESS ||
+        clEnqueueReadBuffer(slot->queue, slot->outputs, CL_FALSE, 0,
+                            count * model->numOutputs * sizeof(FuzzyReal_t),
+                            outputs, 0, NULL, &slot->done) != CL_SUCCESS) {
+        return false;
+    }
+    slot->busy = true;
+    clFlush(slot->queue);
+
+    cl->next = (cl->next + 1) % FUZZY_CL_SLOTS;
+    return true;
+}
+
+/**
+ * Waits until every submitted batch has been downloaded.
+ *
+ * @param cl The FuzzyCl_t to wait for.
+ * @return false if a batch failed.
+ */
+bool FuzzyClFinish(FuzzyCl_t *cl) {
+    bool done = true;
+    for (int s = 0; s < FUZZY_CL_SLOTS; s++) {
+        done &= waitSlot(&cl->slots[s]);
+    }
+    return done;
+}
+
+#endif
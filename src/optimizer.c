@@ -0,0 +1,836 @@
+/**
+ * @file optimizer.c
+ * @brief Fuzzy Logic rule base optimizer implementation.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "optimizer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// The optimizer works on rules in conjunctive form: a rule is the minimum of
+// its clauses and a clause is the maximum of its variables. Every variable of
+// an ALL_OF group becomes a clause of its own and every ANY_OF group becomes
+// one clause, so ALL_OF(a, b), ANY_OF(c, d) is the clauses {a}, {b}, {c, d}.
+typedef struct {
+    FuzzyVariable_t *variables;
+    int length;
+} Clause_t;
+
+typedef struct {
+    Clause_t *clauses;
+    int numClauses;
+    FuzzyVariable_t consequent;
+    // the rule of the input this rule started from
+    int origin;
+    // reads or writes a set which is both the consequent of a rule and read
+    // by a rule, so its position in the rule order matters
+    bool chained;
+    bool removed;
+} NormalRule_t;
+
+// An interval outside of which a membership function is zero, the functions
+// are also zero at the open ends
+typedef struct {
+    FuzzyReal_t lo;
+    FuzzyReal_t hi;
+    bool loOpen;
+    bool hiOpen;
+} Support_t;
+
+static bool sameVariable(const FuzzyVariable_t *a, const FuzzyVariable_t *b) {
+    return a->variable == b->variable && a->value == b->value &&
+           a->invert == b->invert;
+}
+
+static bool sameConsequent(const NormalRule_t *a, const NormalRule_t *b) {
+    return a->consequent.variable == b->consequent.variable &&
+           a->consequent.value == b->consequent.value;
+}
+
+static bool containsVariable(const Clause_t *clause,
+                             const FuzzyVariable_t *variable) {
+    for (int i = 0; i < clause->length; i++) {
+        if (sameVariable(&clause->variables[i], variable)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Every variable of a is in b, so a is never greater than b
+static bool isSubclause(const Clause_t *a, const Clause_t *b) {
+    for (int i = 0; i < a->length; i++) {
+        if (!containsVariable(b, &a->variables[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool sameClause(const Clause_t *a, const Clause_t *b) {
+    return isSubclause(a, b) && isSubclause(b, a);
+}
+
+static bool hasClause(const NormalRule_t *rule, const Clause_t *clause) {
+    for (int i = 0; i < rule->numClauses; i++) {
+        if (sameClause(&rule->clauses[i], clause)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void freeNormalRules(NormalRule_t *rules, int numRules) {
+    for (int r = 0; r < numRules; r++) {
+        for (int c = 0; c < rules[r].numClauses; c++) {
+            free(rules[r].clauses[c].variables);
+        }
+        free(rules[r].clauses);
+    }
+    free(rules);
+}
+
+static bool readsSet(const NormalRule_t *rule, const FuzzySet_t *set) {
+    for (int c = 0; c < rule->numClauses; c++) {
+        for (int i = 0; i < rule->clauses[c].length; i++) {
+            if (rule->clauses[c].variables[i].variable == set) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static bool isConsequent(const NormalRule_t *rules, int numRules,
+                         const FuzzySet_t *set) {
+    for (int r = 0; r < numRules; r++) {
+        if (rules[r].consequent.variable == set) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Marks the rules chained through intermediate sets, sets which one rule
+ * writes and another one reads.
+ *
+ * Compiled programs run the rules in order, so a rule reading an intermediate
+ * set sees the contributions of the rules before it only. Dropping, merging
+ * or moving such rules, or rules writing such a set, changes what the rules
+ * in between read, so all passes but dead rule removal leave them as they
+ * are.
+ */
+static void markChainedRules(NormalRule_t *rules, int numRules) {
+    for (int r = 0; r < numRules; r++) {
+        const FuzzySet_t *written = rules[r].consequent.variable;
+        for (int s = 0; s < numRules && !rules[r].chained; s++) {
+            rules[r].chained = readsSet(&rules[s], written);
+        }
+        for (int c = 0; c < rules[r].numClauses && !rules[r].chained; c++) {
+            const Clause_t *clause = &rules[r].clauses[c];
+            for (int i = 0; i < clause->length && !rules[r].chained; i++) {
+                rules[r].chained = isConsequent(rules, numRules,
+                                                clause->variables[i].variable);
+            }
+        }
+    }
+}
+
+static bool toNormalRule(const FuzzyRule_t *rule, NormalRule_t *normal) {
+    int numClauses = 0;
+    for (int j = 0; j < rule->num_antecedents; j++) {
+        const FuzzyAntecedent_t *antecedent = &rule->antecedent[j];
+        numClauses += antecedent->fuzzy_operator == FUZZY_ANY_OF
+                          ? 1
+                          : antecedent->num_variables;
+    }
+
+    normal->clauses = (Clause_t *)calloc(numClauses + 1, sizeof(Clause_t));
+    normal->numClauses = 0;
+    normal->consequent = rule->consequent;
+    normal->chained = false;
+    normal->removed = false;
+    if (normal->clauses == NULL) {
+        return false;
+    }
+
+    for (int j = 0; j < rule->num_antecedents; j++) {
+        const FuzzyAntecedent_t *antecedent = &rule->antecedent[j];
+        const bool any = antecedent->fuzzy_operator == FUZZY_ANY_OF;
+        const int numGroups = any ? 1 : antecedent->num_variables;
+        const int length = any ? antecedent->num_variables : 1;
+
+        for (int k = 0; k < numGroups; k++) {
+            Clause_t *clause = &normal->clauses[normal->numClauses++];
+            clause->variables = (FuzzyVariable_t *)malloc(
+                (length + 1) * sizeof(FuzzyVariable_t));
+            if (clause->variables == NULL) {
+                return false;
+            }
+            clause->length = length;
+            for (int v = 0; v < length; v++) {
+                clause->variables[v] = antecedent->variables[any ? v : k];
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Returns the support of a variable if its membership values come from
+ * classification, that is the set is not a consequent of any rule. The ends
+ * follow membershipFunction(): triangles are zero at sloped ends, trapezoids
+ * at both ends and rectangles at their end.
+ *
+ * @return false if the support is unbounded or not known.
+ */
+static bool variableSupport(const FuzzyVariable_t *variable,
+                            const NormalRule_t *rules, int numRules,
+                            Support_t *support) {
+    if (variable->invert ||
+        isConsequent(rules, numRules, variable->variable)) {
+        return false;
+    }
+
+    const MembershipFunction_t *mf =
+        &variable->variable->membershipFunctions[variable->value];
+    switch (mf->type) {
+    case TRIANGULAR:
+        *support = (Support_t){mf->a, mf->c, mf->b > mf->a, mf->c > mf->b};
+        return true;
+    case TRAPEZOIDAL:
+        *support = (Support_t){mf->a, mf->d, true, true};
+        return true;
+    case RECTANGULAR:
+        *support = (Support_t){mf->a, mf->b, false, true};
+        return true;
+    case SINGLETON:
+        *support = (Support_t){mf->a, mf->a, false, false};
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool isEmpty(const Support_t *support) {
+    return support->lo > support->hi ||
+           (support->lo == support->hi && (support->loOpen || support->hiOpen));
+}
+
+/**
+ * Collects the union of the supports of a clause as sorted, disjoint
+ * intervals.
+ *
+ * @return The number of intervals, or -1 if the union is unbounded.
+ */
+static int clauseSupport(const Clause_t *clause, const NormalRule_t *rules,
+                         int numRules, Support_t *intervals) {
+    int length = 0;
+    for (int i = 0; i < clause->length; i++) {
+        Support_t support;
+        if (!variableSupport(&clause->variables[i], rules, numRules,
+                             &support)) {
+            return -1;
+        }
+        if (isEmpty(&support)) {
+            continue;
+        }
+        int j = length++;
+        for (; j > 0 && intervals[j - 1].lo > support.lo; j--) {
+            intervals[j] = intervals[j - 1];
+        }
+        intervals[j] = support;
+    }
+
+    int merged = length > 0 ? 1 : 0;
+    for (int i = 1; i < length; i++) {
+        Support_t *last = &intervals[merged - 1];
+        const Support_t *next = &intervals[i];
+        // Intervals touching at a point which neither contains stay apart
+        if (next->lo < last->hi ||
+            (next->lo == last->hi && !(next->loOpen && last->hiOpen))) {
+            if (next->lo == last->lo) {
+                last->loOpen &= next->loOpen;
+            }
+            if (next->hi > last->hi) {
+                last->hi = next->hi;
+                last->hiOpen = next->hiOpen;
+            } else if (next->hi == last->hi) {
+                last->hiOpen &= next->hiOpen;
+            }
+        } else {
+            intervals[merged++] = *next;
+        }
+    }
+    return merged;
+}
+
+/**
+ * Intersects two lists of sorted, disjoint intervals into a.
+ *
+ * @return The number of intervals of the intersection.
+ */
+static int intersectSupports(Support_t *a, int numA, const Support_t *b,
+                             int numB, Support_t *scratch) {
+    int length = 0;
+    for (int i = 0, j = 0; i < numA && j < numB;) {
+        Support_t both = a[i];
+        if (b[j].lo > both.lo) {
+            both.lo = b[j].lo;
+            both.loOpen = b[j].loOpen;
+        } else if (b[j].lo == both.lo) {
+            both.loOpen |= b[j].loOpen;
+        }
+        if (b[j].hi < both.hi) {
+            both.hi = b[j].hi;
+            both.hiOpen = b[j].hiOpen;
+        } else if (b[j].hi == both.hi) {
+            both.hiOpen |= b[j].hiOpen;
+        }
+        if (!isEmpty(&both)) {
+            scratch[length++] = both;
+        }
+        if (a[i].hi < b[j].hi) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+    for (int i = 0; i < length; i++) {
+        a[i] = scratch[i];
+    }
+    return length;
+}
+
+/**
+ * Checks whether a rule can never fire.
+ *
+ * An empty ANY_OF group is always zero. Otherwise the clauses reading only
+ * one classified set are non-zero together only where the unions of their
+ * supports overlap, if they do not overlap for some set the rule never fires
+ * for any input but NaN.
+ */
+static bool isDead(const NormalRule_t *rule, const NormalRule_t *rules,
+                   int numRules, Support_t *buffers, int capacity) {
+    Support_t *common = buffers;
+    Support_t *clause = buffers + capacity;
+    Support_t *scratch = buffers + 2 * capacity;
+
+    for (int c = 0; c < rule->numClauses; c++) {
+        if (rule->clauses[c].length == 0) {
+            return true;
+        }
+    }
+
+    for (int c = 0; c < rule->numClauses; c++) {
+        const FuzzySet_t *set = rule->clauses[c].variables[0].variable;
+        bool first = true;
+        int numCommon = 0;
+
+        for (int d = 0; d < rule->numClauses; d++) {
+            const Clause_t *other = &rule->clauses[d];
+            bool single = true;
+            for (int i = 0; i < other->length; i++) {
+                single &= other->variables[i].variable == set;
+            }
+            if (!single) {
+                continue;
+            }
+            // Every clause on the set is visited from its first clause
+            if (d < c) {
+                break;
+            }
+
+            const int length = clauseSupport(other, rules, numRules, clause);
+            if (length < 0) {
+                continue;
+            }
+            if (first) {
+                for (int i = 0; i < length; i++) {
+                    common[i] = clause[i];
+                }
+                numCommon = length;
+                first = false;
+            } else {
+                numCommon = intersectSupports(common, numCommon, clause,
+                                              length, scratch);
+            }
+            if (numCommon == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Removes duplicate variables and the clauses implied by another clause of
+ * the same rule: min(a, max(a, b)) = a.
+ */
+static bool simplifyRule(NormalRule_t *rule, FuzzyOptimizeReport_t *report) {
+    bool changed = false;
+
+    for (int c = 0; c < rule->numClauses; c++) {
+        Clause_t *clause = &rule->clauses[c];
+        int length = 0;
+        for (int i = 0; i < clause->length; i++) {
+            const Clause_t head = {clause->variables, length};
+            if (containsVariable(&head, &clause->variables[i])) {
+                report->removedVariables++;
+                changed = true;
+            } else {
+                clause->variables[length++] = clause->variables[i];
+            }
+        }
+        clause->length = length;
+    }
+
+    int kept = 0;
+    for (int c = 0; c < rule->numClauses; c++) {
+        Clause_t *clause = &rule->clauses[c];
+        bool implied = false;
+        for (int d = 0; d < rule->numClauses && !implied; d++) {
+            const Clause_t *other = &rule->clauses[d];
+            // Of two equal clauses the first one is kept
+            implied = d != c && other->length >= 0 &&
+                      isSubclause(other, clause) &&
+                      (!isSubclause(clause, other) || d < c);
+        }
+        if (implied) {
+            report->removedVariables += clause->length;
+            report->removedGroups += clause->length > 1;
+            free(clause->variables);
+            clause->variables = NULL;
+            // Marks the clause, removed clauses imply nothing
+            clause->length = -1;
+            changed = true;
+        }
+    }
+    for (int c = 0; c < rule->numClauses; c++) {
+        if (rule->clauses[c].length >= 0) {
+            rule->clauses[kept++] = rule->clauses[c];
+        }
+    }
+    rule->numClauses = kept;
+    return changed;
+}
+
+// Every clause of b has a clause of a not greater than it, so the strength of
+// a is never greater than the strength of b
+static bool isWeaker(const NormalRule_t *a, const NormalRule_t *b) {
+    for (int j = 0; j < b->numClauses; j++) {
+        bool bounded = false;
+        for (int i = 0; i < a->numClauses && !bounded; i++) {
+            bounded = isSubclause(&a->clauses[i], &b->clauses[j]);
+        }
+        if (!bounded) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool subsumeRules(NormalRule_t *rules, int numRules,
+                         FuzzyOptimizeReport_t *report) {
+    bool changed = false;
+    for (int r = 0; r < numRules; r++) {
+        if (!rules[r].removed && !rules[r].chained &&
+            simplifyRule(&rules[r], report)) {
+            changed = true;
+        }
+    }
+
+    for (int r = 0; r < numRules; r++) {
+        for (int s = 0; s < numRules && !rules[r].removed; s++) {
+            if (s == r || rules[s].removed || rules[r].chained ||
+                rules[s].chained || !sameConsequent(&rules[r], &rules[s])) {
+                continue;
+            }
+            // Of two equivalent rules the first one is kept
+            if (isWeaker(&rules[r], &rules[s]) &&
+                (!isWeaker(&rules[s], &rules[r]) || s < r)) {
+                rules[r].removed = true;
+                report->subsumedRules++;
+                changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
+/**
+ * Finds the only clause of a which b does not have.
+ *
+ * @return The index of the clause, or -1 if a has no or several such
+ * clauses.
+ */
+static int onlyOtherClause(const NormalRule_t *a, const NormalRule_t *b) {
+    int other = -1;
+    for (int i = 0; i < a->numClauses; i++) {
+        if (!hasClause(b, &a->clauses[i])) {
+            if (other >= 0) {
+                return -1;
+            }
+            other = i;
+        }
+    }
+    return other;
+}
+
+/**
+ * Merges rules with the same consequent whose clauses only differ in one
+ * clause each: max(min(C, a), min(C, b)) = min(C, max(a, b)).
+ */
+static bool mergeRules(NormalRule_t *rules, int numRules,
+                       FuzzyOptimizeReport_t *report, bool *failed) {
+    bool changed = false;
+    for (int r = 0; r < numRules; r++) {
+        for (int s = r + 1; s < numRules && !rules[r].removed; s++) {
+            if (rules[s].removed || rules[r].chained || rules[s].chained ||
+                !sameConsequent(&rules[r], &rules[s])) {
+                continue;
+            }
+            const int a = onlyOtherClause(&rules[r], &rules[s]);
+            const int b = onlyOtherClause(&rules[s], &rules[r]);
+            if (a < 0 || b < 0) {
+                continue;
+            }
+
+            Clause_t *target = &rules[r].clauses[a];
+            const Clause_t *source = &rules[s].clauses[b];
+            FuzzyVariable_t *variables = (FuzzyVariable_t *)realloc(
+                target->variables,
+                (target->length + source->length + 1) *
+                    sizeof(FuzzyVariable_t));
+            if (variables == NULL) {
+                *failed = true;
+                return false;
+            }
+            target->variables = variables;
+            for (int i = 0; i < source->length; i++) {
+                if (!containsVariable(target, &source->variables[i])) {
+                    target->variables[target->length++] = source->variables[i];
+                }
+            }
+
+            rules[s].removed = true;
+            report->mergedRules++;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+/**
+ * Estimates the share of the universe of a set where a variable is non-zero,
+ * from the supports of all membership functions of the set.
+ */
+static FuzzyReal_t variableShare(const FuzzyVariable_t *variable,
+                                 const NormalRule_t *rules, int numRules) {
+    Support_t support;
+    if (!variableSupport(variable, rules, numRules, &support)) {
+        return 1.0;
+    }
+
+    const FuzzySet_t *set = variable->variable;
+    FuzzyReal_t lo = INFINITY;
+    FuzzyReal_t hi = -INFINITY;
+    for (int i = 0; i < set->length; i++) {
+        const FuzzyVariable_t other = {.variable = variable->variable,
+                                       .value = i};
+        Support_t bounds;
+        if (variableSupport(&other, rules, numRules, &bounds)) {
+            lo = bounds.lo < lo ? bounds.lo : lo;
+            hi = bounds.hi > hi ? bounds.hi : hi;
+        }
+    }
+    if (!(hi > lo)) {
+        return 1.0;
+    }
+    const FuzzyReal_t share = (support.hi - support.lo) / (hi - lo);
+    return share < 1.0 ? share : 1.0;
+}
+
+static FuzzyReal_t clauseShare(const Clause_t *clause,
+                               const NormalRule_t *rules, int numRules) {
+    FuzzyReal_t share = 0.0;
+    for (int i = 0; i < clause->length; i++) {
+        share += variableShare(&clause->variables[i], rules, numRules);
+    }
+    return share < 1.0 ? share : 1.0;
+}
+
+/**
+ * Sorts the clauses of a rule by the share of the universe where they are
+ * non-zero, stable, so equally selective clauses keep their order.
+ */
+static void sortClauses(NormalRule_t *rule, const NormalRule_t *rules,
+                        int numRules) {
+    for (int i = 1; i < rule->numClauses; i++) {
+        const Clause_t clause = rule->clauses[i];
+        const FuzzyReal_t share = clauseShare(&clause, rules, numRules);
+        int j = i;
+        for (; j > 0 &&
+               clauseShare(&rule->clauses[j - 1], rules, numRules) > share;
+             j--) {
+            rule->clauses[j] = rule->clauses[j - 1];
+        }
+        rule->clauses[j] = clause;
+    }
+}
+
+static int countOps(const FuzzyRule_t *rules, int numRules) {
+    int numOps = 0;
+    for (int i = 0; i < numRules; i++) {
+        numOps += 2;
+        for (int j = 0; j < rules[i].num_antecedents; j++) {
+            numOps += 2 + rules[i].antecedent[j].num_variables;
+        }
+    }
+    return numOps;
+}
+
+/**
+ * Allocates the antecedents of a rule with all variables in one block, which
+ * antecedent[0].variables points to.
+ */
+static bool allocateRule(FuzzyRule_t *rule, int numAntecedents,
+                         int numVariables) {
+    rule->antecedent = (FuzzyAntecedent_t *)calloc(numAntecedents + 1,
+                                                   sizeof(FuzzyAntecedent_t));
+    FuzzyVariable_t *variables =
+        (FuzzyVariable_t *)malloc((numVariables + 1) * sizeof(FuzzyVariable_t));
+    if (rule->antecedent == NULL || variables == NULL) {
+        free(rule->antecedent);
+        free(variables);
+        rule->antecedent = NULL;
+        rule->num_antecedents = 0;
+        return false;
+    }
+    rule->antecedent[0].variables = variables;
+    rule->num_antecedents = numAntecedents;
+    return true;
+}
+
+static bool copyRule(const FuzzyRule_t *rule, FuzzyRule_t *copy) {
+    int numVariables = 0;
+    for (int j = 0; j < rule->num_antecedents; j++) {
+        numVariables += rule->antecedent[j].num_variables;
+    }
+    if (!allocateRule(copy, rule->num_antecedents, numVariables)) {
+        return false;
+    }
+
+    FuzzyVariable_t *variables = copy->antecedent[0].variables;
+    for (int j = 0; j < rule->num_antecedents; j++) {
+        const FuzzyAntecedent_t *antecedent = &rule->antecedent[j];
+        copy->antecedent[j] = (FuzzyAntecedent_t){
+            .variables = variables,
+            .num_variables = antecedent->num_variables,
+            .fuzzy_operator = antecedent->fuzzy_operator};
+        for (int k = 0; k < antecedent->num_variables; k++) {
+            *variables++ = antecedent->variables[k];
+        }
+    }
+    copy->consequent = rule->consequent;
+    return true;
+}
+
+/**
+ * Builds a rule from its clauses: the single variable clauses form one ALL_OF
+ * group first, every other clause becomes an ANY_OF group.
+ */
+static bool buildRule(const NormalRule_t *normal, FuzzyRule_t *rule) {
+    int numVariables = 0;
+    int numSingles = 0;
+    for (int c = 0; c < normal->numClauses; c++) {
+        numVariables += normal->clauses[c].length;
+        numSingles += normal->clauses[c].length == 1;
+    }
+    const int numAntecedents =
+        (numSingles > 0) + normal->numClauses - numSingles;
+    if (!allocateRule(rule, numAntecedents, numVariables)) {
+        return false;
+    }
+
+    FuzzyVariable_t *variables = rule->antecedent[0].variables;
+    int j = 0;
+    if (numSingles > 0) {
+        rule->antecedent[j++] =
+            (FuzzyAntecedent_t){.variables = variables,
+                                .num_variables = numSingles,
+                                .fuzzy_operator = FUZZY_ALL_OF};
+        for (int c = 0; c < normal->numClauses; c++) {
+            if (normal->clauses[c].length == 1) {
+                *variables++ = normal->clauses[c].variables[0];
+            }
+        }
+    }
+    for (int c = 0; c < normal->numClauses; c++) {
+        const Clause_t *clause = &normal->clauses[c];
+        if (clause->length == 1) {
+            continue;
+        }
+        rule->antecedent[j++] =
+            (FuzzyAntecedent_t){.variables = variables,
+                                .num_variables = clause->length,
+                                .fuzzy_operator = FUZZY_ANY_OF};
+        for (int i = 0; i < clause->length; i++) {
+            *variables++ = clause->variables[i];
+        }
+    }
+    rule->consequent = normal->consequent;
+    return true;
+}
+
+/**
+ * Optimizes a rule base offline.
+ *
+ * The passes (see FuzzyOptimizePass_e) run until none of them changes the
+ * rules anymore. Dead rules are removed first: rules with an empty ANY_OF
+ * group, and rules whose antecedents on one classified set need membership
+ * functions with disjoint supports, e.g. ALL_OF(VAR(T, LOW), VAR(T, HIGH)).
+ * Sets which are the consequent of a rule are not classified and never count
+ * as disjoint. Then duplicate variables and groups are removed, rules weaker
+ * than another rule with the same consequent are dropped and rules differing
+ * in one group are merged into one with the union of both groups.
+ *
+ * All passes except FUZZY_OPTIMIZE_DEAD rewrite the remaining rules: the
+ * single variables form one ALL_OF group, ordered by FUZZY_OPTIMIZE_REORDER so
+ * that the variables non-zero on the smallest part of their universe come
+ * first and compiled programs stop these rules early, followed by the ANY_OF
+ * groups.
+ *
+ * Rules reading or writing an intermediate set, a set which is the consequent
+ * of one rule and read by another, depend on the order of the rules. Apart
+ * from dead rule removal they are copied unchanged and no other rule is
+ * merged with them. With min and max and FUZZY_NORMALIZE_ONCE the compiled
+ * program of the optimized rules then computes exactly the same outputs.
+ *
+ * @param base Receives the optimized rules and the report, to be released
+ * with FuzzyRuleBaseFree().
+ * @param rules The rules to optimize.
+ * @param numRules The number of rules.
+ * @param passes The FuzzyOptimizePass_e flags to run, e.g.
+ * FUZZY_OPTIMIZE_ALL.
+ * @return false if allocating failed.
+ */
+bool FuzzyRulesOptimize(FuzzyRuleBase_t *base, const FuzzyRule_t *rules,
+                        int numRules, int passes) {
+    FuzzyOptimizeReport_t *report = &base->report;
+    *report = (FuzzyOptimizeReport_t){.opsBefore = countOps(rules, numRules)};
+    base->rules = NULL;
+    base->numRules = 0;
+
+    NormalRule_t *normal =
+        (NormalRule_t *)calloc(numRules + 1, sizeof(NormalRule_t));
+    if (normal == NULL) {
+        return false;
+    }
+    int maxVariables = 1;
+    bool failed = false;
+    for (int r = 0; r < numRules && !failed; r++) {
+        failed = !toNormalRule(&rules[r], &normal[r]);
+        normal[r].origin = r;
+        for (int c = 0; c < normal[r].numClauses; c++) {
+            maxVariables += normal[r].clauses[c].length;
+        }
+    }
+    if (!failed) {
+        markChainedRules(normal, numRules);
+    }
+
+    if (!failed && (passes & FUZZY_OPTIMIZE_DEAD)) {
+        Support_t *buffers =
+            (Support_t *)malloc(3 * maxVariables * sizeof(Support_t));
+        failed = buffers == NULL;
+        for (int r = 0; r < numRules && !failed; r++) {
+            if (isDead(&normal[r], normal, numRules, buffers, maxVariables)) {
+                normal[r].removed = true;
+                report->deadRules++;
+            }
+        }
+        free(buffers);
+    }
+
+    bool changed = true;
+    while (changed && !failed) {
+        changed = false;
+        if (passes & FUZZY_OPTIMIZE_SUBSUME) {
+            changed |= subsumeRules(normal, numRules, report);
+        }
+        if (passes & FUZZY_OPTIMIZE_MERGE) {
+            changed |= mergeRules(normal, numRules, report, &failed);
+        }
+    }
+
+    const bool rewrite = passes & (FUZZY_OPTIMIZE_SUBSUME |
+                                   FUZZY_OPTIMIZE_MERGE |
+                                   FUZZY_OPTIMIZE_REORDER);
+    if (!failed) {
+        base->rules = (FuzzyRule_t *)calloc(numRules + 1, sizeof(FuzzyRule_t));
+        failed = base->rules == NULL;
+    }
+    for (int r = 0; r < numRules && !failed; r++) {
+        if (normal[r].removed) {
+            continue;
+        }
+        FuzzyRule_t *rule = &base->rules[base->numRules++];
+        if (!rewrite || normal[r].chained) {
+            failed = !copyRule(&rules[normal[r].origin], rule);
+            continue;
+        }
+        if (passes & FUZZY_OPTIMIZE_REORDER) {
+            sortClauses(&normal[r], normal, numRules);
+        }
+        failed = !buildRule(&normal[r], rule);
+    }
+    freeNormalRules(normal, numRules);
+
+    if (failed) {
+        FuzzyRuleBaseFree(base);
+        return false;
+    }
+    report->opsAfter = countOps(base->rules, base->numRules);
+    return true;
+}
+
+/**
+ * Frees the rules of an optimized rule base.
+ *
+ * @param base The FuzzyRuleBase_t to free.
+ */
+void FuzzyRuleBaseFree(FuzzyRuleBase_t *base) {
+    for (int r = 0; r < base->numRules; r++) {
+        if (base->rules[r].antecedent != NULL) {
+            free(base->rules[r].antecedent[0].variables);
+            free(base->rules[r].antecedent);
+        }
+    }
+    free(base->rules);
+    base->rules = NULL;
+    base->numRules = 0;
+}
+
+/**
+ * Prints what FuzzyRulesOptimize() changed.
+ *
+ * @param report The FuzzyOptimizeReport_t to print.
+ */
+void printOptimizeReport(const FuzzyOptimizeReport_t *report) {
+    printf("rules: %d dead, %d subsumed, %d merged\n", report->deadRules,
+           report->subsumedRules, report->mergedRules);
+    printf("removed: %d variables, %d groups\n", report->removedVariables,
+           report->removedGroups);
+    printf("ops per evaluation: %d -> %d, %d saved\n", report->opsBefore,
+           report->opsAfter, report->opsBefore - report->opsAfter);
+}
@@ -0,0 +1,1362 @@
+/**
+ * @file program.c
+ * @brief Fuzzy Logic rule compiler and program interpreter implementation.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "program.h"
+
+#include "class.h"
+#include "inference.h"
+#include "stats.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Finds a set in a table of sets and appends it if it is not present yet.
+ *
+ * @param sets The table of sets, must have room for one more entry.
+ * @param numSets The number of sets in the table, updated on append.
+ * @param set The set to find.
+ * @return The index of the set in the table.
+ */
+static int findOrAddSet(const FuzzySet_t **sets, int *numSets,
+                        const FuzzySet_t *set) {
+    for (int i = 0; i < *numSets; i++) {
+        if (sets[i] == set) {
+            return i;
+        }
+    }
+    sets[*numSets] = set;
+    return (*numSets)++;
+}
+
+/**
+ * Appends a set index to a list if it is not present yet.
+ *
+ * @param list The list of set indexes, must have room for one more entry.
+ * @param length The number of entries in the list, updated on append.
+ * @param set The set index to add.
+ */
+static void addUnique(uint16_t *list, int *length, uint16_t set) {
+    for (int i = 0; i < *length; i++) {
+        if (list[i] == set) {
+            return;
+        }
+    }
+    list[(*length)++] = set;
+}
+
+/**
+ * Finds the cheapest gate of the rule starting at op.
+ *
+ * A rule can only fire if every antecedent group is non-zero. An ALL_OF group
+ * is zero as soon as one of its plain variables is, so one such variable gates
+ * the rule; the one of the largest set is picked as it is the most selective.
+ * An ANY_OF group without NOT() variables is zero when all its variables are,
+ * which gates the rule with each of them. Groups which can not gate the rule
+ * are skipped.
+ *
+ * @param program The program containing the rule.
+ * @param op The RULE operation of the rule.
+ * @param end One past the last operation of the rule.
+ * @param gate Receives the first operation of the gating variables.
+ * @return The number of gating variables, 0 if the rule is ungated.
+ */
+static int findGate(const FuzzyProgram_t *program, const FuzzyOp_t *op,
+                    const FuzzyOp_t *end, const FuzzyOp_t **gate) {
+    int best = 0;
+
+    while (op < end) {
+        // The temporary of a shared group bounds the strength like a plain
+        // variable of an ALL_OF group
+        if (op->code == FUZZY_OP_LOAD && best != 1) {
+            best = 1;
+            *gate = op;
+        }
+        if (op->code != FUZZY_OP_ALL_OF && op->code != FUZZY_OP_ANY_OF) {
+            op++;
+            continue;
+        }
+
+        const bool any = op->code == FUZZY_OP_ANY_OF;
+        const FuzzyOp_t *first = ++op;
+        const FuzzyOp_t *selective = NULL;
+        bool gateable = any;
+        for (; op < end && op->code != FUZZY_OP_REDUCE; op++) {
+            if (op->code == FUZZY_OP_MIN &&
+                (selective == NULL ||
+                 program->sets[op->set]->length >
+                     program->sets[selective->set]->length)) {
+                selective = op;
+            } else if (op->code == FUZZY_OP_MAX_NOT) {
+                gateable = false;
+            }
+        }
+
+        int cost = 0;
+        if (!any && selective != NULL) {
+            cost = 1;
+            first = selective;
+        } else if (gateable && op > first) {
+            cost = (int)(op - first);
+        }
+        if (cost > 0 && (best == 0 || cost < best)) {
+            best = cost;
+            *gate = first;
+        }
+    }
+
+    return best;
+}
+
+/**
+ * Checks whether an antecedent of a program reads one of its output sets, the
+ * rules of such programs depend on the order they run in.
+ */
+static bool readsOutputs(const FuzzyProgram_t *program) {
+    const FuzzyOp_t *end = program->ops + program->numOps;
+
+    for (const FuzzyOp_t *op = program->ops; op < end; op++) {
+        if (op->code < FUZZY_OP_MIN || op->code > FUZZY_OP_MAX_NOT) {
+            continue;
+        }
+        for (int i = 0; i < program->numOutputs; i++) {
+            if (program->outputs[i] == op->set) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Builds the rule index of a program for sparse evaluation.
+ *
+ * Sparse evaluation runs the rules grouped by gate rather than in order, so
+ * programs where an antecedent reads an output set are left without an index.
+ *
+ * @param program The compiled program to index.
+ */
+static void buildRuleIndex(FuzzyProgram_t *program) {
+    FuzzyRuleIndex_t *index = &program->index;
+    const FuzzyOp_t *end = program->ops + program->numOps;
+
+    if (readsOutputs(program)) {
+        return;
+    }
+
+    int numRules = 0;
+    for (const FuzzyOp_t *op = program->ops; op < end; op++) {
+        numRules += op->code == FUZZY_OP_RULE;
+    }
+
+    uint32_t *ruleStarts =
+        (uint32_t *)malloc((numRules + 1) * sizeof(uint32_t));
+    numRules = 0;
+    for (int i = 0; i < program->numOps; i++) {
+        if (program->ops[i].code == FUZZY_OP_RULE) {
+            ruleStarts[numRules++] = i;
+        }
+    }
+    ruleStarts[numRules] = program->numOps;
+
+    // Find the gates of every rule, a rule has at most as many as operations
+    int maxGates = program->numOps > 0 ? program->numOps : 1;
+    FuzzyGate_t *gates = (FuzzyGate_t *)calloc(maxGates, sizeof(FuzzyGate_t));
+    uint32_t *gateOf = (uint32_t *)malloc(maxGates * sizeof(uint32_t));
+    uint32_t *ruleOf = (uint32_t *)malloc(maxGates * sizeof(uint32_t));
+    uint32_t *ungated = (uint32_t *)malloc((numRules + 1) * sizeof(uint32_t));
+    int numGates = 0;
+    int numPairs = 0;
+    int numUngated = 0;
+
+    for (int r = 0; r < numRules; r++) {
+        const FuzzyOp_t *gate = NULL;
+        int count = findGate(program, program->ops + ruleStarts[r],
+                             program->ops + ruleStarts[r + 1], &gate);
+        if (count == 0) {
+            ungated[numUngated++] = r;
+            continue;
+        }
+
+        for (int k = 0; k < count; k++) {
+            int g = 0;
+            while (g < numGates && (gates[g].set != gate[k].set ||
+                                    gates[g].value != gate[k].value)) {
+                g++;
+            }
+            if (g == numGates) {
+                gates[numGates].set = gate[k].set;
+                gates[numGates].value = gate[k].value;
+                numGates++;
+            }
+            gates[g].count++;
+            gateOf[numPairs] = g;
+            ruleOf[numPairs] = r;
+            numPairs++;
+        }
+    }
+
+    // Group the gated rules by gate
+    uint32_t *gatedRules =
+        (uint32_t *)malloc((numPairs > 0 ? numPairs : 1) * sizeof(uint32_t));
+    uint32_t first = 0;
+    for (int g = 0; g < numGates; g++) {
+        gates[g].first = first;
+        first += gates[g].count;
+        gates[g].count = 0;
+    }
+    for (int i = 0; i < numPairs; i++) {
+        FuzzyGate_t *gate = &gates[gateOf[i]];
+        gatedRules[gate->first + gate->count++] = ruleOf[i];
+    }
+    free(gateOf);
+    free(ruleOf);
+
+    index->numRules = numRules;
+    index->ruleStarts = ruleStarts;
+    index->gates = gates;
+    index->numGates = numGates;
+    index->gatedRules = gatedRules;
+    index->ungatedRules = ungated;
+    index->numUngated = numUngated;
+}
+
+/**
+ * Compiles an array of fuzzy rules into a linear program.
+ *
+ * The rule tree (rule -> antecedents -> variables) is lowered once into a
+ * contiguous array of operations. All referenced sets are collected into a
+ * table so that each operation only needs a set and a value index, and the
+ * distinct output sets are listed so that they can be reset and normalized
+ * once per run. A rule index is built for sparse evaluation. The program
+ * defaults to FUZZY_NORMALIZE_ONCE with sparse evaluation and must be
+ * released with FuzzyProgramFree(), also if compiling failed.
+ *
+ * The operations store set and membership function indexes in 16 bits, so
+ * the rules may reference at most UINT16_MAX distinct sets of at most
+ * UINT16_MAX membership functions each.
+ *
+ * @param rules An array of fuzzy rules.
+ * @param numRules The number of fuzzy rules in the array.
+ * @param program The FuzzyProgram_t to compile into.
+ * @return false if the rules reference too many sets, a set longer than
+ * UINT16_MAX or a membership function the set does not have, or allocating
+ * failed. The program is then empty and running it does nothing.
+ */
+bool FuzzyCompileRules(const FuzzyRule_t *rules, int numRules,
+                       FuzzyProgram_t *program) {
+    return FuzzyCompileRulesWithSets(rules, numRules, program, NULL, 0);
+}
+
+/**
+ * Checks that a set and one of its membership functions can be referenced by
+ * an operation.
+ */
+static bool validVariable(const FuzzySet_t *set, int value) {
+    return set->length <= UINT16_MAX && value >= 0 && value < set->length;
+}
+
+/**
+ * Compiles an array of fuzzy rules into a linear program with a given set
+ * order.
+ *
+ * This function works like FuzzyCompileRules() but seeds the set table of the
+ * program with the given sets, so that sets[i] always gets index i. Sets used
+ * by the rules but not listed are appended in order of first appearance.
+ *
+ * @param rules An array of fuzzy rules.
+ * @param numRules The number of fuzzy rules in the array.
+ * @param program The FuzzyProgram_t to compile into.
+ * @param sets The sets to place first in the set table, may be NULL.
+ * @param numSets The number of sets to place first.
+ * @return false if the rules can not be compiled, see FuzzyCompileRules().
+ */
+bool FuzzyCompileRulesWithSets(const FuzzyRule_t *rules, int numRules,
+                               FuzzyProgram_t *program,
+                               const FuzzySet_t *const *sets, int numSets) {
+    *program = (FuzzyProgram_t){0};
+    if (numSets > UINT16_MAX) {
+        return false;
+    }
+
+    // Count the operations and an upper bound of distinct sets
+    int numOps = 0;
+    int maxSets = numSets;
+    for (int i = 0; i < numRules; i++) {
+        numOps += 2;
+        maxSets += 1;
+        for (int j = 0; j < rules[i].num_antecedents; j++) {
+            numOps += 2 + rules[i].antecedent[j].num_variables;
+            maxSets += rules[i].antecedent[j].num_variables;
+        }
+    }
+
+    FuzzyOp_t *ops = (FuzzyOp_t *)malloc(numOps * sizeof(FuzzyOp_t) + 1);
+    const FuzzySet_t **table =
+        (const FuzzySet_t **)malloc(maxSets * sizeof(FuzzySet_t *) + 1);
+    uint16_t *outputs = (uint16_t *)malloc(numRules * sizeof(uint16_t) + 1);
+    FuzzyReal_t **values =
+        (FuzzyReal_t **)malloc(maxSets * sizeof(FuzzyReal_t *) + 1);
+    if (ops == NULL || table == NULL || outputs == NULL || values == NULL) {
+        free(ops);
+        free((void *)table);
+        free(outputs);
+        free(values);
+        return false;
+    }
+    int numTable = 0;
+    for (int i = 0; i < numSets; i++) {
+        table[numTable++] = sets[i];
+    }
+    int numOutputs = 0;
+
+    // Lower every rule into its operations, the indexes are checked before
+    // they are truncated to 16 bits
+    bool valid = true;
+    FuzzyOp_t *op = ops;
+    for (int i = 0; i < numRules && valid; i++) {
+        const FuzzyRule_t *rule = &rules[i];
+
+        *op++ = (FuzzyOp_t){.code = FUZZY_OP_RULE};
+
+        for (int j = 0; j < rule->num_antecedents; j++) {
+            const FuzzyAntecedent_t *antecedent = &rule->antecedent[j];
+            const bool any = antecedent->fuzzy_operator == FUZZY_ANY_OF;
+
+            *op++ =
+                (FuzzyOp_t){.code = any ? FUZZY_OP_ANY_OF : FUZZY_OP_ALL_OF};
+
+            for (int k = 0; k < antecedent->num_variables; k++) {
+                const FuzzyVariable_t *variable = &antecedent->variables[k];
+                uint16_t code;
+                if (any) {
+                    code = variable->invert ? FUZZY_OP_MAX_NOT : FUZZY_OP_MAX;
+                } else {
+                    code = variable->invert ? FUZZY_OP_MIN_NOT : FUZZY_OP_MIN;
+                }
+                const int set =
+                    findOrAddSet(table, &numTable, variable->variable);
+                valid = valid && set < UINT16_MAX &&
+                        validVariable(variable->variable, variable->value);
+                *op++ = (FuzzyOp_t){.code = code,
+                                    .set = (uint16_t)set,
+                                    .value = (uint16_t)variable->value};
+            }
+
+            *op++ = (FuzzyOp_t){.code = FUZZY_OP_REDUCE};
+        }
+
+        const int set =
+            findOrAddSet(table, &numTable, rule->consequent.variable);
+        valid = valid && set < UINT16_MAX &&
+                validVariable(rule->consequent.variable,
+                              rule->consequent.value);
+        *op = (FuzzyOp_t){.code = FUZZY_OP_ACCUMULATE,
+                          .set = (uint16_t)set,
+                          .value = (uint16_t)rule->consequent.value};
+        addUnique(outputs, &numOutputs, op->set);
+        op++;
+    }
+    // The seeded sets need not be used by any rule
+    for (int i = 0; i < numSets && valid; i++) {
+        valid = sets[i]->length <= UINT16_MAX;
+    }
+    if (!valid) {
+        free(ops);
+        free((void *)table);
+        free(outputs);
+        free(values);
+        return false;
+    }
+
+    program->ops = ops;
+    program->numOps = numOps;
+    program->sets = table;
+    program->numSets = numTable;
+    program->outputs = outputs;
+    program->numOutputs = numOutputs;
+    program->normalization = FUZZY_NORMALIZE_ONCE;
+    program->norm = FUZZY_NORM_MIN_MAX;
+    program->values = values;
+
+    program->temporaries = NULL;
+
+    program->index = (FuzzyRuleIndex_t){0};
+    buildRuleIndex(program);
+    program->sparse = true;
+    return true;
+}
+
+/**
+ * Frees the memory allocated for a FuzzyProgram_t struct.
+ *
+ * @param program The FuzzyProgram_t struct to free.
+ */
+void FuzzyProgramFree(FuzzyProgram_t *program) {
+    free((void *)program->ops);
+    free((void *)program->sets);
+    free((void *)program->outputs);
+    free(program->values);
+    free((void *)program->index.ruleStarts);
+    free((void *)program->index.gates);
+    free((void *)program->index.gatedRules);
+    free((void *)program->index.ungatedRules);
+    if (program->temporaries != NULL) {
+        FuzzySetFree(program->temporaries);
+        free(program->temporaries);
+    }
+}
+
+// An antecedent group of a rule, see FuzzyProgramShareAntecedents()
+typedef struct {
+    // the ALL_OF or ANY_OF operation, followed by the leaves and REDUCE
+    const FuzzyOp_t *ops;
+    int numOps;
+    // the opening operation and the sorted distinct leaves identify the group
+    uint16_t code;
+    FuzzyOp_t *key;
+    int numKey;
+    int id;
+} FuzzySharedGroup_t;
+
+// A rule of a program, see FuzzyProgramShareAntecedents()
+typedef struct {
+    int index;
+    // the groups of the rule, a range of the program order groups
+    int firstGroup;
+    int numGroups;
+    // the ACCUMULATE operations of the rule
+    const FuzzyOp_t *consequents;
+    int numConsequents;
+    // the sorted distinct ids of the groups identify the antecedent
+    int *signature;
+    int numSignature;
+    // the first rule with the same antecedent and the next one after this
+    int merged;
+    int next;
+} FuzzySharedRule_t;
+
+static int compareOps(const FuzzyOp_t *a, const FuzzyOp_t *b) {
+    if (a->code != b->code) {
+        return a->code < b->code ? -1 : 1;
+    }
+    if (a->set != b->set) {
+        return a->set < b->set ? -1 : 1;
+    }
+    if (a->value != b->value) {
+        return a->value < b->value ? -1 : 1;
+    }
+    return 0;
+}
+
+static int compareGroups(const void *a, const void *b) {
+    const FuzzySharedGroup_t *x = *(const FuzzySharedGroup_t *const *)a;
+    const FuzzySharedGroup_t *y = *(const FuzzySharedGroup_t *const *)b;
+    if (x->code != y->code) {
+        return x->code < y->code ? -1 : 1;
+    }
+    if (x->numKey != y->numKey) {
+        return x->numKey < y->numKey ? -1 : 1;
+    }
+    for (int i = 0; i < x->numKey; i++) {
+        const int order = compareOps(&x->key[i], &y->key[i]);
+        if (order != 0) {
+            return order;
+        }
+    }
+    return 0;
+}
+
+static int compareRules(const void *a, const void *b) {
+    const FuzzySharedRule_t *x = *(const FuzzySharedRule_t *const *)a;
+    const FuzzySharedRule_t *y = *(const FuzzySharedRule_t *const *)b;
+    if (x->numSignature != y->numSignature) {
+        return x->numSignature < y->numSignature ? -1 : 1;
+    }
+    for (int i = 0; i < x->numSignature; i++) {
+        if (x->signature[i] != y->signature[i]) {
+            return x->signature[i] < y->signature[i] ? -1 : 1;
+        }
+    }
+    return x->index < y->index ? -1 : x->index > y->index;
+}
+
+/**
+ * Sorts a short array of operations and removes duplicates.
+ *
+ * @return The number of distinct operations.
+ */
+static int sortUniqueOps(FuzzyOp_t *ops, int length) {
+    for (int i = 1; i < length; i++) {
+        const FuzzyOp_t op = ops[i];
+        int j = i;
+        for (; j > 0 && compareOps(&ops[j - 1], &op) > 0; j--) {
+            ops[j] = ops[j - 1];
+        }
+        ops[j] = op;
+    }
+
+    int unique = 0;
+    for (int i = 0; i < length; i++) {
+        if (unique == 0 || compareOps(&ops[unique - 1], &ops[i]) != 0) {
+            ops[unique++] = ops[i];
+        }
+    }
+    return unique;
+}
+
+/**
+ * Sorts a short array of group ids and removes duplicates.
+ *
+ * @return The number of distinct ids.
+ */
+static int sortUniqueIds(int *ids, int length) {
+    for (int i = 1; i < length; i++) {
+        const int id = ids[i];
+        int j = i;
+        for (; j > 0 && ids[j - 1] > id; j--) {
+            ids[j] = ids[j - 1];
+        }
+        ids[j] = id;
+    }
+
+    int unique = 0;
+    for (int i = 0; i < length; i++) {
+        if (unique == 0 || ids[unique - 1] != ids[i]) {
+            ids[unique++] = ids[i];
+        }
+    }
+    return unique;
+}
+
+/**
+ * Splits a program into its rules and antecedent groups.
+ *
+ * @param program The program to split.
+ * @param rules Receives the rules.
+ * @param groups Receives the groups in program order.
+ * @param keys Storage for the keys of the groups, one per operation.
+ * @return The number of rules, -1 if the program does not have the shape
+ * emitted by the rule compiler, e.g. because it is shared already.
+ */
+static int splitRules(const FuzzyProgram_t *program, FuzzySharedRule_t *rules,
+                      FuzzySharedGroup_t *groups, FuzzyOp_t *keys) {
+    const FuzzyOp_t *op = program->ops;
+    const FuzzyOp_t *end = op + program->numOps;
+    int numRules = 0;
+    int numGroups = 0;
+
+    while (op < end) {
+        if (op->code != FUZZY_OP_RULE) {
+            return -1;
+        }
+        FuzzySharedRule_t *rule = &rules[numRules];
+        rule->index = numRules++;
+        rule->firstGroup = numGroups;
+        op++;
+
+        for (; op < end && (op->code == FUZZY_OP_ALL_OF ||
+                            op->code == FUZZY_OP_ANY_OF);
+             op++) {
+            FuzzySharedGroup_t *group = &groups[numGroups++];
+            group->ops = op;
+            group->code = op->code;
+            group->key = keys;
+            group->numKey = 0;
+            for (op++; op < end && op->code >= FUZZY_OP_MIN &&
+                       op->code <= FUZZY_OP_MAX_NOT;
+                 op++) {
+                group->key[group->numKey++] = *op;
+            }
+            if (op == end || op->code != FUZZY_OP_REDUCE) {
+                return -1;
+            }
+            group->numOps = (int)(op + 1 - group->ops);
+
+            // A single variable is the same in ALL_OF and ANY_OF
+            if (group->numKey == 1) {
+                group->code = FUZZY_OP_ALL_OF;
+                if (group->key[0].code == FUZZY_OP_MAX) {
+                    group->key[0].code = FUZZY_OP_MIN;
+                } else if (group->key[0].code == FUZZY_OP_MAX_NOT) {
+                    group->key[0].code = FUZZY_OP_MIN_NOT;
+                }
+            }
+            group->numKey = sortUniqueOps(group->key, group->numKey);
+            keys += group->numKey;
+        }
+        rule->numGroups = numGroups - rule->firstGroup;
+
+        rule->consequents = op;
+        for (; op < end && op->code == FUZZY_OP_ACCUMULATE; op++) {
+        }
+        rule->numConsequents = (int)(op - rule->consequents);
+        if (rule->numConsequents == 0) {
+            return -1;
+        }
+    }
+    return numRules;
+}
+
+// Scratch buffers of FuzzyProgramShareAntecedents(), sized by the number of
+// operations of the program
+typedef struct {
+    FuzzySharedRule_t *rules;
+    FuzzySharedGroup_t *groups;
+    void **sorted;
+    FuzzyOp_t *keys;
+    // signatures, then per group id the number of merged rules using it, its
+    // temporary and its first group
+    int *ids;
+    // the prologue takes at most as many operations as the rules
+    FuzzyOp_t *ops;
+} FuzzyShareScratch_t;
+
+/**
+ * Rewrites a program with shared antecedents, see
+ * FuzzyProgramShareAntecedents().
+ *
+ * @return false if allocating failed.
+ */
+static bool shareAntecedents(FuzzyProgram_t *program,
+                             FuzzyShareScratch_t *scratch) {
+    const int numOps = program->numOps;
+    FuzzySharedRule_t *rules = scratch->rules;
+    FuzzySharedGroup_t *groups = scratch->groups;
+    void **sorted = scratch->sorted;
+
+    const int numRules = splitRules(program, rules, groups, scratch->keys);
+    if (numRules < 0) {
+        return true;
+    }
+    const int numGroups =
+        rules[numRules - 1].firstGroup + rules[numRules - 1].numGroups;
+    int *signatures = scratch->ids;
+    int *uses = scratch->ids + numOps;
+    int *temporaryOf = scratch->ids + 2 * numOps;
+    int *firstOf = scratch->ids + 3 * numOps;
+    // Number the distinct groups
+    for (int g = 0; g < numGroups; g++) {
+        sorted[g] = &groups[g];
+    }
+    qsort(sorted, numGroups, sizeof(void *), compareGroups);
+    int numIds = 0;
+    for (int g = 0; g < numGroups; g++) {
+        FuzzySharedGroup_t *group = (FuzzySharedGroup_t *)sorted[g];
+        if (g == 0 || compareGroups(&sorted[g - 1], &sorted[g]) != 0) {
+            uses[numIds] = 0;
+            temporaryOf[numIds] = -1;
+            firstOf[numIds] = numGroups;
+            numIds++;
+        }
+        group->id = numIds - 1;
+    }
+
+    // Merge the rules with the same antecedent into the first of them
+    for (int r = 0; r < numRules; r++) {
+        FuzzySharedRule_t *rule = &rules[r];
+        rule->signature = signatures + rule->firstGroup;
+        for (int g = 0; g < rule->numGroups; g++) {
+            rule->signature[g] = groups[rule->firstGroup + g].id;
+        }
+        rule->numSignature = sortUniqueIds(rule->signature, rule->numGroups);
+        rule->next = -1;
+        sorted[r] = rule;
+    }
+    qsort(sorted, numRules, sizeof(void *), compareRules);
+    int numMerged = 0;
+    for (int r = 0; r < numRules; r++) {
+        FuzzySharedRule_t *rule = (FuzzySharedRule_t *)sorted[r];
+        FuzzySharedRule_t *previous =
+            r > 0 ? (FuzzySharedRule_t *)sorted[r - 1] : NULL;
+        if (previous != NULL && previous->numSignature == rule->numSignature &&
+            memcmp(previous->signature, rule->signature,
+                   rule->numSignature * sizeof(int)) == 0) {
+            rule->merged = previous->merged;
+            previous->next = rule->index;
+            continue;
+        }
+        rule->merged = rule->index;
+        numMerged++;
+        for (int i = 0; i < rule->numSignature; i++) {
+            uses[rule->signature[i]]++;
+        }
+    }
+
+    // Give the groups of several variables used by several rules a temporary
+    int numTemporaries = 0;
+    for (int g = 0; g < numGroups; g++) {
+        const int id = groups[g].id;
+        if (g < firstOf[id]) {
+            firstOf[id] = g;
+        }
+    }
+    for (int g = 0; g < numGroups; g++) {
+        const int id = groups[g].id;
+        if (firstOf[id] == g && uses[id] > 1 && groups[g].numKey > 1 &&
+            numTemporaries < UINT16_MAX) {
+            temporaryOf[id] = numTemporaries++;
+        }
+    }
+
+    if (numMerged == numRules && numTemporaries == 0) {
+        return true;
+    }
+    const uint16_t temporarySet = (uint16_t)program->numSets;
+
+    // Emit the prologue computing the temporaries
+    FuzzyOp_t *ops = scratch->ops;
+    FuzzyOp_t *op = ops;
+    for (int g = 0; g < numGroups; g++) {
+        const FuzzySharedGroup_t *group = &groups[g];
+        const int temporary = temporaryOf[group->id];
+        if (temporary < 0 || firstOf[group->id] != g) {
+            continue;
+        }
+        for (int i = 0; i < group->numOps - 1; i++) {
+            *op++ = group->ops[i];
+        }
+        *op++ = (FuzzyOp_t){.code = FUZZY_OP_STORE,
+                            .set = temporarySet,
+                            .value = (uint16_t)temporary};
+    }
+
+    // Emit every merged rule, reading the temporaries first as they are the
+    // cheapest to stop the rule with, followed by all merged consequents
+    for (int r = 0; r < numRules; r++) {
+        const FuzzySharedRule_t *rule = &rules[r];
+        if (rule->merged != r) {
+            continue;
+        }
+
+        *op++ = (FuzzyOp_t){.code = FUZZY_OP_RULE};
+        for (int i = 0; i < rule->numSignature; i++) {
+            const int temporary = temporaryOf[rule->signature[i]];
+            if (temporary >= 0) {
+                *op++ = (FuzzyOp_t){.code = FUZZY_OP_LOAD,
+                                    .set = temporarySet,
+                                    .value = (uint16_t)temporary};
+            }
+        }
+        for (int g = 0; g < rule->numGroups; g++) {
+            const FuzzySharedGroup_t *group = &groups[rule->firstGroup + g];
+            if (temporaryOf[group->id] < 0) {
+                for (int i = 0; i < group->numOps; i++) {
+                    *op++ = group->ops[i];
+                }
+            }
+        }
+        for (int m = r; m >= 0; m = rules[m].next) {
+            for (int i = 0; i < rules[m].numConsequents; i++) {
+                *op++ = rules[m].consequents[i];
+            }
+        }
+    }
+
+    // Replace the operations, the set table and the index of the program
+    const int numShared = (int)(op - ops);
+    FuzzyOp_t *shrunk =
+        (FuzzyOp_t *)realloc(ops, numShared * sizeof(FuzzyOp_t));
+    if (shrunk != NULL) {
+        ops = scratch->ops = shrunk;
+    }
+    const FuzzySet_t **table = (const FuzzySet_t **)malloc(
+        (program->numSets + 1) * sizeof(FuzzySet_t *));
+    FuzzyReal_t **values = (FuzzyReal_t **)malloc((program->numSets + 1) *
+                                                  sizeof(FuzzyReal_t *));
+    FuzzySet_t *temporaries = (FuzzySet_t *)malloc(sizeof(FuzzySet_t));
+    MembershipFunction_t *none = (MembershipFunction_t *)calloc(
+        numTemporaries + 1, sizeof(MembershipFunction_t));
+    if (table == NULL || values == NULL || temporaries == NULL ||
+        none == NULL) {
+        free(table);
+        free(values);
+        free(temporaries);
+        free(none);
+        return false;
+    }
+
+    // The temporaries are never classified or defuzzified, their membership
+    // functions are only placeholders
+    FuzzySetInit(temporaries, none, numTemporaries);
+    free(none);
+    for (int i = 0; i < program->numSets; i++) {
+        table[i] = program->sets[i];
+    }
+    table[temporarySet] = temporaries;
+
+    free((void *)program->ops);
+    free((void *)program->sets);
+    free(program->values);
+    free((void *)program->index.ruleStarts);
+    free((void *)program->index.gates);
+    free((void *)program->index.gatedRules);
+    free((void *)program->index.ungatedRules);
+
+    program->ops = ops;
+    program->numOps = numShared;
+    program->sets = table;
+    program->numSets++;
+    program->values = values;
+    program->temporaries = temporaries;
+    program->index = (FuzzyRuleIndex_t){0};
+    buildRuleIndex(program);
+    scratch->ops = NULL;
+    return true;
+}
+
+/**
+ * Evaluates antecedent groups shared by several rules only once.
+ *
+ * Rules with the same antecedent, as found in rule bases driving several
+ * outputs from the same conditions, are merged into one rule accumulating its
+ * strength into all of their consequents. ALL_OF and ANY_OF groups of at
+ * least two variables used by several of the remaining rules are hoisted into
+ * a prologue computing each of them once per run into a temporary, which the
+ * rules read with a single LOAD. Groups and antecedents are compared
+ * regardless of the order of their variables and groups.
+ *
+ * Removing duplicate variables, groups and rules relies on minimum and
+ * maximum being idempotent, min(a, a) = a, which the other operator families
+ * are not: ALL_OF(A, A) is A * A with FUZZY_NORM_PRODUCT. Programs with
+ * another program->norm are left unchanged and rejected, so set the norm
+ * before this call and do not change it afterwards.
+ *
+ * Minimum and maximum are exact, so the results are identical to the
+ * original program. The prologue always runs, so with sparse evaluation a
+ * shared group is computed even if none of its rules would have run, the
+ * temporaries gate their rules in turn. The temporaries are kept in a set
+ * owned by the program and appended to its set table, so states have to be
+ * sized after this call (see FuzzyModelShareAntecedents()). Programs whose
+ * antecedents read output sets, or which already have UINT16_MAX sets, are
+ * left unchanged.
+ *
+ * @param program The compiled FuzzyProgram_t to optimize.
+ * @return false if the program does not use FUZZY_NORM_MIN_MAX or allocating
+ * failed, the program is left unchanged then.
+ */
+bool FuzzyProgramShareAntecedents(FuzzyProgram_t *program) {
+    const int numOps = program->numOps;
+    if (program->norm != FUZZY_NORM_MIN_MAX) {
+        return false;
+    }
+    // A full set table has no index left for the temporaries
+    if (numOps == 0 || readsOutputs(program) ||
+        program->numSets >= UINT16_MAX) {
+        return true;
+    }
+
+    FuzzyShareScratch_t scratch = {
+        .rules =
+            (FuzzySharedRule_t *)malloc(numOps * sizeof(FuzzySharedRule_t)),
+        .groups =
+            (FuzzySharedGroup_t *)malloc(numOps * sizeof(FuzzySharedGroup_t)),
+        .sorted = (void **)malloc(numOps * sizeof(void *)),
+        .keys = (FuzzyOp_t *)malloc(numOps * sizeof(FuzzyOp_t)),
+        .ids = (int *)malloc(4 * numOps * sizeof(int)),
+        .ops = (FuzzyOp_t *)malloc(2 * numOps * sizeof(FuzzyOp_t))};
+
+    bool shared = false;
+    if (scratch.rules != NULL && scratch.groups != NULL &&
+        scratch.sorted != NULL && scratch.keys != NULL &&
+        scratch.ids != NULL && scratch.ops != NULL) {
+        shared = shareAntecedents(program, &scratch);
+    }
+
+    free(scratch.rules);
+    free(scratch.groups);
+    free(scratch.sorted);
+    free(scratch.keys);
+    free(scratch.ids);
+    free(scratch.ops);
+    return shared;
+}
+
+static inline FuzzyReal_t fuzzyMin(FuzzyReal_t a, FuzzyReal_t b) {
+    return a < b ? a : b;
+}
+
+static inline FuzzyReal_t fuzzyMax(FuzzyReal_t a, FuzzyReal_t b) {
+    return a > b ? a : b;
+}
+
+static inline FuzzyReal_t fuzzyProduct(FuzzyReal_t a, FuzzyReal_t b) {
+    return a * b;
+}
+
+static inline FuzzyReal_t fuzzyProbabilisticSum(FuzzyReal_t a, FuzzyReal_t b) {
+    return a + b - a * b;
+}
+
+static inline FuzzyReal_t fuzzyLukasiewiczAnd(FuzzyReal_t a, FuzzyReal_t b) {
+    const FuzzyReal_t value = a + b - FUZZY_REAL_C(1.0);
+    return value > FUZZY_REAL_C(0.0) ? value : FUZZY_REAL_C(0.0);
+}
+
+static inline FuzzyReal_t fuzzyLukasiewiczOr(FuzzyReal_t a, FuzzyReal_t b) {
+    const FuzzyReal_t value = a + b;
+    return value < FUZZY_REAL_C(1.0) ? value : FUZZY_REAL_C(1.0);
+}
+
+// The Hamacher product and sum are 0 / 0 at a = b = 0 and a = b = 1
+// respectively, where their limits 0 and 1 are used
+static inline FuzzyReal_t fuzzyHamacherProduct(FuzzyReal_t a, FuzzyReal_t b) {
+    const FuzzyReal_t product = a * b;
+    const FuzzyReal_t denominator = a + b - product;
+    return denominator > FUZZY_REAL_C(0.0) ? product / denominator
+                                           : FUZZY_REAL_C(0.0);
+}
+
+static inline FuzzyReal_t fuzzyHamacherSum(FuzzyReal_t a, FuzzyReal_t b) {
+    const FuzzyReal_t product = a * b;
+    const FuzzyReal_t denominator = FUZZY_REAL_C(1.0) - product;
+    return denominator > FUZZY_REAL_C(0.0)
+               ? (a + b - FUZZY_REAL_C(2.0) * product) / denominator
+               : FUZZY_REAL_C(1.0);
+}
+
+// Generates the interpreter of compiled programs for one operator family,
+// with the t-norm _and for ALL_OF groups and rule strengths and the s-norm _or
+// for ANY_OF groups and the aggregation of the consequents. The operators are
+// inlined into the loops, so every family gets its own specialized code and
+// the default min/max family pays nothing for the others. Generates:
+//
+// executeOps_name(op, end, values, sum) executes the operations [op, end).
+// With sum set the strengths are summed into the consequents instead of
+// aggregated, for the weights of Takagi-Sugeno inference.
+//
+// ruleStrength_name(op, end, values, consequents) calculates the strength of
+// the rule [op, end), stopping as soon as it reaches zero. Every t-norm maps
+// zero to zero, so once an ALL_OF group or the rule strength reaches zero the
+// remaining antecedents can not change the result. consequents receives the
+// first ACCUMULATE operation of the rule, or end if the strength is zero.
+//
+// executeRule_name(op, end, values, sum) executes the rule [op, end), stopping
+// as soon as the rule can no longer fire.
+//
+// executeSparse_name(program, values, sum) executes the rules which can fire:
+// only the rules of gates with a non-zero membership value and the ungated
+// rules. A rule gated by several values may run more than once, which is only
+// harmless if accumulating is idempotent, see execute_name().
+//
+// execute_name(program, values, sum) executes all rules, sparse when the
+// program asks for it and the result does not change: the maximum is
+// idempotent, other aggregations and sums need an index listing every rule
+// once (see listsRulesOnce()). Otherwise every rule is executed once, each
+// still stopping early. FUZZY_WCET builds always run every operation.
+#define FUZZY_DEFINE_INTERPRETER(_name, _and, _or, _idempotent)                \
+    static inline void executeOps_##_name(                                     \
+        const FuzzyOp_t *op, const FuzzyOp_t *end, FuzzyReal_t *const *values, \
+        bool sum) {                                                            \
+        FuzzyReal_t strength = 1.0;                                            \
+        FuzzyReal_t group = 1.0;                                               \
+                                                                               \
+        for (; op < end; op++) {                                               \
+            switch (op->code) {                                                \
+            case FUZZY_OP_RULE:                                                \
+                strength = 1.0;                                                \
+                break;                                                         \
+            case FUZZY_OP_ALL_OF:                                              \
+                group = 1.0;                                                   \
+                break;                                                         \
+            case FUZZY_OP_ANY_OF:                                              \
+                group = 0.0;                                                   \
+                break;                                                         \
+            case FUZZY_OP_MIN:                                                 \
+                group = _and(group, values[op->set][op->value]);               \
+                break;                                                         \
+            case FUZZY_OP_MIN_NOT:                                             \
+                group = _and(group,                                            \
+                             FUZZY_REAL_C(1.0) - values[op->set][op->value]);  \
+                break;                                                         \
+            case FUZZY_OP_MAX:                                                 \
+                group = _or(group, values[op->set][op->value]);                \
+                break;                                                         \
+            case FUZZY_OP_MAX_NOT:                                             \
+                group = _or(group,                                             \
+                            FUZZY_REAL_C(1.0) - values[op->set][op->value]);   \
+                break;                                                         \
+            case FUZZY_OP_REDUCE:                                              \
+                strength = _and(strength, group);                              \
+                break;                                                         \
+            case FUZZY_OP_ACCUMULATE: {                                        \
+                FuzzyReal_t *output = &values[op->set][op->value];             \
+                *output = sum ? *output + strength : _or(*output, strength);   \
+                break;                                                         \
+            }                                                                  \
+            case FUZZY_OP_STORE:                                               \
+                values[op->set][op->value] = group;                            \
+                break;                                                         \
+            case FUZZY_OP_LOAD:                                                \
+                strength = _and(strength, values[op->set][op->value]);         \
+                break;                                                         \
+            default:                                                           \
+                break;                                                         \
+            }                                                                  \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    static inline FuzzyReal_t ruleStrength_##_name(                            \
+        const FuzzyOp_t *op, const FuzzyOp_t *end, FuzzyReal_t *const *values, \
+        const FuzzyOp_t **consequents) {                                       \
+        FuzzyReal_t strength = 1.0;                                            \
+        FuzzyReal_t group = 1.0;                                               \
+                                                                               \
+        *consequents = end;                                                    \
+        for (; op < end; op++) {                                               \
+            switch (op->code) {                                                \
+            case FUZZY_OP_ALL_OF:                                              \
+                group = 1.0;                                                   \
+                break;                                                         \
+            case FUZZY_OP_ANY_OF:                                              \
+                group = 0.0;                                                   \
+                break;                                                         \
+            case FUZZY_OP_MIN:                                                 \
+                group = _and(group, values[op->set][op->value]);               \
+                if (group == FUZZY_REAL_C(0.0)) {                              \
+                    return 0.0;                                                \
+                }                                                              \
+                break;                                                         \
+            case FUZZY_OP_MIN_NOT:                                             \
+                group = _and(group,                                            \
+                             FUZZY_REAL_C(1.0) - values[op->set][op->value]);  \
+                if (group == FUZZY_REAL_C(0.0)) {                              \
+                    return 0.0;                                                \
+                }                                                              \
+                break;                                                         \
+            case FUZZY_OP_MAX:                                                 \
+                group = _or(group, values[op->set][op->value]);                \
+                break;                                                         \
+            case FUZZY_OP_MAX_NOT:                                             \
+                group = _or(group,                                             \
+                            FUZZY_REAL_C(1.0) - values[op->set][op->value]);   \
+                break;                                                         \
+            case FUZZY_OP_REDUCE:                                              \
+                strength = _and(strength, group);                              \
+                if (strength == FUZZY_REAL_C(0.0)) {                           \
+                    return 0.0;                                                \
+                }                                                              \
+                break;                                                         \
+            case FUZZY_OP_LOAD:                                                \
+                strength = _and(strength, values[op->set][op->value]);         \
+                if (strength == FUZZY_REAL_C(0.0)) {                           \
+                    return 0.0;                                                \
+                }                                                              \
+                break;                                                         \
+            case FUZZY_OP_ACCUMULATE:                                          \
+                *consequents = op;                                             \
+                return strength;                                               \
+            default:                                                           \
+                break;                                                         \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        return strength;                                                       \
+    }                                                                          \
+                                                                               \
+    static inline void executeRule_##_name(const FuzzyOp_t *op,                \
+                                           const FuzzyOp_t *end,               \
+                                           FuzzyReal_t *const *values,         \
+                                           bool sum) {                         \
+        const FuzzyOp_t *consequents;                                          \
+        const FuzzyReal_t strength =                                           \
+            ruleStrength_##_name(op, end, values, &consequents);               \
+                                                                               \
+        for (op = consequents; op < end; op++) {                               \
+            if (op->code == FUZZY_OP_ACCUMULATE) {                             \
+                FuzzyReal_t *output = &values[op->set][op->value];             \
+                *output = sum ? *output + strength : _or(*output, strength);   \
+            }                                                                  \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    static inline void executeSparse_##_name(const FuzzyProgram_t *program,    \
+                                             FuzzyReal_t *const *values,       \
+                                             bool sum) {                       \
+        const FuzzyRuleIndex_t *index = &program->index;                       \
+        const FuzzyOp_t *ops = program->ops;                                   \
+                                                                               \
+        /* The shared groups in front of the first rule feed the gates */      \
+        executeOps_##_name(ops, ops + index->ruleStarts[0], values, sum);      \
+                                                                               \
+        for (int g = 0; g < index->numGates; g++) {                            \
+            const FuzzyGate_t *gate = &index->gates[g];                        \
+            if (!(values[gate->set][gate->value] > FUZZY_REAL_C(0.0))) {       \
+                continue;                                                      \
+            }                                                                  \
+            for (uint32_t i = gate->first; i < gate->first + gate->count;      \
+                 i++) {                                                        \
+                const uint32_t rule = index->gatedRules[i];                    \
+                executeRule_##_name(ops + index->ruleStarts[rule],             \
+                                    ops + index->ruleStarts[rule + 1], values, \
+                                    sum);                                      \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        for (int i = 0; i < index->numUngated; i++) {                          \
+            const uint32_t rule = index->ungatedRules[i];                      \
+            executeRule_##_name(ops + index->ruleStarts[rule],                 \
+                                ops + index->ruleStarts[rule + 1], values,     \
+                                sum);                                          \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    static inline void execute_##_name(const FuzzyProgram_t *program,          \
+                                       FuzzyReal_t *const *values, bool sum) { \
+        const FuzzyRuleIndex_t *index = &program->index;                       \
+        const FuzzyOp_t *ops = program->ops;                                   \
+                                                                               \
+        if (!FUZZY_SKIP_RULES || index->ruleStarts == NULL) {                  \
+            executeOps_##_name(ops, ops + program->numOps, values, sum);       \
+        } else if (program->sparse &&                                          \
+                   ((_idempotent && !sum) || listsRulesOnce(index))) {         \
+            executeSparse_##_name(program, values, sum);                       \
+        } else if (program->sparse) {                                          \
+            executeOps_##_name(ops, ops + index->ruleStarts[0], values, sum);  \
+            for (int rule = 0; rule < index->numRules; rule++) {               \
+                executeRule_##_name(ops + index->ruleStarts[rule],             \
+                                    ops + index->ruleStarts[rule + 1], values, \
+                                    sum);                                      \
+            }                                                                  \
+        } else {                                                               \
+            executeOps_##_name(ops, ops + program->numOps, values, sum);       \
+        }                                                                      \
+    }
+
+// Whether runs may skip rules and stop them early, FUZZY_WCET builds do the
+// same work for every input: program->numOps ops, a bound read from the
+// program at run time (see real.h)
+#ifdef FUZZY_WCET
+#define FUZZY_SKIP_RULES false
+#else
+#define FUZZY_SKIP_RULES true
+#endif
+
+/**
+ * Checks whether a rule index lists every rule exactly once, i.e. no rule is
+ * gated by several values. The rules of the gates are stored back to back.
+ */
+static bool listsRulesOnce(const FuzzyRuleIndex_t *index) {
+    uint32_t listed = (uint32_t)index->numUngated;
+    if (index->numGates > 0) {
+        const FuzzyGate_t *last = &index->gates[index->numGates - 1];
+        listed += last->first + last->count;
+    }
+    return listed == (uint32_t)index->numRules;
+}
+
+FUZZY_DEFINE_INTERPRETER(MinMax, fuzzyMin, fuzzyMax, true)
+FUZZY_DEFINE_INTERPRETER(Product, fuzzyProduct, fuzzyProbabilisticSum, false)
+FUZZY_DEFINE_INTERPRETER(Lukasiewicz, fuzzyLukasiewiczAnd, fuzzyLukasiewiczOr,
+                         false)
+FUZZY_DEFINE_INTERPRETER(Hamacher, fuzzyHamacherProduct, fuzzyHamacherSum,
+                         false)
+
+/**
+ * Calculates the strength of a single rule of a compiled program.
+ *
+ * The antecedents are combined with min and max, see
+ * FuzzyProgramRuleStrength() for the operators of a program.
+ *
+ * @param op The RULE operation of the rule.
+ * @param end One past the last operation of the rule.
+ * @param values The membership value arrays, indexed by the set of an
+ * operation.
+ * @return The strength of the rule, the minimum of its antecedent groups.
+ */
+FuzzyReal_t FuzzyRuleStrength(const FuzzyOp_t *op, const FuzzyOp_t *end,
+                              FuzzyReal_t *const *values) {
+    const FuzzyOp_t *consequents;
+    return ruleStrength_MinMax(op, end, values, &consequents);
+}
+
+/**
+ * Calculates the strength of a single rule with the operators of a program.
+ *
+ * @param program The compiled FuzzyProgram_t the rule belongs to.
+ * @param op The RULE operation of the rule.
+ * @param end One past the last operation of the rule.
+ * @param values The membership value arrays, indexed by the set of an
+ * operation.
+ * @return The strength of the rule, the t-norm of its antecedent groups.
+ */
+FuzzyReal_t FuzzyProgramRuleStrength(const FuzzyProgram_t *program,
+                                     const FuzzyOp_t *op, const FuzzyOp_t *end,
+                                     FuzzyReal_t *const *values) {
+    const FuzzyOp_t *consequents;
+    switch (program->norm) {
+    case FUZZY_NORM_PRODUCT:
+        return ruleStrength_Product(op, end, values, &consequents);
+    case FUZZY_NORM_LUKASIEWICZ:
+        return ruleStrength_Lukasiewicz(op, end, values, &consequents);
+    case FUZZY_NORM_HAMACHER:
+        return ruleStrength_Hamacher(op, end, values, &consequents);
+    default:
+        return ruleStrength_MinMax(op, end, values, &consequents);
+    }
+}
+
+/**
+ * Executes all rules of a program with the interpreter of its operators.
+ *
+ * @param program The program to execute.
+ * @param values The membership value arrays, indexed by the set of an
+ * operation.
+ * @param sum Sum the strengths into the consequents instead of aggregating
+ * them.
+ */
+static void execute(const FuzzyProgram_t *program, FuzzyReal_t *const *values,
+                    bool sum) {
+    switch (program->norm) {
+    case FUZZY_NORM_PRODUCT:
+        execute_Product(program, values, sum);
+        break;
+    case FUZZY_NORM_LUKASIEWICZ:
+        execute_Lukasiewicz(program, values, sum);
+        break;
+    case FUZZY_NORM_HAMACHER:
+        execute_Hamacher(program, values, sum);
+        break;
+    default:
+        execute_MinMax(program, values, sum);
+        break;
+    }
+}
+
+/**
+ * Runs a compiled program on the membership values of its sets.
+ *
+ * This is the compiled equivalent of fuzzyInference(): the outputs are reset,
+ * all rules are evaluated and the output sets are normalized.
+ *
+ * With FUZZY_NORMALIZE_PER_RULE the results are identical to fuzzyInference()
+ * on the rules the program was compiled from, which normalizes an output set
+ * once for every rule targeting it. With FUZZY_NORMALIZE_ONCE every output set
+ * is reset and normalized exactly once, removing the O(rules x set length)
+ * work. The two modes agree up to rounding: normalizing an already normalized
+ * set divides by a sum which is 1 within a few ulp, so each repeated pass may
+ * change the last bits of the values (and a sum of zero stays all zero). The
+ * once mode also resets the whole output set rather than only the targeted
+ * values, so values no rule targets no longer keep stale memberships from
+ * previous runs.
+ *
+ * With program->sparse set only the rules whose gate (see FuzzyRuleIndex_t)
+ * is non-zero are executed and each rule stops as soon as it can no longer
+ * fire. Skipped rules would only have accumulated zero, so for finite inputs
+ * the results are identical to the dense evaluation. A NaN input can yield
+ * NaN membership values, which do not count as active: sparse runs skip the
+ * rules they gate, while dense runs propagate the NaN into the outputs.
+ * FUZZY_WCET builds ignore program->sparse and always run every operation.
+ *
+ * The antecedents and consequents are combined with the operators of
+ * program->norm, min and max unless the program selects another family (see
+ * FuzzyNorm_e). Every family has its own interpreter, selected once per run.
+ *
+ * @param program The compiled FuzzyProgram_t to run.
+ */
+void FuzzyProgramRun(const FuzzyProgram_t *program) {
+    for (int i = 0; i < program->numSets; i++) {
+        program->values[i] = program->sets[i]->membershipValues;
+    }
+
+    FuzzyProgramRunValues(program, program->values);
+}
+
+/**
+ * Runs a compiled program on caller-provided membership values.
+ *
+ * This function works like FuzzyProgramRun() but reads and writes the
+ * membership values of set i of the program in values[i] instead of the sets
+ * themselves. The program is only read, so many threads can run the same
+ * program concurrently on their own values.
+ *
+ * @param program The compiled FuzzyProgram_t to run.
+ * @param values The membership value arrays, one per set of the program.
+ */
+void FuzzyProgramRunValues(const FuzzyProgram_t *program,
+                           FuzzyReal_t *const *values) {
+    FUZZY_STATS_BEGIN();
+    const FuzzyOp_t *end = program->ops + program->numOps;
+
+    if (program->normalization == FUZZY_NORMALIZE_PER_RULE) {
+        // Initialize the output memberships of the consequent to 0
+        for (const FuzzyOp_t *op = program->ops; op < end; op++) {
+            if (op->code == FUZZY_OP_ACCUMULATE) {
+                values[op->set][op->value] = 0.0;
+            }
+        }
+
+        execute(program, values, false);
+
+        // Normalize the output membership
+        for (const FuzzyOp_t *op = program->ops; op < end; op++) {
+            if (op->code == FUZZY_OP_ACCUMULATE) {
+                normalizeMembershipValues(values[op->set],
+                                          program->sets[op->set]->length);
+            }
+        }
+        FUZZY_STATS_END(FUZZY_STAGE_INFERENCE);
+        FUZZY_STATS_PROGRAM(program, values);
+        return;
+    }
+
+    // Initialize every output set to 0 once
+    for (int i = 0; i < program->numOutputs; i++) {
+        const int set = program->outputs[i];
+        for (int j = 0; j < program->sets[set]->length; j++) {
+            values[set][j] = 0.0;
+        }
+    }
+
+    execute(program, values, false);
+
+    // Normalize every output set once
+    for (int i = 0; i < program->numOutputs; i++) {
+        const int set = program->outputs[i];
+        normalizeMembershipValues(values[set], program->sets[set]->length);
+    }
+    FUZZY_STATS_END(FUZZY_STAGE_INFERENCE);
+    FUZZY_STATS_PROGRAM(program, values);
+}
+
+/**
+ * Runs a compiled program into the rule weights of Takagi-Sugeno inference.
+ *
+ * This function works like FuzzyProgramRunValues(), but every consequent
+ * receives the sum of the strengths of the rules targeting it instead of their
+ * maximum, and the output sets are reset but not normalized. The weighted
+ * average of the consequents with these weights equals the weighted average
+ * over the individual rules.
+ *
+ * A rule gated by several values (see FuzzyRuleIndex_t) may run once per
+ * gate, which would count it several times. Sparse programs whose index lists
+ * every rule once skip the rules which can not fire, other sparse programs
+ * run every rule, stopping each as soon as it can no longer fire. The rule
+ * strengths use the t-norm of program->norm.
+ *
+ * @param program The compiled FuzzyProgram_t to run.
+ * @param values The membership value arrays, one per set of the program.
+ */
+void FuzzyProgramRunWeights(const FuzzyProgram_t *program,
+                            FuzzyReal_t *const *values) {
+    FUZZY_STATS_BEGIN();
+    for (int i = 0; i < program->numOutputs; i++) {
+        const int set = program->outputs[i];
+        for (int j = 0; j < program->sets[set]->length; j++) {
+            values[set][j] = 0.0;
+        }
+    }
+
+    execute(program, values, true);
+    FUZZY_STATS_END(FUZZY_STAGE_INFERENCE);
+    FUZZY_STATS_PROGRAM(program, values);
+}
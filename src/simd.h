@@ -0,0 +1,223 @@
+/**
+ * @file simd.h
+ * @brief Fuzzy Logic SIMD abstraction (library internal).
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#ifndef FUZZY_SIMD_H
+#define FUZZY_SIMD_H
+#pragma once
+
+#include "real.h"
+
+#include <stddef.h>
+
+// The vector backend is picked at compile time from the target flags of the
+// compiler (e.g. -mavx2 or -march=native). Define FUZZY_NO_SIMD to force the
+// portable scalar fallback. Vectors hold FuzzyReal_t lanes, so a float build
+// processes twice as many values per instruction.
+#if !defined(FUZZY_NO_SIMD) && defined(__AVX2__)
+#define FUZZY_SIMD_AVX2
+#elif !defined(FUZZY_NO_SIMD) && defined(__SSE2__)
+#define FUZZY_SIMD_SSE2
+#elif !defined(FUZZY_NO_SIMD) && defined(__ARM_NEON) && defined(__aarch64__)
+#define FUZZY_SIMD_NEON
+#endif
+
+// Detect float builds, FUZZY_REAL is only known as a type to the compiler
+#define FUZZY_REAL_IS_FLOAT_float 1
+#define FUZZY_REAL_IS_FLOAT_(type) FUZZY_REAL_IS_FLOAT_##type
+#define FUZZY_REAL_IS_FLOAT(type) FUZZY_REAL_IS_FLOAT_(type)
+#if FUZZY_REAL_IS_FLOAT(FUZZY_REAL) == 1
+#define FUZZY_SIMD_FLOAT
+#endif
+
+#if defined(FUZZY_SIMD_AVX2) && defined(FUZZY_SIMD_FLOAT)
+#include <immintrin.h>
+
+#define FUZZY_SIMD_WIDTH 8
+typedef __m256 fuzzy_vec_t;
+typedef __m256 fuzzy_mask_t;
+
+#define FUZZY_VLOAD(p) _mm256_loadu_ps(p)
+#define FUZZY_VSTORE(p, v) _mm256_storeu_ps(p, v)
+#define FUZZY_VSET1(x) _mm256_set1_ps(x)
+#define FUZZY_VSUB(a, b) _mm256_sub_ps(a, b)
+#define FUZZY_VDIV(a, b) _mm256_div_ps(a, b)
+#define FUZZY_VADD(a, b) _mm256_add_ps(a, b)
+#define FUZZY_VMUL(a, b) _mm256_mul_ps(a, b)
+#define FUZZY_VLT(a, b) _mm256_cmp_ps(a, b, _CMP_LT_OQ)
+#define FUZZY_VLE(a, b) _mm256_cmp_ps(a, b, _CMP_LE_OQ)
+#define FUZZY_VGT(a, b) _mm256_cmp_ps(a, b, _CMP_GT_OQ)
+#define FUZZY_VGE(a, b) _mm256_cmp_ps(a, b, _CMP_GE_OQ)
+#define FUZZY_VEQ(a, b) _mm256_cmp_ps(a, b, _CMP_EQ_OQ)
+#define FUZZY_VOR(a, b) _mm256_or_ps(a, b)
+// select(m, t, f) picks t where the mask is set and f elsewhere
+#define FUZZY_VSELECT(m, t, f) _mm256_blendv_ps(f, t, m)
+
+#elif defined(FUZZY_SIMD_AVX2)
+#include <immintrin.h>
+
+#define FUZZY_SIMD_WIDTH 4
+typedef __m256d fuzzy_vec_t;
+typedef __m256d fuzzy_mask_t;
+
+#define FUZZY_VLOAD(p) _mm256_loadu_pd(p)
+#define FUZZY_VSTORE(p, v) _mm256_storeu_pd(p, v)
+#define FUZZY_VSET1(x) _mm256_set1_pd(x)
+#define FUZZY_VSUB(a, b) _mm256_sub_pd(a, b)
+#define FUZZY_VDIV(a, b) _mm256_div_pd(a, b)
+#define FUZZY_VADD(a, b) _mm256_add_pd(a, b)
+#define FUZZY_VMUL(a, b) _mm256_mul_pd(a, b)
+#define FUZZY_VLT(a, b) _mm256_cmp_pd(a, b, _CMP_LT_OQ)
+#define FUZZY_VLE(a, b) _mm256_cmp_pd(a, b, _CMP_LE_OQ)
+#define FUZZY_VGT(a, b) _mm256_cmp_pd(a, b, _CMP_GT_OQ)
+#define FUZZY_VGE(a, b) _mm256_cmp_pd(a, b, _CMP_GE_OQ)
+#define FUZZY_VEQ(a, b) _mm256_cmp_pd(a, b, _CMP_EQ_OQ)
+#define FUZZY_VOR(a, b) _mm256_or_pd(a, b)
+#define FUZZY_VSELECT(m, t, f) _mm256_blendv_pd(f, t, m)
+
+#elif defined(FUZZY_SIMD_SSE2) && defined(FUZZY_SIMD_FLOAT)
+#include <emmintrin.h>
+
+#define FUZZY_SIMD_WIDTH 4
+typedef __m128 fuzzy_vec_t;
+typedef __m128 fuzzy_mask_t;
+
+#define FUZZY_VLOAD(p) _mm_loadu_ps(p)
+#define FUZZY_VSTORE(p, v) _mm_storeu_ps(p, v)
+#define FUZZY_VSET1(x) _mm_set1_ps(x)
+#define FUZZY_VSUB(a, b) _mm_sub_ps(a, b)
+#define FUZZY_VDIV(a, b) _mm_div_ps(a, b)
+#define FUZZY_VADD(a, b) _mm_add_ps(a, b)
+#define FUZZY_VMUL(a, b) _mm_mul_ps(a, b)
+#define FUZZY_VLT(a, b) _mm_cmplt_ps(a, b)
+#define FUZZY_VLE(a, b) _mm_cmple_ps(a, b)
+#define FUZZY_VGT(a, b) _mm_cmpgt_ps(a, b)
+#define FUZZY_VGE(a, b) _mm_cmpge_ps(a, b)
+#define FUZZY_VEQ(a, b) _mm_cmpeq_ps(a, b)
+#define FUZZY_VOR(a, b) _mm_or_ps(a, b)
+#define FUZZY_VSELECT(m, t, f)                                                 \
+    _mm_or_ps(_mm_and_ps(m, t), _mm_andnot_ps(m, f))
+
+#elif defined(FUZZY_SIMD_SSE2)
+#include <emmintrin.h>
+
+#define FUZZY_SIMD_WIDTH 2
+typedef __m128d fuzzy_vec_t;
+typedef __m128d fuzzy_mask_t;
+
+#define FUZZY_VLOAD(p) _mm_loadu_pd(p)
+#define FUZZY_VSTORE(p, v) _mm_storeu_pd(p, v)
+#define FUZZY_VSET1(x) _mm_set1_pd(x)
+#define FUZZY_VSUB(a, b) _mm_sub_pd(a, b)
+#define FUZZY_VDIV(a, b) _mm_div_pd(a, b)
+#define FUZZY_VADD(a, b) _mm_add_pd(a, b)
+#define FUZZY_VMUL(a, b) _mm_mul_pd(a, b)
+#define FUZZY_VLT(a, b) _mm_cmplt_pd(a, b)
+#define FUZZY_VLE(a, b) _mm_cmple_pd(a, b)
+#define FUZZY_VGT(a, b) _mm_cmpgt_pd(a, b)
+#define FUZZY_VGE(a, b) _mm_cmpge_pd(a, b)
+#define FUZZY_VEQ(a, b) _mm_cmpeq_pd(a, b)
+#define FUZZY_VOR(a, b) _mm_or_pd(a, b)
+#define FUZZY_VSELECT(m, t, f)                                                 \
+    _mm_or_pd(_mm_and_pd(m, t), _mm_andnot_pd(m, f))
+
+#elif defined(FUZZY_SIMD_NEON) && defined(FUZZY_SIMD_FLOAT)
+#include <arm_neon.h>
+
+#define FUZZY_SIMD_WIDTH 4
+typedef float32x4_t fuzzy_vec_t;
+typedef uint32x4_t fuzzy_mask_t;
+
+#define FUZZY_VLOAD(p) vld1q_f32(p)
+#define FUZZY_VSTORE(p, v) vst1q_f32(p, v)
+#define FUZZY_VSET1(x) vdupq_n_f32(x)
+#define FUZZY_VSUB(a, b) vsubq_f32(a, b)
+#define FUZZY_VDIV(a, b) vdivq_f32(a, b)
+#define FUZZY_VADD(a, b) vaddq_f32(a, b)
+#define FUZZY_VMUL(a, b) vmulq_f32(a, b)
+#define FUZZY_VLT(a, b) vcltq_f32(a, b)
+#define FUZZY_VLE(a, b) vcleq_f32(a, b)
+#define FUZZY_VGT(a, b) vcgtq_f32(a, b)
+#define FUZZY_VGE(a, b) vcgeq_f32(a, b)
+#define FUZZY_VEQ(a, b) vceqq_f32(a, b)
+#define FUZZY_VOR(a, b) vorrq_u32(a, b)
+#define FUZZY_VSELECT(m, t, f) vbslq_f32(m, t, f)
+
+#elif defined(FUZZY_SIMD_NEON)
+#include <arm_neon.h>
+
+#define FUZZY_SIMD_WIDTH 2
+typedef float64x2_t fuzzy_vec_t;
+typedef uint64x2_t fuzzy_mask_t;
+
+#define FUZZY_VLOAD(p) vld1q_f64(p)
+#define FUZZY_VSTORE(p, v) vst1q_f64(p, v)
+#define FUZZY_VSET1(x) vdupq_n_f64(x)
+#define FUZZY_VSUB(a, b) vsubq_f64(a, b)
+#define FUZZY_VDIV(a, b) vdivq_f64(a, b)
+#define FUZZY_VADD(a, b) vaddq_f64(a, b)
+#define FUZZY_VMUL(a, b) vmulq_f64(a, b)
+#define FUZZY_VLT(a, b) vcltq_f64(a, b)
+#define FUZZY_VLE(a, b) vcleq_f64(a, b)
+#define FUZZY_VGT(a, b) vcgtq_f64(a, b)
+#define FUZZY_VGE(a, b) vcgeq_f64(a, b)
+#define FUZZY_VEQ(a, b) vceqq_f64(a, b)
+#define FUZZY_VOR(a, b) vorrq_u64(a, b)
+#define FUZZY_VSELECT(m, t, f) vbslq_f64(m, t, f)
+
+#else
+#define FUZZY_SIMD_WIDTH 1
+#endif
+
+#if FUZZY_SIMD_WIDTH > 1
+// Stores a vector to out[0], out[stride], out[2 * stride], ...
+static inline void fuzzyStoreStrided(FuzzyReal_t *out, size_t stride,
+                                     fuzzy_vec_t v) {
+    if (stride == 1) {
+        FUZZY_VSTORE(out, v);
+    } else {
+        FuzzyReal_t lanes[FUZZY_SIMD_WIDTH];
+        FUZZY_VSTORE(lanes, v);
+        for (int i = 0; i < FUZZY_SIMD_WIDTH; i++) {
+            out[i * stride] = lanes[i];
+        }
+    }
+}
+#endif
+
+// Calculates the dot product of n values of a and b. Every lane sums its own
+// terms, so the order of additions depends on FUZZY_SIMD_WIDTH.
+static inline FuzzyReal_t fuzzyDot(const FuzzyReal_t *a, const FuzzyReal_t *b,
+                                   int n) {
+    FuzzyReal_t sum = 0.0;
+    int i = 0;
+
+#if FUZZY_SIMD_WIDTH > 1
+    if (n >= FUZZY_SIMD_WIDTH) {
+        fuzzy_vec_t sums = FUZZY_VSET1(0.0);
+        for (; i + FUZZY_SIMD_WIDTH <= n; i += FUZZY_SIMD_WIDTH) {
+            sums = FUZZY_VADD(
+                sums, FUZZY_VMUL(FUZZY_VLOAD(a + i), FUZZY_VLOAD(b + i)));
+        }
+        FuzzyReal_t lanes[FUZZY_SIMD_WIDTH];
+        FUZZY_VSTORE(lanes, sums);
+        for (int j = 0; j < FUZZY_SIMD_WIDTH; j++) {
+            sum += lanes[j];
+        }
+    }
+#endif
+
+    for (; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+#endif
@@ -0,0 +1,256 @@
+/**
+ * @file stats.c
+ * @brief Fuzzy Logic instrumentation implementation.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "stats.h"
+
+#ifdef FUZZY_ENABLE_STATS
+
+#include <stdio.h>
+#include <string.h>
+
+// Every thread records into its own statistics, so the hooks need no locking
+// and batch evaluation threads do not disturb each other. FuzzyEvaluateBatch()
+// and FuzzySweep() merge the statistics of their worker threads into those of
+// the calling thread, see FuzzyStatsMerge().
+static _Thread_local FuzzyStats_t threadStats;
+
+/**
+ * Returns the statistics recorded by the calling thread.
+ *
+ * @return The FuzzyStats_t of the calling thread.
+ */
+FuzzyStats_t *FuzzyStatsGet(void) { return &threadStats; }
+
+/**
+ * Clears the statistics recorded by the calling thread.
+ */
+void FuzzyStatsReset(void) { memset(&threadStats, 0, sizeof(threadStats)); }
+
+/**
+ * Finds the entry of a set, adding an empty one for sets not recorded yet.
+ *
+ * @return The entry, NULL if FUZZY_STATS_MAX_SETS sets are recorded already.
+ */
+static FuzzySetStats_t *findSet(FuzzyStats_t *stats, const FuzzySet_t *set) {
+    for (int i = 0; i < stats->numSets; i++) {
+        if (stats->sets[i].set == set) {
+            return &stats->sets[i];
+        }
+    }
+    if (stats->numSets == FUZZY_STATS_MAX_SETS) {
+        return NULL;
+    }
+
+    FuzzySetStats_t *entry = &stats->sets[stats->numSets++];
+    memset(entry, 0, sizeof(*entry));
+    entry->set = set;
+    return entry;
+}
+
+/**
+ * Adds the statistics recorded by another thread.
+ *
+ * The stage calls and ticks, rule counters and set activations are summed,
+ * worst case ticks take the maximum. Rules are matched by their number and
+ * sets by their address, sets past FUZZY_STATS_MAX_SETS are dropped.
+ *
+ * @param stats The FuzzyStats_t to add to, e.g. FuzzyStatsGet().
+ * @param other The FuzzyStats_t to add, must not be stats.
+ */
+void FuzzyStatsMerge(FuzzyStats_t *stats, const FuzzyStats_t *other) {
+    for (int i = 0; i < FUZZY_STAGE_COUNT; i++) {
+        FuzzyStageStats_t *entry = &stats->stages[i];
+        const FuzzyStageStats_t *add = &other->stages[i];
+        entry->calls += add->calls;
+        entry->ticks += add->ticks;
+        if (add->maxTicks > entry->maxTicks) {
+            entry->maxTicks = add->maxTicks;
+        }
+    }
+
+    for (int r = 0; r < other->numRules; r++) {
+        FuzzyRuleStats_t *entry = &stats->rules[r];
+        const FuzzyRuleStats_t *add = &other->rules[r];
+        entry->evaluations += add->evaluations;
+        entry->fires += add->fires;
+        for (int b = 0; b < FUZZY_STATS_BINS; b++) {
+            entry->histogram[b] += add->histogram[b];
+        }
+    }
+    if (other->numRules > stats->numRules) {
+        stats->numRules = other->numRules;
+    }
+
+    for (int s = 0; s < other->numSets; s++) {
+        const FuzzySetStats_t *add = &other->sets[s];
+        FuzzySetStats_t *entry = findSet(stats, add->set);
+        if (entry == NULL) {
+            continue;
+        }
+
+        entry->classifications += add->classifications;
+        for (int i = 0; i < FUZZY_STATS_MAX_TERMS; i++) {
+            entry->activations[i] += add->activations[i];
+        }
+    }
+}
+
+/**
+ * Records one pass through a stage.
+ *
+ * @param stage The stage.
+ * @param ticks The duration of the pass.
+ */
+void fuzzyStatsStage(FuzzyStage_e stage, uint64_t ticks) {
+    FuzzyStageStats_t *entry = &threadStats.stages[stage];
+    entry->calls++;
+    entry->ticks += ticks;
+    if (ticks > entry->maxTicks) {
+        entry->maxTicks = ticks;
+    }
+}
+
+/**
+ * Records the firing strength of a rule.
+ *
+ * @param rule The index of the rule.
+ * @param strength The firing strength.
+ */
+void fuzzyStatsRule(int rule, FuzzyReal_t strength) {
+    if (rule >= FUZZY_STATS_MAX_RULES) {
+        return;
+    }
+
+    FuzzyRuleStats_t *entry = &threadStats.rules[rule];
+    if (rule >= threadStats.numRules) {
+        threadStats.numRules = rule + 1;
+    }
+    entry->evaluations++;
+    if (strength > FUZZY_REAL_C(0.0)) {
+        int bin = (int)(strength * FUZZY_STATS_BINS);
+        bin = bin >= FUZZY_STATS_BINS ? FUZZY_STATS_BINS - 1 : bin;
+        entry->fires++;
+        entry->histogram[bin]++;
+    }
+}
+
+/**
+ * Records the membership functions of a set active after a classification.
+ *
+ * @param set The classified set.
+ * @param values The membership values of the set.
+ */
+void fuzzyStatsSet(const FuzzySet_t *set, const FuzzyReal_t *values) {
+    FuzzySetStats_t *entry = findSet(&threadStats, set);
+    if (entry == NULL) {
+        return;
+    }
+
+    entry->classifications++;
+    const int length = set->length < FUZZY_STATS_MAX_TERMS
+                           ? set->length
+                           : FUZZY_STATS_MAX_TERMS;
+    for (int i = 0; i < length; i++) {
+        entry->activations[i] += values[i] > FUZZY_REAL_C(0.0);
+    }
+}
+
+/**
+ * Records the firing strengths of all rules of a program.
+ *
+ * The executor skips rules and stops them early, so the strengths are
+ * recalculated here, outside of the timed inference stage.
+ *
+ * @param program The program which just ran.
+ * @param values The membership value arrays the program ran on.
+ */
+void fuzzyStatsProgram(const FuzzyProgram_t *program,
+                       FuzzyReal_t *const *values) {
+    const FuzzyOp_t *end = program->ops + program->numOps;
+    const FuzzyOp_t *op = program->ops;
+    int rule = 0;
+
+    // Skip the prologue of shared groups
+    while (op < end && op->code != FUZZY_OP_RULE) {
+        op++;
+    }
+    for (; op < end; rule++) {
+        const FuzzyOp_t *next = op + 1;
+        while (next < end && next->code != FUZZY_OP_RULE) {
+            next++;
+        }
+        fuzzyStatsRule(rule, FuzzyProgramRuleStrength(program, op, next, values));
+        op = next;
+    }
+}
+
+/**
+ * Prints statistics.
+ *
+ * The stage timings are followed by the fire count and strength histogram of
+ * every rule recorded and the activation counts of every set recorded.
+ *
+ * @param stats The FuzzyStats_t to print, see FuzzyStatsGet().
+ * @param ruleLabels Names of the rules, may be NULL.
+ */
+void printStats(const FuzzyStats_t *stats, const char *const *ruleLabels) {
+    static const char *stageLabels[] = {"classify", "inference", "defuzzify"};
+
+    printf("stage\t\t calls\t\t mean\t\t max\n");
+    for (int i = 0; i < FUZZY_STAGE_COUNT; i++) {
+        const FuzzyStageStats_t *stage = &stats->stages[i];
+        const double mean =
+            stage->calls ? (double)stage->ticks / (double)stage->calls : 0.0;
+        printf("%-10s\t %10llu\t %10.1f\t %10llu\n", stageLabels[i],
+               (unsigned long long)stage->calls, mean,
+               (unsigned long long)stage->maxTicks);
+    }
+    printf("\n");
+
+    printf("rule\t\t fires\t\t strength histogram (0, 1]\n");
+    for (int r = 0; r < stats->numRules; r++) {
+        const FuzzyRuleStats_t *rule = &stats->rules[r];
+        if (ruleLabels != NULL) {
+            printf("%-10s\t", ruleLabels[r]);
+        } else {
+            printf("%-10d\t", r + 1);
+        }
+        printf(" %5.1f %%\t [", rule->evaluations
+                                    ? 100.0 * (double)rule->fires /
+                                          (double)rule->evaluations
+                                    : 0.0);
+        for (int b = 0; b < FUZZY_STATS_BINS; b++) {
+            printf(b ? " %llu" : "%llu",
+                   (unsigned long long)rule->histogram[b]);
+        }
+        printf("]\n");
+    }
+    printf("\n");
+
+    printf("set\t\t active %% per membership function\n");
+    for (int s = 0; s < stats->numSets; s++) {
+        const FuzzySetStats_t *set = &stats->sets[s];
+        const int length = set->set->length < FUZZY_STATS_MAX_TERMS
+                               ? set->set->length
+                               : FUZZY_STATS_MAX_TERMS;
+        printf("%-10d\t [", s);
+        for (int i = 0; i < length; i++) {
+            printf(i ? " %5.1f" : "%5.1f",
+                   set->classifications ? 100.0 * (double)set->activations[i] /
+                                              (double)set->classifications
+                                        : 0.0);
+        }
+        printf("]\n");
+    }
+    printf("\n");
+}
+
+#endif
@@ -0,0 +1,419 @@
+/**
+ * @file stream.c
+ * @brief Fuzzy Logic streaming evaluation implementation.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "stream.h"
+
+#include "classifier.h"
+#include "membership_function.h"
+#include "model.h"
+#include "program.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Initializes a FuzzyRing_t struct.
+ *
+ * @param ring The FuzzyRing_t struct to initialize.
+ * @param width The number of values per frame.
+ * @param capacity The number of frames, rounded up to a power of two.
+ * @return false if allocating the frames failed.
+ */
+bool FuzzyRingInit(FuzzyRing_t *ring, int width, size_t capacity) {
+    size_t frames = 1;
+    while (frames < capacity) {
+        frames <<= 1;
+    }
+
+    ring->frames = (FuzzyReal_t *)malloc(frames * width * sizeof(FuzzyReal_t));
+    if (ring->frames == NULL) {
+        return false;
+    }
+    ring->width = width;
+    ring->capacity = frames;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    return true;
+}
+
+/**
+ * Frees the memory allocated for a FuzzyRing_t struct.
+ *
+ * @param ring The FuzzyRing_t struct to free.
+ */
+void FuzzyRingFree(FuzzyRing_t *ring) { free(ring->frames); }
+
+/**
+ * Returns the number of frames in a ring.
+ *
+ * The count is exact when called by the producer or the consumer while the
+ * other side is idle, otherwise it is a snapshot.
+ *
+ * @param ring The FuzzyRing_t to inspect.
+ * @return The number of frames pushed and not yet popped.
+ */
+size_t FuzzyRingCount(FuzzyRing_t *ring) {
+    const size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    const size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    return head - tail;
+}
+
+/**
+ * Returns the contiguous run of frames the consumer can read.
+ *
+ * The frames stay valid until they are released with FuzzyRingConsume().
+ * Runs end at the end of the storage, so a wrapped ring is read in two runs.
+ * Must only be called by the consumer.
+ *
+ * @param ring The FuzzyRing_t to read.
+ * @param frames Receives the first readable frame.
+ * @return The number of readable frames.
+ */
+size_t FuzzyRingPeek(FuzzyRing_t *ring, const FuzzyReal_t **frames) {
+    const size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    const size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    const size_t first = tail & (ring->capacity - 1);
+    const size_t run = ring->capacity - first;
+    const size_t count = head - tail;
+
+    *frames = ring->frames + first * ring->width;
+    return count < run ? count : run;
+}
+
+/**
+ * Hands read frames back to the producer.
+ *
+ * @param ring The FuzzyRing_t read.
+ * @param count The number of frames, at most the count of the last
+ * FuzzyRingPeek().
+ */
+void FuzzyRingConsume(FuzzyRing_t *ring, size_t count) {
+    const size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+}
+
+/**
+ * Returns the contiguous run of free frames the producer can write.
+ *
+ * The frames are published with FuzzyRingCommit(). Must only be called by
+ * the producer.
+ *
+ * @param ring The FuzzyRing_t to write.
+ * @param frames Receives the first writable frame.
+ * @return The number of writable frames.
+ */
+size_t FuzzyRingReserve(FuzzyRing_t *ring, FuzzyReal_t **frames) {
+    const size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    const size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    const size_t first = head & (ring->capacity - 1);
+    const size_t run = ring->capacity - first;
+    const size_t count = ring->capacity - (head - tail);
+
+    *frames = ring->frames + first * ring->width;
+    return count < run ? count : run;
+}
+
+/**
+ * Publishes written frames to the consumer.
+ *
+ * @param ring The FuzzyRing_t written.
+ * @param count The number of frames, at most the count of the last
+ * FuzzyRingReserve().
+ */
+void FuzzyRingCommit(FuzzyRing_t *ring, size_t count) {
+    const size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    atomic_store_explicit(&ring->head, head + count, memory_order_release);
+}
+
+/**
+ * Copies frames into a ring.
+ *
+ * @param ring The FuzzyRing_t to write.
+ * @param frames The frames, ring->width values each.
+ * @param count The number of frames.
+ * @return The number of frames copied, less than count if the ring is full.
+ */
+size_t FuzzyRingPush(FuzzyRing_t *ring, const FuzzyReal_t *frames,
+                     size_t count) {
+    size_t pushed = 0;
+    // Two runs at most, before and after the end of the storage
+    for (int run = 0; run < 2 && pushed < count; run++) {
+        FuzzyReal_t *writable;
+        size_t n = FuzzyRingReserve(ring, &writable);
+        if (n > count - pushed) {
+            n = count - pushed;
+        }
+        memcpy(writable, frames + pushed * ring->width,
+               n * ring->width * sizeof(FuzzyReal_t));
+        FuzzyRingCommit(ring, n);
+        pushed += n;
+    }
+    return pushed;
+}
+
+/**
+ * Copies frames out of a ring.
+ *
+ * @param ring The FuzzyRing_t to read.
+ * @param frames Receives the frames, ring->width values each.
+ * @param count The maximum number of frames.
+ * @return The number of frames copied, less than count if the ring ran empty.
+ */
+size_t FuzzyRingPop(FuzzyRing_t *ring, FuzzyReal_t *frames, size_t count) {
+    size_t popped = 0;
+    for (int run = 0; run < 2 && popped < count; run++) {
+        const FuzzyReal_t *used;
+        size_t n = FuzzyRingPeek(ring, &used);
+        if (n > count - popped) {
+            n = count - popped;
+        }
+        memcpy(frames + popped * ring->width, used,
+               n * ring->width * sizeof(FuzzyReal_t));
+        FuzzyRingConsume(ring, n);
+        popped += n;
+    }
+    return popped;
+}
+
+/**
+ * Initializes a FuzzyStream_t struct.
+ *
+ * The stream evaluates the model on micro-batches of batchSize frames. Each
+ * input of the model is gathered into one column for the whole batch and
+ * classified with the batch membership kernels, then the rules are run and
+ * the outputs defuzzified frame by frame. The states of a batch are sized
+ * to stay in the L1 cache for small models with the default batch size.
+ *
+ * @param stream The FuzzyStream_t struct to initialize.
+ * @param model The FuzzyModel_t to evaluate, must outlive the stream.
+ * @param inputs The source of every model input, copied.
+ * @param ranges The output mapping of every model output, copied, or NULL to
+ * output the crisp values.
+ * @param batchSize The number of frames per micro-batch, 0 for
+ * FUZZY_STREAM_BATCH.
+ * @return false if allocating failed.
+ */
+bool FuzzyStreamInit(FuzzyStream_t *stream, const FuzzyModel_t *model,
+                     const FuzzyStreamInput_t *inputs,
+                     const FuzzyRange_t *ranges, int batchSize) {
+    const FuzzyProgram_t *program = &model->program;
+    if (batchSize <= 0) {
+        batchSize = FUZZY_STREAM_BATCH;
+    }
+
+    stream->model = model;
+    stream->batchSize = batchSize;
+    stream->inputs = (FuzzyStreamInput_t *)malloc(model->numInputs *
+                                                  sizeof(FuzzyStreamInput_t));
+    stream->ranges =
+        ranges != NULL
+            ? (FuzzyRange_t *)malloc(model->numOutputs * sizeof(FuzzyRange_t))
+            : NULL;
+    stream->previous =
+        (FuzzyReal_t *)malloc(model->numInputs * sizeof(FuzzyReal_t));
+    stream->column = (FuzzyReal_t *)malloc(batchSize * sizeof(FuzzyReal_t));
+    stream->crisp = (FuzzyReal_t *)malloc((size_t)batchSize * model->numInputs *
+                                          sizeof(FuzzyReal_t));
+    stream->buffer = (FuzzyReal_t *)calloc((size_t)batchSize * model->numValues,
+                                           sizeof(FuzzyReal_t));
+    stream->values = (FuzzyReal_t **)malloc((size_t)batchSize *
+                                            program->numSets *
+                                            sizeof(FuzzyReal_t *));
+    if (stream->inputs == NULL || (ranges != NULL && stream->ranges == NULL) ||
+        stream->previous == NULL || stream->column == NULL ||
+        (model->numInputs > 0 && stream->crisp == NULL) ||
+        stream->buffer == NULL || stream->values == NULL) {
+        FuzzyStreamFree(stream);
+        return false;
+    }
+
+    memcpy(stream->inputs, inputs,
+           model->numInputs * sizeof(FuzzyStreamInput_t));
+    if (ranges != NULL) {
+        memcpy(stream->ranges, ranges,
+               model->numOutputs * sizeof(FuzzyRange_t));
+    }
+
+    // One state per frame of the batch, laid out like FuzzyStateInit()
+    FuzzyReal_t *values = stream->buffer;
+    for (int k = 0; k < batchSize; k++) {
+        for (int i = 0; i < program->numSets; i++) {
+            stream->values[k * program->numSets + i] = values;
+            values += program->sets[i]->length;
+        }
+    }
+
+    FuzzyStreamReset(stream);
+    return true;
+}
+
+/**
+ * Frees the memory allocated for a FuzzyStream_t struct.
+ *
+ * @param stream The FuzzyStream_t struct to free.
+ */
+void FuzzyStreamFree(FuzzyStream_t *stream) {
+    free(stream->inputs);
+    free(stream->ranges);
+    free(stream->previous);
+    free(stream->column);
+    free(stream->crisp);
+    free(stream->buffer);
+    free(stream->values);
+}
+
+/**
+ * Starts a new series, so the next frame has no previous frame.
+ *
+ * @param stream The FuzzyStream_t to reset.
+ */
+void FuzzyStreamReset(FuzzyStream_t *stream) {
+    stream->primed = false;
+    stream->frames = 0;
+}
+
+/**
+ * Gathers one model input of a batch of frames into the column and the rows
+ * of crisp inputs.
+ *
+ * A FUZZY_STREAM_DELTA input is zero on the first frame of a series.
+ */
+static void gatherInput(FuzzyStream_t *stream, int input,
+                        const FuzzyReal_t *frames, int width, size_t n) {
+    const FuzzyStreamInput_t *source = &stream->inputs[input];
+    FuzzyReal_t *column = stream->column;
+
+    const int numInputs = stream->model->numInputs;
+
+    if (source->source == FUZZY_STREAM_CHANNEL) {
+        for (size_t k = 0; k < n; k++) {
+            column[k] = frames[k * width + source->channel];
+        }
+    } else {
+        FuzzyReal_t previous = stream->primed ? stream->previous[input]
+                                              : frames[source->channel];
+        for (size_t k = 0; k < n; k++) {
+            const FuzzyReal_t x = frames[k * width + source->channel];
+            column[k] = (x - previous) * source->scale;
+            previous = x;
+        }
+        stream->previous[input] = previous;
+    }
+
+    for (size_t k = 0; k < n; k++) {
+        stream->crisp[k * numInputs + input] = column[k];
+    }
+}
+
+/**
+ * Maps a crisp output like the range of the stream, see FuzzyRange_t.
+ */
+static FuzzyReal_t mapRange(const FuzzyRange_t *range, FuzzyReal_t value) {
+    const FuzzyReal_t mapped = (value - range->inMin) *
+                                   (range->outMax - range->outMin) /
+                                   (range->inMax - range->inMin) +
+                               range->outMin;
+    return mapped > range->outMin
+               ? (mapped < range->outMax ? mapped : range->outMax)
+               : range->outMin;
+}
+
+/**
+ * Evaluates one micro-batch of n frames into n output frames.
+ */
+static void processBatch(FuzzyStream_t *stream, const FuzzyReal_t *frames,
+                         int width, FuzzyReal_t *outputs, size_t n) {
+    const FuzzyModel_t *model = stream->model;
+    const FuzzyProgram_t *program = &model->program;
+    const int numSets = program->numSets;
+
+    // Classify every input of the whole batch at once. The batch kernels equal
+    // the scalar membership functions, but sets with a partition index or a
+    // layout evaluate differently and are classified frame by frame like
+    // FuzzyEvaluate() does.
+    for (int i = 0; i < model->numInputs; i++) {
+        const FuzzySet_t *set = program->sets[i];
+        gatherInput(stream, i, frames, width, n);
+        if (set->partition != NULL || set->layout != NULL) {
+            for (size_t k = 0; k < n; k++) {
+                FuzzyClassifierValues(stream->column[k], set,
+                                      stream->values[k * numSets + i]);
+            }
+            continue;
+        }
+        for (int j = 0; j < set->length; j++) {
+            membershipFunctionBatch(stream->column, n,
+                                    set->membershipFunctions[j],
+                                    stream->values[i] + j,
+                                    (size_t)model->numValues);
+        }
+    }
+    stream->primed = true;
+
+    // Perform fuzzy inference and defuzzify frame by frame
+    for (size_t k = 0; k < n; k++) {
+        FuzzyReal_t **values = stream->values + k * numSets;
+        FuzzyReal_t *output = outputs + k * model->numOutputs;
+
+        FuzzyModelInfer(model, values, stream->crisp + k * model->numInputs,
+                        output);
+        if (stream->ranges != NULL) {
+            for (int i = 0; i < model->numOutputs; i++) {
+                output[i] = mapRange(&stream->ranges[i], output[i]);
+            }
+        }
+    }
+}
+
+/**
+ * Evaluates the frames of an input ring into an output ring.
+ *
+ * Every input frame yields one output frame of model->numOutputs values, the
+ * output ring must have that width. The channels of the inputs must be less
+ * than the width of the input ring. This function takes the place of the
+ * consumer of the input ring and the producer of the output ring and returns
+ * once the input ring is empty or the output ring full, so it can run in its
+ * own thread between a producer and a consumer thread. The outputs equal
+ * those of FuzzyEvaluate() on the inputs of every frame.
+ *
+ * @param stream The FuzzyStream_t to evaluate with.
+ * @param input The ring of input frames.
+ * @param output The ring of output frames.
+ * @return The number of frames processed.
+ */
+size_t FuzzyStreamProcess(FuzzyStream_t *stream, FuzzyRing_t *input,
+                          FuzzyRing_t *output) {
+    size_t processed = 0;
+
+    for (;;) {
+        const FuzzyReal_t *frames;
+        FuzzyReal_t *outputs;
+        size_t n = FuzzyRingPeek(input, &frames);
+        const size_t room = FuzzyRingReserve(output, &outputs);
+        if (n > room) {
+            n = room;
+        }
+        if (n > (size_t)stream->batchSize) {
+            n = (size_t)stream->batchSize;
+        }
+        if (n == 0) {
+            break;
+        }
+
+        processBatch(stream, frames, input->width, outputs, n);
+        FuzzyRingConsume(input, n);
+        FuzzyRingCommit(output, n);
+        processed += n;
+    }
+
+    stream->frames += processed;
+    return processed;
+}
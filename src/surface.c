@@ -0,0 +1,249 @@
+/**
+ * @file surface.c
+ * @brief Fuzzy Logic precomputed control surface implementation.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "surface.h"
+
+#include "batch.h"
+#include "model.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * Bakes a model into a FuzzySurface_t.
+ *
+ * The complete classifier, inference and defuzzifier pipeline is evaluated
+ * on every point of the grid spanned by the axes, one axis per model input.
+ * Every axis needs at least two points and max > min, and the model at most
+ * FUZZY_SURFACE_MAX_INPUTS inputs. The surface must be released with
+ * FuzzySurfaceFree(), also if baking failed.
+ *
+ * @param surface The FuzzySurface_t struct to initialize.
+ * @param model The FuzzyModel_t to bake.
+ * @param axes The grid axes, one per input of the model.
+ * @param threads The number of threads to bake with, see FuzzySweep().
+ * @return false if the grid is invalid or too large, or allocating failed.
+ * The surface is then empty and FuzzySurfaceEval() writes no outputs.
+ */
+bool FuzzyBakeSurface(FuzzySurface_t *surface, const FuzzyModel_t *model,
+                      const FuzzyGridAxis_t *axes, int threads) {
+    const int numInputs = model->numInputs;
+    const int numOutputs = model->numOutputs;
+
+    surface->numInputs = 0;
+    surface->numOutputs = 0;
+    surface->values = NULL;
+    if (numInputs < 0 || numInputs > FUZZY_SURFACE_MAX_INPUTS ||
+        numOutputs < 0) {
+        return false;
+    }
+
+    // Check the axes and the size of the grid before writing anything
+    size_t numPoints = 1;
+    for (int k = 0; k < numInputs; k++) {
+        if (axes[k].points < 2 || !(axes[k].max > axes[k].min) ||
+            !isfinite(axes[k].max - axes[k].min)) {
+            return false;
+        }
+        if (numPoints > SIZE_MAX / (size_t)axes[k].points) {
+            return false;
+        }
+        numPoints *= (size_t)axes[k].points;
+    }
+    if (numOutputs > 0 &&
+        numPoints > SIZE_MAX / sizeof(FuzzyReal_t) / (size_t)numOutputs - 1) {
+        return false;
+    }
+
+    FuzzyReal_t *values =
+        (FuzzyReal_t *)malloc(numPoints * numOutputs * sizeof(FuzzyReal_t) + 1);
+    if (values == NULL) {
+        return false;
+    }
+    // The surface stores the outputs in the order FuzzySweep() writes them
+    if (!FuzzySweep(model, axes, values, threads)) {
+        free(values);
+        return false;
+    }
+
+    size_t stride = numOutputs;
+    for (int k = numInputs - 1; k >= 0; k--) {
+        surface->axes[k] = axes[k];
+        surface->scales[k] =
+            (axes[k].points - 1) / (axes[k].max - axes[k].min);
+        surface->strides[k] = stride;
+        stride *= (size_t)axes[k].points;
+    }
+
+    surface->numInputs = numInputs;
+    surface->numOutputs = numOutputs;
+    surface->values = values;
+    return true;
+}
+
+/**
+ * Frees the memory allocated for a FuzzySurface_t struct.
+ *
+ * @param surface The FuzzySurface_t struct to free.
+ */
+void FuzzySurfaceFree(FuzzySurface_t *surface) {
+    free(surface->values);
+    surface->values = NULL;
+    surface->numInputs = 0;
+    surface->numOutputs = 0;
+}
+
+/**
+ * Evaluates a FuzzySurface_t by multilinear interpolation.
+ *
+ * Inputs outside of an axis are clamped to its range. The cost is 2^inputs
+ * weighted sums per output, independent of the size of the model. The surface
+ * must have been baked by FuzzyBakeSurface(), which validates the grid.
+ *
+ * @param surface The FuzzySurface_t to evaluate.
+ * @param inputs The crisp inputs, one per axis.
+ * @param outputs The interpolated crisp outputs.
+ */
+void FuzzySurfaceEval(const FuzzySurface_t *surface, const FuzzyReal_t *inputs,
+                      FuzzyReal_t *outputs) {
+    const int numInputs = surface->numInputs;
+    const int numOutputs = surface->numOutputs;
+    FuzzyReal_t fractions[FUZZY_SURFACE_MAX_INPUTS];
+    size_t base = 0;
+
+    // Locate the grid cell and the position inside of it
+    for (int k = 0; k < numInputs; k++) {
+        const int last = surface->axes[k].points - 1;
+        FuzzyReal_t t = (inputs[k] - surface->axes[k].min) * surface->scales[k];
+        t = t > FUZZY_REAL_C(0.0) ? (t < last ? t : last) : FUZZY_REAL_C(0.0);
+
+        int cell = (int)t;
+        if (cell >= last) {
+            cell = last - 1;
+        }
+        fractions[k] = t - cell;
+        base += (size_t)cell * surface->strides[k];
+    }
+
+    // Expand the weights and offsets of the 2^inputs corners of the cell one
+    // axis at a time
+    FuzzyReal_t weights[1u << FUZZY_SURFACE_MAX_INPUTS];
+    size_t offsets[1u << FUZZY_SURFACE_MAX_INPUTS];
+    unsigned numCorners = 1;
+    weights[0] = 1.0;
+    offsets[0] = base;
+    for (int k = 0; k < numInputs; k++) {
+        for (unsigned c = 0; c < numCorners; c++) {
+            weights[c + numCorners] = weights[c] * fractions[k];
+            offsets[c + numCorners] = offsets[c] + surface->strides[k];
+            weights[c] *= FUZZY_REAL_C(1.0) - fractions[k];
+        }
+        numCorners *= 2;
+    }
+
+    // Blend the corners of the cell
+    for (int j = 0; j < numOutputs; j++) {
+        FuzzyReal_t output = 0.0;
+        for (unsigned c = 0; c < numCorners; c++) {
+            output += weights[c] * surface->values[offsets[c] + j];
+        }
+        outputs[j] = output;
+    }
+}
+
+/**
+ * Measures the interpolation error of a FuzzySurface_t against its model.
+ *
+ * Both the surface and the exact model are evaluated on samplesPerAxis evenly
+ * spaced points per axis (samplesPerAxis^inputs points in total). Choosing a
+ * sample count that is not a multiple of the grid resolution places most
+ * samples between grid points, where the interpolation error is largest.
+ *
+ * @param surface The FuzzySurface_t to check.
+ * @param model The FuzzyModel_t the surface was baked from.
+ * @param samplesPerAxis The number of samples per axis, at least 2.
+ * @param report Receives the error statistics.
+ * @return false if the surface is empty or does not match the model, the
+ * sample count is invalid or allocating failed.
+ */
+bool FuzzySurfaceError(const FuzzySurface_t *surface,
+                       const FuzzyModel_t *model, int samplesPerAxis,
+                       FuzzySurfaceError_t *report) {
+    const int numInputs = surface->numInputs;
+    const int numOutputs = surface->numOutputs;
+
+    *report = (FuzzySurfaceError_t){0};
+    if (surface->values == NULL || numInputs != model->numInputs ||
+        numOutputs != model->numOutputs || samplesPerAxis < 2) {
+        return false;
+    }
+
+    FuzzyGridAxis_t axes[FUZZY_SURFACE_MAX_INPUTS];
+    size_t numSamples = 1;
+    for (int k = 0; k < numInputs; k++) {
+        axes[k] = surface->axes[k];
+        axes[k].points = samplesPerAxis;
+        if (numSamples > SIZE_MAX / (size_t)samplesPerAxis) {
+            return false;
+        }
+        numSamples *= (size_t)samplesPerAxis;
+    }
+
+    FuzzyReal_t *exact =
+        (FuzzyReal_t *)malloc(2 * numOutputs * sizeof(FuzzyReal_t) + 1);
+    if (exact == NULL) {
+        return false;
+    }
+    FuzzyReal_t *interpolated = exact + numOutputs;
+    FuzzyState_t state;
+    FuzzyStateInit(&state, model);
+
+    FuzzyReal_t sum = 0.0;
+    FuzzyReal_t sumOfSquares = 0.0;
+    report->maxError = 0.0;
+    report->maxErrorOutput = 0;
+    for (int k = 0; k < numInputs; k++) {
+        report->maxErrorInputs[k] = axes[k].min;
+    }
+
+    for (size_t i = 0; i < numSamples; i++) {
+        FuzzyReal_t inputs[FUZZY_SURFACE_MAX_INPUTS];
+        FuzzyGridPoint(axes, numInputs, i, inputs);
+
+        FuzzyEvaluate(model, &state, inputs, exact);
+        FuzzySurfaceEval(surface, inputs, interpolated);
+
+        for (int j = 0; j < numOutputs; j++) {
+            FuzzyReal_t error = fabs(exact[j] - interpolated[j]);
+            sum += error;
+            sumOfSquares += error * error;
+            if (error > report->maxError) {
+                report->maxError = error;
+                report->maxErrorOutput = j;
+                for (int k = 0; k < numInputs; k++) {
+                    report->maxErrorInputs[k] = inputs[k];
+                }
+            }
+        }
+    }
+
+    const FuzzyReal_t count = (FuzzyReal_t)numSamples * numOutputs;
+    report->samples = numSamples;
+    report->meanError = count > 0 ? sum / count : FUZZY_REAL_C(0.0);
+    report->rmsError = count > 0 ? sqrt(sumOfSquares / count) : 0.0;
+
+    free(exact);
+    FuzzyStateFree(&state);
+    return true;
+}
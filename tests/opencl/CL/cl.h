@@ -0,0 +1,128 @@
+/**
+ * @file cl.h
+ * @brief The subset of the OpenCL 1.2 API used by opencl.c, for the stub.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ * Stands in for the Khronos header when the tests are built against the
+ * stub runtime of stub.c, see `make -C tests opencl-stub`. The types and
+ * constants match the Khronos definitions, so the backend compiles the same
+ * against either.
+ */
+
+#ifndef FUZZY_CL_STUB_H
+#define FUZZY_CL_STUB_H
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Set when building against the stub, which adds the clStub functions below
+#define FUZZY_CL_STUB 1
+
+typedef int32_t cl_int;
+typedef uint32_t cl_uint;
+typedef uint8_t cl_uchar;
+typedef uint16_t cl_ushort;
+typedef uint64_t cl_ulong;
+typedef cl_uint cl_bool;
+typedef cl_ulong cl_bitfield;
+typedef cl_bitfield cl_device_type;
+typedef cl_bitfield cl_mem_flags;
+typedef cl_bitfield cl_command_queue_properties;
+typedef cl_uint cl_device_info;
+typedef intptr_t cl_context_properties;
+
+typedef struct _cl_platform_id *cl_platform_id;
+typedef struct _cl_device_id *cl_device_id;
+typedef struct _cl_context *cl_context;
+typedef struct _cl_command_queue *cl_command_queue;
+typedef struct _cl_mem *cl_mem;
+typedef struct _cl_program *cl_program;
+typedef struct _cl_kernel *cl_kernel;
+typedef struct _cl_event *cl_event;
+
+#define CL_SUCCESS 0
+#define CL_DEVICE_NOT_FOUND -1
+#define CL_OUT_OF_RESOURCES -5
+#define CL_BUILD_PROGRAM_FAILURE -11
+#define CL_INVALID_VALUE -30
+#define CL_INVALID_KERNEL_NAME -46
+#define CL_INVALID_ARG_INDEX -49
+
+#define CL_FALSE 0
+#define CL_TRUE 1
+
+#define CL_DEVICE_TYPE_GPU (1 << 2)
+#define CL_DEVICE_TYPE_ALL 0xFFFFFFFF
+#define CL_DEVICE_EXTENSIONS 0x1030
+
+#define CL_MEM_READ_WRITE (1 << 0)
+#define CL_MEM_WRITE_ONLY (1 << 1)
+#define CL_MEM_READ_ONLY (1 << 2)
+#define CL_MEM_COPY_HOST_PTR (1 << 5)
+
+cl_int clGetPlatformIDs(cl_uint numEntries, cl_platform_id *platforms,
+                        cl_uint *numPlatforms);
+cl_int clGetDeviceIDs(cl_platform_id platform, cl_device_type type,
+                      cl_uint numEntries, cl_device_id *devices,
+                      cl_uint *numDevices);
+cl_int clGetDeviceInfo(cl_device_id device, cl_device_info name, size_t size,
+                       void *value, size_t *sizeReturned);
+cl_context clCreateContext(const cl_context_properties *properties,
+                           cl_uint numDevices, const cl_device_id *devices,
+                           void (*notify)(const char *, const void *, size_t,
+                                          void *),
+                           void *userData, cl_int *error);
+cl_int clReleaseContext(cl_context context);
+
+cl_command_queue clCreateCommandQueue(cl_context context, cl_device_id device,
+                                      cl_command_queue_properties properties,
+                                      cl_int *error);
+cl_int clReleaseCommandQueue(cl_command_queue queue);
+cl_int clFlush(cl_command_queue queue);
+
+cl_mem clCreateBuffer(cl_context context, cl_mem_flags flags, size_t size,
+                      void *host, cl_int *error);
+cl_int clReleaseMemObject(cl_mem buffer);
+
+cl_program clCreateProgramWithSource(cl_context context, cl_uint count,
+                                     const char **strings,
+                                     const size_t *lengths, cl_int *error);
+cl_int clBuildProgram(cl_program program, cl_uint numDevices,
+                      const cl_device_id *devices, const char *options,
+                      void (*notify)(cl_program, void *), void *userData);
+cl_int clReleaseProgram(cl_program program);
+
+cl_kernel clCreateKernel(cl_program program, const char *name,
+                         cl_int *error);
+cl_int clSetKernelArg(cl_kernel kernel, cl_uint index, size_t size,
+                      const void *value);
+cl_int clReleaseKernel(cl_kernel kernel);
+
+cl_int clEnqueueWriteBuffer(cl_command_queue queue, cl_mem buffer,
+                            cl_bool blocking, size_t offset, size_t size,
+                            const void *host, cl_uint numEvents,
+                            const cl_event *waitList, cl_event *event);
+cl_int clEnqueueReadBuffer(cl_command_queue queue, cl_mem buffer,
+                           cl_bool blocking, size_t offset, size_t size,
+                           void *host, cl_uint numEvents,
+                           const cl_event *waitList, cl_event *event);
+cl_int clEnqueueNDRangeKernel(cl_command_queue queue, cl_kernel kernel,
+                              cl_uint dimensions, const size_t *offset,
+                              const size_t *globalSize,
+                              const size_t *localSize, cl_uint numEvents,
+                              const cl_event *waitList, cl_event *event);
+cl_int clWaitForEvents(cl_uint numEvents, const cl_event *events);
+cl_int clReleaseEvent(cl_event event);
+
+// Number of objects created and not yet released
+int clStubLiveObjects(void);
+// Makes the call-th following API call that can fail return an error, 0
+// disables the injection
+void clStubFailCall(int call);
+
+#endif
@@ -0,0 +1,608 @@
+/**
+ * @file stub.c
+ * @brief A host-only stub of the OpenCL runtime for testing opencl.c.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ * The stub offers one platform with one device. Programs are built by
+ * compiling their OpenCL C source as C with the host compiler ($CC, or cc)
+ * into a shared object, with the -D and -I build options passed on, and
+ * kernels run one work item after the other on the calling thread. Every
+ * command completes when it is enqueued. The stub counts the objects it
+ * hands out so tests can check that everything is released, and can make a
+ * chosen call fail to exercise the error paths of the host code.
+ *
+ * Kernel parameters have to be global pointers or scalars; OpenCL C beyond
+ * what C understands after the prelude below is not supported.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "CL/cl.h"
+
+#include <ctype.h>
+#include <dlfcn.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_KERNELS 8
+#define MAX_ARGS 16
+#define MAX_ARG_SIZE 16
+
+// Runs a kernel for the work items 0 to size - 1
+typedef void (*KernelEntry_t)(void **args, size_t size);
+
+typedef struct {
+    char name[64];
+    int numArgs;
+    bool pointer[MAX_ARGS];
+} KernelSignature_t;
+
+struct _cl_platform_id {
+    int unused;
+};
+
+struct _cl_device_id {
+    int unused;
+};
+
+struct _cl_context {
+    int unused;
+};
+
+struct _cl_command_queue {
+    int unused;
+};
+
+struct _cl_event {
+    int unused;
+};
+
+struct _cl_mem {
+    void *data;
+    size_t size;
+};
+
+struct _cl_program {
+    char *source;
+    void *library;
+    KernelSignature_t kernels[MAX_KERNELS];
+    int numKernels;
+};
+
+struct _cl_kernel {
+    KernelEntry_t entry;
+    const KernelSignature_t *signature;
+    bool set[MAX_ARGS];
+    cl_mem buffers[MAX_ARGS];
+    unsigned char scalars[MAX_ARGS][MAX_ARG_SIZE];
+};
+
+static struct _cl_platform_id stubPlatform;
+static struct _cl_device_id stubDevice;
+
+static int liveObjects = 0;
+static int failCountdown = 0;
+
+int clStubLiveObjects(void) { return liveObjects; }
+
+void clStubFailCall(int call) { failCountdown = call; }
+
+/**
+ * Counts down the calls to the injected failure, see clStubFailCall().
+ */
+static bool failing(void) {
+    return failCountdown > 0 && --failCountdown == 0;
+}
+
+static void setError(cl_int *error, cl_int value) {
+    if (error != NULL) {
+        *error = value;
+    }
+}
+
+/**
+ * Creates a counted object of size bytes, NULL with the error set if the
+ * call is to fail.
+ */
+static void *create(size_t size, cl_int *error) {
+    void *object = failing() ? NULL : calloc(1, size);
+    setError(error, object != NULL ? CL_SUCCESS : CL_OUT_OF_RESOURCES);
+    liveObjects += object != NULL;
+    return object;
+}
+
+static cl_int release(void *object) {
+    if (object == NULL) {
+        return CL_INVALID_VALUE;
+    }
+    free(object);
+    liveObjects--;
+    return CL_SUCCESS;
+}
+
+cl_int clGetPlatformIDs(cl_uint numEntries, cl_platform_id *platforms,
+                        cl_uint *numPlatforms) {
+    if (failing()) {
+        return CL_OUT_OF_RESOURCES;
+    }
+    if (platforms != NULL && numEntries > 0) {
+        platforms[0] = &stubPlatform;
+    }
+    if (numPlatforms != NULL) {
+        *numPlatforms = 1;
+    }
+    return CL_SUCCESS;
+}
+
+cl_int clGetDeviceIDs(cl_platform_id platform, cl_device_type type,
+                      cl_uint numEntries, cl_device_id *devices,
+                      cl_uint *numDevices) {
+    if (failing()) {
+        return CL_OUT_OF_RESOURCES;
+    }
+    if (platform != &stubPlatform || (type & CL_DEVICE_TYPE_GPU) == 0) {
+        return CL_DEVICE_NOT_FOUND;
+    }
+    if (devices != NULL && numEntries > 0) {
+        devices[0] = &stubDevice;
+    }
+    if (numDevices != NULL) {
+        *numDevices = 1;
+    }
+    return CL_SUCCESS;
+}
+
+cl_int clGetDeviceInfo(cl_device_id device, cl_device_info name, size_t size,
+                       void *value, size_t *sizeReturned) {
+    static const char extensions[] = "cl_khr_fp64";
+    if (failing()) {
+        return CL_OUT_OF_RESOURCES;
+    }
+    if (device != &stubDevice || name != CL_DEVICE_EXTENSIONS) {
+        return CL_INVALID_VALUE;
+    }
+    if (value != NULL) {
+        if (size < sizeof(extensions)) {
+            return CL_INVALID_VALUE;
+        }
+        memcpy(value, extensions, sizeof(extensions));
+    }
+    if (sizeReturned != NULL) {
+        *sizeReturned = sizeof(extensions);
+    }
+    return CL_SUCCESS;
+}
+
+cl_context clCreateContext(const cl_context_properties *properties,
+                           cl_uint numDevices, const cl_device_id *devices,
+                           void (*notify)(const char *, const void *, size_t,
+                                          void *),
+                           void *userData, cl_int *error) {
+    (void)properties;
+    (void)notify;
+    (void)userData;
+    if (numDevices != 1 || devices[0] != &stubDevice) {
+        setError(error, CL_INVALID_VALUE);
+        return NULL;
+    }
+    return create(sizeof(struct _cl_context), error);
+}
+
+cl_int clReleaseContext(cl_context context) { return release(context); }
+
+cl_command_queue clCreateCommandQueue(cl_context context, cl_device_id device,
+                                      cl_command_queue_properties properties,
+                                      cl_int *error) {
+    if (context == NULL || device != &stubDevice || properties != 0) {
+        setError(error, CL_INVALID_VALUE);
+        return NULL;
+    }
+    return create(sizeof(struct _cl_command_queue), error);
+}
+
+cl_int clReleaseCommandQueue(cl_command_queue queue) { return release(queue); }
+
+cl_int clFlush(cl_command_queue queue) {
+    return queue != NULL ? CL_SUCCESS : CL_INVALID_VALUE;
+}
+
+cl_mem clCreateBuffer(cl_context context, cl_mem_flags flags, size_t size,
+                      void *host, cl_int *error) {
+    const bool copy = (flags & CL_MEM_COPY_HOST_PTR) != 0;
+    if (context == NULL || size == 0 || copy != (host != NULL)) {
+        setError(error, CL_INVALID_VALUE);
+        return NULL;
+    }
+    void *data = malloc(size);
+    cl_mem buffer = data != NULL ? create(sizeof(struct _cl_mem), error) : NULL;
+    if (buffer == NULL) {
+        free(data);
+        setError(error, CL_OUT_OF_RESOURCES);
+        return NULL;
+    }
+    buffer->data = data;
+    buffer->size = size;
+    if (copy) {
+        memcpy(data, host, size);
+    }
+    return buffer;
+}
+
+cl_int clReleaseMemObject(cl_mem buffer) {
+    if (buffer != NULL) {
+        free(buffer->data);
+    }
+    return release(buffer);
+}
+
+cl_program clCreateProgramWithSource(cl_context context, cl_uint count,
+                                     const char **strings,
+                                     const size_t *lengths, cl_int *error) {
+    if (context == NULL || count == 0 || strings == NULL) {
+        setError(error, CL_INVALID_VALUE);
+        return NULL;
+    }
+    size_t length = 0;
+    for (cl_uint i = 0; i < count; i++) {
+        length += lengths != NULL && lengths[i] != 0 ? lengths[i]
+                                                     : strlen(strings[i]);
+    }
+    char *source = malloc(length + 1);
+    cl_program program =
+        source != NULL ? create(sizeof(struct _cl_program), error) : NULL;
+    if (program == NULL) {
+        free(source);
+        setError(error, CL_OUT_OF_RESOURCES);
+        return NULL;
+    }
+    length = 0;
+    for (cl_uint i = 0; i < count; i++) {
+        const size_t n = lengths != NULL && lengths[i] != 0
+                             ? lengths[i]
+                             : strlen(strings[i]);
+        memcpy(source + length, strings[i], n);
+        length += n;
+    }
+    source[length] = '\0';
+    program->source = source;
+    return program;
+}
+
+static bool isIdentifier(char c) {
+    return isalnum((unsigned char)c) || c == '_';
+}
+
+/**
+ * Parses the parameter list of a kernel starting after its opening
+ * parenthesis and appends a wrapper running the kernel for every work item
+ * to out.
+ */
+static bool parseKernel(const char *name, const char *parameters,
+                        KernelSignature_t *signature, FILE *out) {
+    const char *end = strchr(parameters, ')');
+    if (end == NULL || strlen(name) >= sizeof(signature->name)) {
+        return false;
+    }
+    strcpy(signature->name, name);
+    signature->numArgs = 0;
+
+    char call[4096];
+    size_t used = 0;
+    for (const char *p = parameters; p < end && *p != '\0';) {
+        const char *comma = memchr(p, ',', end - p);
+        const char *stop = comma != NULL ? comma : end;
+        // The type is everything before the name, the last identifier
+        const char *last = stop;
+        while (last > p && isspace((unsigned char)last[-1])) {
+            last--;
+        }
+        const char *nameStart = last;
+        while (nameStart > p && isIdentifier(nameStart[-1])) {
+            nameStart--;
+        }
+        const int i = signature->numArgs;
+        if (i == MAX_ARGS || nameStart == p) {
+            return false;
+        }
+        signature->pointer[i] = memchr(p, '*', nameStart - p) != NULL;
+        const int typeLength = (int)(nameStart - p);
+        const int written =
+            signature->pointer[i]
+                ? snprintf(call + used, sizeof(call) - used,
+                           "%s(%.*s)args[%d]", i > 0 ? ", " : "", typeLength,
+                           p, i)
+                : snprintf(call + used, sizeof(call) - used,
+                           "%s*(%.*s *)args[%d]", i > 0 ? ", " : "",
+                           typeLength, p, i);
+        if (written < 0 || (size_t)written >= sizeof(call) - used) {
+            return false;
+        }
+        used += written;
+        signature->numArgs++;
+        p = stop + 1;
+    }
+
+    fprintf(out,
+            "\nvoid %s__stub(void **args, size_t size) {\n"
+            "    for (stubGlobalId = 0; stubGlobalId < size; stubGlobalId++)\n"
+            "        %s(%s);\n"
+            "}\n",
+            name, name, call);
+    return true;
+}
+
+/**
+ * Writes the source of a program, a prelude mapping OpenCL C onto C and a
+ * wrapper for every kernel.
+ */
+static bool writeSource(cl_program program, FILE *out) {
+    fputs("#include <math.h>\n"
+          "#include <stddef.h>\n"
+          "#define __kernel\n"
+          "#define __global\n"
+          "typedef unsigned char uchar;\n"
+          "typedef unsigned short ushort;\n"
+          "typedef unsigned int uint;\n"
+          "static size_t stubGlobalId;\n"
+          "static size_t get_global_id(uint d) { (void)d; "
+          "return stubGlobalId; }\n"
+          "#line 1\n",
+          out);
+    fputs(program->source, out);
+
+    program->numKernels = 0;
+    for (const char *p = strstr(program->source, "__kernel"); p != NULL;
+         p = strstr(p + 1, "__kernel")) {
+        char name[64];
+        int length = 0;
+        if (sscanf(p, "__kernel void %63[A-Za-z0-9_] (%n", name, &length) !=
+                1 ||
+            length == 0 || program->numKernels == MAX_KERNELS ||
+            !parseKernel(name, p + length,
+                         &program->kernels[program->numKernels], out)) {
+            return false;
+        }
+        program->numKernels++;
+    }
+    return true;
+}
+
+/**
+ * Appends the -D and -I options of a build to a compiler command line,
+ * skipping the OpenCL specific ones such as -cl-std.
+ */
+static bool appendOptions(const char *options, char *command, size_t size) {
+    char copy[1024];
+    if (options == NULL) {
+        return true;
+    }
+    if (strlen(options) >= sizeof(copy)) {
+        return false;
+    }
+    strcpy(copy, options);
+    for (char *option = strtok(copy, " "); option != NULL;
+         option = strtok(NULL, " ")) {
+        if (strncmp(option, "-D", 2) != 0 && strncmp(option, "-I", 2) != 0) {
+            continue;
+        }
+        // The options end up in a shell command
+        for (const char *c = option; *c != '\0'; c++) {
+            if (!isalnum((unsigned char)*c) && strchr("-_=./", *c) == NULL) {
+                return false;
+            }
+        }
+        if (strlen(command) + strlen(option) + 2 > size) {
+            return false;
+        }
+        strcat(command, " ");
+        strcat(command, option);
+    }
+    return true;
+}
+
+cl_int clBuildProgram(cl_program program, cl_uint numDevices,
+                      const cl_device_id *devices, const char *options,
+                      void (*notify)(cl_program, void *), void *userData) {
+    (void)userData;
+    if (program == NULL || program->library != NULL || notify != NULL ||
+        (numDevices > 0 && devices[0] != &stubDevice)) {
+        return CL_INVALID_VALUE;
+    }
+    if (failing()) {
+        return CL_BUILD_PROGRAM_FAILURE;
+    }
+
+    char directory[] = "/tmp/fuzzyclXXXXXX";
+    if (mkdtemp(directory) == NULL) {
+        return CL_OUT_OF_RESOURCES;
+    }
+    char source[64];
+    char library[64];
+    snprintf(source, sizeof(source), "%s/kernel.c", directory);
+    snprintf(library, sizeof(library), "%s/kernel.so", directory);
+
+    cl_int result = CL_BUILD_PROGRAM_FAILURE;
+    FILE *out = fopen(source, "w");
+    if (out != NULL) {
+        const bool written = writeSource(program, out);
+        fclose(out);
+
+        const char *compiler = getenv("CC") != NULL ? getenv("CC") : "cc";
+        char command[2048];
+        snprintf(command, sizeof(command),
+                 "%s -std=gnu11 -O2 -w -shared -fPIC -o %s %s -lm", compiler,
+                 library, source);
+        if (written && appendOptions(options, command, sizeof(command)) &&
+            system(command) == 0) {
+            program->library = dlopen(library, RTLD_NOW | RTLD_LOCAL);
+            result = program->library != NULL ? CL_SUCCESS
+                                              : CL_BUILD_PROGRAM_FAILURE;
+        }
+        unlink(library);
+        unlink(source);
+    }
+    rmdir(directory);
+    return result;
+}
+
+cl_int clReleaseProgram(cl_program program) {
+    if (program != NULL) {
+        if (program->library != NULL) {
+            dlclose(program->library);
+        }
+        free(program->source);
+    }
+    return release(program);
+}
+
+cl_kernel clCreateKernel(cl_program program, const char *name,
+                         cl_int *error) {
+    if (program == NULL || program->library == NULL) {
+        setError(error, CL_INVALID_VALUE);
+        return NULL;
+    }
+    const KernelSignature_t *signature = NULL;
+    for (int i = 0; i < program->numKernels; i++) {
+        if (strcmp(program->kernels[i].name, name) == 0) {
+            signature = &program->kernels[i];
+        }
+    }
+    char symbol[80];
+    snprintf(symbol, sizeof(symbol), "%s__stub", name);
+    void *entry =
+        signature != NULL ? dlsym(program->library, symbol) : NULL;
+    if (entry == NULL) {
+        setError(error, CL_INVALID_KERNEL_NAME);
+        return NULL;
+    }
+
+    cl_kernel kernel = create(sizeof(struct _cl_kernel), error);
+    if (kernel != NULL) {
+        // POSIX guarantees that function pointers convert to void *
+        *(void **)&kernel->entry = entry;
+        kernel->signature = signature;
+    }
+    return kernel;
+}
+
+cl_int clSetKernelArg(cl_kernel kernel, cl_uint index, size_t size,
+                      const void *value) {
+    if (kernel == NULL || index >= (cl_uint)kernel->signature->numArgs) {
+        return CL_INVALID_ARG_INDEX;
+    }
+    if (failing()) {
+        return CL_OUT_OF_RESOURCES;
+    }
+    if (value == NULL) {
+        return CL_INVALID_VALUE;
+    }
+    if (kernel->signature->pointer[index]) {
+        if (size != sizeof(cl_mem)) {
+            return CL_INVALID_VALUE;
+        }
+        kernel->buffers[index] = *(const cl_mem *)value;
+    } else {
+        if (size > MAX_ARG_SIZE) {
+            return CL_INVALID_VALUE;
+        }
+        memcpy(kernel->scalars[index], value, size);
+    }
+    kernel->set[index] = true;
+    return CL_SUCCESS;
+}
+
+cl_int clReleaseKernel(cl_kernel kernel) { return release(kernel); }
+
+/**
+ * Completes a command, creating its event if one is asked for.
+ */
+static cl_int complete(cl_event *event) {
+    if (event == NULL) {
+        return CL_SUCCESS;
+    }
+    cl_int error;
+    *event = create(sizeof(struct _cl_event), &error);
+    return error;
+}
+
+cl_int clEnqueueWriteBuffer(cl_command_queue queue, cl_mem buffer,
+                            cl_bool blocking, size_t offset, size_t size,
+                            const void *host, cl_uint numEvents,
+                            const cl_event *waitList, cl_event *event) {
+    (void)blocking;
+    (void)waitList;
+    if (queue == NULL || buffer == NULL || host == NULL || numEvents != 0 ||
+        offset + size > buffer->size) {
+        return CL_INVALID_VALUE;
+    }
+    if (failing()) {
+        return CL_OUT_OF_RESOURCES;
+    }
+    memcpy((char *)buffer->data + offset, host, size);
+    return complete(event);
+}
+
+cl_int clEnqueueReadBuffer(cl_command_queue queue, cl_mem buffer,
+                           cl_bool blocking, size_t offset, size_t size,
+                           void *host, cl_uint numEvents,
+                           const cl_event *waitList, cl_event *event) {
+    (void)blocking;
+    (void)waitList;
+    if (queue == NULL || buffer == NULL || host == NULL || numEvents != 0 ||
+        offset + size > buffer->size) {
+        return CL_INVALID_VALUE;
+    }
+    if (failing()) {
+        return CL_OUT_OF_RESOURCES;
+    }
+    memcpy(host, (const char *)buffer->data + offset, size);
+    return complete(event);
+}
+
+cl_int clEnqueueNDRangeKernel(cl_command_queue queue, cl_kernel kernel,
+                              cl_uint dimensions, const size_t *offset,
+                              const size_t *globalSize,
+                              const size_t *localSize, cl_uint numEvents,
+                              const cl_event *waitList, cl_event *event) {
+    (void)localSize;
+    (void)waitList;
+    if (queue == NULL || kernel == NULL || dimensions != 1 || offset != NULL ||
+        globalSize == NULL || numEvents != 0) {
+        return CL_INVALID_VALUE;
+    }
+    if (failing()) {
+        return CL_OUT_OF_RESOURCES;
+    }
+
+    void *args[MAX_ARGS];
+    for (int i = 0; i < kernel->signature->numArgs; i++) {
+        if (!kernel->set[i]) {
+            return CL_INVALID_VALUE;
+        }
+        args[i] = kernel->signature->pointer[i] ? kernel->buffers[i]->data
+                                                : kernel->scalars[i];
+    }
+    kernel->entry(args, *globalSize);
+    return complete(event);
+}
+
+cl_int clWaitForEvents(cl_uint numEvents, const cl_event *events) {
+    if (numEvents == 0 || events == NULL) {
+        return CL_INVALID_VALUE;
+    }
+    for (cl_uint i = 0; i < numEvents; i++) {
+        if (events[i] == NULL) {
+            return CL_INVALID_VALUE;
+        }
+    }
+    return failing() ? CL_OUT_OF_RESOURCES : CL_SUCCESS;
+}
+
+cl_int clReleaseEvent(cl_event event) { return release(event); }
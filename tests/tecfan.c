@@ -0,0 +1,15 @@
+/**
+ * @file tecfan.c
+ * @brief The TecFanControl example model, exported for the tests.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+// Reuse the sets, rules and TecFanModel() of the example, without its main
+#define main tecFanMain
+#include "../example/TecFanControl.c"
+#undef main
@@ -0,0 +1,78 @@
+/**
+ * @file test.h
+ * @brief Minimal checks shared by the tests.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ * Every test is an executable whose main() runs its checks and returns
+ * testResult(), so `make test` stops at the first failing test.
+ */
+
+#ifndef FUZZY_TEST_H
+#define FUZZY_TEST_H
+#pragma once
+
+#include "fuzzyc.h"
+
+#include <math.h>
+#include <stdio.h>
+
+static int testFailures = 0;
+
+// Reports a failed check and continues with the test
+#define CHECK(_condition)                                                      \
+    do {                                                                       \
+        if (!(_condition)) {                                                   \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,   \
+                    #_condition);                                              \
+            testFailures++;                                                    \
+        }                                                                      \
+    } while (0)
+
+// Checks that two reals differ by at most _tolerance, NaN only equals NaN
+#define CHECK_CLOSE(_a, _b, _tolerance)                                        \
+    do {                                                                       \
+        const double _x = (_a);                                                \
+        const double _y = (_b);                                                \
+        if (!(fabs(_x - _y) <= (_tolerance)) && !(isnan(_x) && isnan(_y))) {   \
+            fprintf(stderr, "%s:%d: check failed: %s = %.17g, %s = %.17g\n",   \
+                    __FILE__, __LINE__, #_a, _x, #_b, _y);                     \
+            testFailures++;                                                    \
+        }                                                                      \
+    } while (0)
+
+static inline int testResult(const char *name) {
+    printf("%s: %s\n", name, testFailures == 0 ? "ok" : "FAILED");
+    return testFailures == 0 ? 0 : 1;
+}
+
+// The TecFanControl example, see tecfan.c
+const FuzzyModel_t *TecFanModel(void);
+
+// Number of points of tecFanGridPoint()
+#define TECFAN_GRID_POINTS (10 * 7 * 9 * 5)
+
+/**
+ * Calculates a point of a grid over the TecFanControl inputs through all
+ * breakpoints of their membership functions and between them.
+ */
+static inline void tecFanGridPoint(size_t index, FuzzyReal_t *point) {
+    static const FuzzyReal_t temperatures[10] = {-20, 0,  18, 20, 23,
+                                                 25,  30, 35, 60, 100};
+    static const FuzzyReal_t changes[7] = {-20, -2, -1, 0, 1, 2, 20};
+    static const FuzzyReal_t powers[9] = {-5, 0, 3, 7, 10, 15, 20, 25, 100};
+    static const FuzzyReal_t fans[5] = {0, 10, 20, 50, 101};
+
+    point[3] = fans[index % 5];
+    index /= 5;
+    point[2] = powers[index % 9];
+    index /= 9;
+    point[1] = changes[index % 7];
+    index /= 7;
+    point[0] = temperatures[index % 10];
+}
+
+#endif
@@ -0,0 +1,120 @@
+/**
+ * @file test_area.c
+ * @brief Tests the closed form center of area against numerical integration.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "test.h"
+
+// TecFanControl, see tecfan.c
+extern FuzzySet_t FanSpeed;
+
+#define NUM_SAMPLES 120000
+
+/**
+ * Integrates the clipped membership functions of a set over [min, max] with
+ * the midpoint rule and returns the center of their sum, the numerical
+ * counterpart of defuzzificationArea().
+ */
+static double sampledArea(const FuzzySet_t *set, const FuzzyReal_t *values,
+                          double min, double max) {
+    const double step = (max - min) / NUM_SAMPLES;
+    double area = 0.0;
+    double moment = 0.0;
+    for (int k = 0; k < NUM_SAMPLES; k++) {
+        const double x = min + (k + 0.5) * step;
+        double y = 0.0;
+        for (int i = 0; i < set->length; i++) {
+            y += fmin(membershipFunction(x, set->membershipFunctions[i]),
+                      values[i]);
+        }
+        area += y;
+        moment += x * y;
+    }
+    return area > 0.0 ? moment / area : 0.0;
+}
+
+// The activations of the TecFanControl output cover single, overlapping,
+// partial and full activations
+static const FuzzyReal_t activations[][4] = {
+    {1.0, 0.0, 0.0, 0.0}, {0.0, 1.0, 0.0, 0.0}, {0.0, 0.0, 1.0, 0.0},
+    {0.0, 0.0, 0.0, 1.0}, {0.3, 0.0, 0.0, 0.0}, {0.0, 0.5, 0.5, 0.0},
+    {0.0, 0.2, 0.9, 0.4}, {0.1, 0.6, 0.0, 0.8}, {1.0, 1.0, 1.0, 1.0},
+    {0.25, 0.5, 0.75, 1.0},
+};
+
+static void testTecFan(void) {
+    FuzzyReal_t none[4] = {0.0, 0.0, 0.0, 0.0};
+    CHECK(defuzzificationArea(&FanSpeed, none) == 0.0);
+
+    for (size_t i = 0; i < sizeof(activations) / sizeof(activations[0]); i++) {
+        CHECK_CLOSE(defuzzificationArea(&FanSpeed, activations[i]),
+                    sampledArea(&FanSpeed, activations[i], -20.0, 100.0),
+                    1e-3);
+    }
+}
+
+// Clipped Gaussians are integrated in closed form as well, whole bells only
+static void testSmooth(void) {
+    static const MembershipFunction_t gaussians[] = {
+        {10.0, 4.0, 0.0, 0.0, GAUSSIAN},
+        {30.0, 8.0, 0.0, 0.0, GAUSSIAN},
+    };
+    FuzzySet_t set;
+    FuzzySetInit(&set, gaussians, 2);
+    for (size_t i = 0; i < sizeof(activations) / sizeof(activations[0]); i++) {
+        CHECK_CLOSE(defuzzificationArea(&set, activations[i]),
+                    sampledArea(&set, activations[i], -70.0, 110.0), 1e-3);
+    }
+    FuzzySetFree(&set);
+
+    static const MembershipFunction_t bells[] = {
+        {5.0, 2.0, 10.0, 0.0, BELL},
+        {8.0, 3.0, 40.0, 0.0, BELL},
+    };
+    const FuzzyReal_t full[2] = {1.0, 1.0};
+    FuzzySetInit(&set, bells, 2);
+    CHECK_CLOSE(defuzzificationArea(&set, full),
+                sampledArea(&set, full, -2000.0, 2000.0), 1e-3);
+    FuzzySetFree(&set);
+}
+
+// A single activated shape has the same center of sums and center of area
+static void testUniverse(void) {
+    FuzzyUniverse_t universe;
+    CHECK(FuzzyUniverseInit(&universe, &FanSpeed, -20.0, 100.0, 12001));
+    for (size_t i = 0; i < 5; i++) {
+        CHECK_CLOSE(defuzzificationUniverse(&universe, activations[i],
+                                            FUZZY_DEFUZZIFY_CENTROID),
+                    defuzzificationArea(&FanSpeed, activations[i]), 1e-2);
+    }
+    FuzzyUniverseFree(&universe);
+
+    // Invalid universes are left empty and defuzzify to 0
+    const FuzzyReal_t bounds[][2] = {
+        {0.0, 100.0}, {0.0, 100.0}, {0.0, 100.0}, {50.0, 50.0},
+        {100.0, 0.0}, {0.0, NAN},   {0.0, INFINITY},
+    };
+    const int resolutions[] = {1, 0, -5, 100, 100, 100, 100};
+    for (size_t i = 0; i < FUZZY_LENGTH(resolutions); i++) {
+        CHECK(!FuzzyUniverseInit(&universe, &FanSpeed, bounds[i][0],
+                                 bounds[i][1], resolutions[i]));
+        CHECK(universe.resolution == 0 && universe.table == NULL);
+        CHECK(defuzzificationUniverse(&universe, activations[8],
+                                      FUZZY_DEFUZZIFY_BISECTOR) == 0.0);
+        FuzzyUniverseFree(&universe);
+    }
+}
+
+int main(void) {
+    TecFanModel();
+    testTecFan();
+    testSmooth();
+    testUniverse();
+    return testResult("area");
+}
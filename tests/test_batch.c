@@ -0,0 +1,79 @@
+/**
+ * @file test_batch.c
+ * @brief Tests evaluating batches and sweeps on multiple threads.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "test.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#define NUM_THREADS 4
+
+static const FuzzyModel_t *models[NUM_THREADS];
+
+static void *buildModel(void *argument) {
+    *(const FuzzyModel_t **)argument = TecFanModel();
+    return NULL;
+}
+
+// Concurrent first calls of TecFanModel() all get the one initialized model
+static const FuzzyModel_t *testConcurrentInit(void) {
+    pthread_t threads[NUM_THREADS];
+    for (int i = 0; i < NUM_THREADS; i++) {
+        CHECK(pthread_create(&threads[i], NULL, buildModel, &models[i]) == 0);
+    }
+    for (int i = 0; i < NUM_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        CHECK(models[i] == models[0]);
+    }
+    CHECK(TecFanModel() == models[0]);
+    return models[0];
+}
+
+// The grid points of a sweep, the last axis varying fastest
+static const FuzzyGridAxis_t axes[4] = {
+    {-20.0, 100.0, 13}, {-20.0, 20.0, 9}, {-5.0, 100.0, 8}, {0.0, 101.0, 6}};
+#define NUM_POINTS (13 * 9 * 8 * 6)
+
+static FuzzyReal_t swept[NUM_POINTS];
+
+// Sweeps equal FuzzyEvaluate() on the same points for any thread count
+static void testSweep(const FuzzyModel_t *model) {
+    CHECK(FuzzySweepCount(model, axes) == NUM_POINTS);
+
+    FuzzyState_t state;
+    FuzzyStateInit(&state, model);
+    for (int threads = 1; threads <= NUM_THREADS; threads++) {
+        CHECK(FuzzySweep(model, axes, swept, threads));
+        for (size_t p = 0; p < NUM_POINTS; p++) {
+            FuzzyReal_t point[4];
+            size_t index = p;
+            for (int i = 3; i >= 0; i--) {
+                const size_t k = index % (size_t)axes[i].points;
+                index /= (size_t)axes[i].points;
+                point[i] = axes[i].min + (axes[i].max - axes[i].min) *
+                                             (FuzzyReal_t)k /
+                                             (FuzzyReal_t)(axes[i].points - 1);
+            }
+            FuzzyReal_t walked[4];
+            FuzzyGridPoint(axes, 4, p, walked);
+            CHECK(memcmp(walked, point, sizeof(point)) == 0);
+            FuzzyReal_t exact;
+            FuzzyEvaluate(model, &state, point, &exact);
+            CHECK_CLOSE(swept[p], exact, 0.0);
+        }
+    }
+    FuzzyStateFree(&state);
+}
+
+int main(void) {
+    testSweep(testConcurrentInit());
+    return testResult("batch");
+}
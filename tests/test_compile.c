@@ -0,0 +1,128 @@
+/**
+ * @file test_compile.c
+ * @brief Tests the 16 bit index limits of compiled rule programs.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "test.h"
+
+#include <stdint.h>
+
+// TecFanControl, see tecfan.c
+extern FuzzySet_t TemperatureState;
+extern FuzzySet_t FanSpeed;
+
+enum { TEMP_LOW, TEMP_MEDIUM, TEMP_HIGH };
+enum { SPEED_OFF, SPEED_SLOW, SPEED_MEDIUM, SPEED_FAST };
+
+// A table of UINT16_MAX + 1 sets, all the same set of one function
+static const MembershipFunction_t point[] = {{0.0, 0.0, 0.0, 0.0, SINGLETON}};
+static FuzzyReal_t fillerValues[1];
+static FuzzySet_t filler;
+static const FuzzySet_t *table[UINT16_MAX + 1];
+
+// Failed compilations leave an empty program behind
+static bool isEmpty(const FuzzyProgram_t *program) {
+    return program->numOps == 0 && program->numSets == 0 &&
+           program->numOutputs == 0 && program->ops == NULL &&
+           program->sets == NULL;
+}
+
+static void testValues(void) {
+    FuzzyRule_t valid[] = {
+        PROPOSITION(WHEN(ALL_OF(VAR(TemperatureState, TEMP_HIGH))),
+                    THEN(FanSpeed, SPEED_FAST)),
+    };
+    FuzzyProgram_t program;
+    CHECK(FuzzyCompileRules(valid, 1, &program));
+    CHECK(program.numSets == 2 && program.numOutputs == 1);
+    FuzzyProgramFree(&program);
+
+    // Membership functions the sets do not have
+    FuzzyRule_t beyond[] = {
+        PROPOSITION(WHEN(ALL_OF(VAR(TemperatureState, 3))),
+                    THEN(FanSpeed, SPEED_FAST)),
+    };
+    CHECK(!FuzzyCompileRules(beyond, 1, &program) && isEmpty(&program));
+    FuzzyProgramFree(&program);
+
+    FuzzyRule_t negative[] = {
+        PROPOSITION(WHEN(ALL_OF(VAR(TemperatureState, TEMP_LOW))),
+                    THEN(FanSpeed, -1)),
+    };
+    CHECK(!FuzzyCompileRules(negative, 1, &program) && isEmpty(&program));
+    FuzzyProgramFree(&program);
+
+    // A set whose functions can not all be indexed, its functions are never
+    // read
+    FuzzySet_t huge = {.membershipFunctions = point,
+                       .length = UINT16_MAX + 1};
+    FuzzyRule_t wide[] = {
+        PROPOSITION(WHEN(ALL_OF(VAR(huge, 0))), THEN(FanSpeed, SPEED_FAST)),
+    };
+    CHECK(!FuzzyCompileRules(wide, 1, &program) && isEmpty(&program));
+    FuzzyProgramFree(&program);
+}
+
+static void testSetTable(void) {
+    FuzzySetInitBuffer(&filler, point, 1, fillerValues);
+    for (size_t i = 0; i < FUZZY_LENGTH(table); i++) {
+        table[i] = &filler;
+    }
+    FuzzyRule_t rules[] = {
+        PROPOSITION(WHEN(ALL_OF(VAR(TemperatureState, TEMP_HIGH))),
+                    THEN(FanSpeed, SPEED_FAST)),
+        PROPOSITION(WHEN(ANY_OF(VAR(TemperatureState, TEMP_HIGH),
+                                VAR(TemperatureState, TEMP_MEDIUM))),
+                    THEN(FanSpeed, SPEED_MEDIUM)),
+        PROPOSITION(WHEN(ANY_OF(VAR(TemperatureState, TEMP_HIGH),
+                                VAR(TemperatureState, TEMP_MEDIUM))),
+                    THEN(FanSpeed, SPEED_SLOW)),
+    };
+
+    // The rules add two sets to the table, filling it up to UINT16_MAX
+    FuzzyProgram_t program;
+    CHECK(FuzzyCompileRulesWithSets(rules, 3, &program, table,
+                                    UINT16_MAX - 2));
+    CHECK(program.numSets == UINT16_MAX);
+    CHECK(program.ops[2].set == UINT16_MAX - 2);
+    // No index is left for the temporaries of shared groups
+    const int numOps = program.numOps;
+    CHECK(FuzzyProgramShareAntecedents(&program));
+    CHECK(program.numOps == numOps && program.numSets == UINT16_MAX &&
+          program.temporaries == NULL);
+    FuzzyProgramFree(&program);
+
+    // One set more, by the rules or by the given sets
+    CHECK(!FuzzyCompileRulesWithSets(rules, 3, &program, table,
+                                     UINT16_MAX - 1));
+    CHECK(isEmpty(&program));
+    FuzzyProgramFree(&program);
+    CHECK(!FuzzyCompileRulesWithSets(rules, 3, &program, table,
+                                     UINT16_MAX + 1));
+    CHECK(isEmpty(&program));
+    FuzzyProgramFree(&program);
+
+    // Models of rules which do not compile have no inputs and outputs
+    FuzzySet_t huge = {.membershipFunctions = point,
+                       .length = UINT16_MAX + 1};
+    const FuzzySet_t *inputs[] = {&TemperatureState};
+    const FuzzySet_t *outputs[] = {&huge};
+    FuzzyModel_t model;
+    CHECK(!FuzzyModelInit(&model, rules, 3, inputs, 1, outputs, 1));
+    CHECK(model.numInputs == 0 && model.numOutputs == 0 &&
+          model.numValues == 0 && isEmpty(&model.program));
+    FuzzyModelFree(&model);
+}
+
+int main(void) {
+    TecFanModel();
+    testValues();
+    testSetTable();
+    return testResult("compile");
+}
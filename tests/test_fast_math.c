@@ -0,0 +1,118 @@
+/**
+ * @file test_fast_math.c
+ * @brief Tests the error bounds of the fast exponential and logarithm.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "test.h"
+
+#include "../src/fast_math.h"
+
+#include <float.h>
+#include <math.h>
+
+#define NUM_SAMPLES 1000000
+
+// The bounds documented in fast_math.h hold before rounding, the rounding of
+// the few operations after the polynomials adds some ulps of FuzzyReal_t
+#define REAL_EPSILON                                                           \
+    (sizeof(FuzzyReal_t) == sizeof(float) ? FLT_EPSILON : DBL_EPSILON)
+#define EXP_RELATIVE_ERROR (7.5e-9 + 4 * REAL_EPSILON)
+#define LOG_ABSOLUTE_ERROR 1e-9
+
+// The neighbours of x in FuzzyReal_t
+#define NEXT_AFTER(_x, _to)                                                    \
+    (sizeof(FuzzyReal_t) == sizeof(float)                                      \
+         ? (FuzzyReal_t)nextafterf((float)(_x), (float)(_to))                  \
+         : (FuzzyReal_t)nextafter((double)(_x), (double)(_to)))
+
+static double worstExp = 0.0;
+static double worstLog = 0.0;
+
+static void checkExp(FuzzyReal_t y) {
+    const double exact = exp((double)y);
+    const double error = fabs((double)fuzzyExp(y) - exact) / exact;
+    if (error > worstExp) {
+        worstExp = error;
+    }
+    if (!(error <= EXP_RELATIVE_ERROR)) {
+        fprintf(stderr, "fast_math: fuzzyExp(%.17g) off by %.3g\n", (double)y,
+                error);
+        CHECK(false);
+    }
+}
+
+static void checkLog(FuzzyReal_t x) {
+    const double exact = log((double)x);
+    const double error = fabs((double)fuzzyLog(x) - exact);
+    const double tolerance =
+        LOG_ABSOLUTE_ERROR + 2 * REAL_EPSILON * (1.0 + fabs(exact));
+    if (error / tolerance > worstLog) {
+        worstLog = error / tolerance;
+    }
+    if (!(error <= tolerance)) {
+        fprintf(stderr, "fast_math: fuzzyLog(%.17g) off by %.3g\n", (double)x,
+                error);
+        CHECK(false);
+    }
+}
+
+// The whole clamped range, and the ends of every reduced interval around
+// (n + 1/2) ln 2 where the polynomial is the furthest off
+static void testExp(void) {
+    for (int i = 0; i <= NUM_SAMPLES; i++) {
+        checkExp(FUZZY_EXP_MIN +
+                 (FUZZY_EXP_MAX - FUZZY_EXP_MIN) * i / NUM_SAMPLES);
+    }
+    for (int n = -126; n <= 126; n++) {
+        const FuzzyReal_t y = (FuzzyReal_t)((n + 0.5) * log(2.0));
+        if (y >= FUZZY_EXP_MIN && y <= FUZZY_EXP_MAX) {
+            checkExp(y);
+            checkExp(NEXT_AFTER(y, -INFINITY));
+            checkExp(NEXT_AFTER(y, INFINITY));
+        }
+    }
+
+    // Outside of the range results are flushed or saturate
+    CHECK(fuzzyExp(NEXT_AFTER(FUZZY_EXP_MIN, -INFINITY)) == 0.0);
+    CHECK(fuzzyExp(-INFINITY) == 0.0);
+    CHECK(fuzzyExp(INFINITY) == fuzzyExp(FUZZY_EXP_MAX));
+    CHECK(isnan(fuzzyExp(NAN)));
+}
+
+// Every binade of the positive normals, by spacing the bit patterns evenly,
+// and the mantissas around sqrt(2) where the reduction switches
+static void testLog(void) {
+    const fuzzy_bits_t first = fuzzyToBits(REAL_EPSILON == FLT_EPSILON
+                                               ? (FuzzyReal_t)FLT_MIN
+                                               : (FuzzyReal_t)DBL_MIN);
+    const fuzzy_bits_t last = fuzzyToBits(REAL_EPSILON == FLT_EPSILON
+                                              ? (FuzzyReal_t)FLT_MAX
+                                              : (FuzzyReal_t)DBL_MAX);
+    const fuzzy_bits_t step = (last - first) / NUM_SAMPLES;
+    for (fuzzy_bits_t bits = first; bits <= last - step; bits += step) {
+        checkLog(fuzzyFromBits(bits));
+    }
+    checkLog(fuzzyFromBits(last));
+
+    for (int e = -100; e <= 100; e++) {
+        const FuzzyReal_t x = (FuzzyReal_t)ldexp(sqrt(2.0), e);
+        checkLog(x);
+        checkLog(NEXT_AFTER(x, 0.0));
+        checkLog(NEXT_AFTER(x, INFINITY));
+    }
+    CHECK(isnan(fuzzyLog(NAN)));
+}
+
+int main(void) {
+    testExp();
+    testLog();
+    printf("fast_math: exp within %.3g, log within %.2f of its bound\n",
+           worstExp, worstLog);
+    return testResult("fast_math");
+}
@@ -0,0 +1,177 @@
+/**
+ * @file test_fixed_point.c
+ * @brief Tests the Q15 and Q31 backends against the double pipeline.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "test.h"
+
+// TecFanControl, see tecfan.c
+extern FuzzySet_t FanSpeed;
+
+#define NUM_SETS 5
+#define MAX_LENGTH 4
+
+// The universes of the inputs in model order, then of the output
+static const FuzzyReal_t universes[NUM_SETS][2] = {
+    {-20.0, 100.0}, {-20.0, 20.0}, {-5.0, 100.0}, {0.0, 101.0}, {-20.0, 100.0}};
+
+/**
+ * Finds the universe of set i of a program, see universes.
+ */
+static const FuzzyReal_t *universe(const FuzzyModel_t *model, int i) {
+    return universes[i < model->numInputs ? i : model->numInputs];
+}
+
+// Evaluates the grid in Q15 and Q31 and compares it to FuzzyEvaluate()
+static void testTecFan(const FuzzyModel_t *model) {
+    const FuzzyProgram_t *program = &model->program;
+    CHECK(program->numSets == NUM_SETS && program->numOutputs == 1);
+
+    FuzzyQ15Function_t q15[NUM_SETS][MAX_LENGTH];
+    FuzzyQ31Function_t q31[NUM_SETS][MAX_LENGTH];
+    for (int i = 0; i < NUM_SETS; i++) {
+        const FuzzySet_t *set = program->sets[i];
+        CHECK(set->length <= MAX_LENGTH);
+        for (int j = 0; j < set->length; j++) {
+            const FuzzyReal_t *u = universe(model, i);
+            CHECK(FuzzyQ15FunctionInit(&q15[i][j], set->membershipFunctions[j],
+                                       u[0], u[1]));
+            CHECK(FuzzyQ31FunctionInit(&q31[i][j], set->membershipFunctions[j],
+                                       u[0], u[1]));
+        }
+    }
+    const FuzzyReal_t *out = universe(model, model->numInputs);
+    FuzzyQ15_t centroids15[MAX_LENGTH];
+    FuzzyQ31_t centroids31[MAX_LENGTH];
+    FuzzyQ15Centroids(FanSpeed.membershipFunctions, FanSpeed.length, out[0],
+                      out[1], centroids15);
+    FuzzyQ31Centroids(FanSpeed.membershipFunctions, FanSpeed.length, out[0],
+                      out[1], centroids31);
+
+    FuzzyQ15_t values15[NUM_SETS][MAX_LENGTH];
+    FuzzyQ31_t values31[NUM_SETS][MAX_LENGTH];
+    FuzzyQ15_t *rows15[NUM_SETS];
+    FuzzyQ31_t *rows31[NUM_SETS];
+    for (int i = 0; i < NUM_SETS; i++) {
+        rows15[i] = values15[i];
+        rows31[i] = values31[i];
+    }
+
+    FuzzyState_t state;
+    FuzzyStateInit(&state, model);
+    double error15 = 0.0;
+    double error31 = 0.0;
+    for (size_t p = 0; p < TECFAN_GRID_POINTS; p++) {
+        FuzzyReal_t point[4];
+        FuzzyReal_t exact;
+        tecFanGridPoint(p, point);
+        FuzzyEvaluate(model, &state, point, &exact);
+
+        for (int i = 0; i < model->numInputs; i++) {
+            const FuzzyReal_t *u = universe(model, i);
+            FuzzyQ15Classify(FuzzyQ15FromReal(point[i], u[0], u[1]), q15[i],
+                             program->sets[i]->length, values15[i]);
+            FuzzyQ31Classify(FuzzyQ31FromReal(point[i], u[0], u[1]), q31[i],
+                             program->sets[i]->length, values31[i]);
+        }
+        CHECK(FuzzyProgramRunQ15(program, rows15));
+        CHECK(FuzzyProgramRunQ31(program, rows31));
+
+        const int output = program->outputs[0];
+        const FuzzyReal_t crisp15 = FuzzyQ15ToReal(
+            FuzzyQ15Defuzzify(values15[output], centroids15, FanSpeed.length),
+            out[0], out[1]);
+        const FuzzyReal_t crisp31 = FuzzyQ31ToReal(
+            FuzzyQ31Defuzzify(values31[output], centroids31, FanSpeed.length),
+            out[0], out[1]);
+        // Without firing rules the double pipeline outputs 0, the fixed
+        // point one the center of the universe
+        FuzzyReal_t fired = 0.0;
+        for (int j = 0; j < FanSpeed.length; j++) {
+            fired += state.values[output][j];
+        }
+        if (fired == 0.0) {
+            CHECK(exact == 0.0);
+            continue;
+        }
+        error15 = fmax(error15, fabs(crisp15 - exact));
+        error31 = fmax(error31, fabs(crisp31 - exact));
+    }
+    FuzzyStateFree(&state);
+
+    printf("fixed_point: Q15 within %.3g, Q31 within %.3g\n", error15, error31);
+    CHECK(error15 <= 0.04);
+    CHECK(error31 <= 1.2e-5);
+}
+
+// Unsupported shapes, reversed breakpoints and empty universes are rejected
+static void testUnsupported(void) {
+    static const MembershipFunction_t rejected[] = {
+        {0.0, 1.0, 0.0, 0.0, GAUSSIAN},
+        {0.0, 1.0, 0.0, 0.0, SIGMOID},
+        {0.0, 1.0, 2.0, 0.0, BELL},
+        {5.0, 0.0, 0.0, 0.0, SINGLETON},
+        {30.0, 10.0, 50.0, 0.0, TRIANGULAR},
+        {10.0, 50.0, 30.0, 0.0, TRIANGULAR},
+        {10.0, 20.0, 40.0, 30.0, TRAPEZOIDAL},
+        {40.0, 20.0, 0.0, 0.0, RECTANGULAR},
+        {NAN, 20.0, 40.0, 0.0, TRIANGULAR},
+    };
+    for (size_t i = 0; i < sizeof(rejected) / sizeof(rejected[0]); i++) {
+        FuzzyQ15Function_t f15;
+        FuzzyQ31Function_t f31;
+        CHECK(!FuzzyQ15FunctionInit(&f15, rejected[i], 0.0, 100.0));
+        CHECK(!FuzzyQ31FunctionInit(&f31, rejected[i], 0.0, 100.0));
+        // The rejected functions have no membership
+        for (int x = -32768; x < 32768; x += 1024) {
+            CHECK(FuzzyQ15Membership((FuzzyQ15_t)x, &f15) == 0);
+            CHECK(FuzzyQ31Membership(x * 65536, &f31) == 0);
+        }
+    }
+
+    const MembershipFunction_t triangle = {10.0, 20.0, 30.0, 0.0, TRIANGULAR};
+    FuzzyQ15Function_t f15;
+    CHECK(FuzzyQ15FunctionInit(&f15, triangle, 0.0, 100.0));
+    CHECK(!FuzzyQ15FunctionInit(&f15, triangle, 100.0, 100.0));
+    CHECK(!FuzzyQ15FunctionInit(&f15, triangle, 100.0, 0.0));
+}
+
+// Programs of other operator families are rejected and leave the values
+static void testNorms(const FuzzyModel_t *model) {
+    FuzzyProgram_t program = model->program;
+    FuzzyQ15_t values15[NUM_SETS][MAX_LENGTH] = {{0}};
+    FuzzyQ31_t values31[NUM_SETS][MAX_LENGTH] = {{0}};
+    FuzzyQ15_t *rows15[NUM_SETS];
+    FuzzyQ31_t *rows31[NUM_SETS];
+    for (int i = 0; i < NUM_SETS; i++) {
+        values15[i][0] = 123;
+        values31[i][0] = 123;
+        rows15[i] = values15[i];
+        rows31[i] = values31[i];
+    }
+
+    const FuzzyNorm_e norms[] = {FUZZY_NORM_PRODUCT, FUZZY_NORM_LUKASIEWICZ,
+                                 FUZZY_NORM_HAMACHER};
+    for (int k = 0; k < 3; k++) {
+        program.norm = norms[k];
+        CHECK(!FuzzyProgramRunQ15(&program, rows15));
+        CHECK(!FuzzyProgramRunQ31(&program, rows31));
+        for (int i = 0; i < NUM_SETS; i++) {
+            CHECK(values15[i][0] == 123 && values31[i][0] == 123);
+        }
+    }
+}
+
+int main(void) {
+    const FuzzyModel_t *model = TecFanModel();
+    testTecFan(model);
+    testUnsupported();
+    testNorms(model);
+    return testResult("fixed_point");
+}
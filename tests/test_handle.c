@@ -0,0 +1,155 @@
+/**
+ * @file test_handle.c
+ * @brief Tests swapping the model of a handle under concurrent readers.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "test.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#define NUM_READERS 4
+#define NUM_SWAPS 2000
+
+// A copy of TecFanControl which records its release
+typedef struct {
+    FuzzyModel_t model;
+    _Atomic int released;
+} TrackedModel_t;
+
+// The initial model and one per swap
+static TrackedModel_t models[NUM_SWAPS + 1];
+static FuzzyModelHandle_t handle;
+static FuzzyReal_t expected[TECFAN_GRID_POINTS];
+
+static _Atomic int releases = 0;
+static _Atomic int doubleReleases = 0;
+static _Atomic bool swapping = true;
+// evaluations of all readers, every swap waits for one more
+static _Atomic int evaluations = 0;
+
+static void release(const FuzzyModel_t *model, void *context) {
+    CHECK(context == &handle);
+    TrackedModel_t *tracked = (TrackedModel_t *)model;
+    if (atomic_exchange(&tracked->released, 1) != 0) {
+        atomic_fetch_add(&doubleReleases, 1);
+    }
+    atomic_fetch_add(&releases, 1);
+}
+
+typedef struct {
+    int reader;
+    int evaluations;
+    int freed;
+    int mismatches;
+    pthread_t thread;
+} Reader_t;
+
+/**
+ * Evaluates the handle until the swaps are done, alternating between the
+ * evaluation of the handle and evaluations of its own inside of a critical
+ * section. Every model seen must not have been released yet.
+ */
+static void *runReader(void *argument) {
+    Reader_t *reader = (Reader_t *)argument;
+    FuzzyState_t state;
+    CHECK(FuzzyStateInit(&state, &models[0].model));
+
+    for (size_t i = 0; atomic_load(&swapping); i++) {
+        const size_t p = i % TECFAN_GRID_POINTS;
+        FuzzyReal_t point[4];
+        FuzzyReal_t output;
+        tecFanGridPoint(p, point);
+
+        if (i % 2 == 0) {
+            CHECK(FuzzyModelHandleEvaluate(&handle, reader->reader, point,
+                                           &output));
+        } else {
+            // All copies share the layout of the state
+            const TrackedModel_t *model = (const TrackedModel_t *)
+                FuzzyModelHandleEnter(&handle, reader->reader);
+            reader->freed += atomic_load(&model->released) != 0;
+            FuzzyEvaluate(&model->model, &state, point, &output);
+            // Lets swaps run inside of the section, also on one processor
+            sched_yield();
+            reader->freed += atomic_load(&model->released) != 0;
+            FuzzyModelHandleExit(&handle, reader->reader);
+        }
+        reader->mismatches +=
+            memcmp(&output, &expected[p], sizeof(output)) != 0;
+        reader->evaluations++;
+        atomic_fetch_add(&evaluations, 1);
+    }
+
+    FuzzyStateFree(&state);
+    return NULL;
+}
+
+static void testSwaps(const FuzzyModel_t *model) {
+    FuzzyState_t state;
+    CHECK(FuzzyStateInit(&state, model));
+    for (size_t p = 0; p < TECFAN_GRID_POINTS; p++) {
+        FuzzyReal_t point[4];
+        tecFanGridPoint(p, point);
+        FuzzyEvaluate(model, &state, point, &expected[p]);
+    }
+    FuzzyStateFree(&state);
+
+    for (int i = 0; i <= NUM_SWAPS; i++) {
+        models[i].model = *model;
+        atomic_init(&models[i].released, 0);
+    }
+    CHECK(FuzzyModelHandleInit(&handle, &models[0].model, NUM_READERS,
+                               release, &handle));
+
+    Reader_t readers[NUM_READERS];
+    for (int i = 0; i < NUM_READERS; i++) {
+        readers[i] = (Reader_t){.reader = i};
+        CHECK(pthread_create(&readers[i].thread, NULL, runReader,
+                             &readers[i]) == 0);
+    }
+
+    // Readers hold a model for one evaluation at most, so retired models
+    // are released by the swaps while the readers keep evaluating
+    int evaluated = 0;
+    for (int i = 1; i <= NUM_SWAPS; i++) {
+        while (atomic_load(&evaluations) == evaluated) {
+            sched_yield();
+        }
+        evaluated = atomic_load(&evaluations);
+        FuzzyModelHandleSwap(&handle, &models[i].model);
+        CHECK(atomic_load(&releases) <= i);
+    }
+    atomic_store(&swapping, false);
+
+    for (int i = 0; i < NUM_READERS; i++) {
+        pthread_join(readers[i].thread, NULL);
+        CHECK(readers[i].freed == 0 && readers[i].mismatches == 0);
+    }
+
+    // Every retired model is released exactly once, the current one with
+    // the handle
+    FuzzyModelHandleSynchronize(&handle);
+    CHECK(atomic_load(&releases) == NUM_SWAPS);
+    CHECK(FuzzyModelHandleReclaim(&handle) == 0);
+    CHECK(atomic_load(&models[NUM_SWAPS].released) == 0);
+    FuzzyModelHandleFree(&handle);
+    CHECK(atomic_load(&releases) == NUM_SWAPS + 1);
+    CHECK(atomic_load(&doubleReleases) == 0);
+    for (int i = 0; i <= NUM_SWAPS; i++) {
+        CHECK(atomic_load(&models[i].released) == 1);
+    }
+}
+
+int main(void) {
+    testSwaps(TecFanModel());
+    return testResult("handle");
+}
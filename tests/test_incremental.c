@@ -0,0 +1,160 @@
+/**
+ * @file test_incremental.c
+ * @brief Tests incremental evaluation against FuzzyEvaluate().
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "test.h"
+
+#include <stdint.h>
+#include <string.h>
+
+// TecFanControl, see tecfan.c
+extern FuzzyRule_t rules[];
+extern FuzzySet_t TemperatureState;
+extern FuzzySet_t TempChangeState;
+extern FuzzySet_t TECPowerState;
+extern FuzzySet_t FanState;
+extern FuzzySet_t FanSpeed;
+
+#define TECFAN_NUM_RULES 8
+#define NUM_UPDATES 200000
+// Fewer updates for the models evaluated in full every time
+#define NUM_FALLBACK_UPDATES 20000
+
+static uint32_t seed = 1;
+
+static uint32_t nextRandom(void) {
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+/**
+ * Draws a pseudo random value of an input: on one of the breakpoints of the
+ * TecFanControl grid, anywhere including beyond the universes, or the value
+ * the input already has.
+ */
+static FuzzyReal_t randomInput(int input, FuzzyReal_t current) {
+    static const FuzzyReal_t lows[4] = {-30.0, -25.0, -10.0, -5.0};
+    static const FuzzyReal_t highs[4] = {110.0, 25.0, 110.0, 110.0};
+    const uint32_t choice = nextRandom() % 8;
+    if (choice < 3) {
+        FuzzyReal_t point[4];
+        tecFanGridPoint(nextRandom() % TECFAN_GRID_POINTS, point);
+        return point[input];
+    }
+    if (choice == 3) {
+        return current;
+    }
+    return lows[input] +
+           (highs[input] - lows[input]) * nextRandom() / 16777216.0;
+}
+
+/**
+ * Updates one or several random inputs of a context per step, and compares
+ * the outputs and every membership value to a full evaluation of the same
+ * inputs bit by bit.
+ */
+static void compareUpdates(const FuzzyModel_t *model, bool incremental,
+                           int numUpdates, const char *name) {
+    FuzzyContext_t context;
+    FuzzyContextInit(&context, model);
+#ifdef FUZZY_WCET
+    // FUZZY_WCET builds evaluate every model in full
+    incremental = false;
+#endif
+    CHECK(context.incremental == incremental);
+
+    FuzzyState_t state;
+    FuzzyStateInit(&state, model);
+    int mismatches = 0;
+    for (int u = 0; u < numUpdates; u++) {
+        // Mostly single inputs, every eighth step a random subset
+        if (u % 8 != 0) {
+            const int i = (int)(nextRandom() % model->numInputs);
+            FuzzyUpdateInput(&context, i, randomInput(i, context.inputs[i]));
+        } else {
+            const uint32_t subset = nextRandom();
+            for (int i = 0; i < model->numInputs; i++) {
+                if (subset & (1u << i)) {
+                    FuzzyUpdateInput(&context, i,
+                                     randomInput(i, context.inputs[i]));
+                }
+            }
+        }
+
+        FuzzyReal_t output;
+        FuzzyReal_t exact;
+        FuzzyContextEvaluate(&context, &output);
+        FuzzyEvaluate(model, &state, context.inputs, &exact);
+        bool differs = memcmp(&output, &exact, sizeof(exact)) != 0 ||
+                       memcmp(&context.outputs[0], &exact, sizeof(exact)) != 0;
+        if (model->tsk == NULL) {
+            differs |= memcmp(context.state.buffer, state.buffer,
+                              model->numValues * sizeof(FuzzyReal_t)) != 0;
+        }
+        mismatches += differs;
+    }
+    if (mismatches != 0) {
+        fprintf(stderr, "incremental: %s: %d of %d updates differ\n", name,
+                mismatches, numUpdates);
+    }
+    CHECK(mismatches == 0);
+    FuzzyStateFree(&state);
+    FuzzyContextFree(&context);
+}
+
+static void initModel(FuzzyModel_t *model) {
+    const FuzzySet_t *inputs[] = {&TemperatureState, &TempChangeState,
+                                  &TECPowerState, &FanState};
+    const FuzzySet_t *outputs[] = {&FanSpeed};
+    FuzzyModelInit(model, rules, TECFAN_NUM_RULES, inputs, 4, outputs, 1);
+}
+
+// Min and max models which only read their inputs update incrementally
+static void testIncremental(const FuzzyModel_t *model) {
+    compareUpdates(model, true, NUM_UPDATES, "min max");
+
+    FuzzyModel_t dense = *model;
+    dense.program.sparse = false;
+    compareUpdates(&dense, true, NUM_UPDATES, "dense");
+
+    FuzzyModel_t area = *model;
+    area.defuzzifier = FUZZY_DEFUZZIFY_AREA;
+    compareUpdates(&area, true, NUM_UPDATES, "area");
+}
+
+// Models which depend on the order of evaluation are evaluated in full
+static void testFallbacks(const FuzzyModel_t *model) {
+    FuzzyModel_t product = *model;
+    product.program.norm = FUZZY_NORM_PRODUCT;
+    compareUpdates(&product, false, NUM_FALLBACK_UPDATES, "product");
+
+    FuzzyModel_t perRule = *model;
+    perRule.program.normalization = FUZZY_NORMALIZE_PER_RULE;
+    compareUpdates(&perRule, false, NUM_FALLBACK_UPDATES, "per rule");
+
+    FuzzyModel_t shared;
+    initModel(&shared);
+    CHECK(FuzzyModelShareAntecedents(&shared));
+    compareUpdates(&shared, false, NUM_FALLBACK_UPDATES, "shared");
+    FuzzyModelFree(&shared);
+
+    FuzzyModel_t tsk;
+    initModel(&tsk);
+    CHECK(FuzzyModelEnableTsk(&tsk, NULL));
+    compareUpdates(&tsk, false, NUM_FALLBACK_UPDATES, "tsk");
+    FuzzyModelFree(&tsk);
+}
+
+int main(void) {
+    const FuzzyModel_t *model = TecFanModel();
+    testIncremental(model);
+    testFallbacks(model);
+    return testResult("incremental");
+}
@@ -0,0 +1,126 @@
+/**
+ * @file test_inference.c
+ * @brief Tests resetting and normalizing output sets once or per rule.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "test.h"
+
+#include <float.h>
+#include <string.h>
+
+// TecFanControl, see tecfan.c
+extern FuzzyRule_t rules[];
+extern FuzzySet_t TemperatureState;
+extern FuzzySet_t TempChangeState;
+extern FuzzySet_t TECPowerState;
+extern FuzzySet_t FanState;
+extern FuzzySet_t FanSpeed;
+
+#define TECFAN_NUM_RULES 8
+#define FAN_SPEED_LENGTH 4
+
+// Repeated normalization changes the values by a few ulps of FuzzyReal_t,
+// the crisp outputs of up to 100 by some more
+#define REAL_EPSILON                                                           \
+    (sizeof(FuzzyReal_t) == sizeof(float) ? FLT_EPSILON : DBL_EPSILON)
+#define CRISP_TOLERANCE (4096 * REAL_EPSILON)
+
+static void classify(const FuzzyReal_t *point) {
+    FuzzyClassifier(point[0], &TemperatureState);
+    FuzzyClassifier(point[1], &TempChangeState);
+    FuzzyClassifier(point[2], &TECPowerState);
+    FuzzyClassifier(point[3], &FanState);
+}
+
+// Runs a program on the sets it was compiled from and keeps the outputs
+static void runProgram(const FuzzyProgram_t *program, FuzzyReal_t *values) {
+    FuzzyProgramRun(program);
+    memcpy(values, FanSpeed.membershipValues,
+           FAN_SPEED_LENGTH * sizeof(FuzzyReal_t));
+}
+
+static void testOnceAndPerRule(void) {
+    FuzzySet_t *outputs[TECFAN_NUM_RULES];
+    const int numOutputs = fuzzyOutputSets(rules, TECFAN_NUM_RULES, outputs);
+    CHECK(numOutputs == 1 && outputs[0] == &FanSpeed);
+
+    FuzzyProgram_t once;
+    FuzzyProgram_t perRule;
+    FuzzyCompileRules(rules, TECFAN_NUM_RULES, &once);
+    FuzzyCompileRules(rules, TECFAN_NUM_RULES, &perRule);
+    perRule.normalization = FUZZY_NORMALIZE_PER_RULE;
+
+    int differing = 0;
+    for (size_t i = 0; i < TECFAN_GRID_POINTS; i++) {
+        FuzzyReal_t point[4];
+        tecFanGridPoint(i, point);
+        classify(point);
+
+        FuzzyReal_t a[FAN_SPEED_LENGTH];
+        FuzzyReal_t b[FAN_SPEED_LENGTH];
+        FuzzyReal_t compiled[FAN_SPEED_LENGTH];
+
+        fuzzyInference(rules, TECFAN_NUM_RULES);
+        memcpy(a, FanSpeed.membershipValues, sizeof(a));
+        const FuzzyReal_t crispA = defuzzification(&FanSpeed);
+
+        fuzzyInferenceOnce(rules, TECFAN_NUM_RULES, outputs, numOutputs);
+        memcpy(b, FanSpeed.membershipValues, sizeof(b));
+        const FuzzyReal_t crispB = defuzzification(&FanSpeed);
+
+        // Repeated normalization only changes the last bits, a set summing
+        // to zero stays all zero
+        FuzzyReal_t sum = 0.0;
+        for (int j = 0; j < FAN_SPEED_LENGTH; j++) {
+            CHECK_CLOSE(a[j], b[j], 4 * REAL_EPSILON);
+            CHECK(a[j] != 0.0 || b[j] == 0.0);
+            differing += a[j] != b[j];
+            sum += b[j];
+        }
+        CHECK(sum == 0.0 || fabs(sum - 1.0) <= 4 * REAL_EPSILON);
+        CHECK_CLOSE(crispA, crispB, CRISP_TOLERANCE);
+
+        // The compiled modes reproduce both exactly
+        runProgram(&perRule, compiled);
+        CHECK(memcmp(compiled, a, sizeof(a)) == 0);
+        runProgram(&once, compiled);
+        CHECK(memcmp(compiled, b, sizeof(b)) == 0);
+    }
+    printf("inference: %d of %d values differ in the last bits\n", differing,
+           TECFAN_GRID_POINTS * FAN_SPEED_LENGTH);
+
+    FuzzyProgramFree(&once);
+    FuzzyProgramFree(&perRule);
+}
+
+// Values no rule targets are reset by the once mode only
+static void testStaleValues(void) {
+    FuzzyRule_t slow[] = {
+        PROPOSITION(WHEN(ALL_OF(VAR(FanState, 1))), THEN(FanSpeed, 0)),
+    };
+    FuzzySet_t *outputs[1];
+    const int numOutputs = fuzzyOutputSets(slow, 1, outputs);
+
+    FuzzyClassifier(50.0, &FanState);
+    FanSpeed.membershipValues[2] = 0.5;
+    fuzzyInference(slow, 1);
+    CHECK(FanSpeed.membershipValues[2] > 0.0);
+
+    FanSpeed.membershipValues[2] = 0.5;
+    fuzzyInferenceOnce(slow, 1, outputs, numOutputs);
+    CHECK(FanSpeed.membershipValues[0] == 1.0);
+    CHECK(FanSpeed.membershipValues[2] == 0.0);
+}
+
+int main(void) {
+    TecFanModel();
+    testOnceAndPerRule();
+    testStaleValues();
+    return testResult("inference");
+}
@@ -0,0 +1,185 @@
+/**
+ * @file test_kernels.c
+ * @brief Tests the batch membership kernels against the scalar functions.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ * The kernels promise the same bits as membershipFunction() for every input,
+ * whichever vector width they are built for. Run the tests for SSE2 (the
+ * default on x86-64), AVX2 and without SIMD:
+ * > make -C tests test
+ * > make -C tests test DEFINES=-mavx2 OUTPUT_DIR=out/avx2
+ * > make -C tests test DEFINES=-DFUZZY_NO_SIMD OUTPUT_DIR=out/scalar
+ */
+
+#include "test.h"
+
+#include <float.h>
+#include <string.h>
+
+// Inputs per shape: the parameters, their neighbours, points in between and
+// special values
+#define MAX_INPUTS 256
+// The kernels are called on every suffix of the inputs up to this offset, so
+// every input lands in every lane of a vector and in the scalar tail
+#define MAX_OFFSET 9
+
+#define REAL_MAX (sizeof(FuzzyReal_t) == sizeof(float) ? FLT_MAX : DBL_MAX)
+
+// The neighbours of x in FuzzyReal_t
+#define NEXT_AFTER(_x, _to)                                                    \
+    (sizeof(FuzzyReal_t) == sizeof(float)                                      \
+         ? (FuzzyReal_t)nextafterf((float)(_x), (float)(_to))                  \
+         : (FuzzyReal_t)nextafter((double)(_x), (double)(_to)))
+
+// Regular shapes, zero width edges (a == b, b == c, c == d), points and
+// reversed or negative parameters of every type
+static const MembershipFunction_t shapes[] = {
+    {0.0, 5.0, 10.0, 0.0, TRIANGULAR},
+    {5.0, 5.0, 10.0, 0.0, TRIANGULAR},
+    {0.0, 10.0, 10.0, 0.0, TRIANGULAR},
+    {5.0, 5.0, 5.0, 0.0, TRIANGULAR},
+    {-20.0, -20.0, 0.0, 25.0, TRIANGULAR},
+    {-1e-6, 0.0, 1e6, 0.0, TRIANGULAR},
+    {0.1, 0.2, 0.3, 0.0, TRIANGULAR},
+    {0.0, 2.0, 8.0, 10.0, TRAPEZOIDAL},
+    {0.0, 0.0, 5.0, 10.0, TRAPEZOIDAL},
+    {0.0, 5.0, 10.0, 10.0, TRAPEZOIDAL},
+    {0.0, 5.0, 5.0, 10.0, TRAPEZOIDAL},
+    {3.0, 3.0, 3.0, 3.0, TRAPEZOIDAL},
+    {-5.0, -5.0, 20.0, 20.0, TRAPEZOIDAL},
+    {0.1, 0.2, 0.3, 0.7, TRAPEZOIDAL},
+    {0.0, 10.0, 0.0, 0.0, RECTANGULAR},
+    {5.0, 5.0, 0.0, 0.0, RECTANGULAR},
+    {10.0, 0.0, 0.0, 0.0, RECTANGULAR},
+    {0.0, 2.0, 0.0, 0.0, GAUSSIAN},
+    {5.0, 0.0, 0.0, 0.0, GAUSSIAN},
+    {1.0, -3.0, 0.0, 0.0, GAUSSIAN},
+    {2.0, 5.0, 0.0, 0.0, SIGMOID},
+    {-1.0, 0.0, 0.0, 0.0, SIGMOID},
+    {0.0, 3.0, 0.0, 0.0, SIGMOID},
+    {2.0, 3.0, 5.0, 0.0, BELL},
+    {0.0, 2.0, 0.0, 0.0, BELL},
+    {1.0, 0.5, 0.0, 0.0, BELL},
+    {-2.0, 1.0, 1.0, 0.0, BELL},
+    {3.0, 0.0, 0.0, 0.0, SINGLETON},
+    {0.0, 0.0, 0.0, 0.0, SINGLETON},
+    {0.0, 1.0, 2.0, 3.0, (MembershipFunctionType_e)42},
+};
+
+#define NUM_SHAPES (sizeof(shapes) / sizeof(shapes[0]))
+
+static void addInput(FuzzyReal_t *xs, int *n, FuzzyReal_t x) {
+    if (*n < MAX_INPUTS) {
+        xs[(*n)++] = x;
+    }
+}
+
+/**
+ * Collects the inputs of a shape: x on its parameters and their neighbours,
+ * where the x <= a and x < a comparisons differ, points between the
+ * parameters and beyond them, and signed zeros, infinities and NaN.
+ */
+static int shapeInputs(const MembershipFunction_t *mf, FuzzyReal_t *xs) {
+    const FuzzyReal_t parameters[4] = {mf->a, mf->b, mf->c, mf->d};
+    int n = 0;
+    for (int p = 0; p < 4; p++) {
+        const FuzzyReal_t x = parameters[p];
+        addInput(xs, &n, x);
+        addInput(xs, &n, NEXT_AFTER(x, -INFINITY));
+        addInput(xs, &n, NEXT_AFTER(x, INFINITY));
+        for (int q = 0; q < 4; q++) {
+            addInput(xs, &n, (x + parameters[q]) / 2);
+        }
+        addInput(xs, &n, x - 1);
+        addInput(xs, &n, x + 1);
+        addInput(xs, &n, x * 1000);
+    }
+    const FuzzyReal_t specials[] = {
+        0.0,   -0.0,     FLT_MIN,  -FLT_MIN,  1.0, -1.0,
+        1e30,  -1e30,    REAL_MAX, -REAL_MAX, INFINITY, -INFINITY,
+        NAN,   -NAN,
+    };
+    for (size_t s = 0; s < FUZZY_LENGTH(specials); s++) {
+        addInput(xs, &n, specials[s]);
+    }
+    // Inputs from left to right across the shape
+    const FuzzyReal_t low = parameters[0] - 2;
+    const FuzzyReal_t high = parameters[2] + parameters[3] + 2;
+    for (int k = 0; k <= 64; k++) {
+        addInput(xs, &n, low + (high - low) * k / 64);
+    }
+    return n;
+}
+
+static bool sameBits(FuzzyReal_t a, FuzzyReal_t b) {
+    return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// Every suffix of the inputs, at strides 1 and 3
+static void testFunctionBatch(void) {
+    for (size_t s = 0; s < NUM_SHAPES; s++) {
+        FuzzyReal_t xs[MAX_INPUTS];
+        FuzzyReal_t out[3 * MAX_INPUTS];
+        const int n = shapeInputs(&shapes[s], xs);
+        int mismatches = 0;
+        for (int offset = 0; offset < MAX_OFFSET; offset++) {
+            for (size_t stride = 1; stride <= 3; stride += 2) {
+                membershipFunctionBatch(xs + offset, n - offset, shapes[s],
+                                        out, stride);
+                for (int i = offset; i < n; i++) {
+                    mismatches +=
+                        !sameBits(out[(i - offset) * stride],
+                                  membershipFunction(xs[i], shapes[s]));
+                }
+            }
+        }
+        if (mismatches != 0) {
+            fprintf(stderr, "kernels: shape %zu: %d degrees differ\n", s,
+                    mismatches);
+        }
+        CHECK(mismatches == 0);
+    }
+}
+
+// A set of all shapes, against the classifier of a set without a layout, which
+// evaluates membershipFunction()
+static void testClassifierBatch(void) {
+    static FuzzyReal_t xs[NUM_SHAPES * MAX_INPUTS];
+    static FuzzyReal_t out[NUM_SHAPES * MAX_INPUTS * NUM_SHAPES];
+    int n = 0;
+    for (size_t s = 0; s < NUM_SHAPES; s++) {
+        n += shapeInputs(&shapes[s], xs + n);
+    }
+
+    FuzzyReal_t storage[NUM_SHAPES];
+    FuzzySet_t set;
+    FuzzySetInitBuffer(&set, shapes, NUM_SHAPES, storage);
+    CHECK(set.layout == NULL);
+
+    int mismatches = 0;
+    for (int offset = 0; offset < MAX_OFFSET; offset++) {
+        FuzzyClassifierBatch(xs + offset, n - offset, &set, out);
+        for (int i = offset; i < n; i++) {
+            FuzzyReal_t values[NUM_SHAPES];
+            FuzzyClassifierValues(xs[i], &set, values);
+            for (size_t j = 0; j < NUM_SHAPES; j++) {
+                mismatches += !sameBits(
+                    out[(size_t)(i - offset) * NUM_SHAPES + j], values[j]);
+            }
+        }
+    }
+    if (mismatches != 0) {
+        fprintf(stderr, "kernels: %d classified degrees differ\n", mismatches);
+    }
+    CHECK(mismatches == 0);
+}
+
+int main(void) {
+    testFunctionBatch();
+    testClassifierBatch();
+    return testResult("kernels");
+}
@@ -0,0 +1,115 @@
+/**
+ * @file test_layout.c
+ * @brief Tests the division-free layouts of sets.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "test.h"
+
+#include <stdint.h>
+#include <string.h>
+
+// TecFanControl, see tecfan.c
+extern FuzzySet_t TemperatureState;
+extern FuzzySet_t TempChangeState;
+extern FuzzySet_t TECPowerState;
+extern FuzzySet_t FanState;
+
+#define MAX_LENGTH 8
+
+// Inputs on and between the breakpoints of all TecFanControl inputs
+static FuzzyReal_t sample(int i) { return -25.0 + 0.125 * i; }
+#define NUM_SAMPLES 1200
+
+/**
+ * Classifies the samples with a set and compares them to the dense
+ * classification of a set with a heap layout.
+ */
+static void compareToLayout(const FuzzySet_t *expected, const FuzzySet_t *set) {
+    for (int i = 0; i < NUM_SAMPLES; i++) {
+        FuzzyReal_t a[MAX_LENGTH];
+        FuzzyReal_t b[MAX_LENGTH];
+        FuzzyClassifierValues(sample(i), expected, a);
+        FuzzyClassifierValues(sample(i), set, b);
+        CHECK(memcmp(a, b, set->length * sizeof(FuzzyReal_t)) == 0);
+
+        int indices[MAX_LENGTH];
+        FuzzyReal_t sparse[MAX_LENGTH];
+        const int count =
+            FuzzyClassifierSparse(sample(i), set, indices, sparse);
+        for (int k = 0; k < count; k++) {
+            CHECK(sparse[k] == a[indices[k]]);
+        }
+    }
+}
+
+static void testSet(const FuzzySet_t *source) {
+    CHECK(source->length <= MAX_LENGTH);
+    FuzzySet_t dense;
+    FuzzySetInit(&dense, source->membershipFunctions, source->length);
+    CHECK(FuzzySetEnableLayout(&dense));
+
+    // A partition index evaluates its candidates with the prepared slopes
+    FuzzySet_t partitioned;
+    FuzzySetInit(&partitioned, source->membershipFunctions, source->length);
+    CHECK(FuzzySetEnableLayout(&partitioned));
+#ifdef FUZZY_WCET
+    // FUZZY_WCET builds have no partition indexes
+    CHECK(!FuzzySetEnablePartition(&partitioned));
+#else
+    CHECK(FuzzySetEnablePartition(&partitioned));
+    compareToLayout(&dense, &partitioned);
+#endif
+
+    // A layout in caller provided storage equals the heap layout at any
+    // alignment of the storage
+    static uint8_t storage[FUZZY_LAYOUT_SIZE(MAX_LENGTH) + 8];
+    for (int offset = 0; offset <= 8; offset += 4) {
+        FuzzyReal_t values[MAX_LENGTH];
+        MembershipLayout_t layout;
+        FuzzySet_t buffered;
+        FuzzySetInitBuffer(&buffered, source->membershipFunctions,
+                           source->length, values);
+        membershipLayoutInitBuffer(&layout, source->membershipFunctions,
+                                   source->length, storage + offset);
+        CHECK((uintptr_t)layout.a % FUZZY_LAYOUT_ALIGNMENT == 0);
+        CHECK((uint8_t *)(layout.slots + source->length) <=
+              storage + offset + FUZZY_LAYOUT_SIZE(source->length));
+        buffered.layout = &layout;
+        compareToLayout(&dense, &buffered);
+        buffered.layout = NULL;
+        FuzzySetFree(&buffered);
+    }
+
+    // Arena sets are laid out from the arena in FUZZY_DIVISION_FREE builds
+    static uint8_t memory[FUZZY_SET_ARENA_SIZE(MAX_LENGTH)];
+    FuzzyArena_t arena;
+    FuzzyArenaInit(&arena, memory, FUZZY_SET_ARENA_SIZE(source->length));
+    FuzzySet_t arenaSet;
+    CHECK(FuzzySetInitArena(&arenaSet, source->membershipFunctions,
+                            source->length, &arena));
+#ifdef FUZZY_DIVISION_FREE
+    CHECK(arenaSet.layout != NULL && !arenaSet.layout->ownsStorage);
+    compareToLayout(&dense, &arenaSet);
+#else
+    CHECK(arenaSet.layout == NULL);
+#endif
+    FuzzySetFree(&arenaSet);
+
+    FuzzySetFree(&partitioned);
+    FuzzySetFree(&dense);
+}
+
+int main(void) {
+    TecFanModel();
+    testSet(&TemperatureState);
+    testSet(&TempChangeState);
+    testSet(&TECPowerState);
+    testSet(&FanState);
+    return testResult("layout");
+}
@@ -0,0 +1,65 @@
+/**
+ * @file test_memo.c
+ * @brief Tests the sizes accepted by the memoization cache.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "test.h"
+
+#include <limits.h>
+
+// FUZZY_WCET builds have no memo caches, see main()
+#ifndef FUZZY_WCET
+
+// Counts are rounded up to powers of two
+static void testRounding(void) {
+    FuzzyMemo_t memo;
+    CHECK(FuzzyMemoInit(&memo, 0, 1, 1) && memo.numEntries == 1);
+    FuzzyMemoFree(&memo);
+    CHECK(FuzzyMemoInit(&memo, 5, 2, 3) && memo.numEntries == 8);
+
+    const FuzzyReal_t key[2] = {1.0, 2.0};
+    bool hit;
+    FuzzyReal_t *values = FuzzyMemoLookup(&memo, key, &hit);
+    CHECK(!hit);
+    values[0] = 42.0;
+    CHECK(FuzzyMemoLookup(&memo, key, &hit) == values && hit);
+    CHECK(memo.hits == 1 && memo.misses == 1);
+    FuzzyMemoFree(&memo);
+}
+
+// Counts which can not be rounded up and arrays larger than the address space
+// are rejected with an empty cache
+static void testOverflow(void) {
+    const int counts[] = {INT_MAX, INT_MAX / 2 + 2};
+    for (int i = 0; i < 2; i++) {
+        FuzzyMemo_t memo;
+        CHECK(!FuzzyMemoInit(&memo, counts[i], 1, 1));
+        CHECK(memo.numEntries == 0 && memo.keys == NULL &&
+              memo.values == NULL && memo.valid == NULL);
+    }
+
+    FuzzyMemo_t memo;
+    CHECK(!FuzzyMemoInit(&memo, 1 << 20, INT_MAX, 1));
+    CHECK(memo.numEntries == 0 && memo.keys == NULL);
+    CHECK(!FuzzyMemoInit(&memo, 16, 1, -1));
+    CHECK(memo.numEntries == 0 && memo.values == NULL);
+}
+
+#endif
+
+int main(void) {
+#ifdef FUZZY_WCET
+    FuzzyMemo_t memo;
+    CHECK(!FuzzyMemoInit(&memo, 16, 1, 1) && memo.numEntries == 0);
+#else
+    testRounding();
+    testOverflow();
+#endif
+    return testResult("memo");
+}
@@ -0,0 +1,327 @@
+/**
+ * @file test_model_file.c
+ * @brief Tests saving, compiling and loading binary model files.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ * The Makefile compiles ../example/TecFanControl.fuzzy with the model
+ * compiler of the same build into TecFanControl.fzm next to the test.
+ */
+
+#include "test.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_PATH 4096
+
+// Room for the image of TecFanControl
+#define MAX_IMAGE_SIZE 8192
+
+static _Alignas(FUZZY_MODEL_ALIGNMENT) uint8_t image[MAX_IMAGE_SIZE];
+static _Alignas(FUZZY_MODEL_ALIGNMENT) uint8_t scratch[MAX_IMAGE_SIZE + 16];
+
+// The number of parameters of every membership function type, the others
+// are unused and may differ, e.g. d of the triangles of TecFanControl.c
+static const int numParameters[FUZZY_NUM_MEMBERSHIP_TYPES] = {
+    [TRIANGULAR] = 3, [TRAPEZOIDAL] = 4, [RECTANGULAR] = 2, [GAUSSIAN] = 2,
+    [SIGMOID] = 2,    [BELL] = 3,        [SINGLETON] = 1};
+
+/**
+ * Checks that two membership functions have the same type and parameters.
+ */
+static bool sameFunction(const MembershipFunction_t *f,
+                         const MembershipFunction_t *g) {
+    if (f->type != g->type || (unsigned)f->type >= FUZZY_NUM_MEMBERSHIP_TYPES) {
+        return false;
+    }
+    const FuzzyReal_t x[4] = {f->a, f->b, f->c, f->d};
+    const FuzzyReal_t y[4] = {g->a, g->b, g->c, g->d};
+    return memcmp(x, y, numParameters[f->type] * sizeof(FuzzyReal_t)) == 0;
+}
+
+/**
+ * Checks that two models have the same sets, operations and rule index, and
+ * evaluate to the same outputs on the TecFanControl grid bit by bit.
+ */
+static void compareModels(const FuzzyModel_t *expected,
+                          const FuzzyModel_t *model) {
+    const FuzzyProgram_t *a = &expected->program;
+    const FuzzyProgram_t *b = &model->program;
+    CHECK(model->numInputs == expected->numInputs &&
+          model->numOutputs == expected->numOutputs &&
+          model->numValues == expected->numValues &&
+          model->defuzzifier == expected->defuzzifier);
+    CHECK(b->numSets == a->numSets && b->numOps == a->numOps &&
+          b->numOutputs == a->numOutputs);
+    CHECK(b->normalization == a->normalization && b->norm == a->norm &&
+          b->sparse == a->sparse);
+    if (b->numSets != a->numSets || b->numOps != a->numOps ||
+        b->numOutputs != a->numOutputs) {
+        return;
+    }
+
+    for (int i = 0; i < a->numSets; i++) {
+        const FuzzySet_t *x = a->sets[i];
+        const FuzzySet_t *y = b->sets[i];
+        CHECK(y->length == x->length);
+        for (int k = 0; k < x->length && k < y->length; k++) {
+            CHECK(sameFunction(&x->membershipFunctions[k],
+                               &y->membershipFunctions[k]));
+        }
+    }
+    CHECK(memcmp(b->ops, a->ops, a->numOps * sizeof(FuzzyOp_t)) == 0);
+    CHECK(memcmp(b->outputs, a->outputs, a->numOutputs * sizeof(uint16_t)) ==
+          0);
+
+    const FuzzyRuleIndex_t *x = &a->index;
+    const FuzzyRuleIndex_t *y = &b->index;
+    CHECK(y->numRules == x->numRules && y->numGates == x->numGates &&
+          y->numUngated == x->numUngated);
+    if (x->ruleStarts != NULL && y->ruleStarts != NULL &&
+        y->numRules == x->numRules && y->numGates == x->numGates &&
+        y->numUngated == x->numUngated) {
+        CHECK(memcmp(y->ruleStarts, x->ruleStarts,
+                     (x->numRules + 1) * sizeof(uint32_t)) == 0);
+        CHECK(memcmp(y->gates, x->gates, x->numGates * sizeof(FuzzyGate_t)) ==
+              0);
+        CHECK(memcmp(y->ungatedRules, x->ungatedRules,
+                     x->numUngated * sizeof(uint32_t)) == 0);
+        for (int g = 0; g < x->numGates; g++) {
+            CHECK(memcmp(y->gatedRules + x->gates[g].first,
+                         x->gatedRules + x->gates[g].first,
+                         x->gates[g].count * sizeof(uint32_t)) == 0);
+        }
+    } else {
+        CHECK(x->ruleStarts == NULL && y->ruleStarts == NULL);
+    }
+
+    FuzzyState_t expectedState;
+    FuzzyState_t state;
+    FuzzyStateInit(&expectedState, expected);
+    FuzzyStateInit(&state, model);
+    int mismatches = 0;
+    for (size_t p = 0; p < TECFAN_GRID_POINTS; p++) {
+        FuzzyReal_t point[4];
+        FuzzyReal_t exact;
+        FuzzyReal_t output;
+        tecFanGridPoint(p, point);
+        FuzzyEvaluate(expected, &expectedState, point, &exact);
+        FuzzyEvaluate(model, &state, point, &output);
+        mismatches += memcmp(&output, &exact, sizeof(exact)) != 0;
+    }
+    if (mismatches != 0) {
+        fprintf(stderr, "model_file: %d outputs differ\n", mismatches);
+    }
+    CHECK(mismatches == 0);
+    FuzzyStateFree(&state);
+    FuzzyStateFree(&expectedState);
+}
+
+// A saved model opens as the model it was saved from
+static void testRoundTrip(const FuzzyModel_t *model, const char *path) {
+    CHECK(FuzzyModelSave(model, path));
+    FuzzyModelFile_t file;
+    if (!FuzzyModelOpen(&file, path)) {
+        fprintf(stderr, "model_file: can not open %s\n", path);
+        CHECK(false);
+        return;
+    }
+    CHECK(file.mapped && file.size == FuzzyModelImageSize(model));
+    compareModels(model, &file.model);
+    FuzzyModelClose(&file);
+    remove(path);
+}
+
+// The rule file of the example compiles to the model of TecFanControl.c
+static void testCompiled(const FuzzyModel_t *model, const char *path) {
+    FuzzyModelFile_t file;
+    if (!FuzzyModelOpen(&file, path)) {
+        fprintf(stderr, "model_file: can not open %s\n", path);
+        CHECK(false);
+        return;
+    }
+    compareModels(model, &file.model);
+    FuzzyModelClose(&file);
+}
+
+/**
+ * Copies the image to the scratch buffer for a mutation.
+ */
+static FuzzyModelHeader_t *copyImage(size_t size) {
+    memcpy(scratch, image, size);
+    return (FuzzyModelHeader_t *)scratch;
+}
+
+/**
+ * Returns the first operation of the scratch image with a code in
+ * [first, last], NULL if there is none.
+ */
+static FuzzyOp_t *findOp(int first, int last) {
+    const FuzzyModelHeader_t *header = (const FuzzyModelHeader_t *)scratch;
+    FuzzyOp_t *ops = (FuzzyOp_t *)(scratch + header->ops.offset);
+    for (uint32_t i = 0; i < header->ops.count; i++) {
+        if (ops[i].code >= first && ops[i].code <= last) {
+            return &ops[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Loads the scratch image, which must be rejected.
+ */
+static bool rejected(size_t size) {
+    FuzzyModelFile_t file;
+    if (FuzzyModelLoad(&file, scratch, size)) {
+        FuzzyModelClose(&file);
+        return false;
+    }
+    return true;
+}
+
+#define CHECK_REJECTED(_mutation)                                              \
+    do {                                                                       \
+        FuzzyModelHeader_t *header = copyImage(size);                          \
+        (void)header;                                                          \
+        _mutation;                                                             \
+        if (!rejected(size)) {                                                 \
+            fprintf(stderr, "%s:%d: image accepted after %s\n", __FILE__,      \
+                    __LINE__, #_mutation);                                     \
+            testFailures++;                                                    \
+        }                                                                      \
+    } while (0)
+
+// Truncated images and images with offsets or indices out of range are
+// rejected before anything is read from them
+static void testMalformed(const FuzzyModel_t *model) {
+    const size_t size = FuzzyModelImageSize(model);
+    CHECK(size <= MAX_IMAGE_SIZE);
+    if (size > MAX_IMAGE_SIZE) {
+        return;
+    }
+    FuzzyModelWriteImage(model, image);
+    const FuzzyModelHeader_t *valid = (const FuzzyModelHeader_t *)image;
+    const FuzzyModelSet_t *sets =
+        (const FuzzyModelSet_t *)(image + valid->sets.offset);
+    const uint32_t numSets = valid->sets.count;
+
+    // The unchanged copy loads, but neither truncated nor misaligned
+    copyImage(size);
+    CHECK(!rejected(size));
+    for (size_t truncated = 0; truncated < size; truncated++) {
+        CHECK(rejected(truncated));
+    }
+    memcpy(scratch + 8, image, size);
+    FuzzyModelFile_t file;
+    CHECK(!FuzzyModelLoad(&file, scratch + 8, size));
+
+    // The header
+    CHECK_REJECTED(header->magic[0] = 'X');
+    CHECK_REJECTED(header->version++);
+    CHECK_REJECTED(header->realSize = sizeof(FuzzyReal_t) == 4 ? 8 : 4);
+    CHECK_REJECTED(header->functionSize++);
+    CHECK_REJECTED(header->size = (uint32_t)size + 1);
+    CHECK_REJECTED(header->size = sizeof(FuzzyModelHeader_t));
+    CHECK_REJECTED(header->sets.count = 0);
+    CHECK_REJECTED(header->numInputs = (uint16_t)numSets);
+    CHECK_REJECTED(header->defuzzifier = 7);
+    CHECK_REJECTED(header->normalization = FUZZY_NORMALIZE_PER_RULE + 1);
+    CHECK_REJECTED(header->norm = FUZZY_NORM_HAMACHER + 1);
+
+    // Sections off their alignment, beyond the image or longer than it
+    FuzzyModelHeader_t *const copy = (FuzzyModelHeader_t *)scratch;
+    FuzzyModelSection_t *const sections[] = {
+        &copy->sets,       &copy->functions,  &copy->ops,
+        &copy->outputs,    &copy->ruleStarts, &copy->gates,
+        &copy->gatedRules, &copy->ungatedRules};
+    for (size_t s = 0; s < FUZZY_LENGTH(sections); s++) {
+        CHECK_REJECTED(sections[s]->offset += 4);
+        CHECK_REJECTED(sections[s]->offset = (uint32_t)size + 16);
+        CHECK_REJECTED(sections[s]->count = UINT32_MAX);
+        CHECK_REJECTED(sections[s]->count = (uint32_t)size);
+    }
+
+    // Sets beyond the membership functions
+    FuzzyModelSet_t *scratchSets =
+        (FuzzyModelSet_t *)(scratch + valid->sets.offset);
+    const uint32_t last = numSets - 1;
+    CHECK_REJECTED(scratchSets[last].first = valid->functions.count + 1);
+    CHECK_REJECTED(scratchSets[last].length =
+                       valid->functions.count - sets[last].first + 1);
+    CHECK_REJECTED(scratchSets[0].length = UINT32_MAX);
+
+    // Outputs and operations with unknown codes or references beyond their
+    // sets
+    CHECK_REJECTED(((uint16_t *)(scratch + valid->outputs.offset))[0] =
+                       (uint16_t)numSets);
+    copyImage(size);
+    CHECK(findOp(FUZZY_OP_MIN, FUZZY_OP_MAX_NOT) != NULL &&
+          findOp(FUZZY_OP_ACCUMULATE, FUZZY_OP_ACCUMULATE) != NULL);
+    if (findOp(FUZZY_OP_MIN, FUZZY_OP_MAX_NOT) == NULL ||
+        findOp(FUZZY_OP_ACCUMULATE, FUZZY_OP_ACCUMULATE) == NULL) {
+        return;
+    }
+    CHECK_REJECTED(findOp(0, FUZZY_OP_LOAD)->code = FUZZY_NUM_OP_CODES);
+    CHECK_REJECTED(findOp(FUZZY_OP_MIN, FUZZY_OP_MAX_NOT)->set =
+                       (uint16_t)numSets);
+    CHECK_REJECTED({
+        FuzzyOp_t *op = findOp(FUZZY_OP_MIN, FUZZY_OP_MAX_NOT);
+        op->value = (uint16_t)sets[op->set].length;
+    });
+    CHECK_REJECTED(findOp(FUZZY_OP_ACCUMULATE, FUZZY_OP_ACCUMULATE)->set =
+                       (uint16_t)numSets);
+    CHECK_REJECTED({
+        FuzzyOp_t *op = findOp(FUZZY_OP_ACCUMULATE, FUZZY_OP_ACCUMULATE);
+        op->value = (uint16_t)sets[op->set].length;
+    });
+
+    // The rule index, present for TecFanControl
+    CHECK(valid->ruleStarts.count > 1 && valid->gates.count > 0);
+    if (valid->ruleStarts.count <= 1 || valid->gates.count == 0) {
+        return;
+    }
+    const uint32_t numRules = valid->ruleStarts.count - 1;
+    uint32_t *ruleStarts = (uint32_t *)(scratch + valid->ruleStarts.offset);
+    FuzzyGate_t *gates = (FuzzyGate_t *)(scratch + valid->gates.offset);
+    uint32_t *gatedRules = (uint32_t *)(scratch + valid->gatedRules.offset);
+    uint32_t *ungatedRules =
+        (uint32_t *)(scratch + valid->ungatedRules.offset);
+
+    CHECK_REJECTED(header->ruleStarts.count = 0);
+    CHECK_REJECTED(ruleStarts[numRules] = valid->ops.count - 1);
+    CHECK_REJECTED(ruleStarts[0] = ruleStarts[1] + 1);
+    CHECK_REJECTED(gates[0].set = (uint16_t)numSets);
+    CHECK_REJECTED(gates[0].value = (uint16_t)sets[gates[0].set].length);
+    CHECK_REJECTED(gates[0].first = valid->gatedRules.count + 1);
+    CHECK_REJECTED(gates[0].count =
+                       valid->gatedRules.count - gates[0].first + 1);
+    CHECK_REJECTED(gates[0].count = UINT32_MAX);
+    CHECK_REJECTED(gatedRules[0] = numRules);
+    if (valid->ungatedRules.count > 0) {
+        CHECK_REJECTED(ungatedRules[0] = numRules);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    (void)argc;
+    const FuzzyModel_t *model = TecFanModel();
+
+    // The files are kept next to the test executable of the build
+    char saved[MAX_PATH];
+    char compiled[MAX_PATH];
+    const char *slash = strrchr(argv[0], '/');
+    const int directory = slash != NULL ? (int)(slash - argv[0]) + 1 : 0;
+    snprintf(saved, sizeof(saved), "%s.fzm", argv[0]);
+    snprintf(compiled, sizeof(compiled), "%.*sTecFanControl.fzm", directory,
+             argv[0]);
+
+    testRoundTrip(model, saved);
+    testCompiled(model, compiled);
+    testMalformed(model);
+    return testResult("model_file");
+}
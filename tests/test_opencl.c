@@ -0,0 +1,157 @@
+/**
+ * @file test_opencl.c
+ * @brief Tests the OpenCL backend against FuzzyEvaluate().
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ * The backend only exists in builds with FUZZY_ENABLE_OPENCL. Run the tests
+ * on the OpenCL of the system, or on the host with the stub in opencl/:
+ * > make -C tests opencl
+ * > make -C tests opencl-stub
+ */
+
+#include "test.h"
+
+#ifdef FUZZY_ENABLE_OPENCL
+
+#include <stdlib.h>
+
+// Rows per batch, the grid does not divide into whole batches
+#define CAPACITY 1024
+#define NUM_BATCHES                                                            \
+    ((TECFAN_GRID_POINTS + CAPACITY - 1) / CAPACITY)
+
+// The grid by column, the layout of one batch after the other
+static FuzzyReal_t inputs[4 * TECFAN_GRID_POINTS];
+static FuzzyReal_t outputs[TECFAN_GRID_POINTS];
+
+/**
+ * Evaluates the grid in batches and compares every output to
+ * FuzzyEvaluate(), the piecewise linear shapes give identical results.
+ */
+static void testAgainstEvaluate(const FuzzyModel_t *model) {
+    FuzzyCl_t cl;
+    if (!FuzzyClInit(&cl, model, NULL, CAPACITY)) {
+        fprintf(stderr, "opencl: no device with cl_khr_fp64 found\n");
+        CHECK(false);
+        return;
+    }
+
+    for (int b = 0; b < NUM_BATCHES; b++) {
+        const size_t first = (size_t)b * CAPACITY;
+        const size_t count = first + CAPACITY <= TECFAN_GRID_POINTS
+                                 ? CAPACITY
+                                 : TECFAN_GRID_POINTS - first;
+        FuzzyReal_t *columns = inputs + 4 * first;
+        for (size_t j = 0; j < count; j++) {
+            FuzzyReal_t point[4];
+            tecFanGridPoint(first + j, point);
+            for (int i = 0; i < 4; i++) {
+                columns[i * count + j] = point[i];
+            }
+        }
+        // Waits for the batch submitted two calls earlier
+        CHECK(FuzzyClSubmit(&cl, columns, outputs + first, count));
+    }
+    CHECK(FuzzyClFinish(&cl));
+
+    FuzzyState_t state;
+    FuzzyStateInit(&state, model);
+    int mismatches = 0;
+    for (size_t p = 0; p < TECFAN_GRID_POINTS; p++) {
+        FuzzyReal_t point[4];
+        FuzzyReal_t exact;
+        tecFanGridPoint(p, point);
+        FuzzyEvaluate(model, &state, point, &exact);
+        mismatches += outputs[p] != exact;
+    }
+    if (mismatches != 0) {
+        fprintf(stderr, "opencl: %d outputs differ from FuzzyEvaluate()\n",
+                mismatches);
+    }
+    CHECK(mismatches == 0);
+    FuzzyStateFree(&state);
+
+    // Batches beyond the capacity are rejected, empty ones do nothing
+    CHECK(!FuzzyClSubmit(&cl, inputs, outputs, CAPACITY + 1));
+    CHECK(FuzzyClSubmit(&cl, inputs, outputs, 0));
+    FuzzyClFree(&cl);
+#ifdef FUZZY_CL_STUB
+    CHECK(clStubLiveObjects() == 0);
+#endif
+}
+
+// Every operator family and normalization is built into its own kernel
+static void testKernels(const FuzzyModel_t *model) {
+    const FuzzyNorm_e norms[] = {FUZZY_NORM_MIN_MAX, FUZZY_NORM_PRODUCT,
+                                 FUZZY_NORM_LUKASIEWICZ, FUZZY_NORM_HAMACHER};
+    const FuzzyNormalization_e normalizations[] = {FUZZY_NORMALIZE_ONCE,
+                                                   FUZZY_NORMALIZE_PER_RULE};
+    for (size_t n = 0; n < FUZZY_LENGTH(norms); n++) {
+        for (size_t k = 0; k < FUZZY_LENGTH(normalizations); k++) {
+            FuzzyModel_t variant = *model;
+            variant.program.norm = norms[n];
+            variant.program.normalization = normalizations[k];
+            testAgainstEvaluate(&variant);
+        }
+    }
+}
+
+// Models the kernel does not implement are rejected
+static void testUnsupported(const FuzzyModel_t *model) {
+    FuzzyModel_t area = *model;
+    area.defuzzifier = FUZZY_DEFUZZIFY_AREA;
+    FuzzyCl_t cl;
+    CHECK(!FuzzyClInit(&cl, &area, NULL, CAPACITY));
+}
+
+#ifdef FUZZY_CL_STUB
+// A failing OpenCL call makes the init fail and releases everything created
+// up to then
+static void testFailingCalls(const FuzzyModel_t *model) {
+    bool initialized = false;
+    for (int call = 1; !initialized && call < 100; call++) {
+        FuzzyCl_t cl;
+        clStubFailCall(call);
+        initialized = FuzzyClInit(&cl, model, NULL, CAPACITY);
+        clStubFailCall(0);
+        if (initialized) {
+            FuzzyClFree(&cl);
+        }
+        CHECK(clStubLiveObjects() == 0);
+    }
+    CHECK(initialized);
+
+    // A failing submit leaves the other slots usable
+    FuzzyCl_t cl;
+    CHECK(FuzzyClInit(&cl, model, NULL, CAPACITY));
+    clStubFailCall(1);
+    CHECK(!FuzzyClSubmit(&cl, inputs, outputs, CAPACITY));
+    CHECK(FuzzyClSubmit(&cl, inputs, outputs, CAPACITY));
+    CHECK(FuzzyClFinish(&cl));
+    FuzzyClFree(&cl);
+    CHECK(clStubLiveObjects() == 0);
+}
+#endif
+
+int main(void) {
+    const FuzzyModel_t *model = TecFanModel();
+    testKernels(model);
+    testUnsupported(model);
+#ifdef FUZZY_CL_STUB
+    testFailingCalls(model);
+#endif
+    return testResult("opencl");
+}
+
+#else
+
+int main(void) {
+    printf("opencl: skipped, build with -DFUZZY_ENABLE_OPENCL\n");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,189 @@
+/**
+ * @file test_optimizer.c
+ * @brief Tests that optimized rule bases compute the same outputs.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "test.h"
+
+#include <string.h>
+
+// TecFanControl, see tecfan.c
+extern FuzzyRule_t rules[];
+extern FuzzySet_t TemperatureState;
+extern FuzzySet_t TempChangeState;
+extern FuzzySet_t TECPowerState;
+extern FuzzySet_t FanState;
+extern FuzzySet_t FanSpeed;
+
+enum { TEMP_LOW, TEMP_MEDIUM, TEMP_HIGH };
+enum { CHANGE_DECREASING, CHANGE_STABLE, CHANGE_INCREASING };
+enum { POWER_LOW, POWER_MEDIUM, POWER_HIGH };
+enum { FAN_OFF, FAN_ON };
+enum { SPEED_OFF, SPEED_SLOW, SPEED_MEDIUM, SPEED_FAST };
+
+#define TECFAN_NUM_RULES 8
+
+/**
+ * Checks that two rule bases over the TecFanControl sets give the same
+ * outputs on a grid including the breakpoints of the membership functions.
+ */
+static void checkSameOutputs(const FuzzyRule_t *a, int numA,
+                             const FuzzyRule_t *b, int numB,
+                             const FuzzySet_t *const *inputs,
+                             const FuzzySet_t *output) {
+    static const FuzzyReal_t temperatures[] = {-20, 0,  18, 20, 23,
+                                               25,  30, 35, 60, 100};
+    static const FuzzyReal_t changes[] = {-20, -2, -1, 0, 1, 2, 20};
+    static const FuzzyReal_t powers[] = {-5, 0, 3, 7, 10, 15, 20, 25, 100};
+    static const FuzzyReal_t fans[] = {0, 10, 20, 50, 101};
+
+    FuzzyModel_t modelA;
+    FuzzyModel_t modelB;
+    FuzzyModelInit(&modelA, a, numA, inputs, 4, &output, 1);
+    FuzzyModelInit(&modelB, b, numB, inputs, 4, &output, 1);
+    FuzzyState_t stateA;
+    FuzzyState_t stateB;
+    FuzzyStateInit(&stateA, &modelA);
+    FuzzyStateInit(&stateB, &modelB);
+
+    for (size_t i = 0; i < FUZZY_LENGTH(temperatures); i++) {
+        for (size_t j = 0; j < FUZZY_LENGTH(changes); j++) {
+            for (size_t k = 0; k < FUZZY_LENGTH(powers); k++) {
+                for (size_t l = 0; l < FUZZY_LENGTH(fans); l++) {
+                    const FuzzyReal_t point[] = {temperatures[i], changes[j],
+                                                 powers[k], fans[l]};
+                    FuzzyReal_t x;
+                    FuzzyReal_t y;
+                    FuzzyEvaluate(&modelA, &stateA, point, &x);
+                    FuzzyEvaluate(&modelB, &stateB, point, &y);
+                    CHECK_CLOSE(x, y, 0.0);
+                }
+            }
+        }
+    }
+
+    FuzzyStateFree(&stateA);
+    FuzzyStateFree(&stateB);
+    FuzzyModelFree(&modelA);
+    FuzzyModelFree(&modelB);
+}
+
+static void testTecFan(void) {
+    const FuzzySet_t *inputs[] = {&TemperatureState, &TempChangeState,
+                                  &TECPowerState, &FanState};
+
+    // Rules 3 and 6 differ in one group and merge
+    FuzzyRuleBase_t base;
+    CHECK(FuzzyRulesOptimize(&base, rules, TECFAN_NUM_RULES,
+                             FUZZY_OPTIMIZE_ALL));
+    CHECK(base.numRules == TECFAN_NUM_RULES - 1);
+    CHECK(base.report.mergedRules == 1);
+    CHECK(base.report.opsBefore == 66 && base.report.opsAfter == 60);
+    checkSameOutputs(rules, TECFAN_NUM_RULES, base.rules, base.numRules,
+                     inputs, &FanSpeed);
+    FuzzyRuleBaseFree(&base);
+
+    // A dead rule, a duplicate variable and two subsumed rules
+    FuzzyRule_t extra[] = {
+        PROPOSITION(WHEN(ALL_OF(VAR(TECPowerState, POWER_LOW),
+                                VAR(TECPowerState, POWER_HIGH))),
+                    THEN(FanSpeed, SPEED_FAST)),
+        PROPOSITION(WHEN(ALL_OF(VAR(FanState, FAN_ON), VAR(FanState, FAN_ON),
+                                VAR(TECPowerState, POWER_HIGH))),
+                    THEN(FanSpeed, SPEED_FAST)),
+        PROPOSITION(WHEN(ALL_OF(VAR(FanState, FAN_ON),
+                                VAR(TECPowerState, POWER_HIGH),
+                                VAR(TemperatureState, TEMP_HIGH))),
+                    THEN(FanSpeed, SPEED_FAST)),
+        PROPOSITION(WHEN(ALL_OF(VAR(FanState, FAN_ON)),
+                         ANY_OF(VAR(TECPowerState, POWER_HIGH),
+                                VAR(TECPowerState, POWER_LOW))),
+                    THEN(FanSpeed, SPEED_MEDIUM)),
+    };
+    FuzzyRule_t all[TECFAN_NUM_RULES + FUZZY_LENGTH(extra)];
+    memcpy(all, rules, TECFAN_NUM_RULES * sizeof(FuzzyRule_t));
+    memcpy(all + TECFAN_NUM_RULES, extra, sizeof(extra));
+
+    const int passes[] = {FUZZY_OPTIMIZE_DEAD, FUZZY_OPTIMIZE_SUBSUME,
+                          FUZZY_OPTIMIZE_MERGE, FUZZY_OPTIMIZE_REORDER,
+                          FUZZY_OPTIMIZE_ALL};
+    for (size_t p = 0; p < FUZZY_LENGTH(passes); p++) {
+        CHECK(FuzzyRulesOptimize(&base, all, FUZZY_LENGTH(all), passes[p]));
+        CHECK(base.report.opsAfter <= base.report.opsBefore);
+        checkSameOutputs(all, FUZZY_LENGTH(all), base.rules, base.numRules,
+                         inputs, &FanSpeed);
+        if (passes[p] & FUZZY_OPTIMIZE_DEAD) {
+            CHECK(base.report.deadRules == 1);
+        }
+        FuzzyRuleBaseFree(&base);
+    }
+}
+
+// An intermediate set X, written by rules and read by later rules, and the
+// output Y
+static FuzzySet_t X;
+static FuzzySet_t Y;
+
+#define XMembershipFunctions(X)                                                \
+    X(X_A, 0.0, 0.5, 1.0, 0.0, TRIANGULAR)                                     \
+    X(X_B, 1.0, 1.5, 2.0, 0.0, TRIANGULAR)
+DEFINE_FUZZY_MEMBERSHIP(XMembershipFunctions)
+
+#define YMembershipFunctions(X)                                                \
+    X(Y_P, 0.0, 10.0, 30.0, 0.0, TRIANGULAR)                                   \
+    X(Y_Q, 50.0, 80.0, 100.0, 0.0, TRIANGULAR)
+DEFINE_FUZZY_MEMBERSHIP(YMembershipFunctions)
+
+// Rules run in order, so the passes would change what the rules reading X
+// see if it moved, dropped or merged a rule around them
+static void testChainedRules(void) {
+    const FuzzySet_t *inputs[] = {&TemperatureState, &TempChangeState,
+                                  &TECPowerState, &FanState};
+    FuzzySetInit(&X, XMembershipFunctions, FUZZY_LENGTH(XMembershipFunctions));
+    FuzzySetInit(&Y, YMembershipFunctions, FUZZY_LENGTH(YMembershipFunctions));
+
+    FuzzyRule_t chain[] = {
+        // Merges with the third rule into the position of this one, before
+        // the second rule wrote X
+        PROPOSITION(WHEN(ALL_OF(VAR(TemperatureState, TEMP_HIGH),
+                                VAR(FanState, FAN_ON))),
+                    THEN(Y, Y_P)),
+        PROPOSITION(WHEN(ALL_OF(VAR(TemperatureState, TEMP_MEDIUM))),
+                    THEN(X, X_A)),
+        PROPOSITION(WHEN(ALL_OF(VAR(X, X_A), VAR(FanState, FAN_ON))),
+                    THEN(Y, Y_P)),
+        // Weaker than the last rule, which only runs after the rule reading
+        // X
+        PROPOSITION(WHEN(ALL_OF(VAR(TECPowerState, POWER_HIGH),
+                                VAR(FanState, FAN_OFF))),
+                    THEN(X, X_B)),
+        PROPOSITION(WHEN(ALL_OF(VAR(X, X_B))), THEN(Y, Y_Q)),
+        PROPOSITION(WHEN(ALL_OF(VAR(TECPowerState, POWER_HIGH))),
+                    THEN(X, X_B)),
+    };
+
+    FuzzyRuleBase_t base;
+    CHECK(FuzzyRulesOptimize(&base, chain, FUZZY_LENGTH(chain),
+                             FUZZY_OPTIMIZE_ALL));
+    CHECK(base.numRules == (int)FUZZY_LENGTH(chain));
+    CHECK(base.report.mergedRules == 0 && base.report.subsumedRules == 0);
+    checkSameOutputs(chain, FUZZY_LENGTH(chain), base.rules, base.numRules,
+                     inputs, &Y);
+    FuzzyRuleBaseFree(&base);
+
+    FuzzySetFree(&X);
+    FuzzySetFree(&Y);
+}
+
+int main(void) {
+    TecFanModel();
+    testTecFan();
+    testChainedRules();
+    return testResult("optimizer");
+}
@@ -0,0 +1,115 @@
+/**
+ * @file test_share.c
+ * @brief Tests sharing antecedent groups across rules.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "test.h"
+
+// TecFanControl, see tecfan.c
+extern FuzzySet_t TemperatureState;
+extern FuzzySet_t TempChangeState;
+extern FuzzySet_t TECPowerState;
+extern FuzzySet_t FanState;
+extern FuzzySet_t FanSpeed;
+
+enum { TEMP_LOW, TEMP_MEDIUM, TEMP_HIGH };
+enum { CHANGE_DECREASING, CHANGE_STABLE, CHANGE_INCREASING };
+enum { POWER_LOW, POWER_MEDIUM, POWER_HIGH };
+enum { FAN_OFF, FAN_ON };
+enum { SPEED_OFF, SPEED_SLOW, SPEED_MEDIUM, SPEED_FAST };
+
+// Rules repeating groups, antecedents and variables
+static FuzzyRule_t rules[] = {
+    PROPOSITION(WHEN(ALL_OF(VAR(FanState, FAN_ON),
+                            VAR(TemperatureState, TEMP_HIGH)),
+                     ANY_OF(VAR(TECPowerState, POWER_MEDIUM),
+                            VAR(TECPowerState, POWER_HIGH))),
+                THEN(FanSpeed, SPEED_FAST)),
+    PROPOSITION(WHEN(ANY_OF(VAR(TECPowerState, POWER_HIGH),
+                            VAR(TECPowerState, POWER_MEDIUM)),
+                     ALL_OF(VAR(TemperatureState, TEMP_HIGH),
+                            VAR(FanState, FAN_ON))),
+                THEN(FanSpeed, SPEED_MEDIUM)),
+    PROPOSITION(WHEN(ALL_OF(VAR(FanState, FAN_ON),
+                            VAR(TemperatureState, TEMP_MEDIUM),
+                            VAR(TemperatureState, TEMP_MEDIUM))),
+                THEN(FanSpeed, SPEED_SLOW)),
+    PROPOSITION(WHEN(ALL_OF(VAR(FanState, FAN_ON),
+                            VAR(TemperatureState, TEMP_MEDIUM)),
+                     ANY_OF(VAR(TempChangeState, CHANGE_STABLE),
+                            VAR(TempChangeState, CHANGE_DECREASING))),
+                THEN(FanSpeed, SPEED_MEDIUM)),
+    PROPOSITION(WHEN(ALL_OF(NOT(FanState, FAN_ON),
+                            VAR(TemperatureState, TEMP_LOW))),
+                THEN(FanSpeed, SPEED_OFF)),
+};
+
+static void initModel(FuzzyModel_t *model, FuzzyNorm_e norm) {
+    const FuzzySet_t *inputs[] = {&TemperatureState, &TempChangeState,
+                                  &TECPowerState, &FanState};
+    const FuzzySet_t *outputs[] = {&FanSpeed};
+    FuzzyModelInit(model, rules, FUZZY_LENGTH(rules), inputs, 4, outputs, 1);
+    model->program.norm = norm;
+}
+
+static void checkSameOutputs(const FuzzyModel_t *a, const FuzzyModel_t *b) {
+    FuzzyState_t stateA;
+    FuzzyState_t stateB;
+    FuzzyStateInit(&stateA, a);
+    FuzzyStateInit(&stateB, b);
+    for (size_t i = 0; i < TECFAN_GRID_POINTS; i++) {
+        FuzzyReal_t point[4];
+        FuzzyReal_t x;
+        FuzzyReal_t y;
+        tecFanGridPoint(i, point);
+        FuzzyEvaluate(a, &stateA, point, &x);
+        FuzzyEvaluate(b, &stateB, point, &y);
+        CHECK_CLOSE(x, y, 0.0);
+    }
+    FuzzyStateFree(&stateA);
+    FuzzyStateFree(&stateB);
+}
+
+// Min and max are idempotent, sharing keeps the results bit-identical
+static void testMinMax(void) {
+    FuzzyModel_t plain;
+    FuzzyModel_t shared;
+    initModel(&plain, FUZZY_NORM_MIN_MAX);
+    initModel(&shared, FUZZY_NORM_MIN_MAX);
+    CHECK(FuzzyModelShareAntecedents(&shared));
+    CHECK(shared.program.numOps < plain.program.numOps);
+    checkSameOutputs(&plain, &shared);
+    FuzzyModelFree(&plain);
+    FuzzyModelFree(&shared);
+}
+
+// The other families are rejected and the program is left unchanged
+static void testOtherNorms(void) {
+    const FuzzyNorm_e norms[] = {FUZZY_NORM_PRODUCT, FUZZY_NORM_LUKASIEWICZ,
+                                 FUZZY_NORM_HAMACHER};
+    for (size_t n = 0; n < FUZZY_LENGTH(norms); n++) {
+        FuzzyModel_t plain;
+        FuzzyModel_t shared;
+        initModel(&plain, norms[n]);
+        initModel(&shared, norms[n]);
+        CHECK(!FuzzyModelShareAntecedents(&shared));
+        CHECK(shared.program.numOps == plain.program.numOps);
+        CHECK(shared.program.numSets == plain.program.numSets);
+        checkSameOutputs(&plain, &shared);
+        FuzzyModelFree(&plain);
+        FuzzyModelFree(&shared);
+    }
+}
+
+int main(void) {
+    TecFanModel();
+    testMinMax();
+    testOtherNorms();
+    return testResult("share");
+}
@@ -0,0 +1,93 @@
+/**
+ * @file test_sparse.c
+ * @brief Tests skipping inactive rules against dense evaluation.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "test.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define NUM_RANDOM_POINTS 20000
+
+/**
+ * Calculates a pseudo random point of the TecFanControl inputs, including
+ * inputs beyond the universes, the same one for the same index.
+ */
+static void randomPoint(uint32_t index, FuzzyReal_t *point) {
+    static const FuzzyReal_t lows[4] = {-30.0, -25.0, -10.0, -5.0};
+    static const FuzzyReal_t highs[4] = {110.0, 25.0, 110.0, 110.0};
+    uint32_t seed = index * 2654435761u + 1u;
+    for (int i = 0; i < 4; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        point[i] = lows[i] + (highs[i] - lows[i]) * (seed >> 8) / 16777216.0;
+    }
+}
+
+/**
+ * Evaluates a point sparse and dense and compares the outputs and every
+ * membership value of the states bit by bit.
+ */
+static int compare(const FuzzyModel_t *sparse, FuzzyState_t *sparseState,
+                   const FuzzyModel_t *dense, FuzzyState_t *denseState,
+                   const FuzzyReal_t *point) {
+    FuzzyReal_t x;
+    FuzzyReal_t y;
+    FuzzyEvaluate(sparse, sparseState, point, &x);
+    FuzzyEvaluate(dense, denseState, point, &y);
+    return memcmp(&x, &y, sizeof(x)) != 0 ||
+           memcmp(sparseState->buffer, denseState->buffer,
+                  dense->numValues * sizeof(FuzzyReal_t)) != 0;
+}
+
+// Every operator family gives the results of the dense run for finite inputs
+static void testTecFan(const FuzzyModel_t *model) {
+    CHECK(model->program.sparse && model->program.index.numGates > 0);
+
+    const FuzzyNorm_e norms[] = {FUZZY_NORM_MIN_MAX, FUZZY_NORM_PRODUCT,
+                                 FUZZY_NORM_LUKASIEWICZ, FUZZY_NORM_HAMACHER};
+    for (size_t n = 0; n < FUZZY_LENGTH(norms); n++) {
+        // The copies share the compiled operations and the rule index
+        FuzzyModel_t sparse = *model;
+        FuzzyModel_t dense = *model;
+        sparse.program.norm = norms[n];
+        dense.program.norm = norms[n];
+        dense.program.sparse = false;
+
+        FuzzyState_t sparseState;
+        FuzzyState_t denseState;
+        FuzzyStateInit(&sparseState, &sparse);
+        FuzzyStateInit(&denseState, &dense);
+        int mismatches = 0;
+        for (size_t p = 0; p < TECFAN_GRID_POINTS; p++) {
+            FuzzyReal_t point[4];
+            tecFanGridPoint(p, point);
+            mismatches +=
+                compare(&sparse, &sparseState, &dense, &denseState, point);
+        }
+        for (uint32_t p = 0; p < NUM_RANDOM_POINTS; p++) {
+            FuzzyReal_t point[4];
+            randomPoint(p, point);
+            mismatches +=
+                compare(&sparse, &sparseState, &dense, &denseState, point);
+        }
+        if (mismatches != 0) {
+            fprintf(stderr, "sparse: norm %d: %d points differ\n",
+                    (int)norms[n], mismatches);
+        }
+        CHECK(mismatches == 0);
+        FuzzyStateFree(&denseState);
+        FuzzyStateFree(&sparseState);
+    }
+}
+
+int main(void) {
+    testTecFan(TecFanModel());
+    return testResult("sparse");
+}
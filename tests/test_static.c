@@ -0,0 +1,175 @@
+/**
+ * @file test_static.c
+ * @brief Tests a static model against the same model built at runtime.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "test.h"
+
+#include <stdint.h>
+#include <string.h>
+
+// The sets and rules of TecFanControl, see ../example/TecFanControl.c
+#define TemperatureMembershipFunctions(X)                                      \
+    X(TEMPERATURE_LOW, -20.0, -20.0, 18.0, 25.0, TRAPEZOIDAL)                  \
+    X(TEMPERATURE_MEDIUM, 18.0, 23.0, 35.0, 0.0, TRIANGULAR)                   \
+    X(TEMPERATURE_HIGH, 23.0, 35.0, 100.0, 100.0, TRAPEZOIDAL)
+DEFINE_CONST_FUZZY_MEMBERSHIP(TemperatureMembershipFunctions)
+
+#define TempChangeMembershipFunctions(X)                                       \
+    X(TEMP_CHANGE_DECREASING, -20.0, -20.0, -2.0, 0.0, TRAPEZOIDAL)            \
+    X(TEMP_CHANGE_STABLE, -2.0, 0.0, 2.0, 0.0, TRIANGULAR)                     \
+    X(TEMP_CHANGE_INCREASING, 0.0, 2.0, 20.0, 20.0, TRAPEZOIDAL)
+DEFINE_CONST_FUZZY_MEMBERSHIP(TempChangeMembershipFunctions)
+
+#define TECPowerMembershipFunctions(X)                                         \
+    X(TEC_POWER_LOW, -5.0, -5.0, 3.0, 15.0, TRAPEZOIDAL)                       \
+    X(TEC_POWER_MEDIUM, 3.0, 10.0, 25.0, 25.0, TRIANGULAR)                     \
+    X(TEC_POWER_HIGH, 15.0, 25.0, 100.0, 100.0, TRAPEZOIDAL)
+DEFINE_CONST_FUZZY_MEMBERSHIP(TECPowerMembershipFunctions)
+
+#define FanStateMembershipFunctions(X)                                         \
+    X(FAN_STATE_OFF, 0.0, 20.0, 0.0, 0.0, RECTANGULAR)                         \
+    X(FAN_STATE_ON, 20.0, 101.0, 0.0, 0.0, RECTANGULAR)
+DEFINE_CONST_FUZZY_MEMBERSHIP(FanStateMembershipFunctions)
+
+#define FanSpeedMembershipFunctions(X)                                         \
+    X(FAN_SPEED_OFF, -20.0, 20.0, 0.0, 0.0, RECTANGULAR)                       \
+    X(FAN_SPEED_SLOW, 20.0, 20.0, 40.0, 60.0, TRAPEZOIDAL)                     \
+    X(FAN_SPEED_MEDIUM, 30.0, 60.0, 60.0, 65.0, TRAPEZOIDAL)                   \
+    X(FAN_SPEED_FAST, 60.0, 65.0, 100.0, 100.0, TRAPEZOIDAL)
+DEFINE_CONST_FUZZY_MEMBERSHIP(FanSpeedMembershipFunctions)
+
+#define Inputs(X)                                                              \
+    X(TemperatureState, TemperatureMembershipFunctions)                        \
+    X(TempChangeState, TempChangeMembershipFunctions)                          \
+    X(TECPowerState, TECPowerMembershipFunctions)                              \
+    X(FanState, FanStateMembershipFunctions)
+#define Outputs(X) X(FanSpeed, FanSpeedMembershipFunctions)
+
+DEFINE_STATIC_FUZZY_MODEL(
+    StaticTecFan, Inputs, Outputs,
+    STATIC_PROPOSITION(
+        STATIC_WHEN(STATIC_ALL_OF(STATIC_VAR(FanState, FAN_STATE_OFF)),
+                    STATIC_ANY_OF(
+                        STATIC_VAR(TemperatureState, TEMPERATURE_MEDIUM),
+                        STATIC_VAR(TemperatureState, TEMPERATURE_HIGH),
+                        STATIC_VAR(TECPowerState, TEC_POWER_HIGH))),
+        STATIC_THEN(FanSpeed, FAN_SPEED_FAST)),
+    STATIC_PROPOSITION(
+        STATIC_WHEN(
+            STATIC_ALL_OF(STATIC_VAR(FanState, FAN_STATE_OFF),
+                          STATIC_VAR(TemperatureState, TEMPERATURE_LOW)),
+            STATIC_ANY_OF(STATIC_VAR(TempChangeState, TEMP_CHANGE_STABLE),
+                          STATIC_VAR(TempChangeState, TEMP_CHANGE_DECREASING))),
+        STATIC_THEN(FanSpeed, FAN_SPEED_OFF)),
+    STATIC_PROPOSITION(
+        STATIC_WHEN(
+            STATIC_ALL_OF(STATIC_VAR(FanState, FAN_STATE_ON),
+                          STATIC_VAR(TECPowerState, TEC_POWER_LOW)),
+            STATIC_ANY_OF(STATIC_VAR(TempChangeState, TEMP_CHANGE_STABLE),
+                          STATIC_VAR(TempChangeState, TEMP_CHANGE_DECREASING))),
+        STATIC_THEN(FanSpeed, FAN_SPEED_OFF)),
+    STATIC_PROPOSITION(
+        STATIC_WHEN(STATIC_ALL_OF(
+            STATIC_VAR(FanState, FAN_STATE_ON),
+            STATIC_VAR(TemperatureState, TEMPERATURE_MEDIUM),
+            STATIC_NOT(TECPowerState, TEC_POWER_HIGH))),
+        STATIC_THEN(FanSpeed, FAN_SPEED_MEDIUM)),
+    STATIC_PROPOSITION(
+        STATIC_WHEN(
+            STATIC_ALL_OF(STATIC_VAR(FanState, FAN_STATE_ON),
+                          STATIC_VAR(TemperatureState, TEMPERATURE_HIGH)),
+            STATIC_ANY_OF(STATIC_VAR(TECPowerState, TEC_POWER_MEDIUM),
+                          STATIC_VAR(TECPowerState, TEC_POWER_LOW))),
+        STATIC_THEN(FanSpeed, FAN_SPEED_FAST)),
+    STATIC_PROPOSITION(
+        STATIC_WHEN(
+            STATIC_ALL_OF(STATIC_VAR(FanState, FAN_STATE_ON),
+                          STATIC_VAR(TECPowerState, TEC_POWER_LOW),
+                          STATIC_VAR(TemperatureState, TEMPERATURE_LOW))),
+        STATIC_THEN(FanSpeed, FAN_SPEED_OFF)),
+    STATIC_PROPOSITION(
+        STATIC_WHEN(STATIC_ALL_OF(STATIC_VAR(FanState, FAN_STATE_ON),
+                                  STATIC_VAR(TECPowerState, TEC_POWER_MEDIUM))),
+        STATIC_THEN(FanSpeed, FAN_SPEED_MEDIUM)),
+    STATIC_PROPOSITION(
+        STATIC_WHEN(STATIC_ALL_OF(STATIC_VAR(FanState, FAN_STATE_ON),
+                                  STATIC_VAR(TECPowerState, TEC_POWER_HIGH))),
+        STATIC_THEN(FanSpeed, FAN_SPEED_FAST)))
+
+FUZZY_STATE_STORAGE(staticState, StaticTecFan);
+
+// The static model has the sets, counts and operations of the runtime one
+static void testLayout(const FuzzyModel_t *model) {
+    const FuzzyProgram_t *expected = &model->program;
+    const FuzzyProgram_t *program = &StaticTecFan.program;
+
+    CHECK(StaticTecFan.numInputs == model->numInputs);
+    CHECK(StaticTecFan.numOutputs == model->numOutputs);
+    CHECK(StaticTecFan.numValues == model->numValues);
+    CHECK(StaticTecFan.defuzzifier == model->defuzzifier);
+    CHECK(program->numSets == expected->numSets);
+    for (int i = 0; i < program->numSets && i < expected->numSets; i++) {
+        const FuzzySet_t *set = program->sets[i];
+        CHECK(set->length == expected->sets[i]->length);
+        CHECK(memcmp(set->membershipFunctions,
+                     expected->sets[i]->membershipFunctions,
+                     set->length * sizeof(MembershipFunction_t)) == 0);
+    }
+    CHECK(program->numOutputs == expected->numOutputs &&
+          program->outputs[0] == expected->outputs[0]);
+    CHECK(program->normalization == expected->normalization);
+    CHECK(program->norm == expected->norm);
+
+    CHECK(program->numOps == expected->numOps);
+    for (int i = 0; i < program->numOps && i < expected->numOps; i++) {
+        CHECK(program->ops[i].code == expected->ops[i].code);
+        CHECK(program->ops[i].set == expected->ops[i].set);
+        CHECK(program->ops[i].value == expected->ops[i].value);
+    }
+}
+
+// Runtime sets of FUZZY_DIVISION_FREE builds multiply by reciprocal slopes,
+// static sets keep dividing, see real.h
+#ifdef FUZZY_DIVISION_FREE
+#define OUTPUT_TOLERANCE 1e-9
+#else
+#define OUTPUT_TOLERANCE 0.0
+#endif
+
+// Both models give the same outputs on the whole grid
+static void testOutputs(const FuzzyModel_t *model) {
+    FuzzyState_t expectedState;
+    FuzzyState_t state;
+    FuzzyStateInit(&expectedState, model);
+    FuzzyStateInitBuffer(&state, &StaticTecFan, staticState);
+    // Both arrays of the state are aligned, whatever the number of values
+    CHECK(sizeof(staticState) == FuzzyStateSize(model));
+    CHECK((uintptr_t)state.values % _Alignof(FuzzyReal_t *) == 0);
+    CHECK((uintptr_t)state.buffer % _Alignof(FuzzyReal_t) == 0);
+
+    for (size_t p = 0; p < TECFAN_GRID_POINTS; p++) {
+        FuzzyReal_t point[4];
+        FuzzyReal_t exact;
+        FuzzyReal_t output;
+        tecFanGridPoint(p, point);
+        FuzzyEvaluate(model, &expectedState, point, &exact);
+        FuzzyEvaluate(&StaticTecFan, &state, point, &output);
+        CHECK_CLOSE(output, exact, OUTPUT_TOLERANCE);
+    }
+    FuzzyStateFree(&state);
+    FuzzyStateFree(&expectedState);
+}
+
+int main(void) {
+    const FuzzyModel_t *model = TecFanModel();
+    testLayout(model);
+    testOutputs(model);
+    return testResult("static");
+}
@@ -0,0 +1,123 @@
+/**
+ * @file test_stats.c
+ * @brief Tests the instrumentation across threads and caches.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ * The statistics only exist in builds with FUZZY_ENABLE_STATS:
+ * > make -C tests test DEFINES=-DFUZZY_ENABLE_STATS OUTPUT_DIR=out/stats
+ */
+
+#include "test.h"
+
+#ifdef FUZZY_ENABLE_STATS
+
+#include <string.h>
+
+// TecFanControl, see tecfan.c
+extern FuzzySet_t TemperatureState;
+
+static FuzzyReal_t inputs[TECFAN_GRID_POINTS * 4];
+static FuzzyReal_t outputs[TECFAN_GRID_POINTS];
+
+static FuzzyStats_t single;
+
+// A batch records as much as evaluating every row on the calling thread
+static void testBatch(const FuzzyModel_t *model) {
+    for (size_t p = 0; p < TECFAN_GRID_POINTS; p++) {
+        tecFanGridPoint(p, inputs + 4 * p);
+    }
+
+    FuzzyStatsReset();
+    FuzzyEvaluateBatch(model, inputs, outputs, TECFAN_GRID_POINTS, 1);
+    single = *FuzzyStatsGet();
+    CHECK(single.stages[FUZZY_STAGE_CLASSIFY].calls ==
+          (uint64_t)TECFAN_GRID_POINTS * model->numInputs);
+    CHECK(single.numSets == model->numInputs);
+
+    for (int threads = 2; threads <= 4; threads++) {
+        FuzzyStatsReset();
+        FuzzyEvaluateBatch(model, inputs, outputs, TECFAN_GRID_POINTS, threads);
+        const FuzzyStats_t *stats = FuzzyStatsGet();
+        for (int i = 0; i < FUZZY_STAGE_COUNT; i++) {
+            CHECK(stats->stages[i].calls == single.stages[i].calls);
+        }
+        CHECK(stats->numRules == single.numRules);
+        for (int r = 0; r < single.numRules; r++) {
+            CHECK(stats->rules[r].evaluations == single.rules[r].evaluations);
+            CHECK(stats->rules[r].fires == single.rules[r].fires);
+            CHECK(memcmp(stats->rules[r].histogram, single.rules[r].histogram,
+                         sizeof(single.rules[r].histogram)) == 0);
+        }
+        CHECK(stats->numSets == single.numSets);
+        for (int s = 0; s < stats->numSets; s++) {
+            for (int k = 0; k < single.numSets; k++) {
+                if (stats->sets[s].set != single.sets[k].set) {
+                    continue;
+                }
+                CHECK(stats->sets[s].classifications ==
+                      single.sets[k].classifications);
+                CHECK(memcmp(stats->sets[s].activations,
+                             single.sets[k].activations,
+                             sizeof(single.sets[k].activations)) == 0);
+            }
+        }
+    }
+}
+
+// Merging sums the counters, keeps the worst case and matches sets
+static void testMerge(void) {
+    static FuzzyStats_t stats;
+    static FuzzyStats_t doubled;
+    stats = single;
+    stats.stages[FUZZY_STAGE_CLASSIFY].maxTicks = 5;
+    doubled = single;
+    doubled.stages[FUZZY_STAGE_CLASSIFY].maxTicks = 7;
+    FuzzyStatsMerge(&doubled, &stats);
+
+    CHECK(doubled.stages[FUZZY_STAGE_CLASSIFY].calls ==
+          2 * single.stages[FUZZY_STAGE_CLASSIFY].calls);
+    CHECK(doubled.stages[FUZZY_STAGE_CLASSIFY].maxTicks == 7);
+    CHECK(doubled.numRules == single.numRules);
+    CHECK(doubled.rules[0].evaluations == 2 * single.rules[0].evaluations);
+    CHECK(doubled.numSets == single.numSets);
+    CHECK(doubled.sets[0].activations[0] == 2 * single.sets[0].activations[0]);
+}
+
+// Memo hits are recorded like classifications
+static void testMemo(void) {
+    FuzzySet_t set;
+    FuzzySetInit(&set, TemperatureState.membershipFunctions,
+                 TemperatureState.length);
+    CHECK(FuzzySetEnableMemo(&set, 16));
+
+    FuzzyStatsReset();
+    for (int i = 0; i < 3; i++) {
+        FuzzyClassifier(21.0, &set);
+    }
+    const FuzzyStats_t *stats = FuzzyStatsGet();
+    CHECK(set.memo->hits == 2);
+    CHECK(stats->stages[FUZZY_STAGE_CLASSIFY].calls == 3);
+    CHECK(stats->numSets == 1 && stats->sets[0].classifications == 3);
+    FuzzySetFree(&set);
+}
+
+int main(void) {
+    const FuzzyModel_t *model = TecFanModel();
+    testBatch(model);
+    testMerge();
+    testMemo();
+    return testResult("stats");
+}
+
+#else
+
+int main(void) {
+    printf("stats: skipped, build with -DFUZZY_ENABLE_STATS\n");
+    return 0;
+}
+
+#endif
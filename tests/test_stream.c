@@ -0,0 +1,85 @@
+/**
+ * @file test_stream.c
+ * @brief Tests evaluating rings of frames with a stream.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "test.h"
+
+// Frames per micro-batch, the grid does not divide into whole batches
+#define BATCH_SIZE 64
+
+/**
+ * Streams the TecFanControl grid, one frame per point, and compares every
+ * output frame to FuzzyEvaluate() on the same point.
+ */
+static void testAgainstEvaluate(const FuzzyModel_t *model, const char *name) {
+    static const FuzzyStreamInput_t inputs[] = {
+        {FUZZY_STREAM_CHANNEL, 0, 1.0},
+        {FUZZY_STREAM_CHANNEL, 1, 1.0},
+        {FUZZY_STREAM_CHANNEL, 2, 1.0},
+        {FUZZY_STREAM_CHANNEL, 3, 1.0},
+    };
+    FuzzyStream_t stream;
+    FuzzyRing_t input;
+    FuzzyRing_t output;
+    CHECK(FuzzyStreamInit(&stream, model, inputs, NULL, BATCH_SIZE));
+    CHECK(FuzzyRingInit(&input, 4, TECFAN_GRID_POINTS));
+    CHECK(FuzzyRingInit(&output, model->numOutputs, TECFAN_GRID_POINTS));
+
+    for (size_t p = 0; p < TECFAN_GRID_POINTS; p++) {
+        FuzzyReal_t point[4];
+        tecFanGridPoint(p, point);
+        CHECK(FuzzyRingPush(&input, point, 1) == 1);
+    }
+    CHECK(FuzzyStreamProcess(&stream, &input, &output) == TECFAN_GRID_POINTS);
+
+    FuzzyState_t state;
+    FuzzyStateInit(&state, model);
+    int mismatches = 0;
+    for (size_t p = 0; p < TECFAN_GRID_POINTS; p++) {
+        FuzzyReal_t point[4];
+        FuzzyReal_t streamed;
+        FuzzyReal_t exact;
+        tecFanGridPoint(p, point);
+        CHECK(FuzzyRingPop(&output, &streamed, 1) == 1);
+        FuzzyEvaluate(model, &state, point, &exact);
+        mismatches += streamed != exact && !(isnan(streamed) && isnan(exact));
+    }
+    if (mismatches != 0) {
+        fprintf(stderr, "stream: %s: %d outputs differ from FuzzyEvaluate()\n",
+                name, mismatches);
+    }
+    CHECK(mismatches == 0);
+
+    FuzzyStateFree(&state);
+    FuzzyRingFree(&output);
+    FuzzyRingFree(&input);
+    FuzzyStreamFree(&stream);
+}
+
+int main(void) {
+    const FuzzyModel_t *model = TecFanModel();
+    FuzzySet_t *const *sets = (FuzzySet_t *const *)model->program.sets;
+
+    testAgainstEvaluate(model, "dense");
+
+    // Layouts multiply by reciprocal slopes, partitions take precedence
+    for (int i = 0; i < model->numInputs; i++) {
+        CHECK(FuzzySetEnableLayout(sets[i]));
+    }
+    testAgainstEvaluate(model, "layout");
+#ifndef FUZZY_WCET
+    // FUZZY_WCET builds have no partition indexes
+    for (int i = 0; i < model->numInputs; i++) {
+        CHECK(FuzzySetEnablePartition(sets[i]));
+    }
+    testAgainstEvaluate(model, "partition");
+#endif
+    return testResult("stream");
+}
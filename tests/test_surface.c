@@ -0,0 +1,111 @@
+/**
+ * @file test_surface.c
+ * @brief Tests baking and interpolating control surfaces.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ */
+
+#include "test.h"
+
+static const FuzzyGridAxis_t axes[] = {
+    {0.0, 60.0, 13}, {-5.0, 5.0, 11}, {0.0, 100.0, 11}, {0.0, 100.0, 5}};
+
+// The grid points are baked exactly, including the upper ends of the axes
+static void testGridPoints(const FuzzyModel_t *model) {
+    FuzzySurface_t surface;
+    CHECK(FuzzyBakeSurface(&surface, model, axes, 2));
+
+    FuzzyState_t state;
+    FuzzyStateInit(&state, model);
+    for (int i = 0; i < axes[0].points; i++) {
+        for (int j = 0; j < axes[1].points; j++) {
+            for (int k = 0; k < axes[2].points; k++) {
+                for (int l = 0; l < axes[3].points; l++) {
+                    const int index[] = {i, j, k, l};
+                    FuzzyReal_t inputs[4];
+                    for (int a = 0; a < 4; a++) {
+                        inputs[a] = axes[a].min + (axes[a].max - axes[a].min) *
+                                                      index[a] /
+                                                      (axes[a].points - 1);
+                    }
+                    FuzzyReal_t exact;
+                    FuzzyReal_t interpolated;
+                    FuzzyEvaluate(model, &state, inputs, &exact);
+                    FuzzySurfaceEval(&surface, inputs, &interpolated);
+                    CHECK_CLOSE(interpolated, exact, 1e-9);
+                }
+            }
+        }
+    }
+
+    // Inputs outside of the grid are clamped
+    const FuzzyReal_t outside[] = {-100.0, 50.0, 1000.0, 100.0};
+    const FuzzyReal_t clamped[] = {0.0, 5.0, 100.0, 100.0};
+    FuzzyReal_t a;
+    FuzzyReal_t b;
+    FuzzySurfaceEval(&surface, outside, &a);
+    FuzzySurfaceEval(&surface, clamped, &b);
+    CHECK_CLOSE(a, b, 0.0);
+
+    FuzzySurfaceError_t report;
+    CHECK(FuzzySurfaceError(&surface, model, 7, &report));
+    CHECK(report.samples == 7 * 7 * 7 * 7);
+    CHECK(report.maxError >= report.meanError);
+    CHECK(report.rmsError >= report.meanError);
+    CHECK(!FuzzySurfaceError(&surface, model, 1, &report));
+
+    FuzzyStateFree(&state);
+    FuzzySurfaceFree(&surface);
+}
+
+// Invalid grids are rejected and leave an empty surface
+static void testInvalidGrids(const FuzzyModel_t *model) {
+    FuzzySurface_t surface;
+    FuzzyGridAxis_t invalid[FUZZY_SURFACE_MAX_INPUTS + 1];
+    for (int a = 0; a < 4; a++) {
+        invalid[a] = axes[a];
+    }
+
+    invalid[1].points = 1;
+    CHECK(!FuzzyBakeSurface(&surface, model, invalid, 1));
+    CHECK(surface.values == NULL && surface.numOutputs == 0);
+
+    // FuzzySurfaceEval() writes no outputs on an empty surface
+    const FuzzyReal_t inputs[] = {20.0, 0.0, 50.0, 50.0};
+    FuzzyReal_t output = 42.0;
+    FuzzySurfaceEval(&surface, inputs, &output);
+    CHECK(output == 42.0);
+    FuzzySurfaceError_t report;
+    CHECK(!FuzzySurfaceError(&surface, model, 3, &report));
+    FuzzySurfaceFree(&surface);
+
+    invalid[1] = axes[1];
+    invalid[2].max = invalid[2].min;
+    CHECK(!FuzzyBakeSurface(&surface, model, invalid, 1));
+    invalid[2].max = NAN;
+    CHECK(!FuzzyBakeSurface(&surface, model, invalid, 1));
+    invalid[2] = axes[2];
+
+    // A grid larger than the address space
+    invalid[0].points = 1 << 30;
+    invalid[1].points = 1 << 30;
+    invalid[2].points = 1 << 30;
+    CHECK(!FuzzyBakeSurface(&surface, model, invalid, 1));
+
+    // Models with more inputs than a surface holds, only the sizes are read
+    FuzzyModel_t wide = *model;
+    wide.numInputs = FUZZY_SURFACE_MAX_INPUTS + 1;
+    CHECK(!FuzzyBakeSurface(&surface, &wide, invalid, 1));
+    FuzzySurfaceFree(&surface);
+}
+
+int main(void) {
+    const FuzzyModel_t *model = TecFanModel();
+    testGridPoints(model);
+    testInvalidGrids(model);
+    return testResult("surface");
+}
@@ -0,0 +1,591 @@
+/**
+ * @file model_compiler.c
+ * @brief Compiles a text rule file into a binary model file.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ * The rule file declares the sets with their membership functions and the
+ * rules, using the same WHEN / ALL_OF / ANY_OF / THEN syntax as the C macros:
+ *
+ * > # comments start with '#' or '//'
+ * > input Temperature {
+ * >     LOW = TRAPEZOIDAL(-20.0, -20.0, 18.0, 25.0)
+ * >     MEDIUM = TRIANGULAR(18.0, 23.0, 35.0)
+ * >     HIGH = TRAPEZOIDAL(23.0, 35.0, 100.0, 100.0)
+ * > }
+ * > output FanSpeed { ... }
+ * > defuzzifier AREA
+ * > norm PRODUCT
+ * >
+ * > PROPOSITION(WHEN(ALL_OF(VAR(Temperature, HIGH), NOT(Fan, ON))),
+ * >             THEN(FanSpeed, FAST))
+ *
+ * Membership function labels are scoped to their set. The inputs of the model
+ * are the input sets in the order they are declared, followed by the outputs.
+ * The membership function types are those of MembershipFunctionType_e, with
+ * their parameters in order. The defuzzifier is WEIGHTED_CENTROIDS (the
+ * default), AREA or SINGLETONS. The operators combining the antecedents and
+ * the rules are those of FuzzyNorm_e: MIN_MAX (the default), PRODUCT,
+ * LUKASIEWICZ or HAMACHER.
+ *
+ * With -O the rules are optimized with FuzzyRulesOptimize() before they are
+ * compiled and the saved ops are reported:
+ *
+ * > model_compiler -O TecFanControl.fuzzy out/TecFanControl.fzm
+ *
+ * Dead rules are removed for every norm, the other passes only run for
+ * MIN_MAX, where they keep the outputs of the model exactly.
+ */
+
+#include "fuzzyc.h"
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_NAME 64
+
+typedef enum {
+    TOKEN_END,
+    TOKEN_NAME,
+    TOKEN_NUMBER,
+    TOKEN_PUNCT,
+} TokenType_e;
+
+typedef struct {
+    const char *text;
+    int line;
+    TokenType_e type;
+    char name[MAX_NAME];
+    double number;
+    char punct;
+} Lexer_t;
+
+typedef struct {
+    char name[MAX_NAME];
+    bool output;
+    char (*labels)[MAX_NAME];
+    MembershipFunction_t *functions;
+    int length;
+} SetDefinition_t;
+
+typedef struct {
+    int set;
+    int value;
+    bool invert;
+} VariableDefinition_t;
+
+typedef struct {
+    bool any;
+    VariableDefinition_t *variables;
+    int numVariables;
+} AntecedentDefinition_t;
+
+typedef struct {
+    AntecedentDefinition_t *antecedents;
+    int numAntecedents;
+    VariableDefinition_t consequent;
+} RuleDefinition_t;
+
+typedef struct {
+    Lexer_t lexer;
+    const char *path;
+    SetDefinition_t *sets;
+    int numSets;
+    RuleDefinition_t *rules;
+    int numRules;
+    FuzzyDefuzzifyMethod_e defuzzifier;
+    FuzzyNorm_e norm;
+} Parser_t;
+
+// The membership function types and their number of parameters
+static const struct {
+    const char *name;
+    MembershipFunctionType_e type;
+    int numParameters;
+} functionTypes[] = {
+    {"TRIANGULAR", TRIANGULAR, 3},
+    {"TRAPEZOIDAL", TRAPEZOIDAL, 4},
+    {"RECTANGULAR", RECTANGULAR, 2},
+    {"GAUSSIAN", GAUSSIAN, 2},
+    {"SIGMOID", SIGMOID, 2},
+    {"BELL", BELL, 3},
+    {"SINGLETON", SINGLETON, 1},
+};
+
+static void fail(const Parser_t *parser, const char *format, ...) {
+    va_list args;
+    fprintf(stderr, "%s:%d: error: ", parser->path, parser->lexer.line);
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+static void *grow(void *array, int count, size_t size) {
+    array = realloc(array, (count + 1) * size);
+    if (array == NULL) {
+        fprintf(stderr, "error: out of memory\n");
+        exit(1);
+    }
+    return array;
+}
+
+/**
+ * Reads the next token, skipping white space and comments.
+ */
+static void next(Parser_t *parser) {
+    Lexer_t *lexer = &parser->lexer;
+    const char *p = lexer->text;
+
+    for (;;) {
+        while (isspace((unsigned char)*p)) {
+            lexer->line += *p++ == '\n';
+        }
+        if (*p == '#' || (p[0] == '/' && p[1] == '/')) {
+            while (*p != '\0' && *p != '\n') {
+                p++;
+            }
+            continue;
+        }
+        break;
+    }
+
+    if (*p == '\0') {
+        lexer->type = TOKEN_END;
+    } else if (isalpha((unsigned char)*p) || *p == '_') {
+        int length = 0;
+        while (isalnum((unsigned char)*p) || *p == '_') {
+            if (length == MAX_NAME - 1) {
+                fail(parser, "name too long");
+            }
+            lexer->name[length++] = *p++;
+        }
+        lexer->name[length] = '\0';
+        lexer->type = TOKEN_NAME;
+    } else if (isdigit((unsigned char)*p) || *p == '-' || *p == '+' ||
+               *p == '.') {
+        char *end;
+        lexer->number = strtod(p, &end);
+        if (end == p) {
+            fail(parser, "malformed number");
+        }
+        p = end;
+        lexer->type = TOKEN_NUMBER;
+    } else if (strchr("(){},=", *p) != NULL) {
+        lexer->punct = *p++;
+        lexer->type = TOKEN_PUNCT;
+    } else {
+        fail(parser, "unexpected character '%c'", *p);
+    }
+    lexer->text = p;
+}
+
+static bool isPunct(const Parser_t *parser, char punct) {
+    return parser->lexer.type == TOKEN_PUNCT && parser->lexer.punct == punct;
+}
+
+static bool isName(const Parser_t *parser, const char *name) {
+    return parser->lexer.type == TOKEN_NAME &&
+           strcmp(parser->lexer.name, name) == 0;
+}
+
+static void expectPunct(Parser_t *parser, char punct) {
+    if (!isPunct(parser, punct)) {
+        fail(parser, "expected '%c'", punct);
+    }
+    next(parser);
+}
+
+static void expectName(Parser_t *parser, char *name) {
+    if (parser->lexer.type != TOKEN_NAME) {
+        fail(parser, "expected a name");
+    }
+    strcpy(name, parser->lexer.name);
+    next(parser);
+}
+
+static void expectKeyword(Parser_t *parser, const char *keyword) {
+    if (!isName(parser, keyword)) {
+        fail(parser, "expected %s", keyword);
+    }
+    next(parser);
+}
+
+static double expectNumber(Parser_t *parser) {
+    if (parser->lexer.type != TOKEN_NUMBER) {
+        fail(parser, "expected a number");
+    }
+    const double number = parser->lexer.number;
+    next(parser);
+    return number;
+}
+
+static int findSet(const Parser_t *parser, const char *name) {
+    for (int i = 0; i < parser->numSets; i++) {
+        if (strcmp(parser->sets[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int findLabel(const SetDefinition_t *set, const char *label) {
+    for (int i = 0; i < set->length; i++) {
+        if (strcmp(set->labels[i], label) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Parses a set declaration:
+ * ('input' | 'output') NAME '{' { LABEL '=' TYPE '(' numbers ')' } '}'
+ */
+static void parseSet(Parser_t *parser, bool output) {
+    SetDefinition_t set = {.output = output};
+
+    next(parser);
+    expectName(parser, set.name);
+    if (findSet(parser, set.name) >= 0) {
+        fail(parser, "set %s is already defined", set.name);
+    }
+    expectPunct(parser, '{');
+
+    while (!isPunct(parser, '}')) {
+        char label[MAX_NAME];
+        char type[MAX_NAME];
+        expectName(parser, label);
+        if (findLabel(&set, label) >= 0) {
+            fail(parser, "%s is already defined in %s", label, set.name);
+        }
+        expectPunct(parser, '=');
+        expectName(parser, type);
+
+        int t = 0;
+        const int numTypes = sizeof(functionTypes) / sizeof(functionTypes[0]);
+        while (t < numTypes && strcmp(functionTypes[t].name, type) != 0) {
+            t++;
+        }
+        if (t == numTypes) {
+            fail(parser, "unknown membership function type %s", type);
+        }
+
+        double parameters[4] = {0.0, 0.0, 0.0, 0.0};
+        expectPunct(parser, '(');
+        for (int i = 0; i < functionTypes[t].numParameters; i++) {
+            if (i > 0) {
+                expectPunct(parser, ',');
+            }
+            parameters[i] = expectNumber(parser);
+        }
+        expectPunct(parser, ')');
+
+        set.labels = grow(set.labels, set.length, sizeof(*set.labels));
+        set.functions = grow(set.functions, set.length,
+                             sizeof(MembershipFunction_t));
+        strcpy(set.labels[set.length], label);
+        set.functions[set.length] = (MembershipFunction_t){
+            .a = parameters[0],
+            .b = parameters[1],
+            .c = parameters[2],
+            .d = parameters[3],
+            .type = functionTypes[t].type};
+        set.length++;
+    }
+    next(parser);
+
+    if (set.length == 0) {
+        fail(parser, "set %s has no membership functions", set.name);
+    }
+    parser->sets = grow(parser->sets, parser->numSets, sizeof(set));
+    parser->sets[parser->numSets++] = set;
+}
+
+/**
+ * Parses a variable: '(' SET ',' LABEL ')'
+ */
+static VariableDefinition_t parseVariable(Parser_t *parser, bool invert) {
+    char setName[MAX_NAME];
+    char label[MAX_NAME];
+
+    next(parser);
+    expectPunct(parser, '(');
+    expectName(parser, setName);
+    expectPunct(parser, ',');
+    expectName(parser, label);
+    expectPunct(parser, ')');
+
+    const int set = findSet(parser, setName);
+    if (set < 0) {
+        fail(parser, "unknown set %s", setName);
+    }
+    const int value = findLabel(&parser->sets[set], label);
+    if (value < 0) {
+        fail(parser, "%s is not defined in %s", label, setName);
+    }
+    return (VariableDefinition_t){
+        .set = set, .value = value, .invert = invert};
+}
+
+/**
+ * Parses an antecedent: ('ALL_OF' | 'ANY_OF') '(' variable { ',' variable } ')'
+ * where a variable is VAR(...) or NOT(...)
+ */
+static AntecedentDefinition_t parseAntecedent(Parser_t *parser) {
+    AntecedentDefinition_t antecedent = {0};
+
+    if (isName(parser, "ANY_OF")) {
+        antecedent.any = true;
+    } else if (!isName(parser, "ALL_OF")) {
+        fail(parser, "expected ALL_OF or ANY_OF");
+    }
+    next(parser);
+    expectPunct(parser, '(');
+
+    do {
+        if (antecedent.numVariables > 0) {
+            next(parser);
+        }
+        bool invert = false;
+        if (isName(parser, "NOT")) {
+            invert = true;
+        } else if (!isName(parser, "VAR")) {
+            fail(parser, "expected VAR or NOT");
+        }
+        antecedent.variables =
+            grow(antecedent.variables, antecedent.numVariables,
+                 sizeof(VariableDefinition_t));
+        antecedent.variables[antecedent.numVariables++] =
+            parseVariable(parser, invert);
+    } while (isPunct(parser, ','));
+    expectPunct(parser, ')');
+
+    return antecedent;
+}
+
+/**
+ * Parses a rule:
+ * 'PROPOSITION' '(' 'WHEN' '(' antecedent { ',' antecedent } ')' ','
+ * 'THEN' '(' SET ',' LABEL ')' ')'
+ */
+static void parseRule(Parser_t *parser) {
+    RuleDefinition_t rule = {0};
+
+    next(parser);
+    expectPunct(parser, '(');
+    expectKeyword(parser, "WHEN");
+    expectPunct(parser, '(');
+    do {
+        if (rule.numAntecedents > 0) {
+            next(parser);
+        }
+        rule.antecedents = grow(rule.antecedents, rule.numAntecedents,
+                                sizeof(AntecedentDefinition_t));
+        rule.antecedents[rule.numAntecedents++] = parseAntecedent(parser);
+    } while (isPunct(parser, ','));
+    expectPunct(parser, ')');
+    expectPunct(parser, ',');
+
+    if (!isName(parser, "THEN")) {
+        fail(parser, "expected THEN");
+    }
+    rule.consequent = parseVariable(parser, false);
+    if (!parser->sets[rule.consequent.set].output) {
+        fail(parser, "%s is not an output",
+             parser->sets[rule.consequent.set].name);
+    }
+    expectPunct(parser, ')');
+
+    // Rules may be separated by commas as in a C rule table
+    if (isPunct(parser, ',')) {
+        next(parser);
+    }
+
+    parser->rules = grow(parser->rules, parser->numRules, sizeof(rule));
+    parser->rules[parser->numRules++] = rule;
+}
+
+static void parse(Parser_t *parser) {
+    next(parser);
+    while (parser->lexer.type != TOKEN_END) {
+        if (isName(parser, "input")) {
+            parseSet(parser, false);
+        } else if (isName(parser, "output")) {
+            parseSet(parser, true);
+        } else if (isName(parser, "defuzzifier")) {
+            next(parser);
+            if (isName(parser, "AREA")) {
+                parser->defuzzifier = FUZZY_DEFUZZIFY_AREA;
+            } else if (isName(parser, "WEIGHTED_CENTROIDS")) {
+                parser->defuzzifier = FUZZY_DEFUZZIFY_WEIGHTED_CENTROIDS;
+            } else if (isName(parser, "SINGLETONS")) {
+                parser->defuzzifier = FUZZY_DEFUZZIFY_SINGLETONS;
+            } else {
+                fail(parser,
+                     "expected WEIGHTED_CENTROIDS, AREA or SINGLETONS");
+            }
+            next(parser);
+        } else if (isName(parser, "norm")) {
+            next(parser);
+            if (isName(parser, "MIN_MAX")) {
+                parser->norm = FUZZY_NORM_MIN_MAX;
+            } else if (isName(parser, "PRODUCT")) {
+                parser->norm = FUZZY_NORM_PRODUCT;
+            } else if (isName(parser, "LUKASIEWICZ")) {
+                parser->norm = FUZZY_NORM_LUKASIEWICZ;
+            } else if (isName(parser, "HAMACHER")) {
+                parser->norm = FUZZY_NORM_HAMACHER;
+            } else {
+                fail(parser,
+                     "expected MIN_MAX, PRODUCT, LUKASIEWICZ or HAMACHER");
+            }
+            next(parser);
+        } else if (isName(parser, "PROPOSITION")) {
+            parseRule(parser);
+        } else {
+            fail(parser,
+                 "expected input, output, defuzzifier, norm or PROPOSITION");
+        }
+    }
+
+    if (parser->numRules == 0) {
+        fail(parser, "no rules");
+    }
+}
+
+static char *readFile(const char *path) {
+    FILE *stream = fopen(path, "rb");
+    if (stream == NULL) {
+        return NULL;
+    }
+
+    char *text = NULL;
+    size_t length = 0;
+    size_t capacity = 0;
+    size_t count;
+    do {
+        if (length + 4096 + 1 > capacity) {
+            capacity = 2 * capacity + 4096 + 1;
+            text = grow(text, 0, capacity);
+        }
+        count = fread(text + length, 1, capacity - length - 1, stream);
+        length += count;
+    } while (count > 0);
+    fclose(stream);
+
+    text[length] = '\0';
+    return text;
+}
+
+int main(int argc, char *argv[]) {
+    const bool optimize = argc == 4 && strcmp(argv[1], "-O") == 0;
+    if (argc != 3 && !optimize) {
+        printf("Usage: %s [-O] <rules> <model>\n", argv[0]);
+        return 1;
+    }
+    const char *rulesPath = argv[argc - 2];
+    const char *modelPath = argv[argc - 1];
+
+    char *text = readFile(rulesPath);
+    if (text == NULL) {
+        fprintf(stderr, "error: can not read %s\n", rulesPath);
+        return 1;
+    }
+
+    Parser_t parser = {.lexer = {.text = text, .line = 1}, .path = rulesPath};
+    parse(&parser);
+
+    // Build the sets and rules and compile them like any other model
+    FuzzySet_t *sets = calloc(parser.numSets, sizeof(FuzzySet_t));
+    const FuzzySet_t **inputs = calloc(parser.numSets, sizeof(FuzzySet_t *));
+    const FuzzySet_t **outputs = calloc(parser.numSets, sizeof(FuzzySet_t *));
+    int numInputs = 0;
+    int numOutputs = 0;
+    for (int i = 0; i < parser.numSets; i++) {
+        const SetDefinition_t *set = &parser.sets[i];
+        FuzzySetInit(&sets[i], set->functions, set->length);
+        if (set->output) {
+            outputs[numOutputs++] = &sets[i];
+        } else {
+            inputs[numInputs++] = &sets[i];
+        }
+    }
+
+    FuzzyRule_t *rules = calloc(parser.numRules, sizeof(FuzzyRule_t));
+    for (int r = 0; r < parser.numRules; r++) {
+        const RuleDefinition_t *definition = &parser.rules[r];
+        FuzzyRule_t *rule = &rules[r];
+
+        rule->num_antecedents = definition->numAntecedents;
+        rule->antecedent =
+            calloc(definition->numAntecedents, sizeof(FuzzyAntecedent_t));
+        for (int a = 0; a < definition->numAntecedents; a++) {
+            const AntecedentDefinition_t *antecedent =
+                &definition->antecedents[a];
+            FuzzyAntecedent_t *target = &rule->antecedent[a];
+
+            target->fuzzy_operator =
+                antecedent->any ? FUZZY_ANY_OF : FUZZY_ALL_OF;
+            target->num_variables = antecedent->numVariables;
+            target->variables =
+                calloc(antecedent->numVariables, sizeof(FuzzyVariable_t));
+            for (int v = 0; v < antecedent->numVariables; v++) {
+                const VariableDefinition_t *variable =
+                    &antecedent->variables[v];
+                target->variables[v] = (FuzzyVariable_t){
+                    .variable = &sets[variable->set],
+                    .value = variable->value,
+                    .invert = variable->invert};
+            }
+        }
+        rule->consequent = (FuzzyVariable_t){
+            .variable = &sets[definition->consequent.set],
+            .value = definition->consequent.value};
+    }
+
+    int numRules = parser.numRules;
+    FuzzyRuleBase_t base = {0};
+    if (optimize) {
+        const int passes = parser.norm == FUZZY_NORM_MIN_MAX
+                               ? FUZZY_OPTIMIZE_ALL
+                               : FUZZY_OPTIMIZE_DEAD;
+        if (!FuzzyRulesOptimize(&base, rules, numRules, passes)) {
+            fprintf(stderr, "error: out of memory\n");
+            return 1;
+        }
+        printOptimizeReport(&base.report);
+        rules = base.rules;
+        numRules = base.numRules;
+    }
+
+    FuzzyModel_t model;
+    if (!FuzzyModelInit(&model, rules, numRules, inputs, numInputs, outputs,
+                        numOutputs)) {
+        fprintf(stderr, "error: can not compile the rules, more than %d sets "
+                        "or membership functions per set\n",
+                UINT16_MAX);
+        return 1;
+    }
+    model.defuzzifier = parser.defuzzifier;
+    model.program.norm = parser.norm;
+
+    if (!FuzzyModelSave(&model, modelPath)) {
+        fprintf(stderr, "error: can not write %s\n", modelPath);
+        return 1;
+    }
+    printf("%s: %d inputs, %d outputs, %d rules, %zu bytes\n", modelPath,
+           numInputs, numOutputs, numRules, FuzzyModelImageSize(&model));
+
+    // The process exits right away, so only the model is released
+    FuzzyModelFree(&model);
+    return 0;
+}
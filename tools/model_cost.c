@@ -0,0 +1,82 @@
+/**
+ * @file model_cost.c
+ * @brief Prints the worst case cost of evaluating a binary model file.
+ * @author Robin Prilliwtz
+ * @date 2024
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * See LICENSE.txt file for details.
+ *
+ * The model is analyzed with FuzzyModelCost(), which counts the membership
+ * functions, program ops and primitive operations of one FuzzyEvaluate() in a
+ * FUZZY_WCET build, and the counts are weighted with cycles per primitive:
+ *
+ * > model_cost out/TecFanControl.fzm div=32 math=120 budget=20000
+ *
+ * The cycles default to FUZZY_COST_DEFAULT_CYCLES, every primitive can be
+ * overridden with <primitive>=<cycles> (add, mul, div, compare, load, store,
+ * branch, math). With budget=<cycles> the tool exits with status 2 if the
+ * cycle bound exceeds the budget, e.g. the cycles of one control period.
+ */
+
+#include "fuzzyc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <model> [<primitive>=<cycles>]... "
+               "[budget=<cycles>]\n",
+               argv[0]);
+        return 1;
+    }
+
+    uint32_t cycles[FUZZY_NUM_COSTS] = FUZZY_COST_DEFAULT_CYCLES;
+    unsigned long long budget = 0;
+    for (int i = 2; i < argc; i++) {
+        char name[16];
+        unsigned long long value;
+        if (sscanf(argv[i], "%15[a-z]=%llu", name, &value) != 2) {
+            fprintf(stderr, "error: expected <primitive>=<cycles>, got %s\n",
+                    argv[i]);
+            return 1;
+        }
+        if (strcmp(name, "budget") == 0) {
+            budget = value;
+            continue;
+        }
+        const int primitive = FuzzyCostPrimitive(name);
+        if (primitive < 0) {
+            fprintf(stderr, "error: unknown primitive %s\n", name);
+            return 1;
+        }
+        cycles[primitive] = (uint32_t)value;
+    }
+
+    FuzzyModelFile_t file;
+    if (!FuzzyModelOpen(&file, argv[1])) {
+        fprintf(stderr, "error: can not load %s\n", argv[1]);
+        return 1;
+    }
+
+    const FuzzyModel_t *model = &file.model;
+    printf("%s: %d inputs, %d outputs, %d ops\n", argv[1], model->numInputs,
+           model->numOutputs, model->program.numOps);
+    FuzzyCost_t cost;
+    FuzzyModelCost(model, &cost);
+    FuzzyCostPrint(&cost, cycles);
+
+    const uint64_t bound = FuzzyCostCycles(&cost, cycles);
+    FuzzyModelClose(&file);
+
+    if (budget != 0) {
+        printf("budget: %llu, %s\n", budget,
+               bound <= budget ? "met" : "exceeded");
+        if (bound > budget) {
+            return 2;
+        }
+    }
+    return 0;
+}